@@ -0,0 +1,681 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file batch.c
+ * \author Anamitra Ghorui
+ * \brief Evaluation of an expression over columns of values
+ *
+ */
+
+#include "batch.h"
+#include "infer.h"
+#include "kernel.h"
+#include "real.h"
+#include "std.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/// Most arguments of a builtin called on columns.
+#define CA_BATCH_ARGS 8
+
+/// A stack slot: a value for each row of a chunk.
+typedef CaReal CaBatchSlot[CA_BATCH_ROWS];
+
+/* Applies a binary operator to a and b in every row, and pops b. */
+#define BINARY(_expr) do {                              \
+        for (i = 0; i < n; i++) {                       \
+            CaReal a = sp[-2][i];                       \
+            CaReal b = sp[-1][i];                       \
+            sp[-2][i] = (_expr);                        \
+        }                                               \
+        sp--;                                           \
+    } while (0)
+
+/*
+ * Applies operator _op, which is kernel _kop, to a and b in every row and
+ * pops b, or to b and constant or variable arg. When CaReal is a double the
+ * kernels are used, and otherwise the rows are looped over here.
+ */
+#ifdef CA_REAL_DOUBLE
+#define BINARY_REAL(_kop, _op) do {                                     \
+        k->d_vv[CA_KERNEL_##_kop](sp[-2], sp[-2], sp[-1], n);           \
+        sp--;                                                           \
+    } while (0)
+
+#define BINARY_CONST(_kop, _op)                                         \
+    k->d_vs[CA_KERNEL_##_kop](sp[-1], sp[-1], code->consts[ip->arg], n)
+
+#define BINARY_VAR(_kop, _op) do {                                      \
+        v = ca_batch_var(c, cols, ip->arg, start, n, buf);              \
+        k->d_vv[CA_KERNEL_##_kop](sp[-1], sp[-1], v, n);                \
+    } while (0)
+#else
+#define BINARY_REAL(_kop, _op) BINARY(a _op b)
+
+#define BINARY_CONST(_kop, _op) do {                    \
+        value = code->consts[ip->arg];                  \
+        for (i = 0; i < n; i++)                         \
+            sp[-1][i] = sp[-1][i] _op value;            \
+    } while (0)
+
+#define BINARY_VAR(_kop, _op) do {                              \
+        v = ca_batch_var(c, cols, ip->arg, start, n, buf);      \
+        for (i = 0; i < n; i++)                                 \
+            sp[-1][i] = sp[-1][i] _op v[i];                     \
+    } while (0)
+#endif
+
+/* The CaInt values of a stack slot. */
+#define INTS(_slot) ((CaInt *) (_slot))
+
+/* Fails with CA_ERROR_EVAL_OVERFLOW if kernel _op overflows on any row of
+ * CaInt _a and _b, or _a and scalar _bs if _b is NULL. */
+#define OVERFLOW_CHECK(_op, _a, _b, _bs) do {                           \
+        if (ca_batch_overflows(CA_KERNEL_##_op, (_a), (_b), (_bs), n)) { \
+            err = CA_ERROR_EVAL_OVERFLOW;                               \
+            goto done;                                                  \
+        }                                                               \
+    } while (0)
+
+/* Applies kernel _op to CaInt a and b in every row, and pops b. */
+#define BINARY_INT(_op) do {                                            \
+        OVERFLOW_CHECK(_op, INTS(sp[-2]), INTS(sp[-1]), 0);             \
+        k->i_vv[CA_KERNEL_##_op](INTS(sp[-2]), INTS(sp[-2]),            \
+                                 INTS(sp[-1]), n);                      \
+        sp--;                                                           \
+    } while (0)
+
+/* Applies kernel _op to CaInt b and constant arg in every row. */
+#define BINARY_INT_CONST(_op) do {                                      \
+        OVERFLOW_CHECK(_op, INTS(sp[-1]), NULL, code->iconsts[ip->arg]); \
+        k->i_vs[CA_KERNEL_##_op](INTS(sp[-1]), INTS(sp[-1]),            \
+                                 code->iconsts[ip->arg], n);            \
+    } while (0)
+
+/* Applies kernel _op to CaInt _slot and variable _var in every row, which
+ * is only read as a column if it has one. */
+#define BINARY_INT_VAR(_op, _slot, _var) do {                           \
+        if (cols[_var]) {                                               \
+            iv = (const CaInt *) cols[_var]->data + start;              \
+            OVERFLOW_CHECK(_op, INTS(_slot), iv, 0);                    \
+            k->i_vv[CA_KERNEL_##_op](INTS(_slot), INTS(_slot), iv, n);  \
+        } else {                                                        \
+            OVERFLOW_CHECK(_op, INTS(_slot), NULL,                      \
+                           ca_var_int(&c->vars[_var]));                 \
+            k->i_vs[CA_KERNEL_##_op](INTS(_slot), INTS(_slot),          \
+                                     ca_var_int(&c->vars[_var]), n);    \
+        }                                                               \
+    } while (0)
+
+/*
+ * Whether kernel op overflows on any of n rows of a and b, or of a and
+ * scalar bs if b is NULL. Of the kernels, only sums, differences and
+ * products can, besides remainders by 0, which are an error. The chunk is
+ * then run again row by row, on exact integers (see exact.h).
+ */
+static int ca_batch_overflows(CaKernelOp op, const CaInt *a, const CaInt *b,
+                              CaInt bs, CaSize n)
+{
+    CaInt r;
+    int o = 0;
+
+#define CHECK_ROWS(_op) do {                                            \
+        if (b)                                                          \
+            for (CaSize i = 0; i < n; i++)                              \
+                o |= __builtin_##_op##_overflow(a[i], b[i], &r);        \
+        else                                                            \
+            for (CaSize i = 0; i < n; i++)                              \
+                o |= __builtin_##_op##_overflow(a[i], bs, &r);          \
+    } while (0)
+
+    switch (op) {
+    case CA_KERNEL_ADD:
+        CHECK_ROWS(add);
+        break;
+    case CA_KERNEL_SUB:
+        CHECK_ROWS(sub);
+        break;
+    case CA_KERNEL_MUL:
+        CHECK_ROWS(mul);
+        break;
+    case CA_KERNEL_REM:
+        for (CaSize i = 0; i < n; i++)
+            o |= (b ? b[i] : bs) == 0;
+        break;
+    default:
+        break;
+    }
+#undef CHECK_ROWS
+    return o;
+}
+
+/* Raises n rows of CaInt a to the power of b, or of scalar bs if b is NULL,
+ * and gives whether any of them is not a CaInt. */
+static int ca_batch_power(CaInt *a, const CaInt *b, CaInt bs, CaSize n)
+{
+    int o = 0;
+
+    for (CaSize i = 0; i < n; i++)
+        o |= ca_std_int_pow(a[i], b ? b[i] : bs, &a[i]);
+    return o;
+}
+
+/* Whether code can be run on whole chunks. */
+static int ca_batch_can_run(const CaCode *code)
+{
+    for (CaSize i = 0; i < code->count; i++) {
+        switch ((CaOpcode) code->instrs[i].op) {
+        case CA_OPCODE_STORE:
+        case CA_OPCODE_POST_INC:
+        case CA_OPCODE_POST_DEC:
+        case CA_OPCODE_INC_VAR:
+        case CA_OPCODE_STORE_POP:
+        case CA_OPCODE_I_STORE:
+        case CA_OPCODE_I_POST_INC:
+        case CA_OPCODE_I_POST_DEC:
+        case CA_OPCODE_I_INC_VAR:
+        case CA_OPCODE_I_STORE_POP:
+            return 0;
+        case CA_OPCODE_EXT_CALL:
+            if (code->instrs[i].n > CA_BATCH_ARGS)
+                return 0;
+            break;
+        default:
+            if (CA_OPCODE_ISJUMP(code->instrs[i].op))
+                return 0;
+        }
+    }
+    return code->depth > 0;
+}
+
+/*
+ * The values of variable name in rows start to start + n. A CaReal column is
+ * read in place, and anything else is written to buf.
+ */
+static const CaReal *ca_batch_var(const CaContext *c, const CaColumn *const *cols,
+                                  CaSymbol name, CaSize start, CaSize n,
+                                  CaReal *buf)
+{
+    const CaColumn *col = cols[name];
+    const CaInt *ints;
+    CaReal value;
+
+    if (col && col->type == CA_TYPE_REAL)
+        return (const CaReal *) col->data + start;
+    if (col) {
+        ints = (const CaInt *) col->data + start;
+        for (CaSize i = 0; i < n; i++)
+            buf[i] = ints[i];
+        return buf;
+    }
+    value = ca_std_real(&c->vars[name]);
+    for (CaSize i = 0; i < n; i++)
+        buf[i] = value;
+    return buf;
+}
+
+/* Checks that every variable code reads is set, or has a column, and that
+ * every builtin it calls exists. */
+static CaError ca_batch_check(CaContext *c, const CaCode *code,
+                              const CaColumn *const *cols)
+{
+    const CaInstr *ip;
+    const CaBuiltin *f;
+
+    for (CaSize i = 0; i < code->count; i++) {
+        ip = &code->instrs[i];
+        if ((ip->op == CA_OPCODE_LOAD || (ip->op >= CA_OPCODE_ADD_VAR &&
+             ip->op <= CA_OPCODE_DIV_VAR) || ip->op == CA_OPCODE_MUL_ADD_VAR)
+            && !cols[ip->arg] &&
+            ca_var_is(&c->vars[ip->arg], CA_TYPE_UNKNOWN)) {
+            c->error = ca_symbols_name(&c->symbols, ip->arg, &c->error_size);
+            return CA_ERROR_HASH_NOTFOUND;
+        }
+        if (ip->op == CA_OPCODE_EXT_CALL) {
+            f = ip->arg < c->nfuncs ? &c->funcs[ip->arg] : NULL;
+            if (!f || !f->func || f->nargs != ip->n) {
+                c->error = ca_symbols_name(&c->symbols, ip->arg,
+                                           &c->error_size);
+                return f && f->func ? CA_ERROR_EVAL_ARGS :
+                                      CA_ERROR_EVAL_UNKNOWN_FUNCTION;
+            }
+        }
+    }
+    return CA_ERROR_OK;
+}
+
+/*
+ * Runs code, which may be typed code leaving a value of CaType type, on every
+ * chunk of rows. CaInt values take the first half of the slots they are in,
+ * so converting a slot to CaReal goes from the last row down, and to CaInt
+ * from the first row up, each reading a row before writing over it.
+ */
+static CaError ca_batch_run(CaContext *c, const CaCode *code, uint8_t type,
+                            const CaColumn *const *cols, CaSize rows,
+                            CaReal *out, CaSize *ran)
+{
+    const CaKernels *k = ca_kernels(CA_KERNEL_IMPL_AUTO);
+    CaBatchSlot *stack, *sp, *temps;
+    CaReal buf[CA_BATCH_ROWS], args[CA_BATCH_ARGS], value;
+    const CaReal *v;
+    const CaInstr *ip;
+    const CaBuiltin *f;
+    const CaInt *iv;
+    CaInt *ints;
+    CaSize start, n, i;
+    CaError err = CA_ERROR_OK;
+
+    if (!(stack = malloc((code->depth + code->ntemps) * sizeof(CaBatchSlot))))
+        return CA_ERROR_MEM;
+    temps = stack + code->depth;
+
+    for (start = 0; start < rows; start += n) {
+        n = rows - start < CA_BATCH_ROWS ? rows - start : CA_BATCH_ROWS;
+        sp = stack;
+        for (ip = code->instrs; ip->op != CA_OPCODE_END; ip++) {
+            switch ((CaOpcode) ip->op) {
+            case CA_OPCODE_PUSH_CONST:
+                value = code->consts[ip->arg];
+                for (i = 0; i < n; i++)
+                    sp[0][i] = value;
+                sp++;
+                break;
+            case CA_OPCODE_LOAD:
+                v = ca_batch_var(c, cols, ip->arg, start, n, sp[0]);
+                if (v != sp[0])
+                    memcpy(sp[0], v, n * sizeof(CaReal));
+                sp++;
+                break;
+            case CA_OPCODE_POP:
+                sp--;
+                break;
+
+            case CA_OPCODE_POWER:
+                BINARY(ca_real_pow(a, b));
+                break;
+            case CA_OPCODE_MULTIPLICATION:
+                BINARY_REAL(MUL, *);
+                break;
+            case CA_OPCODE_DIVISION:
+                BINARY_REAL(DIV, /);
+                break;
+            case CA_OPCODE_REMAINDER:
+                BINARY(ca_real_fmod(a, b));
+                break;
+            case CA_OPCODE_ADDITION:
+                BINARY_REAL(ADD, +);
+                break;
+            case CA_OPCODE_SUBTRACTION:
+                BINARY_REAL(SUB, -);
+                break;
+            case CA_OPCODE_LSHIFT:
+                BINARY((CaInt) ((CaUint) ca_real_to_int(a) <<
+                                (ca_real_to_int(b) & 63)));
+                break;
+            case CA_OPCODE_RSHIFT:
+                BINARY(ca_real_to_int(a) >> (ca_real_to_int(b) & 63));
+                break;
+            case CA_OPCODE_LT:
+                BINARY_REAL(LT, <);
+                break;
+            case CA_OPCODE_LTEQ:
+                BINARY_REAL(LTEQ, <=);
+                break;
+            case CA_OPCODE_GT:
+                BINARY_REAL(GT, >);
+                break;
+            case CA_OPCODE_GTEQ:
+                BINARY_REAL(GTEQ, >=);
+                break;
+            case CA_OPCODE_EQ:
+                BINARY_REAL(EQ, ==);
+                break;
+            case CA_OPCODE_NEQ:
+                BINARY_REAL(NEQ, !=);
+                break;
+            case CA_OPCODE_B_AND:
+                BINARY(ca_real_to_int(a) & ca_real_to_int(b));
+                break;
+            case CA_OPCODE_B_XOR:
+                BINARY(ca_real_to_int(a) ^ ca_real_to_int(b));
+                break;
+            case CA_OPCODE_B_OR:
+                BINARY(ca_real_to_int(a) | ca_real_to_int(b));
+                break;
+            case CA_OPCODE_BOOL:
+                for (i = 0; i < n; i++)
+                    sp[-1][i] = sp[-1][i] != 0;
+                break;
+
+            /* Builtins take their arguments as an array, so are called a
+             * row at a time. */
+            case CA_OPCODE_EXT_CALL:
+                f = &c->funcs[ip->arg];
+                sp -= ip->n;
+                for (i = 0; i < n; i++) {
+                    for (CaSize j = 0; j < ip->n; j++)
+                        args[j] = sp[j][i];
+                    sp[0][i] = f->func(args);
+                }
+                sp++;
+                break;
+
+            case CA_OPCODE_ADD_CONST:
+                BINARY_CONST(ADD, +);
+                break;
+            case CA_OPCODE_SUB_CONST:
+                BINARY_CONST(SUB, -);
+                break;
+            case CA_OPCODE_MUL_CONST:
+                BINARY_CONST(MUL, *);
+                break;
+            case CA_OPCODE_DIV_CONST:
+                BINARY_CONST(DIV, /);
+                break;
+            case CA_OPCODE_ADD_VAR:
+                BINARY_VAR(ADD, +);
+                break;
+            case CA_OPCODE_SUB_VAR:
+                BINARY_VAR(SUB, -);
+                break;
+            case CA_OPCODE_MUL_VAR:
+                BINARY_VAR(MUL, *);
+                break;
+            case CA_OPCODE_DIV_VAR:
+                BINARY_VAR(DIV, /);
+                break;
+            case CA_OPCODE_MUL_ADD:
+                for (i = 0; i < n; i++)
+                    sp[-3][i] = sp[-3][i] + sp[-2][i] * sp[-1][i];
+                sp -= 2;
+                break;
+            case CA_OPCODE_MUL_ADD_VAR:
+                v = ca_batch_var(c, cols, ip->arg, start, n, buf);
+                for (i = 0; i < n; i++)
+                    sp[-2][i] = sp[-2][i] + sp[-1][i] * v[i];
+                sp--;
+                break;
+            case CA_OPCODE_SQUARE:
+                for (i = 0; i < n; i++)
+                    sp[-1][i] = sp[-1][i] * sp[-1][i];
+                break;
+            case CA_OPCODE_CUBE:
+                for (i = 0; i < n; i++)
+                    sp[-1][i] = sp[-1][i] * sp[-1][i] * sp[-1][i];
+                break;
+
+            case CA_OPCODE_SAVE_TEMP:
+                memcpy(temps[ip->arg], sp[-1], n * sizeof(CaReal));
+                break;
+            case CA_OPCODE_LOAD_TEMP:
+                memcpy(sp[0], temps[ip->arg], n * sizeof(CaReal));
+                sp++;
+                break;
+
+            case CA_OPCODE_I_PUSH_CONST:
+                for (i = 0, ints = INTS(sp[0]); i < n; i++)
+                    ints[i] = code->iconsts[ip->arg];
+                sp++;
+                break;
+            case CA_OPCODE_I_LOAD:
+                ints = INTS(sp[0]);
+                if (cols[ip->arg])
+                    memcpy(ints, (const CaInt *) cols[ip->arg]->data + start,
+                           n * sizeof(CaInt));
+                else
+                    for (i = 0; i < n; i++)
+                        ints[i] = ca_var_int(&c->vars[ip->arg]);
+                sp++;
+                break;
+
+            case CA_OPCODE_I_POWER:
+                if (ca_batch_power(INTS(sp[-2]), INTS(sp[-1]), 0, n)) {
+                    err = CA_ERROR_EVAL_OVERFLOW;
+                    goto done;
+                }
+                sp--;
+                break;
+            case CA_OPCODE_I_MULTIPLICATION:
+                BINARY_INT(MUL);
+                break;
+            case CA_OPCODE_I_REMAINDER:
+                BINARY_INT(REM);
+                break;
+            case CA_OPCODE_I_ADDITION:
+                BINARY_INT(ADD);
+                break;
+            case CA_OPCODE_I_SUBTRACTION:
+                BINARY_INT(SUB);
+                break;
+            case CA_OPCODE_I_LSHIFT:
+                BINARY_INT(LSHIFT);
+                break;
+            case CA_OPCODE_I_RSHIFT:
+                BINARY_INT(RSHIFT);
+                break;
+            case CA_OPCODE_I_LT:
+                BINARY_INT(LT);
+                break;
+            case CA_OPCODE_I_LTEQ:
+                BINARY_INT(LTEQ);
+                break;
+            case CA_OPCODE_I_GT:
+                BINARY_INT(GT);
+                break;
+            case CA_OPCODE_I_GTEQ:
+                BINARY_INT(GTEQ);
+                break;
+            case CA_OPCODE_I_EQ:
+                BINARY_INT(EQ);
+                break;
+            case CA_OPCODE_I_NEQ:
+                BINARY_INT(NEQ);
+                break;
+            case CA_OPCODE_I_B_AND:
+                BINARY_INT(B_AND);
+                break;
+            case CA_OPCODE_I_B_XOR:
+                BINARY_INT(B_XOR);
+                break;
+            case CA_OPCODE_I_B_OR:
+                BINARY_INT(B_OR);
+                break;
+            case CA_OPCODE_I_BOOL:
+                k->i_vs[CA_KERNEL_NEQ](INTS(sp[-1]), INTS(sp[-1]), 0, n);
+                break;
+
+            case CA_OPCODE_I_ADD_CONST:
+                BINARY_INT_CONST(ADD);
+                break;
+            case CA_OPCODE_I_SUB_CONST:
+                BINARY_INT_CONST(SUB);
+                break;
+            case CA_OPCODE_I_MUL_CONST:
+                BINARY_INT_CONST(MUL);
+                break;
+            case CA_OPCODE_I_ADD_VAR:
+                BINARY_INT_VAR(ADD, sp[-1], ip->arg);
+                break;
+            case CA_OPCODE_I_SUB_VAR:
+                BINARY_INT_VAR(SUB, sp[-1], ip->arg);
+                break;
+            case CA_OPCODE_I_MUL_VAR:
+                BINARY_INT_VAR(MUL, sp[-1], ip->arg);
+                break;
+            case CA_OPCODE_I_MUL_ADD:
+                BINARY_INT(MUL);
+                BINARY_INT(ADD);
+                break;
+            case CA_OPCODE_I_MUL_ADD_VAR:
+                BINARY_INT_VAR(MUL, sp[-1], ip->arg);
+                BINARY_INT(ADD);
+                break;
+            case CA_OPCODE_I_SQUARE:
+                ints = INTS(sp[-1]);
+                OVERFLOW_CHECK(MUL, ints, ints, 0);
+                k->i_vv[CA_KERNEL_MUL](ints, ints, ints, n);
+                break;
+            case CA_OPCODE_I_CUBE:
+                if (ca_batch_power(INTS(sp[-1]), NULL, 3, n)) {
+                    err = CA_ERROR_EVAL_OVERFLOW;
+                    goto done;
+                }
+                break;
+
+            case CA_OPCODE_TO_REAL:
+                ints = INTS(sp[-(CaSize) ip->arg]);
+                for (i = n; i-- > 0;)
+                    sp[-(CaSize) ip->arg][i] = ints[i];
+                break;
+            case CA_OPCODE_TO_INT:
+                ints = INTS(sp[-(CaSize) ip->arg]);
+                for (i = 0; i < n; i++)
+                    ints[i] = ca_real_to_int(sp[-(CaSize) ip->arg][i]);
+                break;
+
+            default:
+                err = CA_ERROR_EVAL_UNSUPPORTED;
+                goto done;
+            }
+        }
+        if (type == CA_TYPE_INT)
+            for (ints = INTS(stack[0]), i = n; i-- > 0;)
+                stack[0][i] = ints[i];
+        memcpy(out + start, stack[0], n * sizeof(CaReal));
+    }
+
+done:
+    *ran = start;
+    free(stack);
+    return err;
+}
+
+/* Sets the variables of the columns to the values of a row. */
+static CaError ca_batch_set(CaContext *c, const CaColumn *columns,
+                            CaSize ncolumns, CaSize row)
+{
+    const CaColumn *col;
+    CaVar v = CA_VAR_UNKNOWN;
+    CaError err;
+
+    for (CaSize j = 0; j < ncolumns; j++) {
+        col = &columns[j];
+        if (col->type == CA_TYPE_INT) {
+            if ((err = ca_std_set_int(&v, ((const CaInt *) col->data)[row]))
+                != CA_ERROR_OK)
+                return err;
+        } else {
+            ca_var_set_real(&v, ((const CaReal *) col->data)[row]);
+        }
+        if ((err = ca_context_set(c, col->name, &v)) != CA_ERROR_OK)
+            return err;
+    }
+    return CA_ERROR_OK;
+}
+
+/* Runs code with ca_run for each row from start. */
+static CaError ca_batch_run_rows(CaContext *c, const CaCode *code,
+                                 const CaColumn *columns, CaSize ncolumns,
+                                 CaSize start, CaSize rows, CaReal *out)
+{
+    CaError err = CA_ERROR_OK;
+
+    for (CaSize i = start; i < rows && err == CA_ERROR_OK; i++)
+        if ((err = ca_batch_set(c, columns, ncolumns, i)) == CA_ERROR_OK)
+            err = ca_run(c, code, &out[i]);
+    return err;
+}
+
+/*
+ * Runs code on whole chunks of rows. CaInt operators are run with kernels
+ * (see kernel.h), on the typed code of the code for the types of the
+ * columns, if it has any.
+ */
+static CaError ca_batch_run_chunks(CaContext *c, const CaCode *code,
+                                   const CaColumn *columns, CaSize ncolumns,
+                                   CaSize rows, CaReal *out)
+{
+    const CaColumn **cols;
+    const CaCode *run = code;
+    uint8_t type = CA_TYPE_REAL;
+    CaCode copy;
+    CaSize ran;
+    CaError err;
+
+    if (!(cols = calloc(c->nvars + 1, sizeof(*cols))))
+        return CA_ERROR_MEM;
+    for (CaSize j = 0; j < ncolumns; j++)
+        cols[columns[j].name] = &columns[j];
+    if ((err = ca_batch_check(c, code, cols)) != CA_ERROR_OK) {
+        free(cols);
+        return err;
+    }
+
+    ca_code_init(&copy);
+    if ((err = ca_batch_set(c, columns, ncolumns, 0)) != CA_ERROR_OK) {
+        free(cols);
+        return err;
+    }
+    if ((err = ca_code_copy(&copy, code)) == CA_ERROR_OK &&
+        ca_code_infer(c, &copy) == CA_ERROR_OK &&
+        ca_batch_can_run(&copy.typed->code)) {
+        run  = &copy.typed->code;
+        type = copy.typed->type;
+    }
+
+    /* From the chunk that overflowed, the rows are run one at a time. */
+    if ((err = ca_batch_run(c, run, type, cols, rows, out, &ran)) ==
+        CA_ERROR_EVAL_OVERFLOW)
+        err = ca_batch_run_rows(c, code, columns, ncolumns, ran, rows, out);
+    ca_code_free(&copy);
+    free(cols);
+    return err;
+}
+
+CaError ca_run_batch(CaContext *c, const CaCode *code, const CaColumn *columns,
+                     CaSize ncolumns, CaSize rows, CaReal *out)
+{
+    CaVar *saved;
+    CaError err;
+
+    if ((err = ca_context_reserve(c)) != CA_ERROR_OK)
+        return err;
+    for (CaSize j = 0; j < ncolumns; j++)
+        if (columns[j].name >= c->nvars)
+            return CA_ERROR_HASH_INVALID_KEY;
+    if (!rows)
+        return CA_ERROR_OK;
+
+    if (!(saved = malloc((ncolumns + 1) * sizeof(CaVar))))
+        return CA_ERROR_MEM;
+    for (CaSize j = 0; j < ncolumns; j++)
+        saved[j] = ca_context_take(c, columns[j].name);
+
+    if (ca_batch_can_run(code))
+        err = ca_batch_run_chunks(c, code, columns, ncolumns, rows, out);
+    else
+        err = ca_batch_run_rows(c, code, columns, ncolumns, 0, rows, out);
+
+    for (CaSize j = ncolumns; j-- > 0;)
+        ca_context_set(c, columns[j].name, &saved[j]);
+    free(saved);
+    return err;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file batch.h
+ * \author Anamitra Ghorui
+ * \brief Evaluation of an expression over columns of values
+ *
+ */
+
+/*
+ * ca_run_batch runs compiled code once for each row of a set of columns, each
+ * column holding the values of one variable. Rather than running every
+ * instruction once per row, it runs each on CA_BATCH_ROWS rows at a time,
+ * keeping a vector of values in every stack slot, so the cost of dispatch is
+ * paid once per chunk and every operator is a tight loop over the rows.
+ *
+ * Where the types of the columns make operators work on CaInt values (see
+ * infer.h), those operators are run with the vector kernels of kernel.h, and
+ * variables without a column are passed to them as scalars.
+ *
+ * Only code that sets no variables and does not jump is run this way, which
+ * is most code computing a value from its inputs. Other code, like code
+ * using && or ||, is run with ca_run row by row, with the same results.
+ */
+
+#ifndef CA_BATCH_H
+#define CA_BATCH_H
+
+#include "eval.h"
+#include "command_stack.h"
+#include "error.h"
+#include "types.h"
+
+/// Rows each instruction is run on at a time.
+#define CA_BATCH_ROWS 256
+
+/// The values of a variable, one for each row.
+typedef struct CaColumn {
+    CaSymbol name;      ///< Symbol ID of the variable.
+    CaType type;        ///< CA_TYPE_INT or CA_TYPE_REAL.
+    const void *data;   ///< The values, as CaInt or CaReal.
+} CaColumn;
+
+/**
+ * \brief Runs compiled code for each row of a set of columns. In each row,
+ *        the variables of the columns have the values of that row, and the
+ *        other variables those set in the context.
+ * \param c The context the code was compiled for.
+ * \param code The code.
+ * \param columns The columns. Every variable may have at most one.
+ * \param ncolumns The number of columns.
+ * \param rows The number of rows.
+ * \param out The value of the expression for each row.
+ * \return An error code. On an error, out is only partly written. The
+ *         variables of the columns are left as they were.
+ */
+CaError ca_run_batch(CaContext *c, const CaCode *code, const CaColumn *columns,
+                     CaSize ncolumns, CaSize rows, CaReal *out);
+
+#endif
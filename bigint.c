@@ -0,0 +1,856 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file bigint.c
+ * \author Anamitra Ghorui
+ * \brief Arbitrary precision integers
+ *
+ */
+
+#include "bigint.h"
+#include "real.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/// Two limbs, for products and quotients of limbs.
+typedef unsigned __int128 CaDLimb;
+
+/// The largest power of 10 that fits in a limb, and its number of zeros.
+#define CA_BIGINT_DEC_BASE   10000000000000000000ULL
+#define CA_BIGINT_DEC_DIGITS 19
+
+/*
+ * Limb arrays.
+ *
+ * These work on magnitudes of a given number of limbs, which may have zero
+ * limbs at the top. Results may be the same array as an operand unless
+ * noted otherwise.
+ */
+
+/* The number of limbs of a without the zero limbs at the top. */
+static CaSize ca_limbs_norm(const CaLimb *a, CaSize n)
+{
+    while (n && !a[n - 1])
+        n--;
+    return n;
+}
+
+/* Compares a and b, which have no zero limbs at the top. */
+static int ca_limbs_cmp(const CaLimb *a, CaSize an, const CaLimb *b,
+                        CaSize bn)
+{
+    if (an != bn)
+        return an < bn ? -1 : 1;
+    while (an--) {
+        if (a[an] != b[an])
+            return a[an] < b[an] ? -1 : 1;
+    }
+    return 0;
+}
+
+/* r = a + b for an >= bn, into an limbs. Returns the carry. */
+static CaLimb ca_limbs_add(CaLimb *r, const CaLimb *a, CaSize an,
+                           const CaLimb *b, CaSize bn)
+{
+    CaLimb c = 0;
+    CaSize i;
+
+    for (i = 0; i < bn; i++) {
+        CaLimb s = a[i] + c;
+        c = s < c;
+        s += b[i];
+        c += s < b[i];
+        r[i] = s;
+    }
+    for (; i < an; i++) {
+        r[i] = a[i] + c;
+        c = r[i] < c;
+    }
+    return c;
+}
+
+/* r = a - b for an >= bn, into an limbs. Returns the borrow. */
+static CaLimb ca_limbs_sub(CaLimb *r, const CaLimb *a, CaSize an,
+                           const CaLimb *b, CaSize bn)
+{
+    CaLimb c = 0;
+    CaSize i;
+
+    for (i = 0; i < bn; i++) {
+        CaLimb d = a[i] - b[i];
+        CaLimb c2 = a[i] < b[i];
+        c2 += d < c;
+        r[i] = d - c;
+        c = c2;
+    }
+    for (; i < an; i++) {
+        CaLimb d = a[i];
+        r[i] = d - c;
+        c = d < c;
+    }
+    return c;
+}
+
+/* r = a * m + c into n limbs. Returns the limb carried out. */
+static CaLimb ca_limbs_mul_1(CaLimb *r, const CaLimb *a, CaSize n, CaLimb m,
+                             CaLimb c)
+{
+    for (CaSize i = 0; i < n; i++) {
+        CaDLimb p = (CaDLimb) a[i] * m + c;
+        r[i] = (CaLimb) p;
+        c = (CaLimb) (p >> 64);
+    }
+    return c;
+}
+
+/* r += a * m over n limbs. Returns the limb carried out. */
+static CaLimb ca_limbs_addmul_1(CaLimb *r, const CaLimb *a, CaSize n,
+                                CaLimb m)
+{
+    CaLimb c = 0;
+
+    for (CaSize i = 0; i < n; i++) {
+        CaDLimb p = (CaDLimb) a[i] * m + r[i] + c;
+        r[i] = (CaLimb) p;
+        c = (CaLimb) (p >> 64);
+    }
+    return c;
+}
+
+/* r = a / d over n limbs. Returns the remainder. */
+static CaLimb ca_limbs_div_1(CaLimb *r, const CaLimb *a, CaSize n, CaLimb d)
+{
+    CaLimb rem = 0;
+
+    while (n--) {
+        CaDLimb x = (CaDLimb) rem << 64 | a[n];
+        r[n] = (CaLimb) (x / d);
+        rem = (CaLimb) (x % d);
+    }
+    return rem;
+}
+
+/* Schoolbook multiplication, r = a * b into an + bn limbs. r may not be an
+ * operand. */
+static void ca_limbs_mul_basecase(CaLimb *r, const CaLimb *a, CaSize an,
+                                  const CaLimb *b, CaSize bn)
+{
+    r[an] = ca_limbs_mul_1(r, a, an, b[0], 0);
+    for (CaSize j = 1; j < bn; j++)
+        r[an + j] = ca_limbs_addmul_1(r + j, a, an, b[j]);
+}
+
+static CaError ca_limbs_mul(CaLimb *r, const CaLimb *a, CaSize an,
+                            const CaLimb *b, CaSize bn, CaBigIntMul alg);
+
+static CaError ca_limbs_mul_n(CaLimb *r, const CaLimb *a, const CaLimb *b,
+                              CaSize n, CaBigIntMul alg);
+
+/* r = |a - b| for a of n limbs and b of bn <= n limbs, into n limbs. Returns
+ * nonzero if a < b. */
+static int ca_limbs_absdiff(CaLimb *r, const CaLimb *a, CaSize n,
+                            const CaLimb *b, CaSize bn)
+{
+    CaSize an = ca_limbs_norm(a, n);
+
+    bn = ca_limbs_norm(b, bn);
+    if (ca_limbs_cmp(a, an, b, bn) >= 0) {
+        ca_limbs_sub(r, a, n, b, bn);
+        return 0;
+    }
+    ca_limbs_sub(r, b, bn, a, an);
+    memset(r + bn, 0, (n - bn) * sizeof(CaLimb));
+    return 1;
+}
+
+/*
+ * Karatsuba's algorithm, r = a * b into 2n limbs for n >= 2. With a = a1 B^h
+ * + a0 and b likewise,
+ *
+ *     a * b = a1 b1 B^2h + (a0 b0 + a1 b1 - (a0 - a1)(b0 - b1)) B^h + a0 b0
+ *
+ * which takes three products of half the size rather than four.
+ */
+static CaError ca_limbs_karatsuba(CaLimb *r, const CaLimb *a, const CaLimb *b,
+                                  CaSize n, CaBigIntMul alg)
+{
+    CaSize h = (n + 1) / 2, l = n - h, zn;
+    CaLimb *t, *da, *db, *m, *z;
+    CaError err;
+    int neg;
+
+    if (!(t = malloc((6 * h + 1) * sizeof(CaLimb))))
+        return CA_ERROR_MEM;
+    da = t;
+    db = da + h;
+    m = db + h;
+    z = m + 2 * h;
+
+    neg = ca_limbs_absdiff(da, a, h, a + h, l)
+        ^ ca_limbs_absdiff(db, b, h, b + h, l);
+
+    if ((err = ca_limbs_mul_n(r, a, b, h, alg))
+        || (err = ca_limbs_mul_n(r + 2 * h, a + h, b + h, l, alg))
+        || (err = ca_limbs_mul_n(m, da, db, h, alg))) {
+        free(t);
+        return err;
+    }
+
+    /* The middle term, which is at most 2h + 1 limbs. */
+    memcpy(z, r, 2 * h * sizeof(CaLimb));
+    z[2 * h] = ca_limbs_add(z, z, 2 * h, r + 2 * h, 2 * l);
+    if (neg)
+        z[2 * h] += ca_limbs_add(z, z, 2 * h, m, 2 * h);
+    else
+        z[2 * h] -= ca_limbs_sub(z, z, 2 * h, m, 2 * h);
+
+    zn = ca_limbs_norm(z, 2 * h + 1);
+    ca_limbs_add(r + h, r + h, 2 * n - h, z, zn);
+    free(t);
+    return CA_ERROR_OK;
+}
+
+/* Initialises a as a read only CaBigInt of the n limbs at l. */
+static void ca_bigint_view(CaBigInt *a, const CaLimb *l, CaSize n)
+{
+    a->limbs = (CaLimb *) l;
+    a->size = ca_limbs_norm(l, n);
+    a->capacity = 0;
+    a->neg = 0;
+}
+
+/* Halves a, which is even. */
+static void ca_bigint_half(CaBigInt *a)
+{
+    for (CaSize i = 0; i < a->size; i++) {
+        a->limbs[i] >>= 1;
+        if (i + 1 < a->size)
+            a->limbs[i] |= a->limbs[i + 1] << 63;
+    }
+    a->size = ca_limbs_norm(a->limbs, a->size);
+    a->neg &= a->size != 0;
+}
+
+/* Divides a by 3, which divides it. */
+static void ca_bigint_third(CaBigInt *a)
+{
+    ca_limbs_div_1(a->limbs, a->limbs, a->size, 3);
+    a->size = ca_limbs_norm(a->limbs, a->size);
+    a->neg &= a->size != 0;
+}
+
+/*
+ * Toom-Cook 3, r = a * b into 2n limbs for n >= 3. a and b are split into
+ * three pieces of k limbs, read as polynomials of degree 2 in B^k, whose
+ * product is found from its values at 0, 1, -1, -2 and infinity, with the
+ * interpolation sequence of Bodrato.
+ */
+static CaError ca_limbs_toom3(CaLimb *r, const CaLimb *a, const CaLimb *b,
+                              CaSize n, CaBigIntMul alg)
+{
+    CaSize k = (n + 2) / 3;
+    CaBigInt a0, a1, a2, b0, b1, b2;
+    CaBigInt p[3], q[3], w[5];
+    CaBigInt *w0 = &w[0], *w1 = &w[1], *wm1 = &w[2], *wm2 = &w[3];
+    CaBigInt *winf = &w[4];
+    CaBigInt *c[5];
+    CaError err = CA_ERROR_OK;
+    int i;
+
+    ca_bigint_view(&a0, a, k);
+    ca_bigint_view(&a1, a + k, k);
+    ca_bigint_view(&a2, a + 2 * k, n - 2 * k);
+    ca_bigint_view(&b0, b, k);
+    ca_bigint_view(&b1, b + k, k);
+    ca_bigint_view(&b2, b + 2 * k, n - 2 * k);
+    for (i = 0; i < 3; i++) {
+        ca_bigint_init(&p[i]);
+        ca_bigint_init(&q[i]);
+    }
+    for (i = 0; i < 5; i++)
+        ca_bigint_init(&w[i]);
+
+    /* p = a(1), a(-1), a(-2), and q likewise for b. */
+#define EVALUATE(_p, _x0, _x1, _x2)                                     \
+    (err = ca_bigint_add(&_p[0], &_x0, &_x2))                           \
+    || (err = ca_bigint_sub(&_p[1], &_p[0], &_x1))                      \
+    || (err = ca_bigint_add(&_p[0], &_p[0], &_x1))                      \
+    || (err = ca_bigint_add(&_p[2], &_p[1], &_x2))                      \
+    || (err = ca_bigint_add(&_p[2], &_p[2], &_p[2]))                    \
+    || (err = ca_bigint_sub(&_p[2], &_p[2], &_x0))
+
+    if (EVALUATE(p, a0, a1, a2) || EVALUATE(q, b0, b1, b2)
+        || (err = ca_bigint_mul_with(w0, &a0, &b0, alg))
+        || (err = ca_bigint_mul_with(w1, &p[0], &q[0], alg))
+        || (err = ca_bigint_mul_with(wm1, &p[1], &q[1], alg))
+        || (err = ca_bigint_mul_with(wm2, &p[2], &q[2], alg))
+        || (err = ca_bigint_mul_with(winf, &a2, &b2, alg)))
+        goto end;
+#undef EVALUATE
+
+    /* Coefficients 3, 1 and 2 into wm2, w1 and wm1. */
+    if ((err = ca_bigint_sub(wm2, wm2, w1)))
+        goto end;
+    ca_bigint_third(wm2);
+    if ((err = ca_bigint_sub(w1, w1, wm1)))
+        goto end;
+    ca_bigint_half(w1);
+    if ((err = ca_bigint_sub(wm1, wm1, w0))
+        || (err = ca_bigint_sub(wm2, wm1, wm2)))
+        goto end;
+    ca_bigint_half(wm2);
+    if ((err = ca_bigint_add(wm2, wm2, winf))
+        || (err = ca_bigint_add(wm2, wm2, winf))
+        || (err = ca_bigint_add(wm1, wm1, w1))
+        || (err = ca_bigint_sub(wm1, wm1, winf))
+        || (err = ca_bigint_sub(w1, w1, wm2)))
+        goto end;
+
+    /* Every coefficient is not negative, and fits where it is added. */
+    c[0] = w0;
+    c[1] = w1;
+    c[2] = wm1;
+    c[3] = wm2;
+    c[4] = winf;
+    memset(r, 0, 2 * n * sizeof(CaLimb));
+    for (i = 0; i < 5; i++) {
+        ca_limbs_add(r + i * k, r + i * k, 2 * n - i * k,
+                     c[i]->limbs, c[i]->size);
+    }
+
+end:
+    for (i = 0; i < 3; i++) {
+        ca_bigint_free(&p[i]);
+        ca_bigint_free(&q[i]);
+    }
+    for (i = 0; i < 5; i++)
+        ca_bigint_free(&w[i]);
+    return err;
+}
+
+/* r = a * b into 2n limbs, by the algorithm for the size of n. r may not be
+ * an operand. */
+static CaError ca_limbs_mul_n(CaLimb *r, const CaLimb *a, const CaLimb *b,
+                              CaSize n, CaBigIntMul alg)
+{
+    CaBigIntMul use = alg;
+
+    if (use == CA_BIGINT_MUL_AUTO) {
+        use = n < CA_BIGINT_KARATSUBA_LIMBS ? CA_BIGINT_MUL_SCHOOLBOOK
+            : n < CA_BIGINT_TOOM3_LIMBS ? CA_BIGINT_MUL_KARATSUBA
+            : CA_BIGINT_MUL_TOOM3;
+    }
+    if (use == CA_BIGINT_MUL_TOOM3 && n >= 3)
+        return ca_limbs_toom3(r, a, b, n, alg);
+    if (use != CA_BIGINT_MUL_SCHOOLBOOK && n >= 2)
+        return ca_limbs_karatsuba(r, a, b, n, alg);
+    ca_limbs_mul_basecase(r, a, n, b, n);
+    return CA_ERROR_OK;
+}
+
+/* r = a * b into an + bn limbs for an >= bn >= 1. r may not be an operand. */
+static CaError ca_limbs_mul(CaLimb *r, const CaLimb *a, CaSize an,
+                            const CaLimb *b, CaSize bn, CaBigIntMul alg)
+{
+    CaLimb *t;
+    CaError err = CA_ERROR_OK;
+
+    if (bn == 1 || alg == CA_BIGINT_MUL_SCHOOLBOOK
+        || (alg == CA_BIGINT_MUL_AUTO && bn < CA_BIGINT_KARATSUBA_LIMBS)) {
+        ca_limbs_mul_basecase(r, a, an, b, bn);
+        return CA_ERROR_OK;
+    }
+    if (an == bn)
+        return ca_limbs_mul_n(r, a, b, bn, alg);
+
+    /* bn limbs of a at a time, the last piece being shorter. */
+    if (!(t = malloc(2 * bn * sizeof(CaLimb))))
+        return CA_ERROR_MEM;
+    memset(r, 0, (an + bn) * sizeof(CaLimb));
+    for (CaSize i = 0; i < an && !err; i += bn) {
+        CaSize m = an - i < bn ? an - i : bn;
+
+        if (m == bn)
+            err = ca_limbs_mul_n(t, a + i, b, bn, alg);
+        else
+            err = ca_limbs_mul(t, b, bn, a + i, m, alg);
+        ca_limbs_add(r + i, r + i, an + bn - i, t, bn + m);
+    }
+    free(t);
+    return err;
+}
+
+/*
+ * Divides a by b, for an >= bn >= 2 and b with no zero limbs at the top,
+ * into q of an - bn + 1 limbs and r of bn limbs. This is algorithm D of
+ * Knuth, TAOCP 4.3.1.
+ */
+static CaError ca_limbs_divmod(CaLimb *q, CaLimb *r, const CaLimb *a,
+                               CaSize an, const CaLimb *b, CaSize bn)
+{
+    int s = __builtin_clzll(b[bn - 1]);
+    CaLimb *u, *v;
+    CaSize i, j;
+
+    if (!(u = malloc((an + 1 + bn) * sizeof(CaLimb))))
+        return CA_ERROR_MEM;
+    v = u + an + 1;
+
+    /* Normalise, so that the top bit of the divisor is set. */
+    for (i = bn - 1; i > 0; i--)
+        v[i] = s ? b[i] << s | b[i - 1] >> (64 - s) : b[i];
+    v[0] = b[0] << s;
+    u[an] = s ? a[an - 1] >> (64 - s) : 0;
+    for (i = an - 1; i > 0; i--)
+        u[i] = s ? a[i] << s | a[i - 1] >> (64 - s) : a[i];
+    u[0] = a[0] << s;
+
+    for (j = an - bn + 1; j-- > 0;) {
+        CaDLimb x = (CaDLimb) u[j + bn] << 64 | u[j + bn - 1];
+        CaDLimb qhat = x / v[bn - 1];
+        CaDLimb rhat = x % v[bn - 1];
+        CaLimb c = 0, borrow = 0;
+
+        while (qhat >> 64
+               || qhat * v[bn - 2] > (rhat << 64 | u[j + bn - 2])) {
+            qhat--;
+            rhat += v[bn - 1];
+            if (rhat >> 64)
+                break;
+        }
+
+        /* u -= qhat * v, at j. */
+        for (i = 0; i <= bn; i++) {
+            CaDLimb p = i < bn ? qhat * v[i] + c : c;
+            CaLimb lo = (CaLimb) p, d = u[i + j] - lo;
+            CaLimb b2 = u[i + j] < lo;
+
+            b2 += d < borrow;
+            u[i + j] = d - borrow;
+            borrow = b2;
+            c = (CaLimb) (p >> 64);
+        }
+
+        /* qhat was one too big. */
+        if (borrow) {
+            qhat--;
+            u[j + bn] += ca_limbs_add(u + j, u + j, bn, v, bn);
+        }
+        q[j] = (CaLimb) qhat;
+    }
+
+    for (i = 0; i < bn - 1; i++)
+        r[i] = s ? u[i] >> s | u[i + 1] << (64 - s) : u[i];
+    r[bn - 1] = u[bn - 1] >> s;
+    free(u);
+    return CA_ERROR_OK;
+}
+
+/*
+ * CaBigInt.
+ */
+
+/* Replaces the limbs of r with the n limbs of l, which it takes. */
+static void ca_bigint_take(CaBigInt *r, CaLimb *l, CaSize n, CaSize capacity,
+                           int neg)
+{
+    free(r->capacity ? r->limbs : NULL);
+    r->limbs = l;
+    r->capacity = capacity;
+    r->size = ca_limbs_norm(l, n);
+    r->neg = r->size ? neg : 0;
+}
+
+/* Makes room for n limbs in r, keeping its value. */
+static CaError ca_bigint_reserve(CaBigInt *r, CaSize n)
+{
+    CaLimb *l;
+
+    if (n <= r->capacity)
+        return CA_ERROR_OK;
+    if (!(l = realloc(r->limbs, n * sizeof(CaLimb))))
+        return CA_ERROR_MEM;
+    r->limbs = l;
+    r->capacity = n;
+    return CA_ERROR_OK;
+}
+
+void ca_bigint_init(CaBigInt *a)
+{
+    a->limbs = NULL;
+    a->size = 0;
+    a->capacity = 0;
+    a->neg = 0;
+}
+
+void ca_bigint_free(CaBigInt *a)
+{
+    free(a->capacity ? a->limbs : NULL);
+    ca_bigint_init(a);
+}
+
+CaError ca_bigint_set(CaBigInt *r, const CaBigInt *a)
+{
+    if (r == a)
+        return CA_ERROR_OK;
+    if (ca_bigint_reserve(r, a->size))
+        return CA_ERROR_MEM;
+    if (a->size)
+        memcpy(r->limbs, a->limbs, a->size * sizeof(CaLimb));
+    r->size = a->size;
+    r->neg = a->neg;
+    return CA_ERROR_OK;
+}
+
+CaError ca_bigint_set_int(CaBigInt *r, CaInt i)
+{
+    if (ca_bigint_reserve(r, 1))
+        return CA_ERROR_MEM;
+    r->limbs[0] = i < 0 ? -(CaUint) i : (CaUint) i;
+    r->size = i != 0;
+    r->neg = i < 0;
+    return CA_ERROR_OK;
+}
+
+int ca_bigint_get_int(const CaBigInt *a, CaInt *i)
+{
+    if (!a->size) {
+        *i = 0;
+        return 1;
+    }
+    if (a->size > 1 || a->limbs[0] > (CaUint) INT64_MAX + a->neg)
+        return 0;
+    *i = (CaInt) (a->neg ? -a->limbs[0] : a->limbs[0]);
+    return 1;
+}
+
+CaInt ca_bigint_trunc(const CaBigInt *a)
+{
+    CaUint low = a->size ? a->limbs[0] : 0;
+
+    return (CaInt) (a->neg ? -low : low);
+}
+
+CaReal ca_bigint_real(const CaBigInt *a)
+{
+    const CaLimb *l = a->limbs;
+    CaSize n = a->size, bits, shift, w, i;
+    CaLimb lo, mid, hi, sticky;
+    CaReal x;
+    int o;
+
+    if (!n)
+        return 0;
+    bits = n * 64 - __builtin_clzll(l[n - 1]);
+    if (bits <= 128) {
+        x = (CaReal) ((CaDLimb) (n > 1 ? l[1] : 0) << 64 | l[0]);
+    } else {
+        /* The top 128 bits, with the lowest set if any bit below them is,
+         * which rounds the same as the whole. */
+        shift = bits - 128;
+        w = shift / 64;
+        o = shift % 64;
+        lo = l[w];
+        mid = l[w + 1];
+        hi = w + 2 < n ? l[w + 2] : 0;
+        if (o) {
+            lo = lo >> o | mid << (64 - o);
+            mid = mid >> o | hi << (64 - o);
+        }
+        sticky = o && (l[w] & (((CaLimb) 1 << o) - 1));
+        for (i = 0; i < w && !sticky; i++)
+            sticky = l[i] != 0;
+        x = ca_real_ldexp((CaReal) ((CaDLimb) mid << 64 | lo | sticky),
+                          (int) shift);
+    }
+    return a->neg ? -x : x;
+}
+
+int ca_bigint_cmp(const CaBigInt *a, const CaBigInt *b)
+{
+    int c;
+
+    if (a->neg != b->neg)
+        return a->neg ? -1 : 1;
+    c = ca_limbs_cmp(a->limbs, a->size, b->limbs, b->size);
+    return a->neg ? -c : c;
+}
+
+/* r = a + b if b is taken as negative when bneg is set. */
+static CaError ca_bigint_addsub(CaBigInt *r, const CaBigInt *a,
+                                const CaBigInt *b, int bneg)
+{
+    const CaBigInt *x = a, *y = b;
+    CaSize n;
+    CaLimb *l;
+    int neg = a->neg;
+
+    if (a->neg == bneg) {
+        if (x->size < y->size) {
+            x = b;
+            y = a;
+        }
+        n = x->size + 1;
+        if (!(l = malloc(n * sizeof(CaLimb))))
+            return CA_ERROR_MEM;
+        l[n - 1] = ca_limbs_add(l, x->limbs, x->size, y->limbs, y->size);
+    } else {
+        if (ca_limbs_cmp(a->limbs, a->size, b->limbs, b->size) < 0) {
+            x = b;
+            y = a;
+            neg = bneg;
+        }
+        n = x->size;
+        if (!(l = malloc((n ? n : 1) * sizeof(CaLimb))))
+            return CA_ERROR_MEM;
+        ca_limbs_sub(l, x->limbs, x->size, y->limbs, y->size);
+    }
+    ca_bigint_take(r, l, n, n ? n : 1, neg);
+    return CA_ERROR_OK;
+}
+
+CaError ca_bigint_add(CaBigInt *r, const CaBigInt *a, const CaBigInt *b)
+{
+    return ca_bigint_addsub(r, a, b, b->neg);
+}
+
+CaError ca_bigint_sub(CaBigInt *r, const CaBigInt *a, const CaBigInt *b)
+{
+    return ca_bigint_addsub(r, a, b, !b->neg && b->size);
+}
+
+CaError ca_bigint_mul(CaBigInt *r, const CaBigInt *a, const CaBigInt *b)
+{
+    return ca_bigint_mul_with(r, a, b, CA_BIGINT_MUL_AUTO);
+}
+
+CaError ca_bigint_mul_with(CaBigInt *r, const CaBigInt *a, const CaBigInt *b,
+                           CaBigIntMul alg)
+{
+    const CaBigInt *t;
+    CaSize n;
+    CaLimb *l;
+    CaError err;
+    int neg = a->neg ^ b->neg;
+
+    if (!a->size || !b->size) {
+        r->size = 0;
+        r->neg = 0;
+        return CA_ERROR_OK;
+    }
+    if (a->size < b->size) {
+        t = a;
+        a = b;
+        b = t;
+    }
+    n = a->size + b->size;
+    if (!(l = malloc(n * sizeof(CaLimb))))
+        return CA_ERROR_MEM;
+    if ((err = ca_limbs_mul(l, a->limbs, a->size, b->limbs, b->size, alg))) {
+        free(l);
+        return err;
+    }
+    ca_bigint_take(r, l, n, n, neg);
+    return CA_ERROR_OK;
+}
+
+CaError ca_bigint_divmod(CaBigInt *q, CaBigInt *r, const CaBigInt *a,
+                         const CaBigInt *b)
+{
+    CaSize an = a->size, bn = b->size;
+    CaLimb *ql, *rl;
+    CaError err;
+    int qneg = a->neg ^ b->neg, rneg = a->neg;
+
+    if (!bn)
+        return CA_ERROR_EVAL_DIVISION_BY_ZERO;
+    if (ca_limbs_cmp(a->limbs, an, b->limbs, bn) < 0) {
+        if (r && (err = ca_bigint_set(r, a)))
+            return err;
+        if (q) {
+            q->size = 0;
+            q->neg = 0;
+        }
+        return CA_ERROR_OK;
+    }
+
+    if (!(ql = malloc((an - bn + 1 + bn) * sizeof(CaLimb))))
+        return CA_ERROR_MEM;
+    rl = ql + an - bn + 1;
+    if (bn == 1) {
+        rl[0] = ca_limbs_div_1(ql, a->limbs, an, b->limbs[0]);
+    } else if ((err = ca_limbs_divmod(ql, rl, a->limbs, an, b->limbs, bn))) {
+        free(ql);
+        return err;
+    }
+
+    if (r) {
+        if (ca_bigint_reserve(r, bn)) {
+            free(ql);
+            return CA_ERROR_MEM;
+        }
+        memcpy(r->limbs, rl, bn * sizeof(CaLimb));
+        r->size = ca_limbs_norm(r->limbs, bn);
+        r->neg = r->size ? rneg : 0;
+    }
+    if (q)
+        ca_bigint_take(q, ql, an - bn + 1, an + 1, qneg);
+    else
+        free(ql);
+    return CA_ERROR_OK;
+}
+
+CaError ca_bigint_pow(CaBigInt *r, const CaBigInt *a, uint64_t e)
+{
+    CaBigInt base, p;
+    uint64_t bits;
+    CaError err;
+
+    /* The power of a base of more than one bit has at least e times as many
+     * bits, less one, as the base. */
+    bits = a->size ? a->size * 64 - __builtin_clzll(a->limbs[a->size - 1]) :
+                     0;
+    if (bits > 1 && e > CA_BIGINT_POW_BITS / (bits - 1))
+        return CA_ERROR_EVAL_OVERFLOW;
+
+    ca_bigint_init(&base);
+    ca_bigint_init(&p);
+    if ((err = ca_bigint_set(&base, a)) != CA_ERROR_OK ||
+        (err = ca_bigint_set_int(&p, 1)) != CA_ERROR_OK)
+        goto done;
+    for (; e; e >>= 1) {
+        if ((e & 1) && (err = ca_bigint_mul(&p, &p, &base)) != CA_ERROR_OK)
+            goto done;
+        if (e > 1 && (err = ca_bigint_mul(&base, &base, &base)) !=
+            CA_ERROR_OK)
+            goto done;
+    }
+    ca_bigint_free(r);
+    *r = p;
+    ca_bigint_init(&p);
+
+done:
+    ca_bigint_free(&base);
+    ca_bigint_free(&p);
+    return err;
+}
+
+CaError ca_bigint_parse(CaBigInt *r, const char *s, CaSize len)
+{
+    const char *end = s + len;
+    CaSize digits, n = 0, cap;
+    CaLimb *l;
+    int neg = 0;
+
+    if (s < end && (*s == '-' || *s == '+'))
+        neg = *s++ == '-';
+    if (s == end)
+        return CA_ERROR_NUM_INVALID;
+    for (const char *p = s; p < end; p++) {
+        if (*p < '0' || *p > '9')
+            return CA_ERROR_NUM_INVALID;
+    }
+
+    digits = end - s;
+    cap = digits / CA_BIGINT_DEC_DIGITS + 1;
+    if (!(l = malloc(cap * sizeof(CaLimb))))
+        return CA_ERROR_MEM;
+
+    /* A chunk of up to 19 digits at a time, the first one being shorter. */
+    while (s < end) {
+        CaSize take = (end - s) % CA_BIGINT_DEC_DIGITS;
+        CaLimb chunk = 0, scale = 1, c;
+
+        if (!take)
+            take = CA_BIGINT_DEC_DIGITS;
+        for (CaSize i = 0; i < take; i++) {
+            chunk = chunk * 10 + (CaLimb) (*s++ - '0');
+            scale *= 10;
+        }
+        c = ca_limbs_mul_1(l, l, n, scale, chunk);
+        if (c)
+            l[n++] = c;
+    }
+    ca_bigint_take(r, l, n, cap, neg);
+    return CA_ERROR_OK;
+}
+
+/* The decimal text of a, allocated, and its size in len. */
+static char *ca_bigint_text(const CaBigInt *a, CaSize *len)
+{
+    CaSize n = a->size, m = 0, i;
+    CaLimb *t, *chunks;
+    char *s, *p;
+
+    if (!(t = malloc((2 * n + n / 64 + 2) * sizeof(CaLimb))))
+        return NULL;
+    chunks = t + n;
+    memcpy(t, a->limbs, n * sizeof(CaLimb));
+    while (n) {
+        chunks[m++] = ca_limbs_div_1(t, t, n, CA_BIGINT_DEC_BASE);
+        n = ca_limbs_norm(t, n);
+    }
+
+    if (!(s = malloc(m * CA_BIGINT_DEC_DIGITS + 3))) {
+        free(t);
+        return NULL;
+    }
+    p = s;
+    if (a->neg)
+        *p++ = '-';
+    p += sprintf(p, "%llu", m ? (unsigned long long) chunks[m - 1] : 0ULL);
+    for (i = m - 1; m && i-- > 0;)
+        p += sprintf(p, "%019llu", (unsigned long long) chunks[i]);
+    free(t);
+    *len = p - s;
+    return s;
+}
+
+long ca_bigint_format(char *buf, CaSize size, const CaBigInt *a)
+{
+    CaSize len;
+    char *s = ca_bigint_text(a, &len);
+
+    if (!s)
+        return -1;
+    if (size) {
+        CaSize n = len < size - 1 ? len : size - 1;
+
+        memcpy(buf, s, n);
+        buf[n] = '\0';
+    }
+    free(s);
+    return (long) len;
+}
+
+CaError ca_bigint_print(FILE *f, const CaBigInt *a)
+{
+    CaSize len;
+    char *s = ca_bigint_text(a, &len);
+    CaError err = CA_ERROR_OK;
+
+    if (!s)
+        return CA_ERROR_MEM;
+    if (fwrite(s, 1, len, f) != len)
+        err = CA_ERROR_IO;
+    free(s);
+    return err;
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file bigint.h
+ * \author Anamitra Ghorui
+ * \brief Arbitrary precision integers
+ *
+ */
+
+/*
+ * A CaBigInt is a sign and a magnitude, the magnitude being an array of 64
+ * bit limbs, least significant first, with no zero limbs at the top. Zero has
+ * no limbs and is not negative.
+ *
+ * Multiplication picks its algorithm by the size of the smaller operand:
+ * schoolbook multiplication below CA_BIGINT_KARATSUBA_LIMBS limbs, Karatsuba
+ * below CA_BIGINT_TOOM3_LIMBS, and Toom-Cook 3 above, the last two splitting
+ * the operands and recursing down to the first. An operand much longer than
+ * the other is multiplied a piece of the size of the other at a time.
+ *
+ * Functions writing a CaBigInt allow it to be one of the operands.
+ */
+
+#ifndef CA_BIGINT_H
+#define CA_BIGINT_H
+
+#include "error.h"
+#include "types.h"
+
+#include <stdio.h>
+
+/// Smallest operand multiplied with Karatsuba's algorithm, in limbs.
+#define CA_BIGINT_KARATSUBA_LIMBS 32
+
+/// Smallest operand multiplied with Toom-Cook 3, in limbs.
+#define CA_BIGINT_TOOM3_LIMBS 192
+
+/// Most bits of a power computed by ca_bigint_pow.
+#define CA_BIGINT_POW_BITS (1 << 24)
+
+/// A digit of a CaBigInt.
+typedef uint64_t CaLimb;
+
+/// An arbitrary precision integer.
+typedef struct CaBigInt {
+    CaLimb *limbs;      ///< The magnitude, least significant limb first.
+    CaSize size;        ///< Limbs in use.
+    CaSize capacity;    ///< Limbs allocated.
+    int neg;            ///< Nonzero if the value is negative.
+} CaBigInt;
+
+/// Algorithms of multiplication.
+typedef enum CaBigIntMul {
+    CA_BIGINT_MUL_AUTO = 0,     ///< Chosen by size.
+    CA_BIGINT_MUL_SCHOOLBOOK,
+    CA_BIGINT_MUL_KARATSUBA,
+    CA_BIGINT_MUL_TOOM3
+} CaBigIntMul;
+
+/**
+ * \brief Initialises a CaBigInt to zero. Nothing is allocated until it is
+ *        set to something else.
+ * \param a The CaBigInt.
+ */
+void ca_bigint_init(CaBigInt *a);
+
+/**
+ * \brief Frees the limbs of a CaBigInt, leaving it zero.
+ * \param a The CaBigInt.
+ */
+void ca_bigint_free(CaBigInt *a);
+
+/**
+ * \brief Copies a CaBigInt.
+ * \param r The copy.
+ * \param a The CaBigInt.
+ * \return An error code.
+ */
+CaError ca_bigint_set(CaBigInt *r, const CaBigInt *a);
+
+/**
+ * \brief Sets a CaBigInt to a CaInt.
+ * \param r The CaBigInt.
+ * \param i The value.
+ * \return An error code.
+ */
+CaError ca_bigint_set_int(CaBigInt *r, CaInt i);
+
+/**
+ * \brief Gets the value of a CaBigInt as a CaInt.
+ * \param a The CaBigInt.
+ * \param i The value, if it fits.
+ * \return Nonzero if the value fits in a CaInt.
+ */
+int ca_bigint_get_int(const CaBigInt *a, CaInt *i);
+
+/**
+ * \brief Returns the low 64 bits of the two's complement of a CaBigInt, as
+ *        a CaInt, as a cast to a CaInt would.
+ * \param a The CaBigInt.
+ */
+CaInt ca_bigint_trunc(const CaBigInt *a);
+
+/**
+ * \brief Converts a CaBigInt to the nearest CaReal.
+ * \param a The CaBigInt.
+ * \return The value, or an infinity if it is out of range.
+ */
+CaReal ca_bigint_real(const CaBigInt *a);
+
+/**
+ * \brief Compares two CaBigInt.
+ * \param a The first.
+ * \param b The second.
+ * \return Less than, equal to or greater than 0 as a is less than, equal to
+ *         or greater than b.
+ */
+int ca_bigint_cmp(const CaBigInt *a, const CaBigInt *b);
+
+/**
+ * \brief Adds two CaBigInt.
+ * \param r The sum.
+ * \param a The first operand.
+ * \param b The second operand.
+ * \return An error code.
+ */
+CaError ca_bigint_add(CaBigInt *r, const CaBigInt *a, const CaBigInt *b);
+
+/**
+ * \brief Subtracts a CaBigInt from another.
+ * \param r The difference, a - b.
+ * \param a The first operand.
+ * \param b The second operand.
+ * \return An error code.
+ */
+CaError ca_bigint_sub(CaBigInt *r, const CaBigInt *a, const CaBigInt *b);
+
+/**
+ * \brief Multiplies two CaBigInt.
+ * \param r The product.
+ * \param a The first operand.
+ * \param b The second operand.
+ * \return An error code.
+ */
+CaError ca_bigint_mul(CaBigInt *r, const CaBigInt *a, const CaBigInt *b);
+
+/**
+ * \brief Multiplies two CaBigInt with a given algorithm, used on every level
+ *        of the recursion where the operands are big enough to be split.
+ * \param r The product.
+ * \param a The first operand.
+ * \param b The second operand.
+ * \param alg The algorithm, or CA_BIGINT_MUL_AUTO to choose by size.
+ * \return An error code.
+ */
+CaError ca_bigint_mul_with(CaBigInt *r, const CaBigInt *a, const CaBigInt *b,
+                           CaBigIntMul alg);
+
+/**
+ * \brief Divides a CaBigInt by another, truncating towards zero, as C does.
+ * \param q The quotient, or NULL.
+ * \param r The remainder, which has the sign of a, or NULL. It may not be
+ *          the same as q.
+ * \param a The dividend.
+ * \param b The divisor.
+ * \return An error code. CA_ERROR_EVAL_DIVISION_BY_ZERO if b is zero.
+ */
+CaError ca_bigint_divmod(CaBigInt *q, CaBigInt *r, const CaBigInt *a,
+                         const CaBigInt *b);
+
+/**
+ * \brief Raises a CaBigInt to a power, by repeated squaring.
+ * \param r The power. May be the same as a.
+ * \param a The base.
+ * \param e The exponent.
+ * \return An error code. CA_ERROR_EVAL_OVERFLOW if the power would have more
+ *         than CA_BIGINT_POW_BITS bits.
+ */
+CaError ca_bigint_pow(CaBigInt *r, const CaBigInt *a, uint64_t e);
+
+/**
+ * \brief Reads a CaBigInt from decimal digits, with an optional sign.
+ * \param r The CaBigInt.
+ * \param s The text.
+ * \param len The size of the text.
+ * \return An error code. CA_ERROR_NUM_INVALID if the text is not a number.
+ */
+CaError ca_bigint_parse(CaBigInt *r, const char *s, CaSize len);
+
+/**
+ * \brief Writes a CaBigInt in decimal, like snprintf.
+ * \param buf The buffer.
+ * \param size The size of the buffer. The text is truncated to fit, and
+ *             always NUL terminated if size is not 0.
+ * \param a The CaBigInt.
+ * \return The size of the whole text, or -1 if memory could not be
+ *         allocated.
+ */
+long ca_bigint_format(char *buf, CaSize size, const CaBigInt *a);
+
+/**
+ * \brief Prints a CaBigInt in decimal.
+ * \param f The file.
+ * \param a The CaBigInt.
+ * \return An error code.
+ */
+CaError ca_bigint_print(FILE *f, const CaBigInt *a);
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file builtin.c
+ * \author Anamitra Ghorui
+ * \brief Builtin functions
+ */
+
+#include "builtin.h"
+#include "real.h"
+
+static CaReal ca_builtin_abs(const CaReal *args)   { return ca_real_fabs(args[0]); }
+static CaReal ca_builtin_ceil(const CaReal *args)  { return ca_real_ceil(args[0]); }
+static CaReal ca_builtin_cos(const CaReal *args)   { return ca_real_cos(args[0]); }
+static CaReal ca_builtin_exp(const CaReal *args)   { return ca_real_exp(args[0]); }
+static CaReal ca_builtin_floor(const CaReal *args) { return ca_real_floor(args[0]); }
+static CaReal ca_builtin_log(const CaReal *args)   { return ca_real_log(args[0]); }
+static CaReal ca_builtin_round(const CaReal *args) { return ca_real_round(args[0]); }
+static CaReal ca_builtin_sin(const CaReal *args)   { return ca_real_sin(args[0]); }
+static CaReal ca_builtin_sqrt(const CaReal *args)  { return ca_real_sqrt(args[0]); }
+static CaReal ca_builtin_tan(const CaReal *args)   { return ca_real_tan(args[0]); }
+
+static CaReal ca_builtin_max(const CaReal *args)
+{
+    return ca_real_fmax(args[0], args[1]);
+}
+
+static CaReal ca_builtin_min(const CaReal *args)
+{
+    return ca_real_fmin(args[0], args[1]);
+}
+
+const CaBuiltinDef ca_builtin_list[] = {
+    /*  NAME     FUNCTION           ARGS */
+    { "abs",   { ca_builtin_abs,   1 } },
+    { "ceil",  { ca_builtin_ceil,  1 } },
+    { "cos",   { ca_builtin_cos,   1 } },
+    { "exp",   { ca_builtin_exp,   1 } },
+    { "floor", { ca_builtin_floor, 1 } },
+    { "log",   { ca_builtin_log,   1 } },
+    { "max",   { ca_builtin_max,   2 } },
+    { "min",   { ca_builtin_min,   2 } },
+    { "round", { ca_builtin_round, 1 } },
+    { "sin",   { ca_builtin_sin,   1 } },
+    { "sqrt",  { ca_builtin_sqrt,  1 } },
+    { "tan",   { ca_builtin_tan,   1 } },
+};
+
+const CaSize ca_builtin_count = sizeof(ca_builtin_list) /
+                                sizeof(ca_builtin_list[0]);
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file builtin.h
+ * \author Anamitra Ghorui
+ * \brief Builtin functions
+ *
+ */
+
+/*
+ * Builtins are C functions called by name from expressions, such as
+ * sqrt(x). Each takes a fixed number of arguments, and is looked up by the
+ * symbol ID of its name when it is called, so it may be defined again after
+ * code calling it is compiled.
+ */
+
+#ifndef CA_BUILTIN_H
+#define CA_BUILTIN_H
+
+#include "types.h"
+
+#include <stdint.h>
+
+/// A builtin function. args holds as many values as the builtin takes.
+typedef CaReal (*CaBuiltinFunc)(const CaReal *args);
+
+/// A builtin, as kept by a context.
+typedef struct CaBuiltin {
+    CaBuiltinFunc func;  ///< NULL if no builtin has the name.
+    uint16_t nargs;      ///< Number of arguments it takes.
+} CaBuiltin;
+
+/// A builtin every context starts with.
+typedef struct CaBuiltinDef {
+    const char *name;
+    CaBuiltin builtin;
+} CaBuiltinDef;
+
+/// The builtins every context starts with.
+extern const CaBuiltinDef ca_builtin_list[];
+
+/// Number of entries in ca_builtin_list.
+extern const CaSize ca_builtin_count;
+
+#endif
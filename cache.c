@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file cache.c
+ * \author Anamitra Ghorui
+ * \brief Cache of compiled expressions
+ */
+
+#include "cache.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Entries are kept in one array, which is filled up to the capacity, and then
+ * reused. They are found through a hash table of chains of entry indices, and
+ * kept in a doubly linked list in the order they were last used.
+ */
+
+#define CA_CACHE_NONE UINT32_MAX
+
+CaError ca_cache_init(CaCache *cache, CaSize capacity)
+{
+    CaSize nbuckets = 1;
+
+    /* Entry indices must fit in 32 bits, with one value to spare. */
+    if (capacity >= CA_CACHE_NONE)
+        capacity = CA_CACHE_NONE - 1;
+
+    while (nbuckets < capacity * 2)
+        nbuckets <<= 1;
+
+    cache->count      = 0;
+    cache->capacity   = capacity;
+    cache->mask       = nbuckets - 1;
+    cache->generation = 0;
+    cache->hits       = 0;
+    cache->misses     = 0;
+    cache->entries    = NULL;
+    cache->buckets    = NULL;
+    cache->head       = CA_CACHE_NONE;
+    cache->tail       = CA_CACHE_NONE;
+
+    if (!capacity)
+        return CA_ERROR_OK;
+
+    cache->entries = malloc(capacity * sizeof(CaCacheEntry));
+    cache->buckets = malloc(nbuckets * sizeof(uint32_t));
+    if (!cache->entries || !cache->buckets) {
+        ca_cache_free(cache);
+        return CA_ERROR_MEM;
+    }
+    memset(cache->buckets, 0xFF, nbuckets * sizeof(uint32_t));
+    return CA_ERROR_OK;
+}
+
+void ca_cache_free(CaCache *cache)
+{
+    for (CaSize i = 0; i < cache->count; i++) {
+        free(cache->entries[i].key);
+        ca_code_free(&cache->entries[i].code);
+    }
+    free(cache->entries);
+    free(cache->buckets);
+    cache->entries  = NULL;
+    cache->buckets  = NULL;
+    cache->count    = 0;
+    cache->capacity = 0;
+}
+
+void ca_cache_clear(CaCache *cache)
+{
+    for (CaSize i = 0; i < cache->count; i++) {
+        free(cache->entries[i].key);
+        ca_code_free(&cache->entries[i].code);
+    }
+    cache->count = 0;
+    cache->head  = CA_CACHE_NONE;
+    cache->tail  = CA_CACHE_NONE;
+    if (cache->buckets)
+        memset(cache->buckets, 0xFF, (cache->mask + 1) * sizeof(uint32_t));
+}
+
+long ca_cache_key(const char *s, CaSize size, char *key, uint32_t *hash)
+{
+    uint32_t h = 2166136261u;
+    CaSize n = 0;
+    char quote = '\0', ch;
+    int space = 0;
+
+    for (CaSize i = 0; i < size; i++) {
+        ch = s[i];
+        if (!ch)
+            return -1;
+
+        if (!quote && (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')) {
+            space = n > 0;
+            continue;
+        }
+        if (space) {
+            if (n == CA_CACHE_KEY_SIZE)
+                return -1;
+            key[n++] = ' ';
+            h = (h ^ ' ') * 16777619u;
+            space = 0;
+        }
+        if (ch == quote)
+            quote = '\0';
+        else if (!quote && (ch == '"' || ch == '\''))
+            quote = ch;
+
+        if (n == CA_CACHE_KEY_SIZE)
+            return -1;
+        key[n++] = ch;
+        h = (h ^ (unsigned char) ch) * 16777619u;
+    }
+
+    key[n] = '\0';
+    *hash  = h;
+    return n;
+}
+
+/* Removes entry i from the list of used entries. */
+static void ca_cache_unlink(CaCache *cache, uint32_t i)
+{
+    CaCacheEntry *e = &cache->entries[i];
+
+    if (e->prev != CA_CACHE_NONE)
+        cache->entries[e->prev].next = e->next;
+    else
+        cache->head = e->next;
+    if (e->next != CA_CACHE_NONE)
+        cache->entries[e->next].prev = e->prev;
+    else
+        cache->tail = e->prev;
+}
+
+/* Makes entry i the most recently used one. */
+static void ca_cache_link(CaCache *cache, uint32_t i)
+{
+    CaCacheEntry *e = &cache->entries[i];
+
+    e->prev = CA_CACHE_NONE;
+    e->next = cache->head;
+    if (cache->head != CA_CACHE_NONE)
+        cache->entries[cache->head].prev = i;
+    else
+        cache->tail = i;
+    cache->head = i;
+}
+
+const CaCode *ca_cache_find(CaCache *cache, const char *key, CaSize size,
+                            uint32_t hash, uint32_t generation)
+{
+    CaCacheEntry *e;
+    uint32_t i;
+
+    if (cache->generation != generation) {
+        ca_cache_clear(cache);
+        cache->generation = generation;
+    }
+
+    if (cache->capacity) {
+        for (i = cache->buckets[hash & cache->mask]; i != CA_CACHE_NONE;
+             i = e->chain) {
+            e = &cache->entries[i];
+            if (e->hash == hash && e->key_size == size &&
+                !memcmp(e->key, key, size)) {
+                if (cache->head != i) {
+                    ca_cache_unlink(cache, i);
+                    ca_cache_link(cache, i);
+                }
+                cache->hits++;
+                CA_TRACE(CA_TRACE_INFO, CACHE, HIT, hash, size);
+                return &e->code;
+            }
+        }
+    }
+
+    cache->misses++;
+    CA_TRACE(CA_TRACE_INFO, CACHE, MISS, hash, size);
+    return NULL;
+}
+
+CaError ca_cache_insert(CaCache *cache, const char *key, CaSize size,
+                        uint32_t hash, CaCode *code)
+{
+    CaCacheEntry *e;
+    CaCode tmp;
+    uint32_t i, *p;
+    char *k;
+
+    if (!cache->capacity)
+        return CA_ERROR_OK;
+
+    /* The least recently used entry is dropped if the cache is full. */
+    i = cache->count < cache->capacity ? cache->count : cache->tail;
+    e = &cache->entries[i];
+    if (i == cache->count) {
+        e->key          = NULL;
+        e->key_capacity = 0;
+        ca_code_init(&e->code);
+    }
+
+    if (e->key_capacity < size + 1) {
+        if (!(k = realloc(e->key, size + 1)))
+            return CA_ERROR_MEM;
+        e->key          = k;
+        e->key_capacity = size + 1;
+    }
+
+    if (i == cache->count) {
+        cache->count++;
+    } else {
+        ca_cache_unlink(cache, i);
+        for (p = &cache->buckets[e->hash & cache->mask]; *p != i;
+             p = &cache->entries[*p].chain);
+        *p = e->chain;
+    }
+
+    memcpy(e->key, key, size);
+    e->key[size] = '\0';
+    e->key_size  = size;
+    e->hash      = hash;
+
+    tmp     = e->code;
+    e->code = *code;
+    *code   = tmp;
+    ca_code_reset(code);
+
+    e->chain = cache->buckets[hash & cache->mask];
+    cache->buckets[hash & cache->mask] = i;
+    ca_cache_link(cache, i);
+    return CA_ERROR_OK;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file cache.h
+ * \author Anamitra Ghorui
+ * \brief Cache of compiled expressions
+ *
+ */
+
+/*
+ * Compiled code is kept by the normalized text of the expression it was
+ * compiled from: runs of whitespace outside of quotes become one space, and
+ * whitespace at either end is removed. When the cache is full, the least
+ * recently used expression is dropped.
+ *
+ * Code depends on the builtins, and the optimisation level, of the context it
+ * was compiled for, so the cache is emptied whenever either changes.
+ */
+
+#ifndef CA_CACHE_H
+#define CA_CACHE_H
+
+#include "command_stack.h"
+#include "types.h"
+#include "error.h"
+
+#include <stdint.h>
+
+/// Longest expression, after normalization, that is cached.
+#define CA_CACHE_KEY_SIZE 4096
+
+/// A cached expression.
+typedef struct CaCacheEntry {
+    char *key;        ///< Normalized text of the expression.
+    CaSize key_size;
+    CaSize key_capacity;
+    uint32_t hash;    ///< Hash of the key.
+    uint32_t chain;   ///< Next entry in the same bucket, or UINT32_MAX.
+    uint32_t prev;    ///< Entry used right after this one, or UINT32_MAX.
+    uint32_t next;    ///< Entry used right before this one, or UINT32_MAX.
+    CaCode code;
+} CaCacheEntry;
+
+/// A cache of compiled expressions.
+typedef struct CaCache {
+    CaCacheEntry *entries;
+    CaSize count;
+    CaSize capacity;    ///< Most expressions kept. 0 if nothing is cached.
+    uint32_t *buckets;  ///< First entry of each bucket, or UINT32_MAX.
+    CaSize mask;        ///< Number of buckets, less 1.
+    uint32_t head;      ///< Most recently used entry, or UINT32_MAX.
+    uint32_t tail;      ///< Least recently used entry, or UINT32_MAX.
+    uint32_t generation;///< Context generation the entries were compiled in.
+    CaSize hits;        ///< Lookups that found their expression.
+    CaSize misses;      ///< Lookups that did not.
+} CaCache;
+
+/**
+ * \brief Initialises a cache.
+ * \param cache The cache.
+ * \param capacity The most expressions kept. 0 disables the cache.
+ * \return An error code.
+ */
+CaError ca_cache_init(CaCache *cache, CaSize capacity);
+
+/**
+ * \brief Frees a cache.
+ * \param cache The cache.
+ */
+void ca_cache_free(CaCache *cache);
+
+/**
+ * \brief Drops every expression from a cache. The counters are kept.
+ * \param cache The cache.
+ */
+void ca_cache_clear(CaCache *cache);
+
+/**
+ * \brief Normalizes the text of an expression, and hashes it.
+ * \param s The expression.
+ * \param size The size of the expression.
+ * \param key Where the NUL terminated key is written. Must have room for
+ *        CA_CACHE_KEY_SIZE + 1 bytes.
+ * \param hash The hash of the key.
+ * \return The size of the key, or -1 if the expression cannot be cached,
+ *         because it is too long, or has a NUL byte in it.
+ */
+long ca_cache_key(const char *s, CaSize size, char *key, uint32_t *hash);
+
+/**
+ * \brief Finds the code of an expression, marking it as the most recently
+ *        used one.
+ * \param cache The cache.
+ * \param key The key of the expression, from ca_cache_key.
+ * \param size The size of the key.
+ * \param hash The hash of the key.
+ * \param generation The generation of the context the code is run on. The
+ *        cache is emptied if it is not the one the cache was filled in.
+ * \return The code, or NULL if the expression is not cached.
+ */
+const CaCode *ca_cache_find(CaCache *cache, const char *key, CaSize size,
+                            uint32_t hash, uint32_t generation);
+
+/**
+ * \brief Adds an expression to a cache, dropping the least recently used one
+ *        if the cache is full. The expression must not be in the cache.
+ * \param cache The cache.
+ * \param key The key of the expression, from ca_cache_key.
+ * \param size The size of the key.
+ * \param hash The hash of the key.
+ * \param code The code of the expression. It is swapped with the code of the
+ *        dropped entry, if any, which is emptied, so that its memory is
+ *        reused for the next compilation.
+ * \return An error code.
+ */
+CaError ca_cache_insert(CaCache *cache, const char *key, CaSize size,
+                        uint32_t hash, CaCode *code);
+
+#endif
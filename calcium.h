@@ -28,7 +28,7 @@
 #define _CALCIUM_H
 
 #include "types.h"
-#include "debug.h"
+#include "trace.h"
 #include "hashmap.h"
 #include "stack.h"
 #include "error.h"
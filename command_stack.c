@@ -22,4 +22,329 @@
  * \brief Internal subsystem instruction opcodes
  */
 
+#include "command_stack.h"
+#include "jit.h"
+#include "infer.h"
+#include "real.h"
 
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OPCODE_NAME(_op) [CA_OPCODE_##_op] = #_op
+
+const char *const ca_opcode_names[CA_OPCODE_COUNT] = {
+    OPCODE_NAME(END),
+    OPCODE_NAME(PUSH_CONST),
+    OPCODE_NAME(LOAD),
+    OPCODE_NAME(STORE),
+    OPCODE_NAME(POP),
+    OPCODE_NAME(POST_INC),
+    OPCODE_NAME(POST_DEC),
+    OPCODE_NAME(POWER),
+    OPCODE_NAME(MULTIPLICATION),
+    OPCODE_NAME(DIVISION),
+    OPCODE_NAME(REMAINDER),
+    OPCODE_NAME(ADDITION),
+    OPCODE_NAME(SUBTRACTION),
+    OPCODE_NAME(LSHIFT),
+    OPCODE_NAME(RSHIFT),
+    OPCODE_NAME(LT),
+    OPCODE_NAME(LTEQ),
+    OPCODE_NAME(GT),
+    OPCODE_NAME(GTEQ),
+    OPCODE_NAME(EQ),
+    OPCODE_NAME(NEQ),
+    OPCODE_NAME(B_AND),
+    OPCODE_NAME(B_XOR),
+    OPCODE_NAME(B_OR),
+    OPCODE_NAME(BOOL),
+    OPCODE_NAME(JUMP),
+    OPCODE_NAME(JUMP_FALSE_OR_POP),
+    OPCODE_NAME(JUMP_TRUE_OR_POP),
+    OPCODE_NAME(EXT_CALL),
+    OPCODE_NAME(ADD_CONST),
+    OPCODE_NAME(SUB_CONST),
+    OPCODE_NAME(MUL_CONST),
+    OPCODE_NAME(DIV_CONST),
+    OPCODE_NAME(ADD_VAR),
+    OPCODE_NAME(SUB_VAR),
+    OPCODE_NAME(MUL_VAR),
+    OPCODE_NAME(DIV_VAR),
+    OPCODE_NAME(MUL_ADD),
+    OPCODE_NAME(MUL_ADD_VAR),
+    OPCODE_NAME(SQUARE),
+    OPCODE_NAME(CUBE),
+    OPCODE_NAME(INC_VAR),
+    OPCODE_NAME(STORE_POP),
+    OPCODE_NAME(LT_JUMP_FALSE),
+    OPCODE_NAME(LTEQ_JUMP_FALSE),
+    OPCODE_NAME(GT_JUMP_FALSE),
+    OPCODE_NAME(GTEQ_JUMP_FALSE),
+    OPCODE_NAME(EQ_JUMP_FALSE),
+    OPCODE_NAME(NEQ_JUMP_FALSE),
+    OPCODE_NAME(LT_JUMP_TRUE),
+    OPCODE_NAME(LTEQ_JUMP_TRUE),
+    OPCODE_NAME(GT_JUMP_TRUE),
+    OPCODE_NAME(GTEQ_JUMP_TRUE),
+    OPCODE_NAME(EQ_JUMP_TRUE),
+    OPCODE_NAME(NEQ_JUMP_TRUE),
+    OPCODE_NAME(SAVE_TEMP),
+    OPCODE_NAME(LOAD_TEMP),
+    OPCODE_NAME(I_PUSH_CONST),
+    OPCODE_NAME(I_LOAD),
+    OPCODE_NAME(I_STORE),
+    OPCODE_NAME(I_POST_INC),
+    OPCODE_NAME(I_POST_DEC),
+    OPCODE_NAME(I_POWER),
+    OPCODE_NAME(I_MULTIPLICATION),
+    OPCODE_NAME(I_REMAINDER),
+    OPCODE_NAME(I_ADDITION),
+    OPCODE_NAME(I_SUBTRACTION),
+    OPCODE_NAME(I_LSHIFT),
+    OPCODE_NAME(I_RSHIFT),
+    OPCODE_NAME(I_LT),
+    OPCODE_NAME(I_LTEQ),
+    OPCODE_NAME(I_GT),
+    OPCODE_NAME(I_GTEQ),
+    OPCODE_NAME(I_EQ),
+    OPCODE_NAME(I_NEQ),
+    OPCODE_NAME(I_B_AND),
+    OPCODE_NAME(I_B_XOR),
+    OPCODE_NAME(I_B_OR),
+    OPCODE_NAME(I_BOOL),
+    OPCODE_NAME(I_JUMP_FALSE_OR_POP),
+    OPCODE_NAME(I_JUMP_TRUE_OR_POP),
+    OPCODE_NAME(I_ADD_CONST),
+    OPCODE_NAME(I_SUB_CONST),
+    OPCODE_NAME(I_MUL_CONST),
+    OPCODE_NAME(I_ADD_VAR),
+    OPCODE_NAME(I_SUB_VAR),
+    OPCODE_NAME(I_MUL_VAR),
+    OPCODE_NAME(I_MUL_ADD),
+    OPCODE_NAME(I_MUL_ADD_VAR),
+    OPCODE_NAME(I_SQUARE),
+    OPCODE_NAME(I_CUBE),
+    OPCODE_NAME(I_INC_VAR),
+    OPCODE_NAME(I_STORE_POP),
+    OPCODE_NAME(I_LT_JUMP_FALSE),
+    OPCODE_NAME(I_LTEQ_JUMP_FALSE),
+    OPCODE_NAME(I_GT_JUMP_FALSE),
+    OPCODE_NAME(I_GTEQ_JUMP_FALSE),
+    OPCODE_NAME(I_EQ_JUMP_FALSE),
+    OPCODE_NAME(I_NEQ_JUMP_FALSE),
+    OPCODE_NAME(I_LT_JUMP_TRUE),
+    OPCODE_NAME(I_LTEQ_JUMP_TRUE),
+    OPCODE_NAME(I_GT_JUMP_TRUE),
+    OPCODE_NAME(I_GTEQ_JUMP_TRUE),
+    OPCODE_NAME(I_EQ_JUMP_TRUE),
+    OPCODE_NAME(I_NEQ_JUMP_TRUE),
+    OPCODE_NAME(TO_REAL),
+    OPCODE_NAME(TO_INT),
+};
+
+void ca_code_init(CaCode *code)
+{
+    code->instrs          = NULL;
+    code->count           = 0;
+    code->capacity        = 0;
+    code->consts          = NULL;
+    code->const_types     = NULL;
+    code->iconsts         = NULL;
+    code->nconsts         = 0;
+    code->consts_capacity = 0;
+    code->depth           = 0;
+    code->ntemps          = 0;
+    code->jit             = NULL;
+    code->typed           = NULL;
+}
+
+void ca_code_free(CaCode *code)
+{
+    free(code->instrs);
+    free(code->consts);
+    free(code->const_types);
+    free(code->iconsts);
+    ca_jit_free(code->jit);
+    ca_typed_free(code->typed);
+    ca_code_init(code);
+}
+
+void ca_code_reset(CaCode *code)
+{
+    code->count   = 0;
+    code->nconsts = 0;
+    code->depth   = 0;
+    code->ntemps  = 0;
+    ca_jit_free(code->jit);
+    ca_typed_free(code->typed);
+    code->jit     = NULL;
+    code->typed   = NULL;
+}
+
+CaError ca_code_copy(CaCode *dst, const CaCode *src)
+{
+    if (src->count &&
+        !(dst->instrs = malloc(src->count * sizeof(CaInstr))))
+        return CA_ERROR_MEM;
+    dst->capacity = src->count;
+    if (src->nconsts &&
+        (!(dst->consts = malloc(src->nconsts * sizeof(CaReal))) ||
+         !(dst->const_types = malloc(src->nconsts)) ||
+         !(dst->iconsts = malloc(src->nconsts * sizeof(CaInt))))) {
+        ca_code_free(dst);
+        return CA_ERROR_MEM;
+    }
+    dst->consts_capacity = src->nconsts;
+
+    if (src->count)
+        memcpy(dst->instrs, src->instrs, src->count * sizeof(CaInstr));
+    if (src->nconsts) {
+        memcpy(dst->consts, src->consts, src->nconsts * sizeof(CaReal));
+        memcpy(dst->const_types, src->const_types, src->nconsts);
+        memcpy(dst->iconsts, src->iconsts, src->nconsts * sizeof(CaInt));
+    }
+    dst->count   = src->count;
+    dst->nconsts = src->nconsts;
+    dst->depth   = src->depth;
+    dst->ntemps  = src->ntemps;
+    return CA_ERROR_OK;
+}
+
+CaError ca_code_emit(CaCode *code, CaOpcode op, uint32_t arg, uint16_t n)
+{
+    CaSize capacity;
+    CaInstr *instrs;
+
+    if (code->count == code->capacity) {
+        capacity = code->capacity ? code->capacity * 2 : CA_CODE_SIZE;
+        if (!(instrs = realloc(code->instrs, capacity * sizeof(CaInstr))))
+            return CA_ERROR_MEM;
+        code->instrs   = instrs;
+        code->capacity = capacity;
+    }
+
+    code->instrs[code->count++] = (CaInstr) { .op = op, .n = n, .arg = arg };
+    return CA_ERROR_OK;
+}
+
+static CaError ca_code_add_const(CaCode *code, CaReal value, CaInt i,
+                                 CaType type, uint32_t *index)
+{
+    CaSize capacity;
+    CaReal *consts;
+    CaInt *iconsts;
+    uint8_t *types;
+
+    if (code->nconsts == code->consts_capacity) {
+        capacity = code->consts_capacity ? code->consts_capacity * 2 :
+                                           CA_CODE_CONST_SIZE;
+        if (!(consts = realloc(code->consts, capacity * sizeof(CaReal))))
+            return CA_ERROR_MEM;
+        code->consts = consts;
+        if (!(types = realloc(code->const_types, capacity)))
+            return CA_ERROR_MEM;
+        code->const_types = types;
+        if (!(iconsts = realloc(code->iconsts, capacity * sizeof(CaInt))))
+            return CA_ERROR_MEM;
+        code->iconsts         = iconsts;
+        code->consts_capacity = capacity;
+    }
+
+    *index = code->nconsts;
+    code->consts[code->nconsts]        = value;
+    code->iconsts[code->nconsts]       = i;
+    code->const_types[code->nconsts++] = type;
+    return CA_ERROR_OK;
+}
+
+CaError ca_code_const(CaCode *code, CaReal value, uint32_t *index)
+{
+    return ca_code_add_const(code, value, 0, CA_TYPE_REAL, index);
+}
+
+CaError ca_code_iconst(CaCode *code, CaInt value, uint32_t *index)
+{
+    return ca_code_add_const(code, (CaReal) value, value, CA_TYPE_INT, index);
+}
+
+/* Prints constant k as it was written. */
+static void ca_code_print_const(const CaCode *code, uint32_t k, FILE *f)
+{
+    fputc(' ', f);
+    if (ca_code_const_int(code, k))
+        fprintf(f, "%" PRId64, code->iconsts[k]);
+    else
+        ca_real_print(f, code->consts[k], 6);
+}
+
+void ca_code_print(const CaCode *code, const CaSymbols *symbols, FILE *f)
+{
+    const CaInstr *in;
+    CaSize size;
+    const char *name;
+
+    for (CaSize i = 0; i < code->count; i++) {
+        in = &code->instrs[i];
+        fprintf(f, "%4zu %s", i, in->op < CA_OPCODE_COUNT ?
+                                 ca_opcode_names[in->op] : "?");
+
+        switch (in->op) {
+        case CA_OPCODE_PUSH_CONST:
+        case CA_OPCODE_ADD_CONST:
+        case CA_OPCODE_SUB_CONST:
+        case CA_OPCODE_MUL_CONST:
+        case CA_OPCODE_DIV_CONST:
+        case CA_OPCODE_I_PUSH_CONST:
+        case CA_OPCODE_I_ADD_CONST:
+        case CA_OPCODE_I_SUB_CONST:
+        case CA_OPCODE_I_MUL_CONST:
+            ca_code_print_const(code, in->arg, f);
+            break;
+        case CA_OPCODE_SAVE_TEMP:
+        case CA_OPCODE_LOAD_TEMP:
+        case CA_OPCODE_TO_REAL:
+        case CA_OPCODE_TO_INT:
+            fprintf(f, " %u", in->arg);
+            break;
+        case CA_OPCODE_I_LOAD:
+        case CA_OPCODE_I_STORE:
+        case CA_OPCODE_I_POST_INC:
+        case CA_OPCODE_I_POST_DEC:
+        case CA_OPCODE_I_ADD_VAR:
+        case CA_OPCODE_I_SUB_VAR:
+        case CA_OPCODE_I_MUL_VAR:
+        case CA_OPCODE_I_MUL_ADD_VAR:
+        case CA_OPCODE_I_INC_VAR:
+        case CA_OPCODE_I_STORE_POP:
+        case CA_OPCODE_LOAD:
+        case CA_OPCODE_STORE:
+        case CA_OPCODE_POST_INC:
+        case CA_OPCODE_POST_DEC:
+        case CA_OPCODE_EXT_CALL:
+        case CA_OPCODE_ADD_VAR:
+        case CA_OPCODE_SUB_VAR:
+        case CA_OPCODE_MUL_VAR:
+        case CA_OPCODE_DIV_VAR:
+        case CA_OPCODE_MUL_ADD_VAR:
+        case CA_OPCODE_INC_VAR:
+        case CA_OPCODE_STORE_POP:
+            if (symbols && in->arg < symbols->count) {
+                name = ca_symbols_name(symbols, in->arg, &size);
+                fprintf(f, " %.*s", (int) size, name);
+            } else {
+                fprintf(f, " #%u", in->arg);
+            }
+            if (in->op == CA_OPCODE_EXT_CALL)
+                fprintf(f, " %u", in->n);
+            else if (in->op == CA_OPCODE_INC_VAR ||
+                     in->op == CA_OPCODE_I_INC_VAR)
+                ca_code_print_const(code, in->n, f);
+            break;
+        default:
+            if (CA_OPCODE_ISJUMP(in->op))
+                fprintf(f, " %u", in->arg);
+        }
+        fprintf(f, "\n");
+    }
+}
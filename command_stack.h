@@ -17,7 +17,7 @@
  */
 
 /**
- * \file command_stack.c
+ * \file command_stack.h
  * \author Anamitra Ghorui
  * \brief Internal subsystem instruction opcodes
  */
@@ -25,9 +25,276 @@
 /*
  * Opcodes define how data is processed and in what order. Two separate stacks
  * are kept, one for data, and one for commands on the data.
+ *
+ * The command stack of an expression is a CaCode: a flat array of fixed size
+ * instructions, run from the first one until CA_OPCODE_END, and the constants
+ * they push. The data stack is the expr stack of the context the code is run
+ * on (see vm.h). Variables and functions are referred to by symbol ID, so code
+ * can be kept and run any number of times on the context it was compiled for.
  */
 
+#ifndef CA_COMMAND_STACK_H
+#define CA_COMMAND_STACK_H
+
+#include "types.h"
+#include "error.h"
+#include "symbol.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/// Initial number of instructions a CaCode has room for.
+#define CA_CODE_SIZE 64
+
+/// Initial number of constants a CaCode has room for.
+#define CA_CODE_CONST_SIZE 16
+
+/*
+ * In the comments below, a is the value under the top of the data stack, and
+ * b is the value on top. Binary operators pop both, and push their result.
+ */
 typedef enum CaOpcode {
-    CA_OPCODE_EXT_CALL,
-    CA_OPCODE_
+    CA_OPCODE_END = 0,          ///< Stops the code.
+    CA_OPCODE_PUSH_CONST,       ///< Pushes constant arg.
+    CA_OPCODE_LOAD,             ///< Pushes the value of variable arg.
+    CA_OPCODE_STORE,            ///< Sets variable arg to b, leaving b.
+    CA_OPCODE_POP,              ///< Pops b.
+    CA_OPCODE_POST_INC,         ///< Sets variable arg to b + 1, leaving b.
+    CA_OPCODE_POST_DEC,         ///< Sets variable arg to b - 1, leaving b.
+    CA_OPCODE_POWER,
+    CA_OPCODE_MULTIPLICATION,
+    CA_OPCODE_DIVISION,
+    CA_OPCODE_REMAINDER,
+    CA_OPCODE_ADDITION,
+    CA_OPCODE_SUBTRACTION,
+    CA_OPCODE_LSHIFT,
+    CA_OPCODE_RSHIFT,
+    CA_OPCODE_LT,
+    CA_OPCODE_LTEQ,
+    CA_OPCODE_GT,
+    CA_OPCODE_GTEQ,
+    CA_OPCODE_EQ,
+    CA_OPCODE_NEQ,
+    CA_OPCODE_B_AND,
+    CA_OPCODE_B_XOR,
+    CA_OPCODE_B_OR,
+    CA_OPCODE_BOOL,             ///< Replaces b with 1 if it is non-zero, or 0.
+    CA_OPCODE_JUMP,             ///< Continues at instruction arg.
+    CA_OPCODE_JUMP_FALSE_OR_POP,///< Jumps to arg if b is 0, else pops b.
+    CA_OPCODE_JUMP_TRUE_OR_POP, ///< Jumps to arg unless b is 0, else pops b.
+    CA_OPCODE_EXT_CALL,         ///< Calls builtin arg with the top n values.
+
+    /* Superinstructions, written by the peephole optimiser (see peephole.h).
+     * k is constant arg, and v is variable arg. */
+    CA_OPCODE_ADD_CONST,        ///< b + k
+    CA_OPCODE_SUB_CONST,        ///< b - k
+    CA_OPCODE_MUL_CONST,        ///< b * k
+    CA_OPCODE_DIV_CONST,        ///< b / k
+    CA_OPCODE_ADD_VAR,          ///< b + v
+    CA_OPCODE_SUB_VAR,          ///< b - v
+    CA_OPCODE_MUL_VAR,          ///< b * v
+    CA_OPCODE_DIV_VAR,          ///< b / v
+    CA_OPCODE_MUL_ADD,          ///< Pops three values x, y, z, pushes x + y * z
+    CA_OPCODE_MUL_ADD_VAR,      ///< a + b * v
+    CA_OPCODE_SQUARE,           ///< b ** 2, as b * b
+    CA_OPCODE_CUBE,             ///< b ** 3, as b * b * b, which is rounded
+                                ///< twice for a CaReal
+    CA_OPCODE_INC_VAR,          ///< Adds constant n to v, and pushes v.
+    CA_OPCODE_STORE_POP,        ///< Sets v to b, and pops b.
+    CA_OPCODE_LT_JUMP_FALSE,    ///< Compares a and b, and if false, pushes 0
+    CA_OPCODE_LTEQ_JUMP_FALSE,  ///< and jumps to arg.
+    CA_OPCODE_GT_JUMP_FALSE,
+    CA_OPCODE_GTEQ_JUMP_FALSE,
+    CA_OPCODE_EQ_JUMP_FALSE,
+    CA_OPCODE_NEQ_JUMP_FALSE,
+    CA_OPCODE_LT_JUMP_TRUE,     ///< Compares a and b, and if true, pushes 1
+    CA_OPCODE_LTEQ_JUMP_TRUE,   ///< and jumps to arg.
+    CA_OPCODE_GT_JUMP_TRUE,
+    CA_OPCODE_GTEQ_JUMP_TRUE,
+    CA_OPCODE_EQ_JUMP_TRUE,
+    CA_OPCODE_NEQ_JUMP_TRUE,
+
+    /* Temporaries, written by common subexpression elimination (see cse.h).
+     * They are kept as they are, whatever the type of the value. */
+    CA_OPCODE_SAVE_TEMP,        ///< Copies b to temporary arg.
+    CA_OPCODE_LOAD_TEMP,        ///< Pushes temporary arg.
+
+    /* Integer instructions, written by type inference (see infer.h). They
+     * are the instructions above of the same name, working on CaInt values.
+     * Those that can overflow fail with CA_ERROR_EVAL_OVERFLOW instead, as
+     * does I_POWER for a negative exponent, which gives a CaReal, and
+     * I_REMAINDER for a remainder by 0, which is an error. */
+    CA_OPCODE_I_PUSH_CONST,
+    CA_OPCODE_I_LOAD,
+    CA_OPCODE_I_STORE,
+    CA_OPCODE_I_POST_INC,
+    CA_OPCODE_I_POST_DEC,
+    CA_OPCODE_I_POWER,
+    CA_OPCODE_I_MULTIPLICATION,
+    CA_OPCODE_I_REMAINDER,
+    CA_OPCODE_I_ADDITION,
+    CA_OPCODE_I_SUBTRACTION,
+    CA_OPCODE_I_LSHIFT,
+    CA_OPCODE_I_RSHIFT,
+    CA_OPCODE_I_LT,
+    CA_OPCODE_I_LTEQ,
+    CA_OPCODE_I_GT,
+    CA_OPCODE_I_GTEQ,
+    CA_OPCODE_I_EQ,
+    CA_OPCODE_I_NEQ,
+    CA_OPCODE_I_B_AND,
+    CA_OPCODE_I_B_XOR,
+    CA_OPCODE_I_B_OR,
+    CA_OPCODE_I_BOOL,
+    CA_OPCODE_I_JUMP_FALSE_OR_POP,
+    CA_OPCODE_I_JUMP_TRUE_OR_POP,
+    CA_OPCODE_I_ADD_CONST,
+    CA_OPCODE_I_SUB_CONST,
+    CA_OPCODE_I_MUL_CONST,
+    CA_OPCODE_I_ADD_VAR,
+    CA_OPCODE_I_SUB_VAR,
+    CA_OPCODE_I_MUL_VAR,
+    CA_OPCODE_I_MUL_ADD,
+    CA_OPCODE_I_MUL_ADD_VAR,
+    CA_OPCODE_I_SQUARE,
+    CA_OPCODE_I_CUBE,
+    CA_OPCODE_I_INC_VAR,
+    CA_OPCODE_I_STORE_POP,
+    CA_OPCODE_I_LT_JUMP_FALSE,
+    CA_OPCODE_I_LTEQ_JUMP_FALSE,
+    CA_OPCODE_I_GT_JUMP_FALSE,
+    CA_OPCODE_I_GTEQ_JUMP_FALSE,
+    CA_OPCODE_I_EQ_JUMP_FALSE,
+    CA_OPCODE_I_NEQ_JUMP_FALSE,
+    CA_OPCODE_I_LT_JUMP_TRUE,
+    CA_OPCODE_I_LTEQ_JUMP_TRUE,
+    CA_OPCODE_I_GT_JUMP_TRUE,
+    CA_OPCODE_I_GTEQ_JUMP_TRUE,
+    CA_OPCODE_I_EQ_JUMP_TRUE,
+    CA_OPCODE_I_NEQ_JUMP_TRUE,
+    CA_OPCODE_TO_REAL,          ///< Converts the CaInt arg values down, 1
+                                ///< being b, to a CaReal.
+    CA_OPCODE_TO_INT,           ///< Converts the CaReal arg values down to a
+                                ///< CaInt, truncating it.
+    CA_OPCODE_COUNT
 } CaOpcode;
+
+/// An instruction.
+typedef struct CaInstr {
+    uint8_t op;    ///< A CaOpcode.
+    uint8_t pad;
+    uint16_t n;    ///< Number of arguments, for calls.
+    uint32_t arg;  ///< Constant index, symbol ID, or instruction index.
+} CaInstr;
+
+struct CaJit;
+struct CaTyped;
+
+/// Compiled code of an expression.
+typedef struct CaCode {
+    CaInstr *instrs;
+    CaSize count;
+    CaSize capacity;
+    CaReal *consts;       ///< Constants pushed by CA_OPCODE_PUSH_CONST.
+    uint8_t *const_types; ///< CaType each constant was written as.
+    CaInt *iconsts;       ///< Value of each constant written as an integer.
+    CaSize nconsts;
+    CaSize consts_capacity;
+    CaSize depth;         ///< Data stack slots needed to run the code.
+    CaSize ntemps;        ///< Temporaries the code needs, besides depth.
+    struct CaJit *jit;    ///< Native code of the code, if any (see jit.h).
+    struct CaTyped *typed;///< Typed code of the code, if any (see infer.h).
+} CaCode;
+
+/// Whether an opcode jumps to instruction arg.
+#define CA_OPCODE_ISJUMP(op) ((op) == CA_OPCODE_JUMP ||                   \
+                              (op) == CA_OPCODE_JUMP_FALSE_OR_POP ||      \
+                              (op) == CA_OPCODE_JUMP_TRUE_OR_POP ||       \
+                              (op) == CA_OPCODE_I_JUMP_FALSE_OR_POP ||    \
+                              (op) == CA_OPCODE_I_JUMP_TRUE_OR_POP ||     \
+                              ((op) >= CA_OPCODE_LT_JUMP_FALSE &&         \
+                               (op) <= CA_OPCODE_NEQ_JUMP_TRUE) ||        \
+                              ((op) >= CA_OPCODE_I_LT_JUMP_FALSE &&       \
+                               (op) <= CA_OPCODE_I_NEQ_JUMP_TRUE))
+
+/// Name of each opcode.
+extern const char *const ca_opcode_names[CA_OPCODE_COUNT];
+
+/**
+ * \brief Initialises an empty CaCode. Nothing is allocated until something
+ *        is added to it.
+ * \param code The code.
+ */
+void ca_code_init(CaCode *code);
+
+/**
+ * \brief Frees a CaCode.
+ * \param code The code.
+ */
+void ca_code_free(CaCode *code);
+
+/**
+ * \brief Empties a CaCode, keeping its memory. Any native or typed code is
+ *        freed.
+ * \param code The code.
+ */
+void ca_code_reset(CaCode *code);
+
+/**
+ * \brief Copies a CaCode, but for any native or typed code.
+ * \param dst The copy, which must be empty.
+ * \param src The code.
+ * \return An error code.
+ */
+CaError ca_code_copy(CaCode *dst, const CaCode *src);
+
+/**
+ * \brief Adds an instruction to the end of a CaCode.
+ * \param code The code.
+ * \param op The opcode.
+ * \param arg The argument of the instruction.
+ * \param n The number of arguments, for calls.
+ * \return An error code.
+ */
+CaError ca_code_emit(CaCode *code, CaOpcode op, uint32_t arg, uint16_t n);
+
+/**
+ * \brief Adds a CaReal constant to a CaCode.
+ * \param code The code.
+ * \param value The constant.
+ * \param index The index of the constant.
+ * \return An error code.
+ */
+CaError ca_code_const(CaCode *code, CaReal value, uint32_t *index);
+
+/**
+ * \brief Adds a constant written as an integer to a CaCode. It is kept both
+ *        as it is, in iconsts, and as the nearest CaReal, in consts.
+ * \param code The code.
+ * \param value The constant.
+ * \param index The index of the constant.
+ * \return An error code.
+ */
+CaError ca_code_iconst(CaCode *code, CaInt value, uint32_t *index);
+
+/**
+ * \brief Checks whether a constant was written as an integer, so that its
+ *        exact value is in iconsts.
+ * \param code The code.
+ * \param k The index of the constant.
+ */
+static inline int ca_code_const_int(const CaCode *code, uint32_t k)
+{
+    return code->const_types[k] == CA_TYPE_INT;
+}
+
+/**
+ * \brief Prints the instructions of a CaCode, one on each line. Useful for
+ *        debugging.
+ * \param code The code.
+ * \param symbols The symbol table the code was compiled with, or NULL.
+ * \param f The file to print to.
+ */
+void ca_code_print(const CaCode *code, const CaSymbols *symbols, FILE *f);
+
+#endif
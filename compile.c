@@ -0,0 +1,475 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file compile.c
+ * \author Anamitra Ghorui
+ * \brief Expression to bytecode compiler
+ */
+
+#include "compile.h"
+#include "num.h"
+#include "std.h"
+
+#include <stdlib.h>
+
+/*
+ * Expressions are compiled with the shunting yard algorithm. Values are
+ * written to the code as they are read, and operators are kept on the oper
+ * stack until they are applied, when an operator of lower precedence (a
+ * higher CaOperPrec) follows them, when their bracket is closed, or at the
+ * end of the expression. The code is therefore the expression in postfix
+ * order, and runs on a plain data stack.
+ *
+ * The value stack mirrors the data stack the code runs on, recording the
+ * variable each value is read from, so that assignments and postfix
+ * operators know what to store to. A name is only compiled once the token
+ * after it is read: before '=', it is the left side of an assignment, and is
+ * never read, and before '(', it is a function call.
+ *
+ * '&&' and '||' skip their right side with a jump, which is given its target
+ * once the right side is compiled. ',' separates the arguments of a call, and
+ * elsewhere drops the value on its left.
+ */
+
+#define OPERATOR_ISUNARY(oper) ((oper)->prec == PRECEDENCE_UNARY)
+
+/* Exponentiation and assignments group right to left. */
+#define OPERATOR_ISRIGHT(oper) ((oper)->prec == PRECEDENCE_EXPONENTIAL || \
+                                (oper)->prec == PRECEDENCE_ASSIGNMENT)
+
+/* The opcode of each binary operator, and of each compound assignment. */
+static const uint8_t ca_compile_binary[] = {
+    [OPER_ID_POWER]                 = CA_OPCODE_POWER,
+    [OPER_ID_MULTIPLICATION]        = CA_OPCODE_MULTIPLICATION,
+    [OPER_ID_DIVISION]              = CA_OPCODE_DIVISION,
+    [OPER_ID_REMAINDER]             = CA_OPCODE_REMAINDER,
+    [OPER_ID_ADDITION]              = CA_OPCODE_ADDITION,
+    [OPER_ID_SUBTRACTION]           = CA_OPCODE_SUBTRACTION,
+    [OPER_ID_LSHIFT]                = CA_OPCODE_LSHIFT,
+    [OPER_ID_RSHIFT]                = CA_OPCODE_RSHIFT,
+    [OPER_ID_LT]                    = CA_OPCODE_LT,
+    [OPER_ID_LTEQ]                  = CA_OPCODE_LTEQ,
+    [OPER_ID_GT]                    = CA_OPCODE_GT,
+    [OPER_ID_GTEQ]                  = CA_OPCODE_GTEQ,
+    [OPER_ID_EQ]                    = CA_OPCODE_EQ,
+    [OPER_ID_NEQ]                   = CA_OPCODE_NEQ,
+    [OPER_ID_B_AND]                 = CA_OPCODE_B_AND,
+    [OPER_ID_B_XOR]                 = CA_OPCODE_B_XOR,
+    [OPER_ID_B_OR]                  = CA_OPCODE_B_OR,
+    [OPER_ID_ADDITION_ASSIGN]       = CA_OPCODE_ADDITION,
+    [OPER_ID_SUBTRACTION_ASSIGN]    = CA_OPCODE_SUBTRACTION,
+    [OPER_ID_MULTIPLICATION_ASSIGN] = CA_OPCODE_MULTIPLICATION,
+    [OPER_ID_DIVISION_ASSIGN]       = CA_OPCODE_DIVISION,
+    [OPER_ID_REMAINDER_ASSIGN]      = CA_OPCODE_REMAINDER,
+};
+
+void ca_compiler_begin(CaCompiler *cc, CaCode *code)
+{
+    cc->code     = code;
+    cc->ntokens  = 0;
+    cc->operand  = 0;
+    cc->noun     = CA_SYMBOL_NONE;
+    cc->njumps   = 0;
+    cc->depth    = 0;
+    cc->base     = 0;
+    cc->noper    = 0;
+    cc->nvalues  = 0;
+    ca_code_reset(code);
+}
+
+void ca_compiler_init(CaCompiler *cc)
+{
+    cc->oper           = NULL;
+    cc->oper_capacity  = 0;
+    cc->value          = NULL;
+    cc->value_capacity = 0;
+    cc->noper          = 0;
+    cc->nvalues        = 0;
+}
+
+void ca_compiler_free(CaCompiler *cc)
+{
+    free(cc->oper);
+    free(cc->value);
+    ca_compiler_init(cc);
+}
+
+/* Makes room for one more entry of the given size on a stack of the
+ * compiler, doubling its capacity when it is full. */
+static CaError ca_compile_grow(void **stack, CaSize *capacity, CaSize count,
+                               size_t size)
+{
+    CaSize n;
+    void *p;
+
+    if (count < *capacity)
+        return CA_ERROR_OK;
+    n = *capacity ? *capacity * 2 : CA_STACK_SIZE;
+    if (!(p = realloc(*stack, n * size)))
+        return CA_ERROR_MEM;
+    *stack    = p;
+    *capacity = n;
+    return CA_ERROR_OK;
+}
+
+/* Adds an operator to the oper stack. */
+static inline CaError ca_compile_push_oper(CaCompiler *cc, CaCompileOper o)
+{
+    CaError err;
+
+    if ((err = ca_compile_grow((void **) &cc->oper, &cc->oper_capacity,
+                               cc->noper, sizeof(CaCompileOper))) !=
+        CA_ERROR_OK)
+        return err;
+    cc->oper[cc->noper++] = o;
+    return CA_ERROR_OK;
+}
+
+/* Adds a value to the value stack. */
+static inline CaError ca_compile_push(CaCompiler *cc, CaSymbol name,
+                                      int loaded)
+{
+    CaError err;
+
+    if ((err = ca_compile_grow((void **) &cc->value, &cc->value_capacity,
+                               cc->nvalues, sizeof(CaCompileValue))) !=
+        CA_ERROR_OK)
+        return err;
+    cc->value[cc->nvalues++] = (CaCompileValue) { name, loaded };
+    if (loaded && ++cc->depth > cc->code->depth)
+        cc->code->depth = cc->depth;
+    return CA_ERROR_OK;
+}
+
+/* Pops the top n values, which must all be on the data stack. */
+static inline CaError ca_compile_pop(CaCompiler *cc, CaSize n)
+{
+    if (cc->nvalues < cc->base + n)
+        return CA_ERROR_STACK_EMPTY;
+    for (CaSize i = cc->nvalues - n; i < cc->nvalues; i++)
+        if (!cc->value[i].loaded)
+            return CA_ERROR_EVAL_NOT_LVALUE;
+    cc->nvalues -= n;
+    cc->depth   -= n;
+    return CA_ERROR_OK;
+}
+
+/* Compiles the name read before the operator next, or the end of the
+ * expression if next is NULL. */
+static CaError ca_compile_noun(CaCompiler *cc, const CaOperator *next)
+{
+    CaSymbol name = cc->noun;
+    CaError err;
+
+    cc->noun = CA_SYMBOL_NONE;
+    if (next && next->id == OPER_ID_ASSIGN)
+        return ca_compile_push(cc, name, 0);
+    if ((err = ca_code_emit(cc->code, CA_OPCODE_LOAD, name, 0)) != CA_ERROR_OK)
+        return err;
+    return ca_compile_push(cc, name, 1);
+}
+
+/* Applies an operator to the values on top of the value stack. */
+static CaError ca_compile_apply(CaCompiler *cc, const CaCompileOper *o)
+{
+    const CaOperator *oper = o->oper;
+    CaCompileValue *a;
+    CaError err;
+
+    if (oper->id == OPER_ID_AND || oper->id == OPER_ID_OR) {
+        if ((err = ca_compile_pop(cc, 1)) != CA_ERROR_OK)
+            return err;
+        cc->code->instrs[o->jump].arg = cc->code->count;
+        cc->njumps--;
+        if ((err = ca_code_emit(cc->code, CA_OPCODE_BOOL, 0, 0)) !=
+            CA_ERROR_OK)
+            return err;
+        return ca_compile_push(cc, CA_SYMBOL_NONE, 1);
+    }
+
+    if (oper->prec != PRECEDENCE_ASSIGNMENT) {
+        if ((err = ca_compile_pop(cc, 2)) != CA_ERROR_OK)
+            return err;
+        err = ca_code_emit(cc->code, ca_compile_binary[oper->id], 0, 0);
+        if (err != CA_ERROR_OK)
+            return err;
+        return ca_compile_push(cc, CA_SYMBOL_NONE, 1);
+    }
+
+    /* The left side of an assignment must be a name. Only that of a compound
+     * assignment is read. */
+    if (cc->nvalues < cc->base + 2)
+        return CA_ERROR_STACK_EMPTY;
+    a = &cc->value[cc->nvalues - 2];
+    if (a->name == CA_SYMBOL_NONE || !cc->value[cc->nvalues - 1].loaded ||
+        (oper->id == OPER_ID_ASSIGN) == a->loaded)
+        return CA_ERROR_EVAL_NOT_LVALUE;
+
+    if (oper->id != OPER_ID_ASSIGN &&
+        (err = ca_code_emit(cc->code, ca_compile_binary[oper->id], 0, 0)) !=
+        CA_ERROR_OK)
+        return err;
+    if ((err = ca_code_emit(cc->code, CA_OPCODE_STORE, a->name, 0)) !=
+        CA_ERROR_OK)
+        return err;
+
+    cc->depth   -= a->loaded ? 2 : 1;
+    cc->nvalues -= 2;
+    return ca_compile_push(cc, CA_SYMBOL_NONE, 1);
+}
+
+/* Applies every operator of the innermost bracket. The bracket itself is
+ * popped if close is set. */
+static CaError ca_compile_close(CaCompiler *cc, int close)
+{
+    const CaCompileOper *o;
+    CaError err;
+
+    while (cc->noper) {
+        o = &cc->oper[cc->noper - 1];
+        if (o->oper->id == OPER_ID_NEST) {
+            if (close)
+                cc->noper--;
+            return CA_ERROR_OK;
+        }
+        if ((err = ca_compile_apply(cc, o)) != CA_ERROR_OK)
+            return err;
+        cc->noper--;
+    }
+    return close ? CA_ERROR_EVAL_SYNTAX_NO_OPENING_PARANTHESIS : CA_ERROR_OK;
+}
+
+/* Handles the closing bracket of a call, or of a plain bracket. */
+static CaError ca_compile_nest_close(CaCompiler *cc)
+{
+    CaCompileOper o;
+    CaSize nargs;
+    CaError err;
+
+    if ((err = ca_compile_close(cc, 1)) != CA_ERROR_OK)
+        return err;
+    o     = cc->oper[cc->noper];
+    nargs = cc->nvalues - cc->base;
+
+    if (o.call == CA_SYMBOL_NONE) {
+        if (nargs != 1)
+            return nargs ? CA_ERROR_EVAL : CA_ERROR_STACK_EMPTY;
+        cc->base = o.base;
+        /* The value is no longer a name that may be assigned to. */
+        cc->value[cc->nvalues - 1].name = CA_SYMBOL_NONE;
+        return CA_ERROR_OK;
+    }
+
+    /* A trailing ',' */
+    if (nargs && !cc->operand)
+        return CA_ERROR_EVAL;
+    if ((err = ca_compile_pop(cc, nargs)) != CA_ERROR_OK)
+        return err;
+    cc->base = o.base;
+    if ((err = ca_code_emit(cc->code, CA_OPCODE_EXT_CALL, o.call, nargs)) !=
+        CA_ERROR_OK)
+        return err;
+    return ca_compile_push(cc, CA_SYMBOL_NONE, 1);
+}
+
+/* Handles ',', which either ends an argument of a call, or drops the value
+ * on its left. */
+static CaError ca_compile_comma(CaCompiler *cc)
+{
+    CaError err;
+
+    if (!cc->operand)
+        return CA_ERROR_EVAL;
+    if ((err = ca_compile_close(cc, 0)) != CA_ERROR_OK)
+        return err;
+    if (cc->noper && cc->oper[cc->noper - 1].call != CA_SYMBOL_NONE)
+        return CA_ERROR_OK;
+    if ((err = ca_compile_pop(cc, 1)) != CA_ERROR_OK)
+        return err;
+    return ca_code_emit(cc->code, CA_OPCODE_POP, 0, 0);
+}
+
+/* Handles a postfix operator, which is applied as soon as it is read. */
+static CaError ca_compile_postfix(CaCompiler *cc, const CaOperator *oper)
+{
+    CaCompileValue *a;
+    CaError err;
+
+    if (cc->nvalues <= cc->base)
+        return CA_ERROR_STACK_EMPTY;
+    a = &cc->value[cc->nvalues - 1];
+    if (a->name == CA_SYMBOL_NONE)
+        return CA_ERROR_OK;
+
+    err = ca_code_emit(cc->code, oper->id == OPER_ID_DECREMENT ?
+                                 CA_OPCODE_POST_DEC : CA_OPCODE_POST_INC,
+                       a->name, 0);
+    a->name = CA_SYMBOL_NONE;
+    return err;
+}
+
+/* Handles an operator read from the expression. Operators that bind tighter
+ * than it, or as tight if it groups left to right, are applied first. */
+static CaError ca_compile_oper(CaCompiler *cc, const CaOperator *oper)
+{
+    CaCompileOper o = { oper, CA_SYMBOL_NONE, 0, 0 };
+    const CaOperator *prev;
+    CaOpcode jump;
+    CaError err;
+
+    switch (oper->id) {
+    case OPER_ID_NEST_CLOSE:
+        return ca_compile_nest_close(cc);
+
+    case OPER_ID_COMMA:
+        return ca_compile_comma(cc);
+
+    case OPER_ID_NEST:
+        /* A value followed by a bracket, other than a call. */
+        if (cc->operand)
+            return CA_ERROR_EVAL;
+        o.base   = cc->base;
+        cc->base = cc->nvalues;
+        break;
+
+    default:
+        if (oper->prec == PRECEDENCE_UNKNOWN)
+            return CA_ERROR_EVAL_UNKNOWN_OPERATOR;
+
+        if (OPERATOR_ISUNARY(oper))
+            return ca_compile_postfix(cc, oper);
+
+        while (cc->noper) {
+            prev = cc->oper[cc->noper - 1].oper;
+            if (prev->id == OPER_ID_NEST || prev->prec > oper->prec ||
+                (prev->prec == oper->prec && OPERATOR_ISRIGHT(oper)))
+                break;
+            if ((err = ca_compile_apply(cc, &cc->oper[cc->noper - 1])) !=
+                CA_ERROR_OK)
+                return err;
+            cc->noper--;
+        }
+
+        /* The left side is complete, so it can be tested. */
+        if (oper->id == OPER_ID_AND || oper->id == OPER_ID_OR) {
+            if ((err = ca_compile_pop(cc, 1)) != CA_ERROR_OK)
+                return err;
+            jump = oper->id == OPER_ID_AND ? CA_OPCODE_JUMP_FALSE_OR_POP :
+                                             CA_OPCODE_JUMP_TRUE_OR_POP;
+            o.jump = cc->code->count;
+            if ((err = ca_code_emit(cc->code, jump, 0, 0)) != CA_ERROR_OK)
+                return err;
+            cc->njumps++;
+        }
+    }
+
+    return ca_compile_push_oper(cc, o);
+}
+
+CaError ca_compiler_token(CaCompiler *cc, const char *buf, const CaToken *t)
+{
+    const CaOperator *oper;
+    uint32_t index;
+    CaVar num;
+    CaInt i;
+    CaError err;
+
+    cc->ntokens++;
+
+    switch (t->guess) {
+    case CA_GUESS_INTEGER:
+    case CA_GUESS_FLOAT:
+    case CA_GUESS_NOUN:
+        /* Two values in a row. */
+        if (cc->operand)
+            return CA_ERROR_EVAL;
+        cc->operand = 1;
+        if (t->guess == CA_GUESS_NOUN) {
+            cc->noun = t->id;
+            return CA_ERROR_OK;
+        }
+        if ((err = ca_parse_number(buf + t->pos, t->size, &num)) !=
+            CA_ERROR_OK)
+            return err;
+        if (ca_std_get_int(&num, &i))
+            err = ca_code_iconst(cc->code, i, &index);
+        else
+            err = ca_code_const(cc->code, ca_std_real(&num), &index);
+        ca_std_release(&num);
+        if (err != CA_ERROR_OK)
+            return err;
+        if ((err = ca_code_emit(cc->code, CA_OPCODE_PUSH_CONST, index, 0)) !=
+            CA_ERROR_OK)
+            return err;
+        return ca_compile_push(cc, CA_SYMBOL_NONE, 1);
+
+    case CA_GUESS_OPERATOR:
+        oper = ca_token_oper(t);
+        if (cc->noun != CA_SYMBOL_NONE) {
+            /* A name followed by a bracket is a call. */
+            if (oper->id == OPER_ID_NEST) {
+                if ((err = ca_compile_push_oper(cc, (CaCompileOper) {
+                         oper, cc->noun, cc->base, 0
+                     })) != CA_ERROR_OK)
+                    return err;
+                cc->base    = cc->nvalues;
+                cc->noun    = CA_SYMBOL_NONE;
+                cc->operand = 0;
+                return CA_ERROR_OK;
+            }
+            if ((err = ca_compile_noun(cc, oper)) != CA_ERROR_OK)
+                return err;
+        }
+        err = ca_compile_oper(cc, oper);
+        /* A closing bracket, or postfix operator leaves a value behind. */
+        cc->operand = oper->id == OPER_ID_NEST_CLOSE || OPERATOR_ISUNARY(oper);
+        return err;
+
+    case CA_GUESS_STRING:
+        return CA_ERROR_EVAL_UNSUPPORTED;
+
+    default:
+        return CA_ERROR_EVAL;
+    }
+}
+
+CaError ca_compiler_end(CaCompiler *cc)
+{
+    CaError err;
+
+    if (!cc->ntokens)
+        return CA_ERROR_EVAL_END;
+
+    if (cc->noun != CA_SYMBOL_NONE &&
+        (err = ca_compile_noun(cc, NULL)) != CA_ERROR_OK)
+        return err;
+
+    while (cc->noper) {
+        if (cc->oper[cc->noper - 1].oper->id == OPER_ID_NEST)
+            return CA_ERROR_EVAL_SYNTAX_NO_CLOSING_PARANTHESIS;
+        if ((err = ca_compile_apply(cc, &cc->oper[cc->noper - 1])) !=
+            CA_ERROR_OK)
+            return err;
+        cc->noper--;
+    }
+
+    if (cc->nvalues != 1)
+        return cc->nvalues ? CA_ERROR_EVAL : CA_ERROR_STACK_EMPTY;
+    return ca_code_emit(cc->code, CA_OPCODE_END, 0, 0);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file compile.h
+ * \author Anamitra Ghorui
+ * \brief Expression to bytecode compiler
+ *
+ */
+
+#ifndef CA_COMPILE_H
+#define CA_COMPILE_H
+
+#include "command_stack.h"
+#include "stack.h"
+#include "token.h"
+#include "error.h"
+#include "types.h"
+
+#include <stdint.h>
+
+/// An operator waiting on the oper stack of a compiler.
+typedef struct CaCompileOper {
+    const CaOperator *oper;
+    CaSymbol call;  ///< The function called, if the operator is the bracket
+                    ///< of a call. Else CA_SYMBOL_NONE.
+    uint32_t base;  ///< The base of the enclosing bracket, for brackets.
+    uint32_t jump;  ///< The jump to the end of the right side, for && and ||.
+} CaCompileOper;
+
+/// A value that the compiled code leaves on the data stack.
+typedef struct CaCompileValue {
+    CaSymbol name;   ///< Variable the value is read from, or CA_SYMBOL_NONE.
+    uint8_t loaded;  ///< 0 if the value is the left side of an assignment,
+                     ///< and so not on the data stack.
+} CaCompileValue;
+
+/// State of an expression being compiled, one token at a time.
+typedef struct CaCompiler {
+    CaCode *code;     ///< Where instructions are written.
+    CaSize ntokens;   ///< Tokens read.
+    int operand;      ///< Whether the last token read left a value.
+    CaSymbol noun;    ///< A name read, that has not been compiled yet.
+    CaSize njumps;    ///< Jumps that do not have a target yet.
+    CaSize depth;     ///< Values on the data stack.
+    CaSize base;      ///< Values outside the innermost bracket.
+    CaSize noper;
+    CaSize oper_capacity;
+    CaCompileOper *oper;
+    CaSize nvalues;
+    CaSize value_capacity;
+    CaCompileValue *value;
+} CaCompiler;
+
+/**
+ * \brief Initialises a compiler, with empty oper and value stacks that grow
+ *        as an expression nests deeper.
+ * \param cc The compiler.
+ */
+void ca_compiler_init(CaCompiler *cc);
+
+/**
+ * \brief Frees the stacks of a compiler.
+ * \param cc The compiler.
+ */
+void ca_compiler_free(CaCompiler *cc);
+
+/**
+ * \brief Starts compiling an expression.
+ * \param cc The compiler.
+ * \param code Where the code is written. It is emptied first.
+ */
+void ca_compiler_begin(CaCompiler *cc, CaCode *code);
+
+/**
+ * \brief Compiles the next token of an expression.
+ * \param cc The compiler.
+ * \param buf The buffer the token is in.
+ * \param t The token. Nouns must have been interned.
+ * \return An error code. The expression must be started again after an error.
+ */
+CaError ca_compiler_token(CaCompiler *cc, const char *buf, const CaToken *t);
+
+/**
+ * \brief Finishes compiling an expression, ending the code with
+ *        CA_OPCODE_END. The code leaves one value, that of the expression.
+ * \param cc The compiler.
+ * \return An error code. CA_ERROR_EVAL_END if the expression is empty.
+ */
+CaError ca_compiler_end(CaCompiler *cc);
+
+/**
+ * \brief Checks whether all of the code written so far can be run, and
+ *        removed from the code, before the expression is finished. This is not
+ *        the case while a jump is waiting for its target.
+ * \param cc The compiler.
+ */
+static inline int ca_compiler_can_flush(const CaCompiler *cc)
+{
+    return !cc->njumps;
+}
+
+#endif
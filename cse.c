@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file cse.c
+ * \author Anamitra Ghorui
+ * \brief Common subexpression elimination for compiled code
+ */
+
+#include "cse.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The code is read once, front to back, keeping the value number of every
+ * value on the data stack, and the first instruction of the ones computing
+ * it, which, the stack being a stack, are all the instructions from there on.
+ * The instructions computing a value again can be removed if none of them has
+ * a side effect, that is, if they all come after the last instruction with
+ * one.
+ *
+ * Values are only reused within a block, code that no jump goes into or out
+ * of, so that the instructions computing a value the first time are always
+ * run before the ones that are removed. Removals are kept in order; one that
+ * contains the ones before it replaces them. The code is then rewritten once,
+ * front to back, and the targets of jumps translated.
+ */
+
+/// No instruction, or no value number.
+#define CA_CSE_NONE UINT32_MAX
+
+/// Most temporaries code is given. Values computed again after that are
+/// computed again.
+#define CA_CSE_TEMPS 256
+
+/// A value the code computes.
+typedef struct CaCseValue {
+    uint32_t op;
+    uint32_t arg;
+    uint32_t a, b;   ///< Value numbers of the operands.
+    uint32_t block;  ///< Block the value was computed in.
+    uint32_t number; ///< CA_CSE_NONE for empty entries.
+    uint32_t def;    ///< Instruction computing the value first.
+} CaCseValue;
+
+/// A value on the data stack, or in a variable.
+typedef struct CaCseSlot {
+    uint32_t number;
+    uint32_t start;  ///< First instruction computing it, or its block.
+} CaCseSlot;
+
+/// Instructions computing value of instruction def again.
+typedef struct CaCseRemoval {
+    uint32_t start, end, def;
+} CaCseRemoval;
+
+typedef struct CaCse {
+    const CaCode *code;
+    CaCseValue *values;  ///< Open addressing hash table of values.
+    CaSize mask;
+    CaCseSlot *stack;
+    CaSize depth;
+    CaCseSlot *vars;     ///< Value in each variable, and its block.
+    CaSize nvars;
+    uint8_t *target;     ///< Whether each instruction is jumped to.
+    CaCseRemoval *removals;
+    CaSize nremovals;
+    uint32_t block;
+    uint32_t effect;     ///< Instruction after the last with a side effect.
+    uint32_t next;       ///< Next value number.
+} CaCse;
+
+static int ca_cse_same_const(const CaCode *code, uint32_t j, uint32_t k)
+{
+    CaReal x = code->consts[j], y = code->consts[k];
+
+    if (code->const_types[j] != code->const_types[k])
+        return 0;
+    if (ca_code_const_int(code, j))
+        return code->iconsts[j] == code->iconsts[k];
+    return x == y && !signbit(x) == !signbit(y);
+}
+
+/* Finds the value op computes with arg from values numbered a and b, or the
+ * empty entry it is to be added in. Constants are found by value. */
+static CaCseValue *ca_cse_find(CaCse *cse, uint32_t op, uint32_t arg,
+                               uint32_t a, uint32_t b)
+{
+    CaCseValue *v;
+    uint32_t h;
+    double d;
+
+    if (op == CA_OPCODE_PUSH_CONST) {
+        d = cse->code->consts[arg];
+        memcpy(&h, (char *) &d + 4, sizeof(h));
+        h ^= (uint32_t) d;
+    } else {
+        h = (op * 31 + arg) * 0x9E3779B1u ^ a * 0x85EBCA77u ^ b * 0xC2B2AE3Du;
+    }
+
+    for (CaSize i = h & cse->mask;; i = (i + 1) & cse->mask) {
+        v = &cse->values[i];
+        if (v->number == CA_CSE_NONE)
+            return v;
+        if (v->block != cse->block || v->op != op)
+            continue;
+        if (op == CA_OPCODE_PUSH_CONST ?
+            ca_cse_same_const(cse->code, v->arg, arg) :
+            v->arg == arg && v->a == a && v->b == b)
+            return v;
+    }
+}
+
+/* Pushes the value op computes at instruction i with arg from the values
+ * numbered a and b, which the instructions from start on compute. Those can
+ * be removed if the value has been computed before, and op is an operator. */
+static CaError ca_cse_push(CaCse *cse, uint32_t i, uint32_t op, uint32_t arg,
+                           uint32_t a, uint32_t b, uint32_t start,
+                           int oper)
+{
+    CaCseValue *v = ca_cse_find(cse, op, arg, a, b);
+    CaCseRemoval *removals;
+
+    if (v->number == CA_CSE_NONE)
+        *v = (CaCseValue) { op, arg, a, b, cse->block, cse->next++, i };
+    cse->stack[cse->depth++] = (CaCseSlot) { v->number, start };
+    if (v->def == i || !oper || start < cse->effect)
+        return CA_ERROR_OK;
+
+    while (cse->nremovals && cse->removals[cse->nremovals - 1].start >= start)
+        cse->nremovals--;
+    if (!(cse->nremovals & (cse->nremovals - 1))) {
+        removals = realloc(cse->removals,
+                           (cse->nremovals ? cse->nremovals * 2 : 1) *
+                           sizeof(CaCseRemoval));
+        if (!removals)
+            return CA_ERROR_MEM;
+        cse->removals = removals;
+    }
+    cse->removals[cse->nremovals++] = (CaCseRemoval) { start, i, v->def };
+    return CA_ERROR_OK;
+}
+
+/* Starts a new block at instruction i. */
+static void ca_cse_block(CaCse *cse, uint32_t i)
+{
+    cse->block++;
+    cse->effect = i;
+}
+
+/* Reads instruction i. Returns CA_ERROR_EVAL_UNSUPPORTED for instructions
+ * that are not written by the compiler. */
+static CaError ca_cse_instr(CaCse *cse, uint32_t i)
+{
+    const CaInstr *ip = &cse->code->instrs[i];
+    CaCseSlot a, b, *var;
+
+    if (cse->target[i]) {
+        ca_cse_block(cse, i);
+        /* The top value is the one of whichever instruction got here. */
+        if (cse->depth)
+            cse->stack[cse->depth - 1] = (CaCseSlot) { cse->next++, i };
+    }
+
+    switch ((CaOpcode) ip->op) {
+    case CA_OPCODE_END:
+        return CA_ERROR_OK;
+
+    case CA_OPCODE_PUSH_CONST:
+        return ca_cse_push(cse, i, ip->op, ip->arg, 0, 0, i, 0);
+
+    case CA_OPCODE_LOAD:
+        var = &cse->vars[ip->arg];
+        if (var->number == CA_CSE_NONE || var->start != cse->block)
+            *var = (CaCseSlot) { cse->next++, cse->block };
+        cse->stack[cse->depth++] = (CaCseSlot) { var->number, i };
+        return CA_ERROR_OK;
+
+    case CA_OPCODE_STORE:
+        cse->vars[ip->arg] = (CaCseSlot) { cse->stack[cse->depth - 1].number,
+                                           cse->block };
+        cse->effect = i + 1;
+        return CA_ERROR_OK;
+
+    case CA_OPCODE_POST_INC:
+    case CA_OPCODE_POST_DEC:
+        cse->vars[ip->arg] = (CaCseSlot) { cse->next++, cse->block };
+        cse->effect = i + 1;
+        return CA_ERROR_OK;
+
+    case CA_OPCODE_POP:
+        cse->depth--;
+        return CA_ERROR_OK;
+
+    /* Operands of commutative operators are sorted by value number, so that
+     * a + b is found as b + a. */
+    case CA_OPCODE_MULTIPLICATION:
+    case CA_OPCODE_ADDITION:
+    case CA_OPCODE_EQ:
+    case CA_OPCODE_NEQ:
+    case CA_OPCODE_B_AND:
+    case CA_OPCODE_B_XOR:
+    case CA_OPCODE_B_OR:
+        b = cse->stack[--cse->depth];
+        a = cse->stack[--cse->depth];
+        if (a.number > b.number)
+            return ca_cse_push(cse, i, ip->op, 0, b.number, a.number, a.start,
+                               1);
+        return ca_cse_push(cse, i, ip->op, 0, a.number, b.number, a.start, 1);
+
+    case CA_OPCODE_POWER:
+    case CA_OPCODE_DIVISION:
+    case CA_OPCODE_REMAINDER:
+    case CA_OPCODE_SUBTRACTION:
+    case CA_OPCODE_LSHIFT:
+    case CA_OPCODE_RSHIFT:
+    case CA_OPCODE_LT:
+    case CA_OPCODE_LTEQ:
+    case CA_OPCODE_GT:
+    case CA_OPCODE_GTEQ:
+        b = cse->stack[--cse->depth];
+        a = cse->stack[--cse->depth];
+        return ca_cse_push(cse, i, ip->op, 0, a.number, b.number, a.start, 1);
+
+    case CA_OPCODE_BOOL:
+        a = cse->stack[--cse->depth];
+        /* BOOL of a single value is no longer than reading a temporary. */
+        return ca_cse_push(cse, i, ip->op, 0, a.number, 0, a.start,
+                           a.start < i - 1);
+
+    /* The value tested is left on the stack where the jump is taken. */
+    case CA_OPCODE_JUMP_FALSE_OR_POP:
+    case CA_OPCODE_JUMP_TRUE_OR_POP:
+        ca_cse_block(cse, i + 1);
+        cse->depth--;
+        return CA_ERROR_OK;
+
+    /* A builtin may set variables, so none are known after a call. */
+    case CA_OPCODE_EXT_CALL:
+        ca_cse_block(cse, i + 1);
+        cse->depth -= ip->n;
+        cse->stack[cse->depth++] = (CaCseSlot) { cse->next++, i };
+        return CA_ERROR_OK;
+
+    default:
+        return CA_ERROR_EVAL_UNSUPPORTED;
+    }
+}
+
+/* Rewrites the code of cse, removing its removals. */
+static CaError ca_cse_rewrite(CaCse *cse, CaCode *code, CaSize *removed)
+{
+    uint32_t *temp, *map, ntemps = 0;
+    CaCseRemoval *r = cse->removals, *end = r + cse->nremovals;
+    CaInstr *instrs;
+    CaSize i, j, count = code->count;
+
+    temp   = malloc(count * sizeof(uint32_t));
+    map    = malloc((count + 1) * sizeof(uint32_t));
+    instrs = malloc(count * sizeof(CaInstr));
+    if (!temp || !map || !instrs) {
+        free(temp);
+        free(map);
+        free(instrs);
+        return CA_ERROR_MEM;
+    }
+
+    /* Each value computed again is saved to a temporary where it is
+     * computed first. */
+    memset(temp, 0xFF, count * sizeof(uint32_t));
+    for (CaCseRemoval *p = r; p < end; p++) {
+        if (temp[p->def] == CA_CSE_NONE && ntemps < CA_CSE_TEMPS)
+            temp[p->def] = ntemps++;
+    }
+
+    /* A removal saves at least two instructions, and a temporary costs one,
+     * so the code only shrinks. */
+    for (i = 0, j = 0; i < count;) {
+        if (r < end && r->start == i) {
+            if (temp[r->def] != CA_CSE_NONE) {
+                for (; i <= r->end; i++) {
+                    map[i] = j;
+                    if (code->instrs[i].op != CA_OPCODE_PUSH_CONST &&
+                        code->instrs[i].op != CA_OPCODE_LOAD &&
+                        code->instrs[i].op != CA_OPCODE_POP)
+                        (*removed)++;
+                }
+                instrs[j++] = (CaInstr) { .op = CA_OPCODE_LOAD_TEMP,
+                                          .arg = temp[r->def] };
+            }
+            r++;
+            continue;
+        }
+        map[i] = j;
+        instrs[j++] = code->instrs[i];
+        if (temp[i] != CA_CSE_NONE)
+            instrs[j++] = (CaInstr) { .op = CA_OPCODE_SAVE_TEMP,
+                                      .arg = temp[i] };
+        i++;
+    }
+    map[count] = j;
+
+    for (i = 0; i < j; i++)
+        if (CA_OPCODE_ISJUMP(instrs[i].op))
+            instrs[i].arg = map[instrs[i].arg];
+
+    free(code->instrs);
+    code->instrs   = instrs;
+    code->count    = j;
+    code->capacity = count;
+    code->ntemps   = ntemps;
+    free(temp);
+    free(map);
+    return CA_ERROR_OK;
+}
+
+CaError ca_code_cse(CaCode *code, CaSize *removed)
+{
+    CaCse cse = { code, NULL, 0, NULL, 0, NULL, 0, NULL, NULL, 0, 0, 0, 0 };
+    CaSize size = 1, i;
+    CaError err = CA_ERROR_MEM;
+
+    *removed = 0;
+    if (!code->count)
+        return CA_ERROR_OK;
+
+    for (i = 0; i < code->count; i++) {
+        switch (code->instrs[i].op) {
+        case CA_OPCODE_LOAD:
+        case CA_OPCODE_STORE:
+        case CA_OPCODE_POST_INC:
+        case CA_OPCODE_POST_DEC:
+            if (code->instrs[i].arg >= cse.nvars)
+                cse.nvars = code->instrs[i].arg + 1;
+            break;
+        }
+    }
+    while (size < code->count * 2)
+        size *= 2;
+    cse.mask = size - 1;
+
+    if (!(cse.values = malloc(size * sizeof(CaCseValue))) ||
+        !(cse.stack  = malloc((code->depth + 1) * sizeof(CaCseSlot))) ||
+        !(cse.vars   = malloc((cse.nvars + 1) * sizeof(CaCseSlot))) ||
+        !(cse.target = calloc(code->count + 1, 1)))
+        goto fail;
+    memset(cse.values, 0xFF, size * sizeof(CaCseValue));
+    memset(cse.vars, 0xFF, (cse.nvars + 1) * sizeof(CaCseSlot));
+    for (i = 0; i < code->count; i++)
+        if (CA_OPCODE_ISJUMP(code->instrs[i].op))
+            cse.target[code->instrs[i].arg] = 1;
+
+    for (i = 0; i < code->count; i++) {
+        if ((err = ca_cse_instr(&cse, i)) != CA_ERROR_OK)
+            break;
+    }
+
+    /* Code that is already optimised is left as it is. */
+    if (err == CA_ERROR_EVAL_UNSUPPORTED)
+        err = CA_ERROR_OK;
+    else if (err == CA_ERROR_OK && cse.nremovals)
+        err = ca_cse_rewrite(&cse, code, removed);
+
+fail:
+    free(cse.values);
+    free(cse.stack);
+    free(cse.vars);
+    free(cse.target);
+    free(cse.removals);
+    return err;
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file cse.h
+ * \author Anamitra Ghorui
+ * \brief Common subexpression elimination for compiled code
+ *
+ */
+
+/*
+ * Every value compiled code computes is given a value number, such that two
+ * values with the same number are known to be equal: constants of the same
+ * value, reads of a variable that is not set in between, and the same
+ * operator applied to values of the same numbers. When the code computes a
+ * value it has computed before, the instructions computing it again are
+ * replaced with a read of a temporary, which the instruction computing it
+ * the first time saves it to.
+ *
+ * Only instructions with no side effects are removed. Assignments, increments
+ * and calls to builtins are always kept, as are the instructions computing
+ * their operands, and a call is taken to change every variable.
+ */
+
+#ifndef CA_CSE_H
+#define CA_CSE_H
+
+#include "command_stack.h"
+#include "error.h"
+
+/**
+ * \brief Computes the repeated subexpressions of code once. The code gives
+ *        the same results, and the same errors, as before.
+ * \param code The code, as compiled, before any other optimisation.
+ * \param removed Set to the number of operators removed from the code.
+ * \return An error code.
+ */
+CaError ca_code_cse(CaCode *code, CaSize *removed);
+
+#endif
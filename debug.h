@@ -1,29 +0,0 @@
-/*
- * Copyright (c) 2020 Anamitra Ghorui
- * This file is part of Calcium.
- *
- * Calcium is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License as published by
- * the Free Software Foundation, either version 3 of the License, or
- * (at your option) any later version.
- *
- * Calcium is distributed in the hope that it will be useful,
- * but WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- * GNU General Public License for more details.
- *
- * You should have received a copy of the GNU General Public License
- * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
- */
-
-
-#ifndef CA_DEBUG_H
-#define CA_DEBUG_H
-
-#define DEBUG_TOGGLE
-
-#ifdef DEBUG_TOGGLE
-#   define CA_DBG_PLN printf("At: %s, ln: %d\n", __FILE__, __LINE__);
-#endif
-
-#endif
@@ -43,22 +43,51 @@ typedef enum CaError {
     CA_ERROR_EVAL,
     CA_ERROR_EVAL_SYNTAX_NO_OPENING_PARANTHESIS,
     CA_ERROR_EVAL_SYNTAX_NO_CLOSING_PARANTHESIS,
+    CA_ERROR_MEM,
+    CA_ERROR_JIT_UNSUPPORTED,
+    CA_ERROR_EVAL_UNKNOWN_OPERATOR,
+    CA_ERROR_EVAL_NOT_LVALUE,
+    CA_ERROR_EVAL_UNSUPPORTED,
+    CA_ERROR_NUM_INVALID,
+    CA_ERROR_NUM_RANGE,
+    CA_ERROR_EVAL_UNKNOWN_FUNCTION,
+    CA_ERROR_EVAL_ARGS,
+    CA_ERROR_EVAL_DIVISION_BY_ZERO,
+    CA_ERROR_IO,
+    CA_ERROR_EVAL_OVERFLOW,
     
     CA_ERROR_OK = 0,
 
     /* Info Errors */
     CA_ERROR_HASH_NEW = 0x1000,
     CA_ERROR_HASH_EXISTING,
+    CA_ERROR_EVAL_END,
 } CaError;
 
 #define ERRKEY(_code, _str) [_code + 0x1000] = _str
 
-char *ca_error_strings[] = {
+static const char *const ca_error_strings[] = {
     ERRKEY(CA_ERROR_HASH_INVALID_KEY, "Erroneous hash key: %s"),
     ERRKEY(CA_ERROR_HASH_NOTFOUND, "Key not found in table: %s"),
     ERRKEY(CA_ERROR_STACK_FULL, "Stack Overflow"),
     ERRKEY(CA_ERROR_STACK_EMPTY, "Stack Underflow"),
-    ERRKEY(CA_ERROR_EVAL, "Evaluation Error")
+    ERRKEY(CA_ERROR_EVAL, "Evaluation Error"),
+    ERRKEY(CA_ERROR_EVAL_SYNTAX_NO_OPENING_PARANTHESIS,
+           "Missing opening parenthesis"),
+    ERRKEY(CA_ERROR_EVAL_SYNTAX_NO_CLOSING_PARANTHESIS,
+           "Missing closing parenthesis"),
+    ERRKEY(CA_ERROR_MEM, "Out of memory"),
+    ERRKEY(CA_ERROR_JIT_UNSUPPORTED, "Native code not supported"),
+    ERRKEY(CA_ERROR_EVAL_UNKNOWN_OPERATOR, "Unknown operator: %s"),
+    ERRKEY(CA_ERROR_EVAL_NOT_LVALUE, "Cannot assign to expression"),
+    ERRKEY(CA_ERROR_EVAL_UNSUPPORTED, "Not implemented: %s"),
+    ERRKEY(CA_ERROR_NUM_INVALID, "Invalid number: %s"),
+    ERRKEY(CA_ERROR_NUM_RANGE, "Number out of range: %s"),
+    ERRKEY(CA_ERROR_EVAL_UNKNOWN_FUNCTION, "Unknown function: %s"),
+    ERRKEY(CA_ERROR_EVAL_ARGS, "Wrong number of arguments to %s"),
+    ERRKEY(CA_ERROR_EVAL_DIVISION_BY_ZERO, "Division by zero"),
+    ERRKEY(CA_ERROR_IO, "Input/output error"),
+    ERRKEY(CA_ERROR_EVAL_OVERFLOW, "Integer overflow")
 };
 
 #endif
@@ -17,223 +17,424 @@
  */
 
 #include "eval.h"
+#include "vm.h"
+#include "jit.h"
+#include "infer.h"
+#include "cse.h"
+#include "exact.h"
+#include "react.h"
+#include "std.h"
+#include "trace.h"
 
-#define IN_RANGE(x, l, h) (((x) >= (l)) && ((x) <= (h)))
-#define IS_ALPHA(x)  (IN_RANGE((x), 0x41, 0x5A) ||
-                      IN_RANGE((x), 0x61, 0x7A))
-#define IS_NUMBER(x) (IN_RANGE((x), 0x30, 0x39))
-#define IS_SYMBOL(x) (IN_RANGE((x), 0x21, 0x2F) ||
-                      IN_RANGE((x), 0x3A, 0x40) ||
-                      IN_RANGE((x), 0x5B, 0x60) ||
-                      IN_RANGE((x), 0x7B, 0x7E))
-
-
-char *guess_strings[] = {
-    [CA_GUESS_UNKNOWN]        = "unknown",
-    [CA_GUESS_ERROR]          = "error",
-    [CA_GUESS_NEED_MORE_DATA] = "incomplete",
-    [CA_GUESS_INTEGER]        = "int",
-    [CA_GUESS_FLOAT]          = "float",
-    [CA_GUESS_OPERATOR]       = "oper",
-    [CA_GUESS_NOUN]           = "noun",
-    [CA_GUESS_STRING]         = "string"
-};
-
-CaExpr *ca_tokenize(const char *data)
-{
-    ca_expr *e = calloc(1, sizeof(ca_expr));
-    if (!e)
+#include <string.h>
+
+/*
+ * Expressions are compiled to bytecode (see compile.c), which is run on the
+ * expr stack of the context (see vm.c). Names are interned as they are read,
+ * so variables and builtins are found by indexing vars and funcs with the
+ * symbol ID of their name.
+ *
+ * An expression evaluated one token at a time is run as it is compiled,
+ * every CA_EVAL_FLUSH_SIZE instructions or so, so that the code of a long
+ * expression is never kept whole. While any variable holds a CaBigInt, it is
+ * kept whole instead, as it may have to be run by the exact evaluator (see
+ * exact.h), which cannot be run in parts.
+ */
+
+CaContext *ca_context_init()
+{
+    CaContext *c = malloc(sizeof(CaContext));
+    if (!c)
         return NULL;
-    e->buf = data;
-    e->pos = 0;
-}
-
-/**
-* \brief Gets the next token, and the type from the expression.
-* \param expr The expression to read.
-* \param guess The type of the given token guessed by the compiler
-* \param start The start of the token. (inclusive)
-* \param end The end of the token. (inclusive)
-* \return An error code.
-*/
-CaError *ca_next_token(CaExpr *expr, int *size, CaGuess *guess, CaOperator **oper)
-{
-    *guess         = CA_GUESS_UNKNOWN;
-    char *start    = NULL;
-    int float_hint = 0;
-    char delimiter = '\0';
-    char curr_oper = '\0';
-    int i;
-
-    while (*c) {
-        switch (*c) {
-        case ' ': case '\n': case '\t':
-            if (*guess)
-                goto end;
-            goto next;
-
-        case '"':
-        case '\'':
-            delimiter = *c;
-            start = c;
-            while ((*++c) && *c != delimiter);
-            if (*c != delimiter) {
-                *guess = CA_GUESS_ERROR;
-                goto end;
-            } else {
-                *guess = CA_GUESS_STRING;
-                c++;
-                goto end;
-            }
+    c->flags = 0;
+    c->level = 0;
+    c->optimize = CA_OPTIMIZE_DEFAULT;
+    c->vars  = NULL;
+    c->nvars = 0;
+    c->nbigints = 0;
+    c->funcs = NULL;
+    c->nfuncs = 0;
+    c->generation = 0;
+    c->cse_removed = 0;
+    c->reactive = NULL;
+    c->error = NULL;
+    c->error_size = 0;
+    c->expr  = ca_stack_init(CA_STACK_SIZE);
+    ca_compiler_init(&c->compiler);
+    ca_code_init(&c->code);
+    ca_token_list_init(&c->tokens);
+    c->tokens.symbols = &c->symbols;
+    if (ca_symbols_init(&c->symbols) != CA_ERROR_OK || !c->expr) {
+        ca_context_free(c);
+        return NULL;
+    }
+
+    for (CaSize i = 0; i < ca_builtin_count; i++) {
+        if (ca_context_define(c, ca_builtin_list[i].name,
+                              ca_builtin_list[i].builtin.func,
+                              ca_builtin_list[i].builtin.nargs) !=
+            CA_ERROR_OK) {
+            ca_context_free(c);
+            return NULL;
         }
+    }
+
+    ca_eval_begin(c);
+    return c;
+}
+
+void ca_context_free(CaContext *c)
+{
+    ca_context_reactive(c, 0);
+    ca_symbols_free(&c->symbols);
+    if (c->expr)
+        ca_stack_free(c->expr);
+    ca_token_list_free(&c->tokens);
+    ca_code_free(&c->code);
+    ca_compiler_free(&c->compiler);
+    for (CaSize i = 0; c->nbigints && i < c->nvars; i++)
+        ca_std_release(&c->vars[i]);
+    free(c->vars);
+    free(c->funcs);
+    free(c);
+}
+
+CaError ca_context_reserve(CaContext *c)
+{
+    CaSize nvars;
+    CaVar *vars;
+
+    if (c->nvars >= c->symbols.count)
+        return CA_ERROR_OK;
+
+    /* Symbols are added in bulk as names are read, so vars is grown to
+     * cover all of them at once. */
+    nvars = c->symbols.capacity;
+    if (!(vars = realloc(c->vars, nvars * sizeof(CaVar))))
+        return CA_ERROR_MEM;
+    for (CaSize i = c->nvars; i < nvars; ++i)
+        ca_var_set_unknown(&vars[i]);
+    c->vars  = vars;
+    c->nvars = nvars;
+    return CA_ERROR_OK;
+}
+
+CaError ca_context_store(CaContext *c, CaSymbol name, CaReal value)
+{
+    CaVar v;
+
+    ca_var_set_real(&v, value);
+    return ca_context_set(c, name, &v);
+}
 
-        if (CIS_SYMBOL(*c)) { // non-alphanumeric
-            if (*c == '.' && *guess == CA_GUESS_INTEGER) { // Is this possibly a float?
-                float_hint = 1; // If so, store this "hinting"
-            } else if (*guess && *guess == CA_GUESS_OPERATOR) {
-                // printf("enter");
-                for (i = 1; oper_list[curr_oper][i].extra_symbol; i++) {
-                    if (oper_list[curr_oper][i].extra_symbol == *c) {
-                        c++;
-                        // printf("ending second\n");
-                        *oper = &oper_list[curr_oper][i];
-                        goto end;
-                    }
-                    // printf("iter\n");
-                }
-                // printf("ending first\n");
-                *oper = &oper_list[curr_oper][0];
-                goto end;
-
-            } else if (*guess && *guess != CA_GUESS_OPERATOR) { // Did we just read an entire chunk?
-                // printf("enter 2\n");
-                goto end;
-            } else if (!*guess) { // Is this the continuation or the start of a chunk?
-                // printf("enter else\n");
-                start = c;
-                curr_oper = *c;
-                /*
-                 * If this is only char, this is most definitely the operator
-                 * intended
-                 */
-                *oper = &oper_list[curr_oper][0]; 
-                *guess = CA_GUESS_OPERATOR;
-            }
-        } else if (CIS_ALPHA(*c)) { // alphabetical
-            if (*guess && *guess != CA_GUESS_NOUN)
-                goto end;
-            else if (!*guess)
-                start = c;
-            *guess = CA_GUESS_NOUN;
-        } else if (CIS_NUMBER(*c)) {  // numeric
-            if (float_hint && *guess == CA_GUESS_INTEGER) { // were we hinted about a float?
-                *guess = CA_GUESS_FLOAT; // yeah, this is most likely a float
-            } else if (*guess && (*guess != CA_GUESS_INTEGER && *guess != CA_GUESS_FLOAT)) {
-                goto end;
-            } else if (*guess == CA_GUESS_UNKNOWN) {
-                start = c;
-                *guess = CA_GUESS_INTEGER;
-            }
+CaError ca_context_set(CaContext *c, CaSymbol name, CaVar *value)
+{
+    CaError err;
+
+    if (name >= c->nvars && (err = ca_context_reserve(c)) != CA_ERROR_OK)
+        return err;
+
+    if (ca_var_is(&c->vars[name], CA_TYPE_BIGINT)) {
+        ca_std_release(&c->vars[name]);
+        c->nbigints--;
+    }
+    c->nbigints += ca_var_is(value, CA_TYPE_BIGINT);
+    c->vars[name] = *value;
+    ca_var_set_unknown(value);
+    return CA_ERROR_OK;
+}
+
+CaVar ca_context_take(CaContext *c, CaSymbol name)
+{
+    CaVar v = c->vars[name];
+
+    c->nbigints -= ca_var_is(&v, CA_TYPE_BIGINT);
+    ca_var_set_unknown(&c->vars[name]);
+    return v;
+}
+
+CaError ca_context_define(CaContext *c, const char *name, CaBuiltinFunc func,
+                          uint16_t nargs)
+{
+    CaSize nfuncs;
+    CaBuiltin *funcs;
+    CaSymbol id;
+    CaError err;
+
+    err = ca_symbols_intern(&c->symbols, name, strlen(name), &id);
+    if (err != CA_ERROR_OK)
+        return err;
+
+    if (id >= c->nfuncs) {
+        nfuncs = c->symbols.capacity;
+        if (!(funcs = realloc(c->funcs, nfuncs * sizeof(CaBuiltin))))
+            return CA_ERROR_MEM;
+        for (CaSize i = c->nfuncs; i < nfuncs; ++i)
+            funcs[i] = (CaBuiltin) { NULL, 0 };
+        c->funcs  = funcs;
+        c->nfuncs = nfuncs;
+    }
+
+    c->funcs[id] = (CaBuiltin) { func, nargs };
+    c->generation++;
+    return CA_ERROR_OK;
+}
+
+/* Optimises compiled code to the level set in the context. */
+static CaError ca_compile_optimize(CaContext *c, CaCode *code)
+{
+    CaSize removed;
+    CaError err;
+
+    if (c->optimize >= CA_OPTIMIZE_CSE) {
+        if ((err = ca_code_cse(code, &removed)) != CA_ERROR_OK)
+            return err;
+        c->cse_removed += removed;
+    }
+    err = ca_code_optimize(code, c->optimize);
+    CA_TRACE(CA_TRACE_INFO, EVAL, COMPILE, code->count, code->nconsts);
+    return err;
+}
+
+/* Infers the types of optimised code, and compiles it to native code, as the
+ * context asks. */
+static CaError ca_compile_types(CaContext *c, CaCode *code)
+{
+    CaError err;
+
+    /* Code without typed or native code is run on the VM as it is. Native
+     * code works on CaReal values only, so code with typed code, which
+     * keeps integers exact, is not compiled to it. */
+    if (c->optimize >= CA_OPTIMIZE_TYPES &&
+        ca_code_infer(c, code) == CA_ERROR_MEM)
+        return CA_ERROR_MEM;
+    if ((c->flags & CA_CONTEXT_JIT) && !code->typed) {
+        err = ca_jit_compile(code);
+        CA_TRACE(CA_TRACE_INFO, JIT, COMPILE, err,
+                 code->jit ? code->jit->mem_size : 0);
+        if (err == CA_ERROR_MEM)
+            return CA_ERROR_MEM;
+    }
+    return CA_ERROR_OK;
+}
+
+static CaError ca_compile_code(CaContext *c, CaExpr *s, CaCode *code)
+{
+    const CaToken *t, *end;
+    CaError err;
+
+    c->error = NULL;
+    ca_compiler_begin(&c->compiler, code);
+    if ((err = ca_tokenize(&c->tokens, s)) != CA_ERROR_OK)
+        return err;
+
+    end = c->tokens.tokens + c->tokens.count;
+    for (t = c->tokens.tokens; t < end; t++) {
+        c->error      = s->buf + t->pos;
+        c->error_size = t->size;
+        if ((err = ca_compiler_token(&c->compiler, s->buf, t)) != CA_ERROR_OK) {
+            CA_TRACE(CA_TRACE_ERROR, EVAL, ERROR, err, t->pos);
+            return err;
         }
-next:
-        c++;
     }
 
-end:
-    *size = (int) (c - start);
-    return start;
+    c->error = NULL;
+    if ((err = ca_compiler_end(&c->compiler)) != CA_ERROR_OK) {
+        CA_TRACE(CA_TRACE_ERROR, EVAL, ERROR, err, strlen(s->buf));
+        return err;
+    }
+    return ca_compile_optimize(c, code);
 }
 
+CaError ca_compile(CaContext *c, CaExpr *s, CaCode *code)
+{
+    CaError err;
 
-/**
- * \brief Initialises a context.
- * \return A pointer to the context.
+    if ((err = ca_compile_code(c, s, code)) != CA_ERROR_OK)
+        return err;
+    return ca_compile_types(c, code);
+}
+
+/*
+ * Code is run as native code if it has any and the variables it reads are
+ * CaReal, else as typed code if the variables it reads have the types it was
+ * inferred for, else as it is. Typed code that overflows is run again by the
+ * exact evaluator, as is all code touching a variable holding a CaBigInt, and
+ * code without typed code for the types of its variables that reads one
+ * holding a CaInt, such as cached code compiled while it held a CaReal.
  */
-ca_context *ca_context_init()
+CaError ca_run_var(CaContext *c, const CaCode *code, CaVar *result)
 {
-    ca_context *c = malloc(sizeof(ca_context));
-    c->flags = 0;
-    c->env  = ca_hash_init();
-    c->oper = ca_stack_init(CA_STACK_SIZE);
-    c->expr = ca_stack_init(CA_STACK_SIZE);
-    return c;
+    CaTyped *typed = NULL;
+    const CaCode *run = code;
+    CaReal r;
+    CaError err;
+
+    if (c->nbigints && ca_exact_needed(c, code))
+        goto exact;
+    if (code->jit && ca_jit_run(c, code, &r)) {
+        ca_var_set_real(result, r);
+        goto done;
+    }
+    if (code->typed && (run = ca_code_typed(c, code))) {
+        if ((err = ca_context_reserve(c)) != CA_ERROR_OK)
+            return err;
+        typed = code->typed;
+        ca_typed_save(c, typed);
+    } else if (ca_exact_reads_ints(c, code)) {
+        goto exact;
+    } else {
+        run = code;
+    }
+
+    c->expr->top = 0;
+    CA_TRACE(CA_TRACE_DEBUG, VM, RUN, run->count, run->depth);
+    if ((err = ca_vm_run(c, run)) == CA_ERROR_EVAL_OVERFLOW && typed) {
+        ca_typed_restore(c, typed);
+        goto exact;
+    }
+    if (err != CA_ERROR_OK) {
+        CA_TRACE(CA_TRACE_ERROR, VM, ERROR, err, run->count);
+        return err;
+    }
+    c->expr->top = 0;
+    if (typed && typed->type == CA_TYPE_INT) {
+        ca_var_set_unknown(result);
+        if ((err = ca_std_set_int(result, c->expr->data[0].value.i)) !=
+            CA_ERROR_OK)
+            return err;
+    } else {
+        ca_var_set_real(result, c->expr->data[0].value.f);
+    }
+    goto done;
+
+exact:
+    c->expr->top = 0;
+    if ((err = ca_exact_run(c, code, result)) != CA_ERROR_OK) {
+        CA_TRACE(CA_TRACE_ERROR, VM, ERROR, err, code->count);
+        ca_var_set_unknown(result);
+        return err;
+    }
+done:
+    return c->reactive ? ca_react_update(c, code) : CA_ERROR_OK;
+}
+
+CaError ca_run(CaContext *c, const CaCode *code, CaReal *result)
+{
+    CaVar v;
+    CaError err;
+
+    if ((err = ca_run_var(c, code, &v)) != CA_ERROR_OK)
+        return err;
+    *result = ca_std_real(&v);
+    ca_std_release(&v);
+    return CA_ERROR_OK;
 }
 
-/**
- * \brief Evaluates a given tokenised expression.
- * \param c The context.
- * \param s The expression.
- * \return An error code.
+void ca_eval_begin(CaContext *c)
+{
+    c->error      = NULL;
+    c->error_size = 0;
+    c->expr->top  = 0;
+    c->checked    = 0;
+    c->whole      = 0;
+    ca_compiler_begin(&c->compiler, &c->code);
+}
+
+/*
+ * Whether the code of the expression compiled so far computes CaReal values
+ * only, so that it gives the same values on the VM as it is as typed code
+ * or exactly would. That is the case if it has no integer constants, shifts
+ * or bitwise operators, and only reads variables holding a CaReal.
  */
-int operate(EvalContext *e, Operator *oper)
-{
-    Operator *prev_oper;
-    int push_operator = 1;
-
-    if (!oper) {
-        printf("oper end\n");
-        // End condition. Perform all operations left.
-        while (!stack_empty(e->os)) {
-            printf("oper top: %d\n", e->os.top);
-            stack_pop(&e->os, &oper);
-            operate_internal(e, oper);
-        }
-        printf("exiting\n");
-        return 0;
-    } else {
-        printf("oper enter: %d\n", oper->id);
-    }
-
-    // Closing Bracket?
-    if (oper->id == OPER_ID_NEST_CLOSE) {
-        printf("oper nest close\n");
-        // End condition of nested expression. Perform all operations left.
-        while (!stack_empty(e->os)) {
-            stack_pop(&e->os, &oper);
-            if (oper->id == OPER_ID_NEST) {
-                printf("bracket processed\n");
-                return 0;
-            }
-            operate_internal(e, oper);
+static int ca_eval_reals(CaContext *c)
+{
+    const CaInstr *ip;
+
+    for (; !c->whole && c->checked < c->code.count; c->checked++) {
+        ip = &c->code.instrs[c->checked];
+        switch ((CaOpcode) ip->op) {
+        case CA_OPCODE_PUSH_CONST:
+            c->whole = ca_code_const_int(&c->code, ip->arg);
+            break;
+        case CA_OPCODE_LOAD:
+        case CA_OPCODE_POST_INC:
+        case CA_OPCODE_POST_DEC:
+            c->whole = ip->arg >= c->nvars ||
+                       !ca_var_is(&c->vars[ip->arg], CA_TYPE_REAL);
+            break;
+        case CA_OPCODE_LSHIFT:
+        case CA_OPCODE_RSHIFT:
+        case CA_OPCODE_B_AND:
+        case CA_OPCODE_B_XOR:
+        case CA_OPCODE_B_OR:
+            c->whole = 1;
+            break;
+        default:
+            break;
         }
     }
+    return !c->whole;
+}
 
-    // Opening Bracket?
-    if (oper->id == OPER_ID_NEST) {
-        int v = stack_push(&e->os, &oper);
-        printf("oper nest open\n");
-        stack_push(&e->oper_scope_offset, &e->os.top);
-        printf("oper top = %d\n",e->os.top);
-        stack_push(&e->num_scope_offset, &v);
-        return 0;
-    }
-
-    // Is there a previous operator?
-    if (oper_scope_size(e)) {
-        stack_peek(&e->os, &prev_oper);
-        printf("oper scope > 1 prev_oper = %d\n", prev_oper->id);
-    }
-
-    switch (oper_scope_size(e)) {
-    // Push the operator. We need to look for the next operator before dealing
-    // with this one.
-    case 0:
-        printf("oper scope == 0\n");
-        stack_push(&e->os, &oper);
-        break;
-
-    default:
-        printf("oper scope > 0\n");
-        // Does previous operator have a higher precendence? If so, operate it
-        // first
-        if (prev_oper->prec <= oper->prec) { // is the expression something like `1 * 2 +` ?
-            printf("prev_oper prec >= curr prec with oper_id = %d\n", prev_oper->id);
-            operate_internal(e, prev_oper);
-            stack_pop(&e->os, &prev_oper);
-        }
-        // Push the current operator
-        stack_push(&e->os, &oper);
+CaError ca_eval_token(CaContext *c, const char *buf, const CaToken *t)
+{
+    CaError err;
+
+    c->error      = buf + t->pos;
+    c->error_size = t->size;
+    if ((err = ca_compiler_token(&c->compiler, buf, t)) != CA_ERROR_OK)
+        return err;
+
+    /* Reactive mode keeps the definitions of whole expressions. */
+    if (c->code.count < CA_EVAL_FLUSH_SIZE || c->nbigints || c->reactive ||
+        !ca_eval_reals(c) || !ca_compiler_can_flush(&c->compiler))
+        return CA_ERROR_OK;
+
+    /* Runs what is compiled so far, leaving its values on the stack. */
+    if ((err = ca_code_emit(&c->code, CA_OPCODE_END, 0, 0)) != CA_ERROR_OK ||
+        (err = ca_vm_run(c, &c->code)) != CA_ERROR_OK)
+        return err;
+    ca_code_reset(&c->code);
+    c->checked = 0;
+    return CA_ERROR_OK;
+}
+
+CaError ca_eval_end(CaContext *c, CaVar *result)
+{
+    CaError err;
+
+    c->error = NULL;
+    if ((err = ca_compiler_end(&c->compiler)) != CA_ERROR_OK)
+        return err;
+
+    if (!c->expr->top) {
+        if ((err = ca_compile_optimize(c, &c->code)) != CA_ERROR_OK ||
+            (err = ca_compile_types(c, &c->code)) != CA_ERROR_OK)
+            return err;
+        return ca_run_var(c, &c->code, result);
     }
-    
-    return 0;
+
+    /* The rest of an expression that was run in part is run on the CaReal
+     * values that part left, on the VM if it too computes CaReal values
+     * only, else exactly. */
+    if (!ca_eval_reals(c)) {
+        err = ca_exact_run(c, &c->code, result);
+        c->expr->top = 0;
+        return err;
+    }
+    if ((err = ca_vm_run(c, &c->code)) != CA_ERROR_OK)
+        return err;
+    ca_var_set_real(result, c->expr->data[--c->expr->top].value.f);
+    return CA_ERROR_OK;
+}
+
+CaError ca_eval(CaContext *c, CaExpr *s, CaReal *result)
+{
+    CaError err;
+
+    ca_eval_begin(c);
+    if ((err = ca_compile_code(c, s, &c->code)) != CA_ERROR_OK)
+        return err;
+    return ca_run(c, &c->code, result);
 }
@@ -27,7 +27,11 @@
 #define CA_EVAL_H
 
 #include "stack.h"
-#include "hashmap.h"
+#include "token.h"
+#include "builtin.h"
+#include "command_stack.h"
+#include "compile.h"
+#include "peephole.h"
 #include "error.h"
 #include "types.h"
 
@@ -35,55 +39,188 @@
 #include <stdint.h>
 #include <ctype.h>
 
+/// Instructions an expression read one token at a time may compile to before
+/// they are run, if they compute CaReal values only (see ca_eval_token).
+#define CA_EVAL_FLUSH_SIZE 256
 
-/// Contains the expression and the current location on the expression.
-typedef struct CaExpr CaExpr;
+/// Flag of a context: ca_compile also compiles code to native code where it
+/// can (see jit.h).
+#define CA_CONTEXT_JIT 0x1
 
-struct CaExpr {
-    CaSize pos;
-    const char *buf;
-};
+struct CaReactive;
 
 /// The "context" the evaluator runs on.
 typedef struct CaContext {
-    uint8_t flags;
+    uint8_t flags;       ///< CA_CONTEXT_ flags.
     uint16_t level;
-    CaHash env;
-    CaStack *oper;
-    CaStack *expr;
+    uint8_t optimize;    ///< Optimisation level of ca_compile (see peephole.h)
+    CaSymbols symbols;   ///< Every name read by the context.
+    CaVar *vars;         ///< Value of each symbol. CA_TYPE_UNKNOWN if unset.
+                         ///< The VM covers all symbols before running.
+    CaSize nvars;        ///< Number of entries in vars.
+    CaSize nbigints;     ///< Number of vars holding a CaBigInt.
+    CaBuiltin *funcs;    ///< Builtin of each symbol.
+    CaSize nfuncs;       ///< Number of entries in funcs.
+    uint32_t generation; ///< Changed whenever a builtin is defined.
+    CaSize cse_removed;  ///< Operators removed from compiled code (see cse.h).
+    struct CaReactive *reactive; ///< Definitions of variables, in reactive
+                                 ///< mode (see react.h), or NULL.
+    CaTokenList tokens;  ///< Tokens of the expression being evaluated.
+    const char *error;   ///< The token or name an error occured at, if any.
+    CaSize error_size;   ///< Size of the error token.
+    CaStack *expr;       ///< The data stack code is run on.
+    CaCode code;         ///< Code of the expression being evaluated.
+    CaSize checked;      ///< Instructions of code found to compute CaReal
+                         ///< values only.
+    int whole;           ///< Whether code must be run whole, at the end.
+    CaCompiler compiler;
 } CaContext;
 
 /**
- * \brief Takes a string and readies it for tokenisation.
- * \param data The string
- * \return Pointer to a ca_expr struct
+ * \brief Initialises a context.
+ * \return A pointer to the context.
  */
-CaExpr *ca_tokenize(const char *data);
+CaContext *ca_context_init();
 
 /**
-* \brief Gets the next token, and the type from the expression.
-* \param expr The expression to read.
-* \param type The type to write back.
-* \param start The start of the token.
-* \param end The end of the token.
-* \return An error code.
-*/
-CaError ca_next_token(CaExpr *expr, CaType *guess, CaSize *start, 
-                      CaSize *end);
+ * \brief Frees a context, and the variables defined in it.
+ * \param c The context.
+ */
+void ca_context_free(CaContext *c);
 
+/**
+ * \brief Gives every symbol of a context a slot in its vars, so that code
+ *        compiled for the context can index vars by symbol ID unchecked.
+ * \param c The context.
+ * \return An error code.
+ */
+CaError ca_context_reserve(CaContext *c);
 
 /**
- * \brief Initialises a context.
- * \return A pointer to the context.
+ * \brief Sets a variable.
+ * \param c The context.
+ * \param name The symbol ID of the variable.
+ * \param value The value.
+ * \return An error code.
  */
-CaContext *ca_context_init();
+CaError ca_context_store(CaContext *c, CaSymbol name, CaReal value);
+
+/**
+ * \brief Sets a variable to a value of any type, freeing its old value.
+ * \param c The context.
+ * \param name The symbol ID of the variable.
+ * \param value The value, which the variable takes. It is left unset.
+ * \return An error code.
+ */
+CaError ca_context_set(CaContext *c, CaSymbol name, CaVar *value);
+
+/**
+ * \brief Takes the value of a variable, leaving it unset.
+ * \param c The context.
+ * \param name The symbol ID of the variable, which must have a slot.
+ * \return The value, to be released with ca_std_release (see std.h).
+ */
+CaVar ca_context_take(CaContext *c, CaSymbol name);
+
+/**
+ * \brief Defines a builtin, replacing any builtin of the same name.
+ * \param c The context.
+ * \param name The NUL terminated name of the builtin.
+ * \param func The function, or NULL to remove the builtin.
+ * \param nargs The number of arguments it takes.
+ * \return An error code.
+ */
+CaError ca_context_define(CaContext *c, const char *name, CaBuiltinFunc func,
+                          uint16_t nargs);
 
 /**
- * \brief Evaluates a given expression.
+ * \brief Returns a value that changes whenever code compiled for a context
+ *        may have to be compiled again, as when a builtin is defined, or the
+ *        flags or optimisation level are changed.
  * \param c The context.
+ */
+static inline uint32_t ca_context_generation(const CaContext *c)
+{
+    return c->generation << 16 | c->flags << 8 | c->optimize;
+}
+
+/**
+ * \brief Compiles an expression, to be run any number of times with ca_run,
+ *        and optimises it to the level set in the context. With
+ *        CA_CONTEXT_JIT, it is also compiled to native code if it can be and
+ *        has no typed code, whose integers native code would not keep
+ *        exact.
+ *        Any expression being evaluated one token at a time is abandoned.
+ * \param c The context. The code may only be run on this context.
  * \param s The expression.
+ * \param code The code. It is emptied first.
+ * \return An error code. CA_ERROR_EVAL_END if the expression is empty.
+ */
+CaError ca_compile(CaContext *c, CaExpr *s, CaCode *code);
+
+/**
+ * \brief Runs compiled code. In reactive mode, the definitions reading the
+ *        variables it sets are then run again (see react.h).
+ * \param c The context the code was compiled for.
+ * \param code The code.
+ * \param result The value of the expression.
+ * \return An error code.
+ */
+CaError ca_run(CaContext *c, const CaCode *code, CaReal *result);
+
+/**
+ * \brief Runs compiled code as ca_run does, giving the value as it is. The
+ *        value is a CaReal unless it was computed on integers, by typed code
+ *        or exactly (see infer.h and exact.h), when it is a CaInt or
+ *        CaBigInt.
+ * \param c The context the code was compiled for.
+ * \param code The code.
+ * \param result The value of the expression. It is overwritten, and must be
+ *               released with ca_std_release (see std.h).
  * \return An error code.
  */
-CaError ca_eval(CaContext c, CaExpr s);
+CaError ca_run_var(CaContext *c, const CaCode *code, CaVar *result);
+
+/**
+ * \brief Evaluates a given expression. Its types are not inferred, nor is
+ *        it compiled to native code, which only pays off for code run many
+ *        times.
+ * \param c The context.
+ * \param s The expression.
+ * \param result The value of the expression.
+ * \return An error code. CA_ERROR_EVAL_END if the expression is empty.
+ */
+CaError ca_eval(CaContext *c, CaExpr *s, CaReal *result);
+
+/**
+ * \brief Starts evaluating an expression that is read one token at a time,
+ *        such as from a CaLexer.
+ * \param c The context.
+ */
+void ca_eval_begin(CaContext *c);
+
+/**
+ * \brief Evaluates the next token of an expression. The token need not
+ *        outlive the call, but nouns must have been interned in the symbol
+ *        table of the context. Long expressions are run in part as they are
+ *        read, as long as they compute CaReal values only, so that they are
+ *        evaluated in constant memory. Others are kept whole until the end.
+ * \param c The context.
+ * \param buf The buffer the token is in.
+ * \param t The token.
+ * \return An error code. The expression must be started again after an error.
+ */
+CaError ca_eval_token(CaContext *c, const char *buf, const CaToken *t);
+
+/**
+ * \brief Finishes evaluating an expression read one token at a time. It is
+ *        compiled and run as ca_compile and ca_run_var would, and gives the
+ *        same value.
+ * \param c The context.
+ * \param result The value of the expression. It is overwritten, and must be
+ *               released with ca_std_release (see std.h).
+ * \return An error code. CA_ERROR_EVAL_END if the expression is empty.
+ */
+CaError ca_eval_end(CaContext *c, CaVar *result);
 
 #endif
@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file exact.c
+ * \author Anamitra Ghorui
+ * \brief Exact evaluation of compiled code
+ *
+ */
+
+#include "exact.h"
+#include "real.h"
+#include "std.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/*
+ * Values are kept on the expr stack of the context, for the depth of the
+ * code, followed by its temporaries. The CaReal values already on it, left
+ * by the part of an expression run before (see ca_eval_token), are the
+ * bottom of the stack. Every slot is initialised, so that a value written
+ * over one frees what it held. Operators are applied with ca_std_binary_op,
+ * which writes its result over a, and b is then released.
+ *
+ * Constants written as integers are pushed as CaInt, and the others as
+ * CaReal, as typed code would read them.
+ */
+
+/* The operator of std.h of binary operator _op, or of superinstruction _op
+ * from _first, the superinstruction of the first operator _oper. */
+#define OPER(_op) ((CaOperID) ((_op) - CA_OPCODE_POWER + OPER_ID_POWER))
+#define OPER_FROM(_op, _first, _oper) \
+    ((CaOperID) ((_op) - CA_OPCODE_##_first + OPER_ID_##_oper))
+
+static CaError ca_exact_error(CaContext *c, CaSymbol name, CaError err)
+{
+    c->error = ca_symbols_name(&c->symbols, name, &c->error_size);
+    return err;
+}
+
+/* Sets v to constant k. */
+static CaError ca_exact_const(const CaCode *code, uint32_t k, CaVar *v)
+{
+    if (ca_code_const_int(code, k))
+        return ca_std_set_int(v, code->iconsts[k]);
+    ca_std_release(v);
+    ca_var_set_real(v, code->consts[k]);
+    return CA_ERROR_OK;
+}
+
+/* Whether a value is not 0. */
+static int ca_exact_true(const CaVar *v)
+{
+    if (ca_var_is(v, CA_TYPE_INT))
+        return ca_var_int(v) != 0;
+    if (ca_var_is(v, CA_TYPE_BIGINT))
+        return ca_var_bigint(v)->size != 0;
+    return ca_var_real(v) != 0;
+}
+
+/* a = a oper b. A remainder of integers by 0 fails with
+ * CA_ERROR_EVAL_DIVISION_BY_ZERO. */
+static inline CaError ca_exact_binary(CaOperID oper, CaVar *a, const CaVar *b)
+{
+    return ca_std_binary_op(oper, a, a, b);
+}
+
+/* Sets variable name to a copy of v. */
+static CaError ca_exact_store(CaContext *c, CaSymbol name, const CaVar *v)
+{
+    CaVar copy = CA_VAR_UNKNOWN;
+    CaError err;
+
+    if ((err = ca_std_assign(&copy, v)) != CA_ERROR_OK)
+        return err;
+    return ca_context_set(c, name, &copy);
+}
+
+CaError ca_exact_run(CaContext *c, const CaCode *code, CaVar *result)
+{
+    const CaInstr *ip = code->instrs;
+    const CaBuiltin *f;
+    CaVar *stack, *sp, *temps, *var, t = CA_VAR_UNKNOWN;
+    CaReal *args;
+    CaSize below = c->expr->top, size = code->depth + code->ntemps + 1;
+    CaError err = CA_ERROR_OK;
+    int cmp;
+
+    if ((err = ca_stack_reserve(c->expr, below + size)) != CA_ERROR_OK ||
+        (err = ca_context_reserve(c)) != CA_ERROR_OK)
+        return err;
+    if (!(args = malloc(size * sizeof(CaReal))))
+        return CA_ERROR_MEM;
+    stack = c->expr->data;
+    for (CaSize i = 0; i < below; i++)
+        ca_var_set_real(&stack[i], stack[i].value.f);
+    for (CaSize i = below; i < below + size; i++)
+        ca_var_set_unknown(&stack[i]);
+    sp = stack + below;
+    temps = sp + code->depth + 1;
+    c->error = NULL;
+
+    for (;; ip++) {
+        var = NULL;
+        switch ((CaOpcode) ip->op) {
+        case CA_OPCODE_LOAD:
+        case CA_OPCODE_ADD_VAR:
+        case CA_OPCODE_SUB_VAR:
+        case CA_OPCODE_MUL_VAR:
+        case CA_OPCODE_DIV_VAR:
+        case CA_OPCODE_MUL_ADD_VAR:
+        case CA_OPCODE_INC_VAR:
+            var = &c->vars[ip->arg];
+            if (ca_var_is(var, CA_TYPE_UNKNOWN)) {
+                err = ca_exact_error(c, ip->arg, CA_ERROR_HASH_NOTFOUND);
+                goto done;
+            }
+            break;
+        default:
+            break;
+        }
+
+        switch ((CaOpcode) ip->op) {
+        case CA_OPCODE_END:
+            goto done;
+
+        case CA_OPCODE_PUSH_CONST:
+            err = ca_exact_const(code, ip->arg, sp++);
+            break;
+        case CA_OPCODE_LOAD:
+            err = ca_std_assign(sp++, var);
+            break;
+        case CA_OPCODE_STORE:
+            err = ca_exact_store(c, ip->arg, sp - 1);
+            break;
+        case CA_OPCODE_STORE_POP:
+            err = ca_context_set(c, ip->arg, --sp);
+            break;
+        case CA_OPCODE_POP:
+            ca_std_release(--sp);
+            break;
+
+        case CA_OPCODE_POST_INC:
+        case CA_OPCODE_POST_DEC:
+            ca_std_release(&t);
+            ca_var_set_int(&t, 1);
+            err = ca_std_binary_op(ip->op == CA_OPCODE_POST_INC ?
+                                   OPER_ID_ADDITION : OPER_ID_SUBTRACTION,
+                                   &t, sp - 1, &t);
+            if (err == CA_ERROR_OK)
+                err = ca_context_set(c, ip->arg, &t);
+            break;
+
+        case CA_OPCODE_POWER:
+        case CA_OPCODE_MULTIPLICATION:
+        case CA_OPCODE_DIVISION:
+        case CA_OPCODE_REMAINDER:
+        case CA_OPCODE_ADDITION:
+        case CA_OPCODE_SUBTRACTION:
+        case CA_OPCODE_LSHIFT:
+        case CA_OPCODE_RSHIFT:
+        case CA_OPCODE_LT:
+        case CA_OPCODE_LTEQ:
+        case CA_OPCODE_GT:
+        case CA_OPCODE_GTEQ:
+        case CA_OPCODE_EQ:
+        case CA_OPCODE_NEQ:
+        case CA_OPCODE_B_AND:
+        case CA_OPCODE_B_XOR:
+        case CA_OPCODE_B_OR:
+            err = ca_exact_binary(OPER(ip->op), sp - 2, sp - 1);
+            ca_std_release(--sp);
+            break;
+
+        case CA_OPCODE_BOOL:
+            cmp = ca_exact_true(sp - 1);
+            ca_std_release(sp - 1);
+            ca_var_set_int(sp - 1, cmp);
+            break;
+
+        case CA_OPCODE_JUMP:
+            ip = code->instrs + ip->arg - 1;
+            break;
+        case CA_OPCODE_JUMP_FALSE_OR_POP:
+        case CA_OPCODE_JUMP_TRUE_OR_POP:
+            if (ca_exact_true(sp - 1) ==
+                (ip->op == CA_OPCODE_JUMP_TRUE_OR_POP))
+                ip = code->instrs + ip->arg - 1;
+            else
+                ca_std_release(--sp);
+            break;
+
+        case CA_OPCODE_EXT_CALL:
+            f = ip->arg < c->nfuncs ? &c->funcs[ip->arg] : NULL;
+            if (!f || !f->func || f->nargs != ip->n) {
+                err = ca_exact_error(c, ip->arg, f && f->func ?
+                                     CA_ERROR_EVAL_ARGS :
+                                     CA_ERROR_EVAL_UNKNOWN_FUNCTION);
+                break;
+            }
+            sp -= ip->n;
+            for (CaSize i = 0; i < ip->n; i++) {
+                args[i] = ca_std_real(&sp[i]);
+                ca_std_release(&sp[i]);
+            }
+            ca_var_set_real(sp++, f->func(args));
+            break;
+
+        case CA_OPCODE_ADD_CONST:
+        case CA_OPCODE_SUB_CONST:
+        case CA_OPCODE_MUL_CONST:
+        case CA_OPCODE_DIV_CONST:
+            if ((err = ca_exact_const(code, ip->arg, &t)) != CA_ERROR_OK)
+                break;
+            err = ca_exact_binary(ip->op == CA_OPCODE_ADD_CONST ?
+                                  OPER_ID_ADDITION :
+                                  ip->op == CA_OPCODE_SUB_CONST ?
+                                  OPER_ID_SUBTRACTION :
+                                  ip->op == CA_OPCODE_MUL_CONST ?
+                                  OPER_ID_MULTIPLICATION : OPER_ID_DIVISION,
+                                  sp - 1, &t);
+            break;
+        case CA_OPCODE_ADD_VAR:
+        case CA_OPCODE_SUB_VAR:
+        case CA_OPCODE_MUL_VAR:
+        case CA_OPCODE_DIV_VAR:
+            err = ca_exact_binary(ip->op == CA_OPCODE_ADD_VAR ?
+                                  OPER_ID_ADDITION :
+                                  ip->op == CA_OPCODE_SUB_VAR ?
+                                  OPER_ID_SUBTRACTION :
+                                  ip->op == CA_OPCODE_MUL_VAR ?
+                                  OPER_ID_MULTIPLICATION : OPER_ID_DIVISION,
+                                  sp - 1, var);
+            break;
+
+        case CA_OPCODE_MUL_ADD:
+            if ((err = ca_exact_binary(OPER_ID_MULTIPLICATION, sp - 2,
+                                       sp - 1)) != CA_ERROR_OK)
+                break;
+            ca_std_release(--sp);
+            err = ca_exact_binary(OPER_ID_ADDITION, sp - 2, sp - 1);
+            ca_std_release(--sp);
+            break;
+        case CA_OPCODE_MUL_ADD_VAR:
+            if ((err = ca_exact_binary(OPER_ID_MULTIPLICATION, sp - 1,
+                                       var)) != CA_ERROR_OK)
+                break;
+            err = ca_exact_binary(OPER_ID_ADDITION, sp - 2, sp - 1);
+            ca_std_release(--sp);
+            break;
+
+        case CA_OPCODE_SQUARE:
+            err = ca_exact_binary(OPER_ID_MULTIPLICATION, sp - 1, sp - 1);
+            break;
+        case CA_OPCODE_CUBE:
+            if ((err = ca_std_assign(&t, sp - 1)) != CA_ERROR_OK ||
+                (err = ca_exact_binary(OPER_ID_MULTIPLICATION, sp - 1,
+                                       sp - 1)) != CA_ERROR_OK)
+                break;
+            err = ca_exact_binary(OPER_ID_MULTIPLICATION, sp - 1, &t);
+            break;
+
+        case CA_OPCODE_INC_VAR:
+            if ((err = ca_exact_const(code, ip->n, &t)) != CA_ERROR_OK ||
+                (err = ca_std_binary_op(OPER_ID_ADDITION, &t, var, &t)) !=
+                CA_ERROR_OK ||
+                (err = ca_std_assign(sp++, &t)) != CA_ERROR_OK)
+                break;
+            err = ca_context_set(c, ip->arg, &t);
+            break;
+
+        case CA_OPCODE_LT_JUMP_FALSE:
+        case CA_OPCODE_LTEQ_JUMP_FALSE:
+        case CA_OPCODE_GT_JUMP_FALSE:
+        case CA_OPCODE_GTEQ_JUMP_FALSE:
+        case CA_OPCODE_EQ_JUMP_FALSE:
+        case CA_OPCODE_NEQ_JUMP_FALSE:
+        case CA_OPCODE_LT_JUMP_TRUE:
+        case CA_OPCODE_LTEQ_JUMP_TRUE:
+        case CA_OPCODE_GT_JUMP_TRUE:
+        case CA_OPCODE_GTEQ_JUMP_TRUE:
+        case CA_OPCODE_EQ_JUMP_TRUE:
+        case CA_OPCODE_NEQ_JUMP_TRUE:
+            err = ca_exact_binary(ip->op <= CA_OPCODE_NEQ_JUMP_FALSE ?
+                                  OPER_FROM(ip->op, LT_JUMP_FALSE, LT) :
+                                  OPER_FROM(ip->op, LT_JUMP_TRUE, LT),
+                                  sp - 2, sp - 1);
+            if (err != CA_ERROR_OK)
+                break;
+            ca_std_release(--sp);
+            cmp = (int) ca_var_int(sp - 1);
+            ca_std_release(--sp);
+            if (cmp == (ip->op >= CA_OPCODE_LT_JUMP_TRUE)) {
+                ca_var_set_int(sp++, cmp);
+                ip = code->instrs + ip->arg - 1;
+            }
+            break;
+
+        case CA_OPCODE_SAVE_TEMP:
+            err = ca_std_assign(&temps[ip->arg], sp - 1);
+            break;
+        case CA_OPCODE_LOAD_TEMP:
+            err = ca_std_assign(sp++, &temps[ip->arg]);
+            break;
+
+        default:
+            err = CA_ERROR_EVAL;
+            break;
+        }
+        if (err != CA_ERROR_OK)
+            goto done;
+    }
+
+done:
+    if (err == CA_ERROR_OK && result) {
+        *result = *--sp;
+        ca_var_set_unknown(sp);
+    }
+    ca_std_release(&t);
+    for (CaSize i = 0; i < below + size; i++)
+        ca_std_release(&stack[i]);
+    free(args);
+    return err;
+}
+
+/* Whether code reads, or if stores is set, sets a variable holding a value
+ * of type t, or of type u. */
+static int ca_exact_touches(const CaContext *c, const CaCode *code,
+                            int stores, CaType t, CaType u)
+{
+    const CaVar *v;
+
+    for (CaSize i = 0; i < code->count; i++) {
+        switch ((CaOpcode) code->instrs[i].op) {
+        case CA_OPCODE_STORE:
+        case CA_OPCODE_STORE_POP:
+            if (!stores)
+                break;
+            /* fall through */
+        case CA_OPCODE_LOAD:
+        case CA_OPCODE_POST_INC:
+        case CA_OPCODE_POST_DEC:
+        case CA_OPCODE_ADD_VAR:
+        case CA_OPCODE_SUB_VAR:
+        case CA_OPCODE_MUL_VAR:
+        case CA_OPCODE_DIV_VAR:
+        case CA_OPCODE_MUL_ADD_VAR:
+        case CA_OPCODE_INC_VAR:
+            if (code->instrs[i].arg >= c->nvars)
+                break;
+            v = &c->vars[code->instrs[i].arg];
+            if (ca_var_is(v, t) || ca_var_is(v, u))
+                return 1;
+            break;
+        default:
+            break;
+        }
+    }
+    return 0;
+}
+
+int ca_exact_needed(const CaContext *c, const CaCode *code)
+{
+    return ca_exact_touches(c, code, 1, CA_TYPE_BIGINT, CA_TYPE_BIGINT);
+}
+
+int ca_exact_reads_ints(const CaContext *c, const CaCode *code)
+{
+    return ca_exact_touches(c, code, 0, CA_TYPE_INT, CA_TYPE_BIGINT);
+}
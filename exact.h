@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file exact.h
+ * \author Anamitra Ghorui
+ * \brief Exact evaluation of compiled code
+ *
+ */
+
+/*
+ * Compiled code works on CaReal values, and typed code on CaInt values that
+ * must not overflow (see infer.h). The exact evaluator runs compiled code on
+ * CaVar values instead, with the operators of std.h, so that integers are
+ * kept exact whatever their size: a CaInt that overflows becomes a CaBigInt.
+ *
+ * It is much slower than the VM, and is only used where the others cannot
+ * give the value: when typed code overflows, and when the code reads or sets
+ * a variable holding a CaBigInt.
+ */
+
+#ifndef CA_EXACT_H
+#define CA_EXACT_H
+
+#include "eval.h"
+#include "command_stack.h"
+#include "error.h"
+
+/**
+ * \brief Runs compiled code with exact integers, on the CaReal values already
+ *        on the expr stack of the context.
+ * \param c The context the code was compiled for.
+ * \param code The code, which must not be typed code.
+ * \param result The value of the expression, or NULL. It is overwritten,
+ *               and must be released with ca_std_release.
+ * \return An error code. On an error, c->error is set as ca_vm_run does.
+ */
+CaError ca_exact_run(CaContext *c, const CaCode *code, CaVar *result);
+
+/**
+ * \brief Checks whether code reads or sets a variable holding a CaBigInt,
+ *        and must be run by ca_exact_run.
+ * \param c The context the code was compiled for.
+ * \param code The code.
+ * \return Nonzero if it does.
+ */
+int ca_exact_needed(const CaContext *c, const CaCode *code);
+
+/**
+ * \brief Checks whether code reads a variable holding a CaInt or a
+ *        CaBigInt, which only typed code or ca_exact_run keep exact.
+ * \param c The context the code was compiled for.
+ * \param code The code.
+ * \return Nonzero if it does.
+ */
+int ca_exact_reads_ints(const CaContext *c, const CaCode *code);
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file gen_oper.c
+ * \author Anamitra Ghorui
+ * \brief Generates the operator trie in oper_trie.h from oper_list
+ *
+ * Run at build time as "gen_oper > oper_trie.h".
+ */
+
+#include "oper.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* The bytes the lexer reads as symbols. Keep this in line with the
+ * CA_CC_SYMBOL, CA_CC_SIGN and CA_CC_DOT classes of token.c. */
+#define CIN_RANGE(x, l, h) (((x) >= (l)) && ((x) <= (h)))
+#define CIS_SYMBOL(x) (CIN_RANGE((x), 0x21, 0x2F) || \
+                       CIN_RANGE((x), 0x3A, 0x40) || \
+                       CIN_RANGE((x), 0x5B, 0x5E) || \
+                       CIN_RANGE((x), 0x7B, 0x7E))
+
+/* Every operator has at most one node per symbol, and there is a root. */
+#define MAX_NODES (1 + 128 + CA_OPER_COUNT * CA_MAX_OPER_LEN)
+
+static int child[MAX_NODES][256];
+static int parent[MAX_NODES];
+static CaOperMatch match[MAX_NODES];
+static int nnodes = 1;
+
+static int add_child(int node, unsigned char c)
+{
+    if (!child[node][c]) {
+        parent[nnodes] = node;
+        child[node][c] = nnodes++;
+    }
+    return child[node][c];
+}
+
+int main()
+{
+    uint8_t column[256] = { 0 };
+    int nsymbols = 1, node;
+    size_t len;
+
+    if (CA_OPER_COUNT > UINT8_MAX) {
+        fprintf(stderr, "gen_oper: Too many operators\n");
+        return 1;
+    }
+
+    /* A lone symbol is at least an unknown operator. */
+    for (int c = 0; c < 256; ++c) {
+        if (CIS_SYMBOL(c)) {
+            column[c] = nsymbols++;
+            match[add_child(0, c)] = (CaOperMatch) { 1, 0 };
+        }
+    }
+
+    for (size_t i = 1; i < CA_OPER_COUNT; ++i) {
+        const char *s = oper_list[i].symbol;
+
+        len = strnlen(s, CA_MAX_OPER_LEN + 1);
+        if (!len || len > CA_MAX_OPER_LEN) {
+            fprintf(stderr, "gen_oper: Bad length for operator %zu\n", i);
+            return 1;
+        }
+
+        node = 0;
+        for (size_t j = 0; j < len; ++j) {
+            if (!column[(unsigned char) s[j]]) {
+                fprintf(stderr, "gen_oper: '%s' is not made of symbols\n", s);
+                return 1;
+            }
+            node = add_child(node, s[j]);
+        }
+
+        if (match[node].oper) {
+            fprintf(stderr, "gen_oper: '%s' is defined twice\n", s);
+            return 1;
+        }
+        match[node] = (CaOperMatch) { len, i };
+    }
+
+    /* Nodes that are only a prefix of longer operators fall back to the
+     * longest operator before them. Children always come after parents. */
+    for (int i = 1; i < nnodes; ++i)
+        if (!match[i].len)
+            match[i] = match[parent[i]];
+
+    printf("/* Generated by gen_oper from oper_list in oper.h. Do not edit. */\n\n"
+           "#ifndef CA_OPER_TRIE_H\n"
+           "#define CA_OPER_TRIE_H\n\n"
+           "#include \"oper.h\"\n\n"
+           "#define CA_OPER_TRIE_NODES %d\n"
+           "#define CA_OPER_SYMBOLS %d\n\n", nnodes, nsymbols);
+
+    printf("/// Column of each byte in ca_oper_trie. 0 for bytes that are not "
+           "symbols.\nstatic const uint8_t ca_oper_column[256] = {");
+    for (int c = 0; c < 256; ++c)
+        printf("%s%3d,", c % 16 ? " " : "\n    ", column[c]);
+
+    printf("\n};\n\n/// Child of each node for each symbol. Node 0 is the root, "
+           "and 0 means\n/// there is no child.\n"
+           "static const uint8_t ca_oper_trie[CA_OPER_TRIE_NODES]"
+           "[CA_OPER_SYMBOLS] = {\n");
+    for (int i = 0; i < nnodes; ++i) {
+        printf("    {");
+        for (int c = 0, col = 0; c < 256; ++c) {
+            if (c && !column[c])
+                continue;
+            printf("%s%d", col++ ? ", " : " ", column[c] ? child[i][c] : 0);
+        }
+        printf(" },\n");
+    }
+
+    printf("};\n\n/// Longest operator read on reaching each node.\n"
+           "static const CaOperMatch ca_oper_match[CA_OPER_TRIE_NODES] = {\n");
+    for (int i = 0; i < nnodes; ++i)
+        printf("    { %d, %2d },\n", match[i].len, match[i].oper);
+    printf("};\n\n#endif\n");
+
+    return 0;
+}
@@ -17,6 +17,7 @@
  */
 
 #include "hashmap.h"
+#include "mem.h"
 
 /**
  * The hash map is simply an array of linked lists, which are the entries for
@@ -37,7 +38,7 @@
 
 CaHash ca_hash_init()
 {
-    CaHash h = ca_mallocarray(CA_HASH_SIZE, sizeof(CaHashNode *));
+    CaHash h = ca_malloczarray(CA_HASH_SIZE, sizeof(CaHashNode *));
     return h;
 }
 
@@ -48,8 +49,9 @@ CaHashNode *ca_hash_node_init(CaHashKey key, CaSize size, CaType type,
     size = size > CA_HASH_KEY_SIZE ? CA_HASH_KEY_SIZE : size;
     CaHashNode *h = malloc(sizeof(CaHashNode));
     char *nkey = malloc(size + 1);
-    strncpy(nkey, key, size + 1);
-    h->key  = nkey;
+    memcpy(nkey, key, size);
+    nkey[size] = '\0';
+    h->key  = (CaHashKey) nkey;
     h->data = data;
     h->next = NULL;
     h->type = type;
@@ -58,9 +60,9 @@ CaHashNode *ca_hash_node_init(CaHashKey key, CaSize size, CaType type,
 
 void ca_hash_node_free(CaHashNode *h)
 {
-    ca_freep((&((char *) h->key));
+    free((void *) h->key);
     // TODO Deallocate data.
-    ca_freep(&h);
+    free(h);
 }
 
 void ca_hash_free(CaHash map)
@@ -76,22 +78,33 @@ void ca_hash_free(CaHash map)
     free(map);
 }
 
+/* Compares a key of the given size against a stored, NUL terminated key. */
+static inline int ca_hash_key_eq(CaHashKey key, CaSize size, CaHashKey stored)
+{
+    return strncmp((const char *) key, (const char *) stored, size) == 0 &&
+           stored[size] == '\0';
+}
+
 CaError ca_hash_set(CaHash map, CaHashKey key, CaSize size, CaType type,
                     void *data)
 {
-    CaSize index = CA_HASH_KEY_INDEX(key[0]);
-    CaHashNode *k = map[index];
+    CaSize index;
+    CaHashNode *k;
     
     if (size <= 0 || CA_HASH_KEY_INDEX(key[0]) < 0)
         return CA_ERROR_HASH_INVALID_KEY;
 
+    size  = size > CA_HASH_KEY_SIZE ? CA_HASH_KEY_SIZE : size;
+    index = CA_HASH_KEY_INDEX(key[0]);
+    k     = map[index];
+
     if (map[index] == NULL) {
         map[index] = ca_hash_node_init(key, size, type, data);
         return CA_ERROR_HASH_NEW;
     }
 
     while (k->next != NULL) {
-        if (strncmp(key, k->key, CA_HASH_KEY_SIZE) == 0) {
+        if (ca_hash_key_eq(key, size, k->key)) {
             k->data = data;
             k->type = type;
             return CA_ERROR_HASH_EXISTING;
@@ -99,7 +112,7 @@ CaError ca_hash_set(CaHash map, CaHashKey key, CaSize size, CaType type,
         k = k->next;
     }
 
-    if (strcmp(key, k->key) == 0) {
+    if (ca_hash_key_eq(key, size, k->key)) {
         k->data = data;
         k->type = type;
         return CA_ERROR_HASH_EXISTING;
@@ -111,32 +124,34 @@ CaError ca_hash_set(CaHash map, CaHashKey key, CaSize size, CaType type,
 
 CaError ca_hash_get(CaHash map, CaHashKey key, CaSize size, CaHashNode **h)
 {
-    CaSize index = CA_HASH_KEY_INDEX(key[0]);
-    size = size > CA_HASH_KEY_SIZE ? CA_HASH_KEY_SIZE : size;
-    *h =  map[index];
+    CaSize index;
     
+    *h = NULL;
     if ((size <= 0) || CA_HASH_KEY_INDEX(key[0]) < 0) {
         return CA_ERROR_HASH_INVALID_KEY;
     }
-    CA_DBG_PLN
+    index = CA_HASH_KEY_INDEX(key[0]);
+    size = size > CA_HASH_KEY_SIZE ? CA_HASH_KEY_SIZE : size;
+    *h =  map[index];
+    CA_TRACE(CA_TRACE_DEBUG, HASH, GET, size, index);
     while (*h != NULL) {
-        CA_DBG_PLN
-        if (strncmp(key, (*h)->key, CA_HASH_KEY_SIZE) == 0) {
+        CA_TRACE(CA_TRACE_DEBUG, HASH, PROBE, size, index);
+        if (ca_hash_key_eq(key, size, (*h)->key)) {
             return CA_ERROR_OK;
         }
-        CA_DBG_PLN
         *h = (*h)->next;
     }
-    CA_DBG_PLN
+    CA_TRACE(CA_TRACE_DEBUG, HASH, MISS, size, index);
     return CA_ERROR_HASH_NOTFOUND;
 }
 
 CaError ca_hash_print(CaHash map)
 {
-    for (char i = 0; i < CA_HASH_SIZE; ++i) {
+    for (int i = 0; i < CA_HASH_SIZE; ++i) {
         for (CaHashNode *h = map[i]; h != NULL; h = h->next) {
             printf("%s: %d, ", h->key,  *((int *) h->data));
         }
     }
     printf("\n");
+    return CA_ERROR_OK;
 }
@@ -37,7 +37,8 @@
 #define CA_HASHMAP_H
 
 #include "types.h"
-#include "debug.h"
+#include "error.h"
+#include "trace.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -50,6 +51,13 @@
 /// underscore.
 #define CA_HASH_SIZE 53
 
+/// The bucket of a key, decided by its first character. -1 if the character
+/// cannot start a key.
+#define CA_HASH_KEY_INDEX(c) \
+    ((c) >= 'A' && (c) <= 'Z' ? (c) - 'A' :      \
+     (c) >= 'a' && (c) <= 'z' ? (c) - 'a' + 26 : \
+     (c) == '_' ? 52 : -1)
+
 /// Defines a hashmap/hashtable node. This is a linked-list based hashmap 
 /// meant to store user variables.
 typedef struct CaHashNode CaHashNode;
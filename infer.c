@@ -0,0 +1,533 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file infer.c
+ * \author Anamitra Ghorui
+ * \brief Type inference for compiled code
+ *
+ */
+
+#include "infer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The code is read once, from the start, keeping the type of every value on
+ * the data stack, and the type of every variable it has read or set. Jumps
+ * only go forward, and the values under the one a jump leaves are never
+ * changed by the code it skips, so a jump is followed by keeping the depth
+ * and the type of the top value it leaves at its target, which must be the
+ * same from every instruction that gets there.
+ *
+ * A variable set by code that a jump may skip could have either type after
+ * it, so the code is given up on if that changes the type of the variable.
+ */
+
+/// A jump that has not reached its target yet.
+typedef struct CaInferJump {
+    CaSize target;
+    CaSize depth;
+    uint8_t type;
+} CaInferJump;
+
+typedef struct CaInfer {
+    const CaContext *c;
+    const CaCode *code;
+    CaTyped *typed;
+    uint8_t *stack;      ///< Type of each value on the data stack.
+    CaSize depth;
+    CaGuard *vars;       ///< Type of each variable read or set so far.
+    CaSize nvars;
+    CaInferJump *jumps;
+    CaSize njumps;
+    uint8_t *temps;      ///< Type of each temporary.
+    CaSize *consts;      ///< Instruction that pushed each value, if it is a
+                         ///< CaInt constant no other instruction has read,
+                         ///< else CA_INFER_NONE.
+    CaSize ints;         ///< Integer instructions written.
+} CaInfer;
+
+#define CA_INFER_NONE ((CaSize) -1)
+
+/* Integer instruction of each instruction. */
+static const uint8_t ca_infer_int[CA_OPCODE_COUNT] = {
+#define INT(_op) [CA_OPCODE_##_op] = CA_OPCODE_I_##_op
+    INT(PUSH_CONST), INT(LOAD), INT(STORE), INT(POST_INC), INT(POST_DEC),
+    INT(POWER), INT(MULTIPLICATION), INT(REMAINDER), INT(ADDITION),
+    INT(SUBTRACTION), INT(LSHIFT), INT(RSHIFT), INT(LT), INT(LTEQ), INT(GT), INT(GTEQ), INT(EQ), INT(NEQ),
+    INT(B_AND), INT(B_XOR), INT(B_OR), INT(BOOL), INT(JUMP_FALSE_OR_POP),
+    INT(JUMP_TRUE_OR_POP), INT(ADD_CONST), INT(SUB_CONST), INT(MUL_CONST),
+    INT(ADD_VAR), INT(SUB_VAR), INT(MUL_VAR), INT(MUL_ADD), INT(MUL_ADD_VAR),
+    INT(SQUARE), INT(CUBE),
+    INT(INC_VAR), INT(STORE_POP), INT(LT_JUMP_FALSE), INT(LTEQ_JUMP_FALSE),
+    INT(GT_JUMP_FALSE), INT(GTEQ_JUMP_FALSE), INT(EQ_JUMP_FALSE),
+    INT(NEQ_JUMP_FALSE), INT(LT_JUMP_TRUE), INT(LTEQ_JUMP_TRUE),
+    INT(GT_JUMP_TRUE), INT(GTEQ_JUMP_TRUE), INT(EQ_JUMP_TRUE),
+    INT(NEQ_JUMP_TRUE),
+#undef INT
+};
+
+void ca_typed_free(CaTyped *typed)
+{
+    if (!typed)
+        return;
+    ca_code_free(&typed->code);
+    free(typed->guards);
+    free(typed->stores);
+    free(typed->saved);
+    free(typed);
+}
+
+/* Type of the value n down the data stack, 1 being the top. */
+#define TYPE(_n) (in->stack[in->depth - (_n)])
+
+static CaError ca_infer_emit(CaInfer *in, CaOpcode op, uint32_t arg,
+                             uint16_t n)
+{
+    if (op >= CA_OPCODE_I_PUSH_CONST && op < CA_OPCODE_TO_REAL)
+        in->ints++;
+    return ca_code_emit(&in->typed->code, op, arg, n);
+}
+
+/* Converts the value n down the data stack to type. A CaInt constant made a
+ * CaReal is pushed as one instead, and is not integer arithmetic, so that
+ * code whose integers are all constants made CaReal has no typed code. */
+static CaError ca_infer_convert(CaInfer *in, CaSize n, uint8_t type)
+{
+    CaSize *k = &in->consts[in->depth - n];
+
+    if (TYPE(n) == type)
+        return CA_ERROR_OK;
+    TYPE(n) = type;
+    if (type == CA_TYPE_REAL && *k != CA_INFER_NONE) {
+        in->typed->code.instrs[*k].op = CA_OPCODE_PUSH_CONST;
+        in->ints--;
+        *k = CA_INFER_NONE;
+        return CA_ERROR_OK;
+    }
+    return ca_infer_emit(in, type == CA_TYPE_INT ? CA_OPCODE_TO_INT :
+                                                   CA_OPCODE_TO_REAL, n, 0);
+}
+
+/* Converts the top n values of the data stack to type. */
+static CaError ca_infer_convert_all(CaInfer *in, CaSize n, uint8_t type)
+{
+    CaError err;
+
+    for (; n > 0; n--)
+        if ((err = ca_infer_convert(in, n, type)) != CA_ERROR_OK)
+            return err;
+    return CA_ERROR_OK;
+}
+
+static CaGuard *ca_infer_find(CaInfer *in, CaSymbol var)
+{
+    for (CaSize i = 0; i < in->nvars; i++)
+        if (in->vars[i].var == var)
+            return &in->vars[i];
+    return NULL;
+}
+
+/* Adds a variable of a type to a list. */
+static CaError ca_infer_add(CaGuard **list, CaSize *count, CaSymbol var,
+                            uint8_t type)
+{
+    CaGuard *p;
+
+    /* Lists have room for 4 entries, then grow at powers of two. */
+    if (!*count || (*count >= 4 && !(*count & (*count - 1)))) {
+        if (!(p = realloc(*list, (*count ? *count * 2 : 4) *
+                                 sizeof(CaGuard))))
+            return CA_ERROR_MEM;
+        *list = p;
+    }
+    (*list)[(*count)++] = (CaGuard) { var, type };
+    return CA_ERROR_OK;
+}
+
+/* Finds the type of a variable that is read. The first time a variable is
+ * read before it is set, its type in the context becomes a guard. */
+static CaError ca_infer_read(CaInfer *in, CaSymbol var, uint8_t *type)
+{
+    const CaGuard *v = ca_infer_find(in, var);
+    const CaContext *c = in->c;
+    CaError err;
+
+    if (v) {
+        *type = v->type;
+        return CA_ERROR_OK;
+    }
+
+    if (var >= c->nvars || (!ca_var_is(&c->vars[var], CA_TYPE_INT) &&
+                            !ca_var_is(&c->vars[var], CA_TYPE_REAL)))
+        return CA_ERROR_EVAL_UNSUPPORTED;
+    *type = ca_var_type(&c->vars[var]);
+    if ((err = ca_infer_add(&in->typed->guards, &in->typed->nguards, var,
+                            *type)) != CA_ERROR_OK)
+        return err;
+    return ca_infer_add(&in->vars, &in->nvars, var, *type);
+}
+
+/* Sets the type of a variable that is set. */
+static CaError ca_infer_write(CaInfer *in, CaSymbol var, uint8_t type)
+{
+    CaGuard *v = ca_infer_find(in, var);
+    CaTyped *typed = in->typed;
+    CaSize i;
+    CaError err;
+
+    for (i = 0; i < typed->nstores && typed->stores[i].var != var; i++)
+        ;
+    if (i == typed->nstores &&
+        (err = ca_infer_add(&typed->stores, &typed->nstores, var, type)) !=
+        CA_ERROR_OK)
+        return err;
+
+    if (v && v->type == type)
+        return CA_ERROR_OK;
+    /* The code setting it may be skipped. */
+    if (in->njumps)
+        return CA_ERROR_EVAL_UNSUPPORTED;
+    if (v) {
+        v->type = type;
+        return CA_ERROR_OK;
+    }
+    return ca_infer_add(&in->vars, &in->nvars, var, type);
+}
+
+/* Records a jump to target, leaving depth values, the top one of type. */
+static CaError ca_infer_jump(CaInfer *in, CaSize target, CaSize depth,
+                             uint8_t type)
+{
+    CaInferJump *jumps;
+
+    if (!(in->njumps & (in->njumps - 1))) {
+        jumps = realloc(in->jumps, (in->njumps ? in->njumps * 2 : 1) *
+                                   sizeof(CaInferJump));
+        if (!jumps)
+            return CA_ERROR_MEM;
+        in->jumps = jumps;
+    }
+    in->jumps[in->njumps++] = (CaInferJump) { target, depth, type };
+    return CA_ERROR_OK;
+}
+
+/* Joins the jumps to instruction i with the code before it. Returns 0 if i
+ * cannot be reached, and -1 if the types differ. */
+static int ca_infer_join(CaInfer *in, CaSize i, int reachable)
+{
+    CaInferJump *j;
+
+    for (CaSize k = 0; k < in->njumps;) {
+        j = &in->jumps[k];
+        if (j->target != i) {
+            k++;
+            continue;
+        }
+        /* The values may have been pushed by either path. */
+        for (CaSize s = 0; s < in->depth || s < j->depth; s++)
+            in->consts[s] = CA_INFER_NONE;
+        if (!reachable) {
+            in->depth = j->depth;
+            if (j->depth)
+                TYPE(1) = j->type;
+            reachable = 1;
+        } else if (j->depth != in->depth ||
+                   (j->depth && TYPE(1) != j->type)) {
+            return -1;
+        }
+        *j = in->jumps[--in->njumps];
+    }
+    return reachable;
+}
+
+/* Infers the types of the instruction at ip. */
+static CaError ca_infer_instr(CaInfer *in, const CaInstr *ip)
+{
+    uint8_t op = ip->op, iop = ca_infer_int[op], type, t;
+    CaError err = CA_ERROR_OK;
+
+    switch ((CaOpcode) op) {
+    case CA_OPCODE_END:
+        /* The value is left as it is, for ca_run_var to give exactly. */
+        in->typed->type = in->depth ? TYPE(1) : CA_TYPE_REAL;
+        return ca_infer_emit(in, op, 0, 0);
+
+    case CA_OPCODE_PUSH_CONST:
+        type = ca_code_const_int(in->code, ip->arg) ? CA_TYPE_INT :
+                                                      CA_TYPE_REAL;
+        in->consts[in->depth] = type == CA_TYPE_INT ? in->typed->code.count :
+                                                      CA_INFER_NONE;
+        in->stack[in->depth++] = type;
+        break;
+
+    case CA_OPCODE_LOAD:
+        if ((err = ca_infer_read(in, ip->arg, &type)) != CA_ERROR_OK)
+            return err;
+        in->stack[in->depth++] = type;
+        break;
+
+    case CA_OPCODE_STORE:
+    case CA_OPCODE_STORE_POP:
+    case CA_OPCODE_POST_INC:
+    case CA_OPCODE_POST_DEC:
+        type = TYPE(1);
+        if ((err = ca_infer_write(in, ip->arg, type)) != CA_ERROR_OK)
+            return err;
+        if (op == CA_OPCODE_STORE_POP)
+            in->depth--;
+        break;
+
+    case CA_OPCODE_POP:
+        in->depth--;
+        type = CA_TYPE_UNKNOWN;
+        break;
+
+    /* CaInt if both values are, else CaReal. A CaInt power with a negative
+     * exponent, or remainder by 0, fails as an overflow would, to be run
+     * again exactly, which gives a CaReal or the error. */
+    case CA_OPCODE_POWER:
+    case CA_OPCODE_MULTIPLICATION:
+    case CA_OPCODE_REMAINDER:
+    case CA_OPCODE_ADDITION:
+    case CA_OPCODE_SUBTRACTION:
+    case CA_OPCODE_LT:
+    case CA_OPCODE_LTEQ:
+    case CA_OPCODE_GT:
+    case CA_OPCODE_GTEQ:
+    case CA_OPCODE_EQ:
+    case CA_OPCODE_NEQ:
+        type = TYPE(1) == CA_TYPE_INT && TYPE(2) == CA_TYPE_INT ?
+               CA_TYPE_INT : CA_TYPE_REAL;
+        err = ca_infer_convert_all(in, 2, type);
+        in->depth--;
+        break;
+
+    /* Always CaReal. */
+    case CA_OPCODE_DIVISION:
+        type = CA_TYPE_REAL;
+        err = ca_infer_convert_all(in, 2, type);
+        in->depth--;
+        break;
+
+    /* Always CaInt. */
+    case CA_OPCODE_LSHIFT:
+    case CA_OPCODE_RSHIFT:
+    case CA_OPCODE_B_AND:
+    case CA_OPCODE_B_XOR:
+    case CA_OPCODE_B_OR:
+        type = CA_TYPE_INT;
+        err = ca_infer_convert_all(in, 2, type);
+        in->depth--;
+        break;
+
+    case CA_OPCODE_BOOL:
+        type = TYPE(1);
+        break;
+
+    case CA_OPCODE_JUMP:
+        type = in->depth ? TYPE(1) : CA_TYPE_REAL;
+        err = ca_infer_jump(in, ip->arg, in->depth, type);
+        break;
+    case CA_OPCODE_JUMP_FALSE_OR_POP:
+    case CA_OPCODE_JUMP_TRUE_OR_POP:
+        type = TYPE(1);
+        err = ca_infer_jump(in, ip->arg, in->depth, type);
+        in->depth--;
+        break;
+
+    case CA_OPCODE_EXT_CALL:
+        type = CA_TYPE_REAL;
+        err = ca_infer_convert_all(in, ip->n, type);
+        in->depth -= ip->n;
+        in->stack[in->depth++] = type;
+        break;
+
+    case CA_OPCODE_ADD_CONST:
+    case CA_OPCODE_SUB_CONST:
+    case CA_OPCODE_MUL_CONST:
+        type = TYPE(1) == CA_TYPE_INT &&
+               ca_code_const_int(in->code, ip->arg) ? CA_TYPE_INT :
+                                                      CA_TYPE_REAL;
+        err = ca_infer_convert(in, 1, type);
+        break;
+    case CA_OPCODE_DIV_CONST:
+        type = CA_TYPE_REAL;
+        err = ca_infer_convert(in, 1, type);
+        break;
+
+    case CA_OPCODE_ADD_VAR:
+    case CA_OPCODE_SUB_VAR:
+    case CA_OPCODE_MUL_VAR:
+    case CA_OPCODE_DIV_VAR:
+        if ((err = ca_infer_read(in, ip->arg, &t)) != CA_ERROR_OK)
+            return err;
+        type = TYPE(1) == CA_TYPE_INT && t == CA_TYPE_INT &&
+               op != CA_OPCODE_DIV_VAR ? CA_TYPE_INT : CA_TYPE_REAL;
+        err = ca_infer_convert(in, 1, type);
+        break;
+
+    case CA_OPCODE_MUL_ADD:
+        type = TYPE(1) == CA_TYPE_INT && TYPE(2) == CA_TYPE_INT &&
+               TYPE(3) == CA_TYPE_INT ? CA_TYPE_INT : CA_TYPE_REAL;
+        err = ca_infer_convert_all(in, 3, type);
+        in->depth -= 2;
+        TYPE(1) = type;
+        break;
+    case CA_OPCODE_MUL_ADD_VAR:
+        if ((err = ca_infer_read(in, ip->arg, &t)) != CA_ERROR_OK)
+            return err;
+        type = TYPE(1) == CA_TYPE_INT && TYPE(2) == CA_TYPE_INT &&
+               t == CA_TYPE_INT ? CA_TYPE_INT : CA_TYPE_REAL;
+        err = ca_infer_convert_all(in, 2, type);
+        in->depth--;
+        TYPE(1) = type;
+        break;
+
+    case CA_OPCODE_SQUARE:
+    case CA_OPCODE_CUBE:
+        type = TYPE(1);
+        break;
+
+    case CA_OPCODE_INC_VAR:
+        if ((err = ca_infer_read(in, ip->arg, &t)) != CA_ERROR_OK)
+            return err;
+        type = t == CA_TYPE_INT && ca_code_const_int(in->code, ip->n) ?
+               CA_TYPE_INT : CA_TYPE_REAL;
+        if ((err = ca_infer_write(in, ip->arg, type)) != CA_ERROR_OK)
+            return err;
+        in->stack[in->depth++] = type;
+        break;
+
+    case CA_OPCODE_LT_JUMP_FALSE:
+    case CA_OPCODE_LTEQ_JUMP_FALSE:
+    case CA_OPCODE_GT_JUMP_FALSE:
+    case CA_OPCODE_GTEQ_JUMP_FALSE:
+    case CA_OPCODE_EQ_JUMP_FALSE:
+    case CA_OPCODE_NEQ_JUMP_FALSE:
+    case CA_OPCODE_LT_JUMP_TRUE:
+    case CA_OPCODE_LTEQ_JUMP_TRUE:
+    case CA_OPCODE_GT_JUMP_TRUE:
+    case CA_OPCODE_GTEQ_JUMP_TRUE:
+    case CA_OPCODE_EQ_JUMP_TRUE:
+    case CA_OPCODE_NEQ_JUMP_TRUE:
+        type = TYPE(1) == CA_TYPE_INT && TYPE(2) == CA_TYPE_INT ?
+               CA_TYPE_INT : CA_TYPE_REAL;
+        if ((err = ca_infer_convert_all(in, 2, type)) != CA_ERROR_OK)
+            return err;
+        in->depth -= 2;
+        err = ca_infer_jump(in, ip->arg, in->depth + 1, type);
+        break;
+
+    /* Temporaries are only read after they are saved, with no jump in
+     * between. */
+    case CA_OPCODE_SAVE_TEMP:
+        type = in->temps[ip->arg] = TYPE(1);
+        break;
+    case CA_OPCODE_LOAD_TEMP:
+        type = in->temps[ip->arg];
+        in->stack[in->depth++] = type;
+        break;
+
+    default:
+        return CA_ERROR_EVAL_UNSUPPORTED;
+    }
+
+    if (err != CA_ERROR_OK)
+        return err;
+    return ca_infer_emit(in, type == CA_TYPE_INT && iop ? iop : op, ip->arg,
+                         ip->n);
+}
+
+CaError ca_code_infer(const CaContext *c, CaCode *code)
+{
+    CaInfer in = { c, code, NULL, NULL, 0, NULL, 0, NULL, 0, NULL, NULL, 0 };
+    CaSize *map = NULL;
+    uint32_t index;
+    CaCode *t;
+    CaError err = CA_ERROR_MEM;
+    int reachable = 1;
+
+    ca_typed_free(code->typed);
+    code->typed = NULL;
+
+    if (!(in.typed = calloc(1, sizeof(CaTyped))) ||
+        !(in.stack = malloc(code->depth + 1)) ||
+        !(in.temps = malloc(code->ntemps + 1)) ||
+        !(in.consts = malloc((code->depth + 1) * sizeof(CaSize))) ||
+        !(map = malloc((code->count + 1) * sizeof(CaSize))))
+        goto fail;
+    t = &in.typed->code;
+    ca_code_init(t);
+
+    for (CaSize i = 0; i < code->count; i++) {
+        map[i] = t->count;
+        if ((reachable = ca_infer_join(&in, i, reachable)) < 0) {
+            err = CA_ERROR_EVAL_UNSUPPORTED;
+            goto fail;
+        }
+        /* Code after a jump that nothing jumps into. */
+        if (!reachable)
+            continue;
+        if ((err = ca_infer_instr(&in, &code->instrs[i])) != CA_ERROR_OK)
+            goto fail;
+        /* The value left on top may be read as it is. */
+        if (code->instrs[i].op != CA_OPCODE_PUSH_CONST && in.depth)
+            in.consts[in.depth - 1] = CA_INFER_NONE;
+        if (code->instrs[i].op == CA_OPCODE_JUMP)
+            reachable = 0;
+    }
+
+    err = CA_ERROR_EVAL_UNSUPPORTED;
+    if (!in.ints || in.njumps)
+        goto fail;
+
+    for (CaSize i = 0; i < t->count; i++)
+        if (CA_OPCODE_ISJUMP(t->instrs[i].op))
+            t->instrs[i].arg = map[t->instrs[i].arg];
+
+    /* The typed code has its own copy of the constants. */
+    err = CA_ERROR_MEM;
+    for (CaSize k = 0; k < code->nconsts; k++)
+        if ((ca_code_const_int(code, k) ?
+             ca_code_iconst(t, code->iconsts[k], &index) :
+             ca_code_const(t, code->consts[k], &index)) != CA_ERROR_OK)
+            goto fail;
+    t->depth  = code->depth;
+    t->ntemps = code->ntemps;
+    if (in.typed->nstores &&
+        !(in.typed->saved = malloc(in.typed->nstores * sizeof(CaVar))))
+        goto fail;
+
+    code->typed = in.typed;
+    in.typed    = NULL;
+    err = CA_ERROR_OK;
+
+fail:
+    ca_typed_free(in.typed);
+    free(in.stack);
+    free(in.vars);
+    free(in.jumps);
+    free(in.temps);
+    free(in.consts);
+    free(map);
+    return err;
+}
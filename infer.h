@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file infer.h
+ * \author Anamitra Ghorui
+ * \brief Type inference for compiled code
+ *
+ */
+
+/*
+ * Compiled code works on CaReal values only. Type inference follows the type
+ * of every value through the code, starting from the types the constants
+ * were written as, and the types the variables it reads have when it is
+ * compiled. Where an operator is proven to work on CaInt values, it is
+ * replaced with its integer instruction, and values are converted to CaReal
+ * only where an operator needs one. The result is kept as typed code, next to
+ * the code it was inferred from.
+ *
+ * The types of the variables are guards: typed code is only run while the
+ * variables it reads still have the types it was inferred with, and the code
+ * as compiled is run otherwise. Both give the same values, but that typed
+ * code sets variables to CaInt values where the code as compiled sets them to
+ * the same CaReal values.
+ *
+ * CaInt arithmetic in typed code fails with CA_ERROR_EVAL_OVERFLOW rather
+ * than overflowing, and the code is then run again by the exact evaluator
+ * (see exact.h). The variables typed code sets are kept before it is run, so
+ * that they can be put back first.
+ */
+
+#ifndef CA_INFER_H
+#define CA_INFER_H
+
+#include "eval.h"
+#include "command_stack.h"
+#include "error.h"
+
+/// The type a variable must have for typed code to be run.
+typedef struct CaGuard {
+    CaSymbol var;
+    uint8_t type;
+} CaGuard;
+
+/// Typed code.
+typedef struct CaTyped {
+    CaCode code;
+    CaGuard *guards;
+    CaSize nguards;
+    CaGuard *stores;    ///< Variables the code sets.
+    CaSize nstores;
+    CaVar *saved;       ///< Values of the stores before the code was run.
+    uint8_t type;       ///< CaType of the value the code leaves.
+} CaTyped;
+
+/**
+ * \brief Infers the types of the values of code, and keeps its typed code in
+ *        code->typed until the code is emptied or freed.
+ * \param c The context the code was compiled for.
+ * \param code The code, ending in CA_OPCODE_END.
+ * \return An error code. CA_ERROR_EVAL_UNSUPPORTED if no CaInt operator was
+ *         found, or the types could not be inferred, as when a variable is
+ *         not set, or is set to values of different types depending on a
+ *         condition.
+ */
+CaError ca_code_infer(const CaContext *c, CaCode *code);
+
+/**
+ * \brief Frees typed code.
+ * \param typed The typed code, or NULL.
+ */
+void ca_typed_free(CaTyped *typed);
+
+/**
+ * \brief Returns the typed code of compiled code, if it can be run on the
+ *        context as it is.
+ * \param c The context the code was compiled for.
+ * \param code The code.
+ * \return The typed code, or NULL.
+ */
+static inline const CaCode *ca_code_typed(const CaContext *c,
+                                          const CaCode *code)
+{
+    const CaTyped *typed = code->typed;
+
+    if (!typed)
+        return NULL;
+    for (CaSize i = 0; i < typed->nguards; i++)
+        if (!ca_var_is(&c->vars[typed->guards[i].var],
+                       (CaType) typed->guards[i].type))
+            return NULL;
+    return &typed->code;
+}
+
+/**
+ * \brief Keeps the values of the variables typed code sets, which must have
+ *        slots, before it is run.
+ * \param c The context.
+ * \param typed The typed code.
+ */
+static inline void ca_typed_save(const CaContext *c, CaTyped *typed)
+{
+    for (CaSize i = 0; i < typed->nstores; i++)
+        typed->saved[i] = c->vars[typed->stores[i].var];
+}
+
+/**
+ * \brief Puts back the values kept by ca_typed_save.
+ * \param c The context.
+ * \param typed The typed code.
+ */
+static inline void ca_typed_restore(CaContext *c, const CaTyped *typed)
+{
+    for (CaSize i = 0; i < typed->nstores; i++)
+        c->vars[typed->stores[i].var] = typed->saved[i];
+}
+
+#endif
@@ -21,4 +21,296 @@
  * \author Anamitra Ghorui
  * \brief Calcium interpreter program
  */
- 
+
+#include "interpreter.h"
+#include "react.h"
+#include "real.h"
+#include "std.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+/*
+ * Every line of input is one expression. Input is read in chunks, which are
+ * split at newlines and fed to a CaLexer, and each token is compiled as soon
+ * as it is read, the code being run every so often. Lines of any length are
+ * read in constant memory, apart from the longest token.
+ *
+ * A line that is read whole in one chunk, and is short enough, is instead
+ * looked up in a cache of compiled lines (see cache.h), and only lexed and
+ * compiled if it is not found there.
+ *
+ * The context, and with it the stacks, is kept for the whole session, so
+ * evaluating a line does not allocate anything unless a new variable is
+ * defined.
+ */
+
+typedef struct CaInterpreter {
+    CaContext *c;
+    CaLexer lexer;
+    CaError err;  ///< The error the current line stopped at, if any.
+    int partial;  ///< Whether part of the current line has been streamed.
+    CaCache cache;
+    CaCode code;  ///< Code of the line being compiled for the cache.
+    char key[CA_CACHE_KEY_SIZE + 1];
+    FILE *f_out;
+    FILE *f_err;
+} CaInterpreter;
+
+static void ca_print_error(CaContext *c, CaError err, FILE *f_err)
+{
+    char name[CA_HASH_KEY_SIZE + 1] = "";
+    CaSize size;
+
+    if (c && c->error) {
+        size = c->error_size > CA_HASH_KEY_SIZE ? CA_HASH_KEY_SIZE :
+                                                  c->error_size;
+        memcpy(name, c->error, size);
+        name[size] = '\0';
+    }
+
+    if (err < 0 && ca_error_strings[err + 0x1000])
+        fprintf(f_err, ca_error_strings[err + 0x1000], name);
+    else
+        fprintf(f_err, "Error %d", err);
+    fprintf(f_err, "\n");
+}
+
+/* Evaluates the tokens of the current line that have been read so far. */
+static void ca_interpret_tokens(CaInterpreter *in)
+{
+    CaToken t;
+
+    while (in->err == CA_ERROR_OK) {
+        in->err = ca_lexer_next(&in->lexer, &t);
+        if (in->err == CA_ERROR_EVAL_END) {
+            in->err = CA_ERROR_OK;
+            return;
+        }
+        if (in->err != CA_ERROR_OK) {
+            ca_print_error(NULL, in->err, in->f_err);
+            return;
+        }
+        if (t.guess == CA_GUESS_NEED_MORE_DATA)
+            return;
+
+        in->err = ca_eval_token(in->c, in->lexer.buf, &t);
+        if (in->err != CA_ERROR_OK)
+            ca_print_error(in->c, in->err, in->f_err);
+    }
+}
+
+/* Prints the value of a line. Integers run on exactly are printed in full. */
+static void ca_interpret_print(CaInterpreter *in, const CaVar *v)
+{
+    if (ca_var_is(v, CA_TYPE_BIGINT))
+        ca_bigint_print(in->f_out, ca_var_bigint(v));
+    else if (ca_var_is(v, CA_TYPE_INT))
+        fprintf(in->f_out, "%" PRId64, ca_var_int(v));
+    else
+        ca_real_print(in->f_out, ca_var_real(v), CA_REAL_DIG);
+    fputc('\n', in->f_out);
+}
+
+/* Ends the current line, and prints its value. */
+static void ca_interpret_end(CaInterpreter *in)
+{
+    CaVar result;
+    CaError err;
+
+    ca_lexer_finish(&in->lexer);
+    ca_interpret_tokens(in);
+
+    if (in->err == CA_ERROR_OK) {
+        err = ca_eval_end(in->c, &result);
+        if (err == CA_ERROR_OK) {
+            ca_interpret_print(in, &result);
+            ca_std_release(&result);
+        } else if (err != CA_ERROR_EVAL_END)
+            ca_print_error(in->c, err, in->f_err);
+    }
+
+    ca_lexer_reset(&in->lexer);
+    ca_eval_begin(in->c);
+    in->err     = CA_ERROR_OK;
+    in->partial = 0;
+}
+
+/* Evaluates a whole line through the cache. Returns 0 if the line cannot be
+ * cached, and must be streamed instead. */
+static int ca_interpret_line(CaInterpreter *in, const char *line, CaSize size)
+{
+    const CaCode *code;
+    CaExpr e;
+    CaVar result;
+    uint32_t hash;
+    long n;
+    CaError err;
+
+    if ((n = ca_cache_key(line, size, in->key, &hash)) < 0)
+        return 0;
+    if (!n)
+        return 1;
+
+    code = ca_cache_find(&in->cache, in->key, n, hash,
+                         ca_context_generation(in->c));
+    if (!code) {
+        e   = (CaExpr) { 0, in->key };
+        err = ca_compile(in->c, &e, &in->code);
+        /* Code that fails to run is kept, as it may well run once the
+         * variables it reads are set. */
+        if (err == CA_ERROR_OK) {
+            err = ca_run_var(in->c, &in->code, &result);
+            if (ca_cache_insert(&in->cache, in->key, n, hash, &in->code) !=
+                CA_ERROR_OK)
+                ca_print_error(NULL, CA_ERROR_MEM, in->f_err);
+        }
+    } else {
+        err = ca_run_var(in->c, code, &result);
+    }
+
+    if (err == CA_ERROR_OK) {
+        ca_interpret_print(in, &result);
+        ca_std_release(&result);
+    } else if (err != CA_ERROR_EVAL_END)
+        ca_print_error(in->c, err, in->f_err);
+
+    /* ca_compile leaves the context ready to compile into in->code. */
+    ca_eval_begin(in->c);
+    return 1;
+}
+
+/* Reads a chunk of input, evaluating every line it ends. */
+static void ca_interpret_chunk(CaInterpreter *in, const char *data,
+                               CaSize size)
+{
+    const char *end = data + size, *nl, *line_end;
+
+    while (data < end) {
+        nl = memchr(data, '\n', end - data);
+        line_end = nl ? nl : end;
+
+        if (nl && !in->partial && in->cache.capacity &&
+            ca_interpret_line(in, data, line_end - data)) {
+            data = nl + 1;
+            continue;
+        }
+
+        /* The rest of a line is skipped after an error. */
+        if (in->err == CA_ERROR_OK) {
+            in->err = ca_lexer_feed(&in->lexer, data, line_end - data);
+            if (in->err != CA_ERROR_OK)
+                ca_print_error(NULL, in->err, in->f_err);
+            ca_interpret_tokens(in);
+        }
+
+        if (!nl) {
+            in->partial = 1;
+            break;
+        }
+        ca_interpret_end(in);
+        data = nl + 1;
+    }
+}
+
+static int ca_interpreter_init(CaInterpreter *in, FILE *f_out, FILE *f_err,
+                               const CaInterpreterOptions *opts)
+{
+    in->c       = ca_context_init();
+    in->err     = CA_ERROR_OK;
+    in->partial = 0;
+    in->f_out   = f_out;
+    in->f_err   = f_err;
+    ca_lexer_init(&in->lexer);
+    ca_code_init(&in->code);
+
+    if (!in->c || ca_cache_init(&in->cache, opts ? opts->cache_size :
+                                            CA_INTERPRETER_CACHE_SIZE) !=
+                  CA_ERROR_OK) {
+        ca_print_error(NULL, CA_ERROR_MEM, f_err);
+        ca_lexer_free(&in->lexer);
+        if (in->c)
+            ca_context_free(in->c);
+        return 0;
+    }
+    in->lexer.symbols = &in->c->symbols;
+    if (opts && opts->jit)
+        in->c->flags |= CA_CONTEXT_JIT;
+    if (opts && opts->reactive &&
+        ca_context_reactive(in->c, 1) != CA_ERROR_OK) {
+        ca_print_error(NULL, CA_ERROR_MEM, f_err);
+        ca_cache_free(&in->cache);
+        ca_code_free(&in->code);
+        ca_lexer_free(&in->lexer);
+        ca_context_free(in->c);
+        return 0;
+    }
+    ca_eval_begin(in->c);
+    return 1;
+}
+
+static void ca_interpreter_free(CaInterpreter *in, CaInterpreterOptions *opts)
+{
+    if (opts) {
+        opts->cache_hits   = in->cache.hits;
+        opts->cache_misses = in->cache.misses;
+        opts->cse_removed  = in->c->cse_removed;
+        opts->recomputed   = ca_react_recomputed(in->c);
+    }
+    ca_cache_free(&in->cache);
+    ca_code_free(&in->code);
+    ca_lexer_free(&in->lexer);
+    ca_context_free(in->c);
+}
+
+void ca_start_interactive(FILE *f_in, FILE *f_out, FILE *f_err,
+                          CaInterpreterOptions *opts)
+{
+    char buf[CA_INTERPRETER_BUF_SIZE];
+    CaInterpreter in;
+    int line_start = 1;
+    CaSize size;
+
+    if (!ca_interpreter_init(&in, f_out, f_err, opts))
+        return;
+
+    for (;;) {
+        if (line_start) {
+            fprintf(f_out, "%s ", CA_INTERACTIVE_PROMPT_STR);
+            fflush(f_out);
+        }
+        if (!fgets(buf, CA_INTERPRETER_BUF_SIZE, f_in))
+            break;
+        size = strlen(buf);
+        ca_interpret_chunk(&in, buf, size);
+        line_start = size && buf[size - 1] == '\n';
+    }
+
+    ca_interpret_end(&in);
+    ca_interpreter_free(&in, opts);
+    fprintf(f_out, "\n");
+}
+
+void ca_start_interpreter(FILE *f_in, FILE *f_out, FILE *f_err,
+                          CaInterpreterOptions *opts)
+{
+    CaInterpreter in;
+    CaSize size;
+    char *buf;
+
+    if (!(buf = malloc(CA_INTERPRETER_CHUNK_SIZE))) {
+        ca_print_error(NULL, CA_ERROR_MEM, f_err);
+        return;
+    }
+    if (!ca_interpreter_init(&in, f_out, f_err, opts)) {
+        free(buf);
+        return;
+    }
+
+    while ((size = fread(buf, 1, CA_INTERPRETER_CHUNK_SIZE, f_in)) > 0)
+        ca_interpret_chunk(&in, buf, size);
+
+    ca_interpret_end(&in);
+    ca_interpreter_free(&in, opts);
+    free(buf);
+}
@@ -26,25 +26,52 @@
 #define CA_INTERPRETER_H
 
 #include "eval.h"
+#include "cache.h"
 #include "calcium.h"
 
 #define CA_INTERACTIVE_PROMPT_STR ":"
 #define CA_INTERACTIVE_BLOCK_STR "::"
 
+/// Size of the reads of the interactive interpreter. Longer lines are read
+/// in parts.
+#define CA_INTERPRETER_BUF_SIZE 4096
+
+/// Size of the reads of the non-interactive interpreter.
+#define CA_INTERPRETER_CHUNK_SIZE (64 << 10)
+
+/// Number of compiled lines an interpreter keeps by default.
+#define CA_INTERPRETER_CACHE_SIZE 1024
+
+/// Options of an interpreter.
+typedef struct CaInterpreterOptions {
+    CaSize cache_size;   ///< Compiled lines kept. 0 disables the cache.
+    CaSize cache_hits;   ///< Set to the number of lines found in the cache.
+    CaSize cache_misses; ///< Set to the number of lines that were not.
+    CaSize cse_removed;  ///< Set to the number of operators common
+                         ///< subexpression elimination removed.
+    int jit;             ///< Compile cached lines to native code (see jit.h).
+    int reactive;        ///< Run in reactive mode (see react.h).
+    CaSize recomputed;   ///< Set to the number of definitions run again.
+} CaInterpreterOptions;
+
 /**
  * \brief Brings up an interactive interpreter
  * \param f_in File Object used for input data
  * \param f_out File Object used for output data
  * \param f_err File Object used for error output
+ * \param opts Options, or NULL for the defaults
  */
-void ca_start_interactive(FILE *f_in, FILE *f_out, FILE *f_err);
+void ca_start_interactive(FILE *f_in, FILE *f_out, FILE *f_err,
+                          CaInterpreterOptions *opts);
 
 /**
  * \brief Brings up an interpreter
  * \param f_in File Object used for input data
  * \param f_out File Object used for output data
  * \param f_err File Object used for error output
+ * \param opts Options, or NULL for the defaults
  */
-void ca_start_interpreter(FILE *f_in, FILE *f_out, FILE *f_err);
+void ca_start_interpreter(FILE *f_in, FILE *f_out, FILE *f_err,
+                          CaInterpreterOptions *opts);
 
 #endif
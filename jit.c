@@ -0,0 +1,819 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file jit.c
+ * \author Anamitra Ghorui
+ * \brief Native code generator for arithmetic expressions
+ *
+ */
+
+#include "jit.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CA_JIT_X86_64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+void ca_jit_free(CaJit *jit)
+{
+    if (!jit)
+        return;
+#if CA_JIT_X86_64
+    if (jit->mem)
+        munmap(jit->mem, jit->mem_size);
+#endif
+    free(jit->loads);
+    free(jit);
+}
+
+int ca_jit_run(CaContext *c, const CaCode *code, CaReal *result)
+{
+    const CaJit *jit = code->jit;
+
+    if (!jit || jit->nvars > c->nvars)
+        return 0;
+    for (CaSize i = 0; i < jit->nloads; i++)
+        if (!ca_var_is(&c->vars[jit->loads[i]], CA_TYPE_REAL))
+            return 0;
+
+    *result = jit->func(c->vars, code->consts);
+    return 1;
+}
+
+#if !CA_JIT_X86_64
+
+CaError ca_jit_compile(CaCode *code)
+{
+    (void) code;
+    return CA_ERROR_JIT_UNSUPPORTED;
+}
+
+#else
+
+/*
+ * The emitted function follows the System V calling convention: vars is in
+ * rdi, consts is in rsi, and the result is returned in xmm0 for a double, or
+ * st(0) for a long double. Values are kept in registers, so no value is
+ * stored in memory between instructions but temporaries, and the depth of the
+ * data stack is checked for each instruction as the code is translated.
+ */
+
+/* Registers, as numbered in ModRM bytes. */
+#define REG_RSI 6
+#define REG_RDI 7
+
+#define SETA_AL   0x0F, 0x97, 0xC0
+#define SETAE_AL  0x0F, 0x93, 0xC0
+#define SETE_AL   0x0F, 0x94, 0xC0
+#define SETNE_AL  0x0F, 0x95, 0xC0
+#define SETNP_CL  0x0F, 0x9B, 0xC1
+#define SETP_CL   0x0F, 0x9A, 0xC1
+#define AND_AL_CL 0x20, 0xC8
+#define OR_AL_CL  0x08, 0xC8
+#define MOVZX_EAX_AL 0x0F, 0xB6, 0xC0
+#define MOV_EAX_1 0xB8, 0x01, 0x00, 0x00, 0x00
+
+#define RET 0xC3
+
+/* Emits a sequence of bytes. */
+#define EMIT(_b, ...) do {                                      \
+        static const uint8_t _bytes[] = { __VA_ARGS__ };        \
+        ca_jit_emit(_b, _bytes, sizeof(_bytes));                \
+    } while (0)
+
+/* Machine code being written. */
+typedef struct CaJitBuf {
+    uint8_t *data;
+    CaSize size;
+    CaSize capacity;
+    int failed;  ///< Set if memory could not be allocated.
+} CaJitBuf;
+
+static void ca_jit_emit(CaJitBuf *b, const uint8_t *bytes, CaSize size)
+{
+    uint8_t *data;
+    CaSize capacity;
+
+    if (b->size + size > b->capacity) {
+        capacity = b->capacity ? b->capacity * 2 : 256;
+        while (capacity < b->size + size)
+            capacity *= 2;
+        if (!(data = realloc(b->data, capacity))) {
+            b->failed = 1;
+            return;
+        }
+        b->data     = data;
+        b->capacity = capacity;
+    }
+    memcpy(b->data + b->size, bytes, size);
+    b->size += size;
+}
+
+/* Emits an instruction on [base + disp], with reg the ModRM reg field. */
+static void ca_jit_emit_mem(CaJitBuf *b, uint8_t op, uint8_t reg, uint8_t base,
+                            uint32_t disp)
+{
+    uint8_t bytes[6] = {
+        op, 0x80 | reg << 3 | base,
+        disp, disp >> 8, disp >> 16, disp >> 24
+    };
+    ca_jit_emit(b, bytes, sizeof(bytes));
+}
+
+/* Offset of variable v from vars. */
+static uint32_t ca_jit_var(CaSymbol v)
+{
+    return v * sizeof(CaVar) + offsetof(CaVar, value);
+}
+
+/* Offset of temporary k from rsp. The temporaries are 16 bytes apart, under
+ * 32 bytes left for other uses, in the red zone. */
+static uint32_t ca_jit_temp(uint32_t k)
+{
+    return -(int32_t) (32 + k * 16);
+}
+
+/* Marks variable v set to a CaReal. A NaN-boxed double needs no tag, and the
+ * only NaN the hardware makes from canonical ones is the default NaN, which
+ * reads as a CaReal (see types.h). */
+static void ca_jit_tag_var(CaJitBuf *b, CaSymbol v)
+{
+#ifndef CA_NANBOX
+    uint8_t imm[4] = { CA_TYPE_REAL, 0, 0, 0 };
+
+    ca_jit_emit_mem(b, 0xC7, 0, REG_RDI,
+                    v * sizeof(CaVar) + offsetof(CaVar, type));
+    ca_jit_emit(b, imm, sizeof(imm));
+#else
+    (void) b;
+    (void) v;
+#endif
+}
+
+static CaError ca_jit_load(CaJit *jit, CaSize *capacity, CaSymbol v)
+{
+    CaSymbol *loads;
+
+    for (CaSize i = 0; i < jit->nloads; i++)
+        if (jit->loads[i] == v)
+            return CA_ERROR_OK;
+
+    if (jit->nloads == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 8;
+        if (!(loads = realloc(jit->loads, *capacity * sizeof(CaSymbol))))
+            return CA_ERROR_MEM;
+        jit->loads = loads;
+    }
+    jit->loads[jit->nloads++] = v;
+    if (v >= jit->nvars)
+        jit->nvars = v + 1;
+    return CA_ERROR_OK;
+}
+
+static void ca_jit_store(CaJit *jit, CaSymbol v)
+{
+    if (v >= jit->nvars)
+        jit->nvars = v + 1;
+}
+
+/* Each instruction is checked to have the values it pops, and room for the
+ * ones it pushes and for any it keeps in registers on the way. */
+#define NEED(_pops, _peak) do {                                        \
+        if (depth < (_pops) || depth + (_peak) > CA_JIT_DEPTH)         \
+            return CA_ERROR_EVAL_UNSUPPORTED;                          \
+    } while (0)
+
+#ifdef CA_REAL_DOUBLE
+
+/*
+ * Value n of the data stack, counting from the bottom, is in xmm(n), so the
+ * result is in xmm0 when the function returns. Every operation is the scalar
+ * SSE2 instruction the VM's own is compiled to, and rounds as it does, to the
+ * range of a double.
+ */
+
+/* SSE2 instructions, as mandatory prefix and opcode. */
+#define SSE_MOVSD_LOAD  0xF2, 0x10
+#define SSE_MOVSD_STORE 0xF2, 0x11
+#define SSE_ADDSD       0xF2, 0x58
+#define SSE_MULSD       0xF2, 0x59
+#define SSE_SUBSD       0xF2, 0x5C
+#define SSE_DIVSD       0xF2, 0x5E
+#define SSE_CVTSI2SD    0xF2, 0x2A
+#define SSE_MOVAPD      0x66, 0x28
+#define SSE_UCOMISD     0x66, 0x2E
+
+/* Emits an instruction from xmm(y), or eax, to xmm(x). */
+static void ca_jit_sse_reg(CaJitBuf *b, uint8_t prefix, uint8_t op,
+                           CaSize x, CaSize y)
+{
+    uint8_t bytes[4] = { prefix, 0x0F, op, 0xC0 | x << 3 | y };
+
+    ca_jit_emit(b, bytes, sizeof(bytes));
+}
+
+/* Emits an instruction between xmm(x) and [base + disp]. */
+static void ca_jit_sse_mem(CaJitBuf *b, uint8_t prefix, uint8_t op,
+                           CaSize x, uint8_t base, uint32_t disp)
+{
+    uint8_t bytes[8] = {
+        prefix, 0x0F, op, 0x80 | x << 3 | base,
+        disp, disp >> 8, disp >> 16, disp >> 24
+    };
+    ca_jit_emit(b, bytes, sizeof(bytes));
+}
+
+/* Emits an instruction between xmm(x) and temporary k. */
+static void ca_jit_sse_temp(CaJitBuf *b, uint8_t prefix, uint8_t op,
+                            CaSize x, uint32_t k)
+{
+    uint32_t disp = ca_jit_temp(k);
+    uint8_t bytes[9] = {
+        prefix, 0x0F, op, 0x80 | x << 3 | 4, 0x24, /* [rsp + disp32] */
+        disp, disp >> 8, disp >> 16, disp >> 24
+    };
+    ca_jit_emit(b, bytes, sizeof(bytes));
+}
+
+#define CONST(_op, _x, _k) \
+    ca_jit_sse_mem(b, _op, _x, REG_RSI, (_k) * sizeof(CaReal))
+#define VAR(_op, _x, _v) ca_jit_sse_mem(b, _op, _x, REG_RDI, ca_jit_var(_v))
+#define REG(_op, _x, _y) ca_jit_sse_reg(b, _op, _x, _y)
+
+/* Sets variable v to xmm(x). */
+static void ca_jit_store_var(CaJitBuf *b, CaSymbol v, CaSize x)
+{
+    VAR(SSE_MOVSD_STORE, x, v);
+    ca_jit_tag_var(b, v);
+}
+
+/* Sets xmm(x) to the 0 or 1 in al. */
+static void ca_jit_bool(CaJitBuf *b, CaSize x)
+{
+    EMIT(b, MOVZX_EAX_AL);
+    REG(SSE_CVTSI2SD, x, 0);
+}
+
+/* Translates the instructions of code into b. */
+static CaError ca_jit_translate(const CaCode *code, CaJitBuf *b, CaJit *jit)
+{
+    CaSize depth = 0, capacity = 0;
+    CaError err = CA_ERROR_OK;
+
+    for (const CaInstr *ip = code->instrs; ip < code->instrs + code->count;
+         ip++) {
+        switch ((CaOpcode) ip->op) {
+        case CA_OPCODE_END:
+            if (depth != 1)
+                return CA_ERROR_EVAL_UNSUPPORTED;
+            EMIT(b, RET);
+            return b->failed ? CA_ERROR_MEM : CA_ERROR_OK;
+
+        case CA_OPCODE_PUSH_CONST:
+            NEED(0, 1);
+            CONST(SSE_MOVSD_LOAD, depth, ip->arg);
+            depth++;
+            break;
+        case CA_OPCODE_LOAD:
+            NEED(0, 1);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            VAR(SSE_MOVSD_LOAD, depth, ip->arg);
+            depth++;
+            break;
+        case CA_OPCODE_STORE:
+            NEED(1, 0);
+            ca_jit_store(jit, ip->arg);
+            ca_jit_store_var(b, ip->arg, depth - 1);
+            break;
+        case CA_OPCODE_STORE_POP:
+            NEED(1, 0);
+            ca_jit_store(jit, ip->arg);
+            ca_jit_store_var(b, ip->arg, depth - 1);
+            depth--;
+            break;
+        case CA_OPCODE_POP:
+            NEED(1, 0);
+            depth--;
+            break;
+        case CA_OPCODE_POST_INC:
+        case CA_OPCODE_POST_DEC:
+            NEED(1, 2);
+            ca_jit_store(jit, ip->arg);
+            EMIT(b, MOV_EAX_1);
+            REG(SSE_CVTSI2SD, depth, 0);
+            REG(SSE_MOVAPD, depth + 1, depth - 1);
+            if (ip->op == CA_OPCODE_POST_INC)
+                REG(SSE_ADDSD, depth + 1, depth);
+            else
+                REG(SSE_SUBSD, depth + 1, depth);
+            ca_jit_store_var(b, ip->arg, depth + 1);
+            break;
+
+        case CA_OPCODE_ADDITION:
+            NEED(2, 0);
+            REG(SSE_ADDSD, depth - 2, depth - 1);
+            depth--;
+            break;
+        case CA_OPCODE_SUBTRACTION:
+            NEED(2, 0);
+            REG(SSE_SUBSD, depth - 2, depth - 1);
+            depth--;
+            break;
+        case CA_OPCODE_MULTIPLICATION:
+            NEED(2, 0);
+            REG(SSE_MULSD, depth - 2, depth - 1);
+            depth--;
+            break;
+        case CA_OPCODE_DIVISION:
+            NEED(2, 0);
+            REG(SSE_DIVSD, depth - 2, depth - 1);
+            depth--;
+            break;
+
+        /* ucomisd sets the flags as an unsigned compare of its operands
+         * would, and sets all of ZF, PF and CF if either is NaN, so the
+         * "above" conditions are false for NaN. a < b is tested as b > a. */
+        case CA_OPCODE_LT:
+            NEED(2, 0);
+            REG(SSE_UCOMISD, depth - 1, depth - 2);
+            EMIT(b, SETA_AL);
+            ca_jit_bool(b, depth - 2);
+            depth--;
+            break;
+        case CA_OPCODE_LTEQ:
+            NEED(2, 0);
+            REG(SSE_UCOMISD, depth - 1, depth - 2);
+            EMIT(b, SETAE_AL);
+            ca_jit_bool(b, depth - 2);
+            depth--;
+            break;
+        case CA_OPCODE_GT:
+            NEED(2, 0);
+            REG(SSE_UCOMISD, depth - 2, depth - 1);
+            EMIT(b, SETA_AL);
+            ca_jit_bool(b, depth - 2);
+            depth--;
+            break;
+        case CA_OPCODE_GTEQ:
+            NEED(2, 0);
+            REG(SSE_UCOMISD, depth - 2, depth - 1);
+            EMIT(b, SETAE_AL);
+            ca_jit_bool(b, depth - 2);
+            depth--;
+            break;
+        case CA_OPCODE_EQ:
+            NEED(2, 0);
+            REG(SSE_UCOMISD, depth - 2, depth - 1);
+            EMIT(b, SETE_AL, SETNP_CL, AND_AL_CL);
+            ca_jit_bool(b, depth - 2);
+            depth--;
+            break;
+        case CA_OPCODE_NEQ:
+            NEED(2, 0);
+            REG(SSE_UCOMISD, depth - 2, depth - 1);
+            EMIT(b, SETNE_AL, SETP_CL, OR_AL_CL);
+            ca_jit_bool(b, depth - 2);
+            depth--;
+            break;
+
+        case CA_OPCODE_ADD_CONST:
+            NEED(1, 0);
+            CONST(SSE_ADDSD, depth - 1, ip->arg);
+            break;
+        case CA_OPCODE_SUB_CONST:
+            NEED(1, 0);
+            CONST(SSE_SUBSD, depth - 1, ip->arg);
+            break;
+        case CA_OPCODE_MUL_CONST:
+            NEED(1, 0);
+            CONST(SSE_MULSD, depth - 1, ip->arg);
+            break;
+        case CA_OPCODE_DIV_CONST:
+            NEED(1, 0);
+            CONST(SSE_DIVSD, depth - 1, ip->arg);
+            break;
+        case CA_OPCODE_ADD_VAR:
+            NEED(1, 0);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            VAR(SSE_ADDSD, depth - 1, ip->arg);
+            break;
+        case CA_OPCODE_SUB_VAR:
+            NEED(1, 0);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            VAR(SSE_SUBSD, depth - 1, ip->arg);
+            break;
+        case CA_OPCODE_MUL_VAR:
+            NEED(1, 0);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            VAR(SSE_MULSD, depth - 1, ip->arg);
+            break;
+        case CA_OPCODE_DIV_VAR:
+            NEED(1, 0);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            VAR(SSE_DIVSD, depth - 1, ip->arg);
+            break;
+
+        case CA_OPCODE_MUL_ADD:
+            NEED(3, 0);
+            REG(SSE_MULSD, depth - 2, depth - 1);
+            REG(SSE_ADDSD, depth - 3, depth - 2);
+            depth -= 2;
+            break;
+        case CA_OPCODE_MUL_ADD_VAR:
+            NEED(2, 0);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            VAR(SSE_MULSD, depth - 1, ip->arg);
+            REG(SSE_ADDSD, depth - 2, depth - 1);
+            depth--;
+            break;
+        case CA_OPCODE_SQUARE:
+            NEED(1, 0);
+            REG(SSE_MULSD, depth - 1, depth - 1);
+            break;
+        case CA_OPCODE_CUBE:
+            NEED(1, 1);
+            REG(SSE_MOVAPD, depth, depth - 1);
+            REG(SSE_MULSD, depth, depth - 1);
+            REG(SSE_MULSD, depth - 1, depth);
+            break;
+        case CA_OPCODE_INC_VAR:
+            NEED(0, 1);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            VAR(SSE_MOVSD_LOAD, depth, ip->arg);
+            CONST(SSE_ADDSD, depth, ip->n);
+            ca_jit_store_var(b, ip->arg, depth);
+            depth++;
+            break;
+
+        case CA_OPCODE_SAVE_TEMP:
+            NEED(1, 0);
+            if (ip->arg >= CA_JIT_TEMPS)
+                return CA_ERROR_EVAL_UNSUPPORTED;
+            ca_jit_sse_temp(b, SSE_MOVSD_STORE, depth - 1, ip->arg);
+            break;
+        case CA_OPCODE_LOAD_TEMP:
+            NEED(0, 1);
+            if (ip->arg >= CA_JIT_TEMPS)
+                return CA_ERROR_EVAL_UNSUPPORTED;
+            ca_jit_sse_temp(b, SSE_MOVSD_LOAD, depth, ip->arg);
+            depth++;
+            break;
+
+        default:
+            return CA_ERROR_EVAL_UNSUPPORTED;
+        }
+        if (err != CA_ERROR_OK)
+            return err;
+    }
+
+    /* The code does not end in CA_OPCODE_END. */
+    return CA_ERROR_EVAL_UNSUPPORTED;
+}
+
+#undef CONST
+#undef VAR
+#undef REG
+
+#else
+
+/*
+ * Every value on the data stack is an x87 register, b being st(0) and a
+ * st(1), so binary operators are the popping forms of the x87 instructions,
+ * and the register stack holds exactly the result when the function returns.
+ * A long double is the format of the registers, so every operation rounds as
+ * the VM's own does.
+ */
+
+/* x87 instructions with no operands. */
+#define X87_FLD_ST0   0xD9, 0xC0 /* Pushes st(0) again. */
+#define X87_FXCH      0xD9, 0xC9
+#define X87_FLD1      0xD9, 0xE8
+#define X87_FSTP_ST0  0xDD, 0xD8 /* Pops st(0). */
+#define X87_FADDP     0xDE, 0xC1 /* st(1) + st(0), popping st(0). */
+#define X87_FMULP     0xDE, 0xC9
+#define X87_FSUBP     0xDE, 0xE9 /* st(1) - st(0) */
+#define X87_FDIVP     0xDE, 0xF9 /* st(1) / st(0) */
+#define X87_FUCOMIP   0xDF, 0xE9 /* Compares st(0) to st(1), popping st(0). */
+
+/* Loads and stores of a CaReal in memory, as opcode and ModRM reg field. */
+#define X87_FLD_REAL  0xDB, 5 /* fld tword */
+#define X87_FSTP_REAL 0xDB, 7 /* fstp tword */
+
+/* Pushes al, which is 0 or 1, as a value. */
+#define BOOL_PUSH 0x0F, 0xB6, 0xC0, /* movzx eax, al      */ \
+                  0x50,             /* push rax           */ \
+                  0xDF, 0x2C, 0x24, /* fild qword [rsp]   */ \
+                  0x58              /* pop rax            */
+
+/* Emits an instruction on temporary k, with reg the ModRM reg field. */
+static void ca_jit_emit_temp(CaJitBuf *b, uint8_t op, uint8_t reg, uint32_t k)
+{
+    uint32_t disp = ca_jit_temp(k);
+    uint8_t bytes[7] = {
+        op, 0x80 | reg << 3 | 4, 0x24, /* [rsp + disp32] */
+        disp, disp >> 8, disp >> 16, disp >> 24
+    };
+    ca_jit_emit(b, bytes, sizeof(bytes));
+}
+
+/* Pushes constant k. */
+static void ca_jit_fld_const(CaJitBuf *b, uint32_t k)
+{
+    ca_jit_emit_mem(b, X87_FLD_REAL, REG_RSI, k * sizeof(CaReal));
+}
+
+/* Pushes variable v. */
+static void ca_jit_fld_var(CaJitBuf *b, CaSymbol v)
+{
+    ca_jit_emit_mem(b, X87_FLD_REAL, REG_RDI, ca_jit_var(v));
+}
+
+/* Pops b into variable v, and marks it set. */
+static void ca_jit_fstp_var(CaJitBuf *b, CaSymbol v)
+{
+    ca_jit_emit_mem(b, X87_FSTP_REAL, REG_RDI, ca_jit_var(v));
+    ca_jit_tag_var(b, v);
+}
+
+/* Translates the instructions of code into b. */
+static CaError ca_jit_translate(const CaCode *code, CaJitBuf *b, CaJit *jit)
+{
+    CaSize depth = 0, capacity = 0;
+    CaError err = CA_ERROR_OK;
+
+    for (const CaInstr *ip = code->instrs; ip < code->instrs + code->count;
+         ip++) {
+        switch ((CaOpcode) ip->op) {
+        case CA_OPCODE_END:
+            if (depth != 1)
+                return CA_ERROR_EVAL_UNSUPPORTED;
+            EMIT(b, RET);
+            return b->failed ? CA_ERROR_MEM : CA_ERROR_OK;
+
+        case CA_OPCODE_PUSH_CONST:
+            NEED(0, 1);
+            ca_jit_fld_const(b, ip->arg);
+            depth++;
+            break;
+        case CA_OPCODE_LOAD:
+            NEED(0, 1);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            ca_jit_fld_var(b, ip->arg);
+            depth++;
+            break;
+        case CA_OPCODE_STORE:
+            NEED(1, 1);
+            ca_jit_store(jit, ip->arg);
+            EMIT(b, X87_FLD_ST0);
+            ca_jit_fstp_var(b, ip->arg);
+            break;
+        case CA_OPCODE_STORE_POP:
+            NEED(1, 0);
+            ca_jit_store(jit, ip->arg);
+            ca_jit_fstp_var(b, ip->arg);
+            depth--;
+            break;
+        case CA_OPCODE_POP:
+            NEED(1, 0);
+            EMIT(b, X87_FSTP_ST0);
+            depth--;
+            break;
+        case CA_OPCODE_POST_INC:
+        case CA_OPCODE_POST_DEC:
+            NEED(1, 2);
+            ca_jit_store(jit, ip->arg);
+            EMIT(b, X87_FLD_ST0, X87_FLD1);
+            if (ip->op == CA_OPCODE_POST_INC)
+                EMIT(b, X87_FADDP);
+            else
+                EMIT(b, X87_FSUBP);
+            ca_jit_fstp_var(b, ip->arg);
+            break;
+
+        case CA_OPCODE_ADDITION:
+            NEED(2, 0);
+            EMIT(b, X87_FADDP);
+            depth--;
+            break;
+        case CA_OPCODE_SUBTRACTION:
+            NEED(2, 0);
+            EMIT(b, X87_FSUBP);
+            depth--;
+            break;
+        case CA_OPCODE_MULTIPLICATION:
+            NEED(2, 0);
+            EMIT(b, X87_FMULP);
+            depth--;
+            break;
+        case CA_OPCODE_DIVISION:
+            NEED(2, 0);
+            EMIT(b, X87_FDIVP);
+            depth--;
+            break;
+
+        /* fucomip sets the flags as an unsigned compare of st(0) to st(1)
+         * would, and sets all of ZF, PF and CF if either is NaN, so the
+         * "above" conditions are false for NaN. a > b is tested as b < a by
+         * swapping them first. */
+        case CA_OPCODE_LT:
+            NEED(2, 0);
+            EMIT(b, X87_FUCOMIP, X87_FSTP_ST0, SETA_AL, BOOL_PUSH);
+            depth--;
+            break;
+        case CA_OPCODE_LTEQ:
+            NEED(2, 0);
+            EMIT(b, X87_FUCOMIP, X87_FSTP_ST0, SETAE_AL, BOOL_PUSH);
+            depth--;
+            break;
+        case CA_OPCODE_GT:
+            NEED(2, 0);
+            EMIT(b, X87_FXCH, X87_FUCOMIP, X87_FSTP_ST0, SETA_AL, BOOL_PUSH);
+            depth--;
+            break;
+        case CA_OPCODE_GTEQ:
+            NEED(2, 0);
+            EMIT(b, X87_FXCH, X87_FUCOMIP, X87_FSTP_ST0, SETAE_AL, BOOL_PUSH);
+            depth--;
+            break;
+        case CA_OPCODE_EQ:
+            NEED(2, 0);
+            EMIT(b, X87_FUCOMIP, X87_FSTP_ST0, SETE_AL, SETNP_CL, AND_AL_CL,
+                 BOOL_PUSH);
+            depth--;
+            break;
+        case CA_OPCODE_NEQ:
+            NEED(2, 0);
+            EMIT(b, X87_FUCOMIP, X87_FSTP_ST0, SETNE_AL, SETP_CL, OR_AL_CL,
+                 BOOL_PUSH);
+            depth--;
+            break;
+
+        case CA_OPCODE_ADD_CONST:
+            NEED(1, 1);
+            ca_jit_fld_const(b, ip->arg);
+            EMIT(b, X87_FADDP);
+            break;
+        case CA_OPCODE_SUB_CONST:
+            NEED(1, 1);
+            ca_jit_fld_const(b, ip->arg);
+            EMIT(b, X87_FSUBP);
+            break;
+        case CA_OPCODE_MUL_CONST:
+            NEED(1, 1);
+            ca_jit_fld_const(b, ip->arg);
+            EMIT(b, X87_FMULP);
+            break;
+        case CA_OPCODE_DIV_CONST:
+            NEED(1, 1);
+            ca_jit_fld_const(b, ip->arg);
+            EMIT(b, X87_FDIVP);
+            break;
+        case CA_OPCODE_ADD_VAR:
+            NEED(1, 1);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            ca_jit_fld_var(b, ip->arg);
+            EMIT(b, X87_FADDP);
+            break;
+        case CA_OPCODE_SUB_VAR:
+            NEED(1, 1);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            ca_jit_fld_var(b, ip->arg);
+            EMIT(b, X87_FSUBP);
+            break;
+        case CA_OPCODE_MUL_VAR:
+            NEED(1, 1);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            ca_jit_fld_var(b, ip->arg);
+            EMIT(b, X87_FMULP);
+            break;
+        case CA_OPCODE_DIV_VAR:
+            NEED(1, 1);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            ca_jit_fld_var(b, ip->arg);
+            EMIT(b, X87_FDIVP);
+            break;
+
+        case CA_OPCODE_MUL_ADD:
+            NEED(3, 0);
+            EMIT(b, X87_FMULP, X87_FADDP);
+            depth -= 2;
+            break;
+        case CA_OPCODE_MUL_ADD_VAR:
+            NEED(2, 1);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            ca_jit_fld_var(b, ip->arg);
+            EMIT(b, X87_FMULP, X87_FADDP);
+            depth--;
+            break;
+        case CA_OPCODE_SQUARE:
+            NEED(1, 1);
+            EMIT(b, X87_FLD_ST0, X87_FMULP);
+            break;
+        case CA_OPCODE_CUBE:
+            NEED(1, 2);
+            EMIT(b, X87_FLD_ST0, X87_FLD_ST0, X87_FMULP, X87_FMULP);
+            break;
+        case CA_OPCODE_INC_VAR:
+            NEED(0, 2);
+            err = ca_jit_load(jit, &capacity, ip->arg);
+            ca_jit_fld_var(b, ip->arg);
+            ca_jit_fld_const(b, ip->n);
+            EMIT(b, X87_FADDP, X87_FLD_ST0);
+            ca_jit_fstp_var(b, ip->arg);
+            depth++;
+            break;
+
+        /* A store of a CaReal always pops, so b is pushed again first. */
+        case CA_OPCODE_SAVE_TEMP:
+            NEED(1, 1);
+            if (ip->arg >= CA_JIT_TEMPS)
+                return CA_ERROR_EVAL_UNSUPPORTED;
+            EMIT(b, X87_FLD_ST0);
+            ca_jit_emit_temp(b, X87_FSTP_REAL, ip->arg);
+            break;
+        case CA_OPCODE_LOAD_TEMP:
+            NEED(0, 1);
+            if (ip->arg >= CA_JIT_TEMPS)
+                return CA_ERROR_EVAL_UNSUPPORTED;
+            ca_jit_emit_temp(b, X87_FLD_REAL, ip->arg);
+            depth++;
+            break;
+
+        default:
+            return CA_ERROR_EVAL_UNSUPPORTED;
+        }
+        if (err != CA_ERROR_OK)
+            return err;
+    }
+    /* The code does not end in CA_OPCODE_END. */
+    return CA_ERROR_EVAL_UNSUPPORTED;
+}
+
+#endif /* CA_REAL_DOUBLE */
+
+#undef NEED
+
+CaError ca_jit_compile(CaCode *code)
+{
+    CaJitBuf b = { NULL, 0, 0, 0 };
+    CaSize page = sysconf(_SC_PAGESIZE);
+    CaJit *jit;
+    CaError err;
+    void *mem;
+
+    ca_jit_free(code->jit);
+    code->jit = NULL;
+
+    if (!(jit = calloc(1, sizeof(CaJit))))
+        return CA_ERROR_MEM;
+
+    if ((err = ca_jit_translate(code, &b, jit)) != CA_ERROR_OK) {
+        free(b.data);
+        ca_jit_free(jit);
+        return err;
+    }
+
+    /* The pages are never writable and executable at once. */
+    jit->mem_size = (b.size + page - 1) / page * page;
+    mem = mmap(NULL, jit->mem_size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        free(b.data);
+        ca_jit_free(jit);
+        return CA_ERROR_MEM;
+    }
+    jit->mem = mem;
+    memcpy(mem, b.data, b.size);
+    free(b.data);
+    if (mprotect(mem, jit->mem_size, PROT_READ | PROT_EXEC)) {
+        ca_jit_free(jit);
+        return CA_ERROR_MEM;
+    }
+
+    jit->func = (CaJitFunc) mem;
+    code->jit = jit;
+    return CA_ERROR_OK;
+}
+
+#endif
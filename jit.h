@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file jit.h
+ * \author Anamitra Ghorui
+ * \brief Native code generator for arithmetic expressions
+ *
+ */
+
+/*
+ * Code made only of arithmetic on constants and variables may be compiled to
+ * x86-64 machine code, which is run in place of the VM by ca_run. The data
+ * stack is kept in registers, xmm0 to xmm7 with SSE2 when CaReal is a double,
+ * and the x87 register stack when it is a long double, so that each operation
+ * rounds as the VM's does. No value is stored in memory between instructions
+ * but temporaries, and code needing more than 8 registers is not compiled.
+ * Code with jumps or calls, or with any other instruction, is left to the VM.
+ *
+ * Native code does no checks while it runs. The variables it reads must all
+ * be set, and those it writes must have room in the context, before it is
+ * run, or else the VM is run instead, which also reports any error.
+ *
+ * Defining CA_NO_JIT leaves out the code generator. It is also left out when
+ * CaReal is a binary128, which the x87 cannot load.
+ */
+
+#ifndef CA_JIT_H
+#define CA_JIT_H
+
+#include "eval.h"
+#include "command_stack.h"
+#include "error.h"
+
+#if defined(__x86_64__) && defined(__unix__) && !defined(CA_NO_JIT) && \
+    !defined(CA_REAL_FLOAT128)
+#define CA_JIT_X86_64 1
+#else
+#define CA_JIT_X86_64 0
+#endif
+
+/// Number of values the data stack of native code holds.
+#define CA_JIT_DEPTH 8
+
+/// Number of temporaries native code holds, in the red zone under its stack
+/// pointer.
+#define CA_JIT_TEMPS 6
+
+/// Native code. It returns the value of the expression.
+typedef CaReal (*CaJitFunc)(CaVar *vars, const CaReal *consts);
+
+/// Native code compiled from a CaCode.
+typedef struct CaJit {
+    CaJitFunc func;
+    void *mem;           ///< The pages func is in.
+    CaSize mem_size;
+    CaSymbol *loads;     ///< Variables that must be set to run func.
+    CaSize nloads;
+    CaSize nvars;        ///< Number of variables the context must have room for.
+} CaJit;
+
+/**
+ * \brief Compiles code to native code, which is kept in code->jit until the
+ *        code is emptied or freed. The code must not be changed otherwise
+ *        while it has native code.
+ * \param code The code, ending in CA_OPCODE_END.
+ * \return An error code. CA_ERROR_JIT_UNSUPPORTED if native code is not
+ *         supported on this machine, and CA_ERROR_EVAL_UNSUPPORTED if the code
+ *         has instructions that cannot be compiled. The code is still run on
+ *         the VM in either case.
+ */
+CaError ca_jit_compile(CaCode *code);
+
+/**
+ * \brief Frees native code.
+ * \param jit The native code, or NULL.
+ */
+void ca_jit_free(CaJit *jit);
+
+/**
+ * \brief Runs the native code of compiled code, if it can be run on the
+ *        context as it is.
+ * \param c The context the code was compiled for.
+ * \param code The code.
+ * \param result The value of the expression.
+ * \return 1 if the native code was run, else 0, and the code must be run on
+ *         the VM.
+ */
+int ca_jit_run(CaContext *c, const CaCode *code, CaReal *result);
+
+#endif
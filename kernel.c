@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file kernel.c
+ * \author Anamitra Ghorui
+ * \brief Binary operators on columns of values
+ */
+
+#include "kernel.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#   define CA_KERNEL_X86
+#endif
+
+const char *const ca_kernel_op_names[CA_KERNEL_OP_COUNT] = {
+    "+", "-", "*", "/", "%", "<<", ">>", "<", "<=", ">", ">=", "==", "!=",
+    "&", "^", "|", "&&", "||"
+};
+
+/* CaInt arithmetic, wrapping on overflow. */
+#define IADD(_a, _b) ((CaInt) ((CaUint) (_a) + (CaUint) (_b)))
+#define ISUB(_a, _b) ((CaInt) ((CaUint) (_a) - (CaUint) (_b)))
+#define IMUL(_a, _b) ((CaInt) ((CaUint) (_a) * (CaUint) (_b)))
+
+static inline CaInt ca_kernel_idiv(CaInt a, CaInt b)
+{
+    return b == 0 ? 0 : b == -1 ? ISUB(0, a) : a / b;
+}
+
+static inline CaInt ca_kernel_irem(CaInt a, CaInt b)
+{
+    return b == 0 || b == -1 ? 0 : a % b;
+}
+
+/* The CaInt a double is truncated to by shifts and bitwise operators, as
+ * ca_real_to_int does (see real.h). */
+static inline CaInt ca_kernel_trunc(double x)
+{
+    if (x != x)
+        return 0;
+    if (x >= 0x1p63)
+        return INT64_MAX;
+    return x < -0x1p63 ? INT64_MIN : (CaInt) x;
+}
+
+#define TRUNC(_x) ca_kernel_trunc(_x)
+
+/* 1.0 where a mask of a double comparison is set, 0.0 elsewhere. */
+#define DMASK(_m) ((VD) ((_m) & (VI) ((VD) {} + 1.0)))
+
+/*
+ * The operators, with the expressions giving the result from operands x and
+ * y: as vectors, for the operators that have one, and as scalars. Vector
+ * expressions work on the types VI, VU and VD, vectors of CaInt, CaUint and
+ * double, which every implementation defines for its own width.
+ */
+#define CA_KERNEL_INT_VECTOR(X, _s, _a, _b)                                 \
+    X(_s, _a, _b, ADD, add, (VI) ((VU) x + (VU) y), IADD(x, y))            \
+    X(_s, _a, _b, SUB, sub, (VI) ((VU) x - (VU) y), ISUB(x, y))            \
+    X(_s, _a, _b, MUL, mul, (VI) ((VU) x * (VU) y), IMUL(x, y))            \
+    X(_s, _a, _b, LSHIFT, lshift, (VI) ((VU) x << (VU) (y & 63)),         \
+      (CaInt) ((CaUint) x << (y & 63)))                                    \
+    X(_s, _a, _b, RSHIFT, rshift, x >> (y & 63), x >> (y & 63))            \
+    X(_s, _a, _b, LT, lt, -(x < y), x < y)                                 \
+    X(_s, _a, _b, LTEQ, lteq, -(x <= y), x <= y)                           \
+    X(_s, _a, _b, GT, gt, -(x > y), x > y)                                 \
+    X(_s, _a, _b, GTEQ, gteq, -(x >= y), x >= y)                           \
+    X(_s, _a, _b, EQ, eq, -(x == y), x == y)                               \
+    X(_s, _a, _b, NEQ, neq, -(x != y), x != y)                             \
+    X(_s, _a, _b, B_AND, b_and, x & y, x & y)                              \
+    X(_s, _a, _b, B_XOR, b_xor, x ^ y, x ^ y)                              \
+    X(_s, _a, _b, B_OR, b_or, x | y, x | y)                                \
+    X(_s, _a, _b, AND, and, -((x != 0) & (y != 0)), x && y)                \
+    X(_s, _a, _b, OR, or, -((x != 0) | (y != 0)), x || y)
+
+#define CA_KERNEL_INT_SCALAR(X, _s)                                         \
+    X(_s, DIV, div, ca_kernel_idiv(x, y))                                  \
+    X(_s, REM, rem, ca_kernel_irem(x, y))
+
+#define CA_KERNEL_REAL_VECTOR(X, _s, _a, _b)                                \
+    X(_s, _a, _b, ADD, add, x + y, x + y)                                  \
+    X(_s, _a, _b, SUB, sub, x - y, x - y)                                  \
+    X(_s, _a, _b, MUL, mul, x * y, x * y)                                  \
+    X(_s, _a, _b, DIV, div, x / y, x / y)                                  \
+    X(_s, _a, _b, LT, lt, DMASK(x < y), x < y)                             \
+    X(_s, _a, _b, LTEQ, lteq, DMASK(x <= y), x <= y)                       \
+    X(_s, _a, _b, GT, gt, DMASK(x > y), x > y)                             \
+    X(_s, _a, _b, GTEQ, gteq, DMASK(x >= y), x >= y)                       \
+    X(_s, _a, _b, EQ, eq, DMASK(x == y), x == y)                           \
+    X(_s, _a, _b, NEQ, neq, DMASK(x != y), x != y)                         \
+    X(_s, _a, _b, AND, and, DMASK((x != 0) & (y != 0)), x != 0 && y != 0)  \
+    X(_s, _a, _b, OR, or, DMASK((x != 0) | (y != 0)), x != 0 || y != 0)
+
+#define CA_KERNEL_REAL_SCALAR(X, _s)                                        \
+    X(_s, REM, rem, fmod(x, y))                                            \
+    X(_s, LSHIFT, lshift, (CaInt) ((CaUint) TRUNC(x) << (TRUNC(y) & 63)))  \
+    X(_s, RSHIFT, rshift, TRUNC(x) >> (TRUNC(y) & 63))                     \
+    X(_s, B_AND, b_and, TRUNC(x) & TRUNC(y))                               \
+    X(_s, B_XOR, b_xor, TRUNC(x) ^ TRUNC(y))                               \
+    X(_s, B_OR, b_or, TRUNC(x) | TRUNC(y))
+
+/*
+ * The three kernels of an operator on type _t, named after _name and _p, the
+ * prefix of the type. Vector kernels, defined where _b is the width of the
+ * vectors in bytes, run the vector expression on every whole vector of the
+ * columns, and the scalar expression on the rest. Scalars are only broadcast
+ * to a vector, never to a column, by subtracting a zero vector from them,
+ * which unlike adding one keeps the sign of -0.0.
+ */
+#define KERNEL_LOOP(_t, _b, _vt, _vexpr, _sexpr, _x, _y, _vx, _vy)          \
+    typedef CaInt VI __attribute__((vector_size(_b), unused));              \
+    typedef CaUint VU __attribute__((vector_size(_b), unused));             \
+    typedef double VD __attribute__((vector_size(_b), unused));             \
+    const CaSize w = (_b) / sizeof(_t);                                     \
+    CaSize i = 0;                                                           \
+    for (; i + w <= n; i += w) {                                            \
+        _vt x, y, r;                                                        \
+        _vx;                                                                \
+        _vy;                                                                \
+        r = (_vexpr);                                                       \
+        memcpy(dst + i, &r, sizeof(r));                                     \
+    }                                                                       \
+    for (; i < n; i++) {                                                    \
+        _t x = (_x), y = (_y);                                              \
+        dst[i] = (_sexpr);                                                  \
+    }
+
+#define KERNEL_VECTOR(_t, _p, _s, _a, _b, _vt, _name, _vexpr, _sexpr)       \
+    _a static void ca_kernel_##_p##_##_name##_vv_##_s(                      \
+        _t *dst, const _t *a, const _t *b, CaSize n)                        \
+    {                                                                       \
+        KERNEL_LOOP(_t, _b, _vt, _vexpr, _sexpr, a[i], b[i],                \
+                    memcpy(&x, a + i, sizeof(x)),                           \
+                    memcpy(&y, b + i, sizeof(y)))                           \
+    }                                                                       \
+    _a static void ca_kernel_##_p##_##_name##_vs_##_s(                      \
+        _t *dst, const _t *a, _t b, CaSize n)                               \
+    {                                                                       \
+        KERNEL_LOOP(_t, _b, _vt, _vexpr, _sexpr, a[i], b,                   \
+                    memcpy(&x, a + i, sizeof(x)),                           \
+                    y = b - (_vt) {})                                       \
+    }                                                                       \
+    _a static void ca_kernel_##_p##_##_name##_sv_##_s(                      \
+        _t *dst, _t a, const _t *b, CaSize n)                               \
+    {                                                                       \
+        KERNEL_LOOP(_t, _b, _vt, _vexpr, _sexpr, a, b[i],                   \
+                    x = a - (_vt) {},                                       \
+                    memcpy(&y, b + i, sizeof(y)))                           \
+    }
+
+#define KERNEL_SCALAR(_t, _p, _s, _name, _sexpr)                            \
+    static void ca_kernel_##_p##_##_name##_vv_##_s(                         \
+        _t *dst, const _t *a, const _t *b, CaSize n)                        \
+    {                                                                       \
+        for (CaSize i = 0; i < n; i++) {                                    \
+            _t x = a[i], y = b[i];                                          \
+            dst[i] = (_sexpr);                                              \
+        }                                                                   \
+    }                                                                       \
+    static void ca_kernel_##_p##_##_name##_vs_##_s(                         \
+        _t *dst, const _t *a, _t y, CaSize n)                               \
+    {                                                                       \
+        for (CaSize i = 0; i < n; i++) {                                    \
+            _t x = a[i];                                                    \
+            dst[i] = (_sexpr);                                              \
+        }                                                                   \
+    }                                                                       \
+    static void ca_kernel_##_p##_##_name##_sv_##_s(                         \
+        _t *dst, _t x, const _t *b, CaSize n)                               \
+    {                                                                       \
+        for (CaSize i = 0; i < n; i++) {                                    \
+            _t y = b[i];                                                    \
+            dst[i] = (_sexpr);                                              \
+        }                                                                   \
+    }
+
+#define INT_VECTOR(_s, _a, _b, _op, _name, _vexpr, _sexpr)                  \
+    KERNEL_VECTOR(CaInt, i, _s, _a, _b, VI, _name, _vexpr, _sexpr)
+#define REAL_VECTOR(_s, _a, _b, _op, _name, _vexpr, _sexpr)                 \
+    KERNEL_VECTOR(double, d, _s, _a, _b, VD, _name, _vexpr, _sexpr)
+#define INT_SCALAR_ALL(_s, _a, _b, _op, _name, _vexpr, _sexpr)              \
+    KERNEL_SCALAR(CaInt, i, _s, _name, _sexpr)
+#define REAL_SCALAR_ALL(_s, _a, _b, _op, _name, _vexpr, _sexpr)             \
+    KERNEL_SCALAR(double, d, _s, _name, _sexpr)
+#define INT_SCALAR(_s, _op, _name, _sexpr)                                  \
+    KERNEL_SCALAR(CaInt, i, _s, _name, _sexpr)
+#define REAL_SCALAR(_s, _op, _name, _sexpr)                                 \
+    KERNEL_SCALAR(double, d, _s, _name, _sexpr)
+
+/* Entries of a CaKernels for the kernels of implementation _s. */
+#define ENTRIES(_p, _op, _name, _s)                                         \
+    ._p##_vv[CA_KERNEL_##_op] = ca_kernel_##_p##_##_name##_vv_##_s,         \
+    ._p##_vs[CA_KERNEL_##_op] = ca_kernel_##_p##_##_name##_vs_##_s,         \
+    ._p##_sv[CA_KERNEL_##_op] = ca_kernel_##_p##_##_name##_sv_##_s,
+#define INT_ENTRIES(_s, _a, _b, _op, _name, _vexpr, _sexpr)                 \
+    ENTRIES(i, _op, _name, _s)
+#define REAL_ENTRIES(_s, _a, _b, _op, _name, _vexpr, _sexpr)                \
+    ENTRIES(d, _op, _name, _s)
+#define INT_SCALAR_ENTRIES(_s, _op, _name, _sexpr)                          \
+    ENTRIES(i, _op, _name, scalar)
+#define REAL_SCALAR_ENTRIES(_s, _op, _name, _sexpr)                         \
+    ENTRIES(d, _op, _name, scalar)
+
+/* Kernels and table of a vector implementation. */
+#define KERNEL_IMPL(_s, _a, _b)                                             \
+    CA_KERNEL_INT_VECTOR(INT_VECTOR, _s, _a, _b)                            \
+    CA_KERNEL_REAL_VECTOR(REAL_VECTOR, _s, _a, _b)                          \
+    static const CaKernels ca_kernels_##_s = {                              \
+        CA_KERNEL_INT_VECTOR(INT_ENTRIES, _s, _a, _b)                       \
+        CA_KERNEL_INT_SCALAR(INT_SCALAR_ENTRIES, _s)                        \
+        CA_KERNEL_REAL_VECTOR(REAL_ENTRIES, _s, _a, _b)                     \
+        CA_KERNEL_REAL_SCALAR(REAL_SCALAR_ENTRIES, _s)                      \
+    };
+
+CA_KERNEL_INT_VECTOR(INT_SCALAR_ALL, scalar, , 0)
+CA_KERNEL_INT_SCALAR(INT_SCALAR, scalar)
+CA_KERNEL_REAL_VECTOR(REAL_SCALAR_ALL, scalar, , 0)
+CA_KERNEL_REAL_SCALAR(REAL_SCALAR, scalar)
+
+static const CaKernels ca_kernels_scalar = {
+    CA_KERNEL_INT_VECTOR(INT_ENTRIES, scalar, , 0)
+    CA_KERNEL_INT_SCALAR(INT_SCALAR_ENTRIES, scalar)
+    CA_KERNEL_REAL_VECTOR(REAL_ENTRIES, scalar, , 0)
+    CA_KERNEL_REAL_SCALAR(REAL_SCALAR_ENTRIES, scalar)
+};
+
+#ifdef CA_KERNEL_X86
+KERNEL_IMPL(sse2, __attribute__((target("sse2"))), 16)
+KERNEL_IMPL(avx2, __attribute__((target("avx2"))), 32)
+KERNEL_IMPL(avx512, __attribute__((target("avx512f,avx512dq"))), 64)
+#endif
+
+int ca_kernel_supported(CaKernelImpl impl)
+{
+    switch (impl) {
+    case CA_KERNEL_IMPL_AUTO:
+    case CA_KERNEL_IMPL_SCALAR:
+        return 1;
+#ifdef CA_KERNEL_X86
+    case CA_KERNEL_IMPL_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case CA_KERNEL_IMPL_AVX2:
+        return __builtin_cpu_supports("avx2");
+    case CA_KERNEL_IMPL_AVX512:
+        return __builtin_cpu_supports("avx512f") &&
+               __builtin_cpu_supports("avx512dq");
+#endif
+    default:
+        return 0;
+    }
+}
+
+const CaKernels *ca_kernels(CaKernelImpl impl)
+{
+    if (impl == CA_KERNEL_IMPL_AUTO) {
+        if (ca_kernel_supported(CA_KERNEL_IMPL_AVX512))
+            impl = CA_KERNEL_IMPL_AVX512;
+        else if (ca_kernel_supported(CA_KERNEL_IMPL_AVX2))
+            impl = CA_KERNEL_IMPL_AVX2;
+        else if (ca_kernel_supported(CA_KERNEL_IMPL_SSE2))
+            impl = CA_KERNEL_IMPL_SSE2;
+        else
+            impl = CA_KERNEL_IMPL_SCALAR;
+    }
+
+    if (!ca_kernel_supported(impl))
+        return NULL;
+
+    switch (impl) {
+#ifdef CA_KERNEL_X86
+    case CA_KERNEL_IMPL_SSE2:
+        return &ca_kernels_sse2;
+    case CA_KERNEL_IMPL_AVX2:
+        return &ca_kernels_avx2;
+    case CA_KERNEL_IMPL_AVX512:
+        return &ca_kernels_avx512;
+#endif
+    default:
+        return &ca_kernels_scalar;
+    }
+}
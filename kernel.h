@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file kernel.h
+ * \author Anamitra Ghorui
+ * \brief Binary operators on columns of values
+ *
+ */
+
+/*
+ * A kernel applies a binary operator to every element of one or two columns,
+ * writing a column of results. There is a kernel for each operator, for
+ * CaInt and for double values, and for each shape of operands: two columns,
+ * a column and a scalar, and a scalar and a column, so that a scalar never
+ * has to be copied to a column of its own.
+ *
+ * Kernels are built for SSE2, AVX2 and AVX-512 with GCC vector extensions,
+ * working on 16, 32 or 64 bytes at a time, and are picked at runtime for the
+ * CPU. Every implementation gives the same results as the scalar one, which
+ * is used on other CPUs. Operators with no vector instructions, like integer
+ * division, have scalar kernels in every implementation.
+ *
+ * Integer arithmetic wraps on overflow, shift counts are taken modulo 64, and
+ * comparisons and logical operators give 1 or 0. Double shifts and bitwise
+ * operators work on the values truncated to CaInt, as the VM does.
+ */
+
+#ifndef CA_KERNEL_H
+#define CA_KERNEL_H
+
+#include "types.h"
+
+/// The operators there are kernels for.
+typedef enum CaKernelOp {
+    CA_KERNEL_ADD = 0,
+    CA_KERNEL_SUB,
+    CA_KERNEL_MUL,
+    CA_KERNEL_DIV,   ///< Integer division truncates, and x / 0 is 0.
+    CA_KERNEL_REM,   ///< Integer x % 0 is 0. Double remainders are fmod's.
+    CA_KERNEL_LSHIFT,
+    CA_KERNEL_RSHIFT,
+    CA_KERNEL_LT,
+    CA_KERNEL_LTEQ,
+    CA_KERNEL_GT,
+    CA_KERNEL_GTEQ,
+    CA_KERNEL_EQ,
+    CA_KERNEL_NEQ,
+    CA_KERNEL_B_AND,
+    CA_KERNEL_B_XOR,
+    CA_KERNEL_B_OR,
+    CA_KERNEL_AND,
+    CA_KERNEL_OR,
+    CA_KERNEL_OP_COUNT
+} CaKernelOp;
+
+/// The instruction set kernels are built for.
+typedef enum CaKernelImpl {
+    CA_KERNEL_IMPL_AUTO = 0,
+    CA_KERNEL_IMPL_SCALAR,
+    CA_KERNEL_IMPL_SSE2,
+    CA_KERNEL_IMPL_AVX2,
+    CA_KERNEL_IMPL_AVX512
+} CaKernelImpl;
+
+/*
+ * Kernels write n results to dst, which may be the same as a column operand.
+ * They are named after the shape of their operands: v for a column, s for a
+ * scalar.
+ */
+typedef void (*CaKernelIntVV)(CaInt *dst, const CaInt *a, const CaInt *b,
+                              CaSize n);
+typedef void (*CaKernelIntVS)(CaInt *dst, const CaInt *a, CaInt b, CaSize n);
+typedef void (*CaKernelIntSV)(CaInt *dst, CaInt a, const CaInt *b, CaSize n);
+typedef void (*CaKernelRealVV)(double *dst, const double *a, const double *b,
+                               CaSize n);
+typedef void (*CaKernelRealVS)(double *dst, const double *a, double b,
+                               CaSize n);
+typedef void (*CaKernelRealSV)(double *dst, double a, const double *b,
+                               CaSize n);
+
+/// The kernels of an implementation, indexed by CaKernelOp.
+typedef struct CaKernels {
+    CaKernelIntVV i_vv[CA_KERNEL_OP_COUNT];
+    CaKernelIntVS i_vs[CA_KERNEL_OP_COUNT];
+    CaKernelIntSV i_sv[CA_KERNEL_OP_COUNT];
+    CaKernelRealVV d_vv[CA_KERNEL_OP_COUNT];
+    CaKernelRealVS d_vs[CA_KERNEL_OP_COUNT];
+    CaKernelRealSV d_sv[CA_KERNEL_OP_COUNT];
+} CaKernels;
+
+/// Name of each operator.
+extern const char *const ca_kernel_op_names[CA_KERNEL_OP_COUNT];
+
+/**
+ * \brief Checks whether an implementation can run on this CPU.
+ * \param impl The implementation.
+ * \return Nonzero if it can.
+ */
+int ca_kernel_supported(CaKernelImpl impl);
+
+/**
+ * \brief Gets the kernels of an implementation.
+ * \param impl The implementation, or CA_KERNEL_IMPL_AUTO for the fastest one
+ *             the CPU supports.
+ * \return The kernels, or NULL if the CPU does not support them.
+ */
+const CaKernels *ca_kernels(CaKernelImpl impl);
+
+#endif
@@ -15,3 +15,102 @@
  * You should have received a copy of the GNU General Public License
  * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
  */
+
+/**
+ * \file main.c
+ * \author Anamitra Ghorui
+ * \brief Calcium interpreter entry point
+ */
+
+#include "interpreter.h"
+#include "real.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static void ca_usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-c cache_size] [-j] [-r] [-s] [-t trace] [file]\n"
+                    "  -c  Number of compiled lines kept (default %d)\n"
+                    "  -j  Compile kept lines to native code\n"
+                    "  -r  Recompute variables defined from the ones a line "
+                    "sets\n"
+                    "  -s  Print cache and optimiser statistics on exit\n"
+                    "  -t  Write the events traced to a file on exit (only "
+                    "if built\n"
+                    "      with CA_TRACE_LEVEL; see trace_dump)\n"
+                    "Reals are %s, with a %d bit significand.\n",
+            name, CA_INTERPRETER_CACHE_SIZE, CA_REAL_NAME, CA_REAL_MANT_DIG);
+}
+
+int main(int argc, char **argv)
+{
+    CaInterpreterOptions opts = { CA_INTERPRETER_CACHE_SIZE, 0, 0, 0, 0, 0, 0 };
+    FILE *f_in = stdin, *f_trace = NULL;
+    int opt, stats = 0;
+    char *end;
+
+    while ((opt = getopt(argc, argv, "c:jrst:")) != -1) {
+        switch (opt) {
+        case 'c':
+            opts.cache_size = strtoul(optarg, &end, 10);
+            if (*end || !*optarg) {
+                ca_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'j':
+            opts.jit = 1;
+            break;
+        case 'r':
+            opts.reactive = 1;
+            break;
+        case 's':
+            stats = 1;
+            break;
+        case 't':
+            if (!(f_trace = fopen(optarg, "wb"))) {
+                perror(optarg);
+                return 1;
+            }
+            ca_trace_enable(1);
+            break;
+        default:
+            ca_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind < argc && !(f_in = fopen(argv[optind], "r"))) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    if (f_in == stdin && isatty(STDIN_FILENO))
+        ca_start_interactive(f_in, stdout, stderr, &opts);
+    else
+        ca_start_interpreter(f_in, stdout, stderr, &opts);
+
+    if (stats) {
+        fprintf(stderr, "Reals: %s\n", CA_REAL_NAME);
+        fprintf(stderr, "Cache: %zu hits, %zu misses\n", opts.cache_hits,
+                opts.cache_misses);
+        fprintf(stderr, "CSE: %zu operators removed\n", opts.cse_removed);
+        if (opts.reactive)
+            fprintf(stderr, "Reactive: %zu definitions recomputed\n",
+                    opts.recomputed);
+    }
+
+    if (f_trace) {
+        ca_trace_enable(0);
+        if (ca_trace_write(f_trace) != CA_ERROR_OK)
+            fprintf(stderr, "Could not write the trace\n");
+        fclose(f_trace);
+    }
+
+    if (f_in != stdin)
+        fclose(f_in);
+    return 0;
+}
@@ -22,6 +22,8 @@
  * \brief Calcium memory allocation functions
  */
 
+#include "mem.h"
+
 void *ca_malloc(size_t size)
 {
     return malloc(size);
@@ -29,9 +31,9 @@ void *ca_malloc(size_t size)
 
 void *ca_mallocarray(size_t elem_size, size_t nelem)
 {
-    size_t mul =  elem_size * size;
-    if (CHECK_INT_MUL_OVERFLOW(elem_size, size, mul))
-        return NULL
+    size_t mul =  elem_size * nelem;
+    if (CHECK_INT_MUL_OVERFLOW(elem_size, nelem, mul))
+        return NULL;
     else
         return malloc(mul);
 }
@@ -43,7 +45,7 @@ void *ca_mallocz(size_t size)
 
 void *ca_malloczarray(size_t elem_size, size_t nelem)
 {
-    return calloc(size, elem_size);
+    return calloc(nelem, elem_size);
 }
 
 void *ca_realloc_f(void *ptr, size_t size)
@@ -55,11 +57,11 @@ void *ca_realloc_f(void *ptr, size_t size)
     return ret;
 }
 
-void *ca_reallocarray_f(void *ptr, size_t size)
+void *ca_reallocarray_f(void *ptr, size_t elem_size, size_t nelem)
 {
     void *ret;
-    size_t mul =  elem_size * size;
-    if (CHECK_INT_MUL_OVERFLOW(elem_size, size, mul))
+    size_t mul =  elem_size * nelem;
+    if (CHECK_INT_MUL_OVERFLOW(elem_size, nelem, mul))
         ret = NULL;
     else
         ret = realloc(ptr, mul);
@@ -70,7 +72,7 @@ void *ca_reallocarray_f(void *ptr, size_t size)
 
 void ca_freep(void **ptr)
 {
-    if (*ptr)
+    if (!*ptr)
         return;
     free(*ptr);
     *ptr = NULL;
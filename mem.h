@@ -24,8 +24,8 @@
  */
 
 
-#ifndef _CALCIUM_H
-#define _CALCIUM_H
+#ifndef CA_MEM_H
+#define CA_MEM_H
 
 #include <stdlib.h>
 
@@ -43,8 +43,8 @@
  */
 #define CHECK_INT_MUL_OVERFLOW(a, b, m) \
 ( \
-    ((a | b) >= (1 << (sizeof(a) / 2))) &&
-    a && b &&  ((m / b) != b)
+    (((a) | (b)) >= ((size_t) 1 << (sizeof(a) * 4))) && \
+    (a) && (b) && (((m) / (b)) != (a)) \
 )
 
 /**
@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file num.c
+ * \author Anamitra Ghorui
+ * \brief Numeric literal parsing
+ */
+
+#include "num.h"
+#include "pow5.h"
+#include "real.h"
+#include "std.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Reals are read into a decimal significand w of at most 19 digits and an
+ * exponent q, so that the literal is w * 10^q. They are then converted with,
+ * in order of preference:
+ *
+ * 1. Clinger's fast path: if w and 10^|q| are both exact in the target type,
+ *    a single multiplication or division rounds correctly.
+ * 2. The Eisel-Lemire algorithm (doubles only): multiply w by a 128 bit
+ *    approximation of 5^q (see pow5.h), and round from the top bits of the
+ *    product. It gives up in the rare cases where the approximation cannot
+ *    decide the rounding, and for subnormals.
+ * 3. strtod, strtold or strtoflt128, on a NUL terminated copy without
+ *    underscores. The interpreter never changes LC_NUMERIC from "C", so this
+ *    is not affected by the locale. It is also used for literals with more
+ *    than 19 digits.
+ *
+ * When CaReal is a double, ca_parse_real is ca_parse_double.
+ */
+
+#define CA_DECIMAL_DIGITS 19
+
+/* Largest power of 10 that is exact in a long double. */
+#if LDBL_MANT_DIG >= 113
+#   define CA_LDBL_EXACT_POW10 48
+#elif LDBL_MANT_DIG >= 64
+#   define CA_LDBL_EXACT_POW10 27
+#else
+#   define CA_LDBL_EXACT_POW10 22
+#endif
+
+#define CA_DBL_EXACT_POW10 22
+
+/* Literals longer than this are copied to the heap for the fallback. */
+#define CA_PARSE_BUF_SIZE 128
+
+static const double ca_pow10_dbl[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#ifndef CA_REAL_DOUBLE
+static const long double ca_pow10_ldbl[] = {
+    1e0L,  1e1L,  1e2L,  1e3L,  1e4L,  1e5L,  1e6L,  1e7L,  1e8L,  1e9L,
+    1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L,
+    1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L, 1e28L, 1e29L,
+    1e30L, 1e31L, 1e32L, 1e33L, 1e34L, 1e35L, 1e36L, 1e37L, 1e38L, 1e39L,
+    1e40L, 1e41L, 1e42L, 1e43L, 1e44L, 1e45L, 1e46L, 1e47L, 1e48L
+};
+#endif
+
+/// A decimal literal, w * 10^q.
+typedef struct CaDecimal {
+    uint64_t w;
+    int64_t q;
+    int ndigits;   ///< Significant digits in w.
+    int truncated; ///< Nonzero digits were left out of w.
+} CaDecimal;
+
+static inline int ca_digit_value(unsigned char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return 99;
+}
+
+/*
+ * Reads digits, and underscores between them, into d. Digits after the
+ * decimal point lower the exponent, and integer digits that do not fit
+ * raise it. Returns the number of digits read.
+ */
+static int ca_read_digits(const char **p, const char *end, CaDecimal *d,
+                          int frac)
+{
+    const char *c = *p;
+    int n = 0, v;
+
+    for (; c < end; c++) {
+        v = (unsigned char) *c - '0';
+        if (v >= 0 && v <= 9) {
+            if (d->ndigits < CA_DECIMAL_DIGITS) {
+                d->w = d->w * 10 + v;
+                d->ndigits += d->w != 0;
+                d->q -= frac;
+            } else {
+                d->q += !frac;
+                d->truncated |= v != 0;
+            }
+            n++;
+        } else if (!(*c == '_' && n && c + 1 < end &&
+                     ca_digit_value(c[1]) <= 9)) {
+            break;
+        }
+    }
+
+    *p = c;
+    return n;
+}
+
+static CaError ca_read_decimal(const char *s, CaSize len, CaDecimal *d)
+{
+    const char *p = s, *end = s + len;
+    int64_t exp = 0;
+    int n, sign = 1;
+
+    memset(d, 0, sizeof(*d));
+    n = ca_read_digits(&p, end, d, 0);
+    if (p < end && *p == '.') {
+        p++;
+        n += ca_read_digits(&p, end, d, 1);
+    }
+    if (!n)
+        return CA_ERROR_NUM_INVALID;
+
+    if (p < end && (*p | 0x20) == 'e') {
+        if (++p < end && (*p == '+' || *p == '-'))
+            sign = *p++ == '-' ? -1 : 1;
+        n = 0;
+        for (; p < end; p++) {
+            if (*p >= '0' && *p <= '9') {
+                /* Anything past this is zero or infinity anyway. */
+                if (exp < 100000)
+                    exp = exp * 10 + (*p - '0');
+                n++;
+            } else if (!(*p == '_' && n && p + 1 < end &&
+                         ca_digit_value(p[1]) <= 9)) {
+                break;
+            }
+        }
+        if (!n)
+            return CA_ERROR_NUM_INVALID;
+        d->q += sign * exp;
+    }
+
+    return p == end ? CA_ERROR_OK : CA_ERROR_NUM_INVALID;
+}
+
+/* Copies a literal without its underscores, for strtod and strtold. */
+static char *ca_copy_literal(const char *s, CaSize len, char *buf)
+{
+    char *copy = len < CA_PARSE_BUF_SIZE ? buf : malloc(len + 1);
+    CaSize n = 0;
+
+    if (!copy)
+        return NULL;
+    for (CaSize i = 0; i < len; ++i)
+        if (s[i] != '_')
+            copy[n++] = s[i];
+    copy[n] = '\0';
+    return copy;
+}
+
+static inline uint64_t ca_mul128(uint64_t a, uint64_t b, uint64_t *lo)
+{
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 p = (unsigned __int128) a * b;
+    *lo = (uint64_t) p;
+    return (uint64_t) (p >> 64);
+#else
+    uint64_t al = (uint32_t) a, ah = a >> 32, bl = (uint32_t) b, bh = b >> 32;
+    uint64_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+    uint64_t mid = (ll >> 32) + (uint32_t) lh + (uint32_t) hl;
+    *lo = (mid << 32) | (uint32_t) ll;
+    return hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+/* Eisel-Lemire. Returns 0 if the rounding cannot be decided. */
+static int ca_eisel_lemire(uint64_t w, int64_t q, double *value)
+{
+    const uint64_t *pow5;
+    uint64_t hi, lo, hi2, lo2, mantissa, bits;
+    int32_t power2;
+    int lz, upper;
+
+    if (w == 0 || q < CA_POW5_MIN) {
+        *value = 0;
+        return 1;
+    }
+    if (q > CA_POW5_MAX) {
+        *value = INFINITY;
+        return 1;
+    }
+
+    pow5 = ca_pow5[q - CA_POW5_MIN];
+    lz = __builtin_clzll(w);
+    w <<= lz;
+
+    /* 55 bits are needed: 53 of mantissa, one to round and one in case the
+     * top bit of the product is clear. */
+    hi = ca_mul128(w, pow5[0], &lo);
+    if ((hi & 0x1FF) == 0x1FF) {
+        hi2 = ca_mul128(w, pow5[1], &lo2);
+        lo += hi2;
+        hi += lo < hi2;
+        if (lo == UINT64_MAX && (q < -27 || q > 55))
+            return 0;
+    }
+
+    upper    = hi >> 63;
+    mantissa = hi >> (upper + 9);
+    power2   = (int32_t) (((152170 + 65536) * (int32_t) q) >> 16) + 63 +
+               upper - lz + 1023;
+    if (power2 <= 0)
+        return 0;
+
+    /* Exactly halfway between two doubles: round to even. */
+    if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 &&
+        (mantissa << (upper + 9)) == hi)
+        mantissa &= ~(uint64_t) 1;
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (uint64_t) 2 << 52) {
+        mantissa = (uint64_t) 1 << 52;
+        power2++;
+    }
+    mantissa &= ~((uint64_t) 1 << 52);
+    if (power2 >= 0x7FF) {
+        power2   = 0x7FF;
+        mantissa = 0;
+    }
+
+    bits = mantissa | (uint64_t) power2 << 52;
+    memcpy(value, &bits, sizeof(bits));
+    return 1;
+}
+
+CaError ca_parse_int(const char *s, CaSize len, CaInt *value)
+{
+    const char *p = s, *end = s + len;
+    CaUint v = 0;
+    unsigned base = 10, d;
+    int n = 0;
+
+    if (len > 2 && s[0] == '0' && (s[1] | 0x20) == 'x') {
+        base = 16;
+        p += 2;
+    } else if (len > 2 && s[0] == '0' && (s[1] | 0x20) == 'b') {
+        base = 2;
+        p += 2;
+    }
+
+    for (; p < end; p++) {
+        d = ca_digit_value(*p);
+        if (d < base) {
+            if (v > (UINT64_MAX - d) / base)
+                return CA_ERROR_NUM_RANGE;
+            v = v * base + d;
+            n++;
+        } else if (!(*p == '_' && n && p + 1 < end &&
+                     ca_digit_value(p[1]) < base)) {
+            return CA_ERROR_NUM_INVALID;
+        }
+    }
+
+    if (!n)
+        return CA_ERROR_NUM_INVALID;
+    if (base == 10 && v > INT64_MAX)
+        return CA_ERROR_NUM_RANGE;
+
+    *value = (CaInt) v;
+    return CA_ERROR_OK;
+}
+
+CaError ca_parse_double(const char *s, CaSize len, double *value)
+{
+    char buf[CA_PARSE_BUF_SIZE], *copy;
+    CaDecimal d;
+    CaError err;
+
+    if ((err = ca_read_decimal(s, len, &d)) != CA_ERROR_OK)
+        return err;
+
+    if (!d.truncated) {
+        if (d.w <= (uint64_t) 1 << 53 && d.q >= -CA_DBL_EXACT_POW10 &&
+            d.q <= CA_DBL_EXACT_POW10) {
+            *value = d.q < 0 ? (double) d.w / ca_pow10_dbl[-d.q] :
+                               (double) d.w * ca_pow10_dbl[d.q];
+            return CA_ERROR_OK;
+        }
+        if (ca_eisel_lemire(d.w, d.q, value))
+            return CA_ERROR_OK;
+    }
+
+    if (!(copy = ca_copy_literal(s, len, buf)))
+        return CA_ERROR_MEM;
+    *value = strtod(copy, NULL);
+    if (copy != buf)
+        free(copy);
+    return CA_ERROR_OK;
+}
+
+CaError ca_parse_real(const char *s, CaSize len, CaReal *value)
+{
+#ifdef CA_REAL_DOUBLE
+    return ca_parse_double(s, len, value);
+#else
+    char buf[CA_PARSE_BUF_SIZE], *copy;
+    CaDecimal d;
+    CaError err;
+
+    if ((err = ca_read_decimal(s, len, &d)) != CA_ERROR_OK)
+        return err;
+
+    /* A 19 digit significand is exact in any long double wider than a
+     * double, and in a binary128. */
+    if (!d.truncated && (LDBL_MANT_DIG >= 64 || d.w <= (uint64_t) 1 << 53) &&
+        d.q >= -CA_LDBL_EXACT_POW10 && d.q <= CA_LDBL_EXACT_POW10) {
+        *value = d.q < 0 ? (CaReal) d.w / ca_pow10_ldbl[-d.q] :
+                           (CaReal) d.w * ca_pow10_ldbl[d.q];
+        return CA_ERROR_OK;
+    }
+
+    if (!(copy = ca_copy_literal(s, len, buf)))
+        return CA_ERROR_MEM;
+    *value = ca_real_strto(copy);
+    if (copy != buf)
+        free(copy);
+    return CA_ERROR_OK;
+#endif
+}
+
+CaError ca_parse_number(const char *s, CaSize len, CaVar *var)
+{
+    int real = 0;
+    CaReal f;
+    CaInt i;
+    CaError err;
+
+    ca_var_set_unknown(var);
+    if (!(len > 2 && s[0] == '0' && ((s[1] | 0x20) == 'x' ||
+                                     (s[1] | 0x20) == 'b'))) {
+        for (CaSize i = 0; i < len && !real; ++i)
+            real = s[i] == '.' || (s[i] | 0x20) == 'e';
+    }
+
+    if (real) {
+        if ((err = ca_parse_real(s, len, &f)) == CA_ERROR_OK)
+            ca_var_set_real(var, f);
+        return err;
+    }
+    if ((err = ca_parse_int(s, len, &i)) != CA_ERROR_OK)
+        return err;
+    return ca_std_set_int(var, i);
+}
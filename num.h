@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file num.h
+ * \author Anamitra Ghorui
+ * \brief Numeric literal parsing
+ *
+ */
+
+/*
+ * Literals are read from a pointer and a size, like tokens are, and need not
+ * be NUL terminated. The accepted forms are:
+ *
+ * - Decimal integers: 123, 1_000_000
+ * - Hexadecimal and binary integers: 0xFF, 0b1010_1010
+ * - Reals: 1.5, 1., 2e10, 1.5E-3, 3.141_592
+ *
+ * An underscore may only appear between two digits. Reals are correctly
+ * rounded, and do not depend on the locale.
+ */
+
+#ifndef CA_NUM_H
+#define CA_NUM_H
+
+#include "types.h"
+#include "error.h"
+
+/**
+ * \brief Parses an integer literal.
+ * \param s The literal.
+ * \param len The size of the literal.
+ * \param value The value parsed. Hexadecimal and binary literals may use all
+ *              64 bits, and wrap around to negative values.
+ * \return An error code.
+ */
+CaError ca_parse_int(const char *s, CaSize len, CaInt *value);
+
+/**
+ * \brief Parses a decimal literal as a double.
+ * \param s The literal.
+ * \param len The size of the literal.
+ * \param value The value parsed.
+ * \return An error code.
+ */
+CaError ca_parse_double(const char *s, CaSize len, double *value);
+
+/**
+ * \brief Parses a decimal literal as a CaReal.
+ * \param s The literal.
+ * \param len The size of the literal.
+ * \param value The value parsed.
+ * \return An error code.
+ */
+CaError ca_parse_real(const char *s, CaSize len, CaReal *value);
+
+/**
+ * \brief Parses a literal as a CaInt if it is an integer, and as a CaReal if
+ *        it has a fraction or exponent.
+ * \param s The literal.
+ * \param len The size of the literal.
+ * \param var The value parsed, with its type set. A CaInt too large for a
+ *            CaVar is a CaBigInt (see types.h), which must be released with
+ *            ca_std_release.
+ * \return An error code.
+ */
+CaError ca_parse_number(const char *s, CaSize len, CaVar *var);
+
+#endif
@@ -19,17 +19,16 @@
 #ifndef CA_OPER_H
 #define CA_OPER_H
 
-#include "std.h"
 #include "types.h"
 
 #include <stdint.h>
 
+/// Length of the longest operator.
 #define CA_MAX_OPER_LEN 3
 
-
 /*
  * Only the following symbols ca be used in operator expressions:
- * '+' '-' '*' '/' '>' '<' '.' '!' '@' '#' '$' '%' '^' '&' '|' '~'
+ * '+' '-' '*' '/' '>' '<' '.' '!' '@' '#' '$' '%' '^' '&' '|' '~' ','
  */
 
 typedef enum CaOperPrec {
@@ -47,7 +46,8 @@ typedef enum CaOperPrec {
     PRECEDENCE_B_OR,
     PRECEDENCE_AND,
     PRECEDENCE_OR,
-    PRECEDENCE_ASSIGNMENT
+    PRECEDENCE_ASSIGNMENT,
+    PRECEDENCE_COMMA
 } CaOperPrec;
 
 typedef enum CaOperID {
@@ -80,87 +80,67 @@ typedef enum CaOperID {
     OPER_ID_DIVISION_ASSIGN,
     OPER_ID_REMAINDER_ASSIGN,
     OPER_ID_NEST,
-    OPER_ID_NEST_CLOSE
+    OPER_ID_NEST_CLOSE,
+    OPER_ID_COMMA
 } CaOperID;
 
 
-/* TODO Rearrange extra symbol to end */
-
 typedef struct CaOperator {
-    char extra_symbol;
+    char symbol[CA_MAX_OPER_LEN + 1];
     CaOperID id;
     CaOperPrec prec;
-} Operator;
+} CaOperator;
 
+/// The longest operator that is a prefix of the symbols leading to a node of
+/// the operator trie (see oper_trie.h).
+typedef struct CaOperMatch {
+    uint8_t len;  ///< Length of the operator.
+    uint8_t oper; ///< Index of the operator in oper_list.
+} CaOperMatch;
 
-CaOperator oper_list[][5] = {
-    /*    OPER  OPER_ID                        PRECEDENCE                     */
-    ['('] =
-    {
-        { '\0', OPER_ID_NEST,                  PRECEDENCE_INVALID        },
-        { 0 }
-    },
-    [')'] = {
-        { '\0', OPER_ID_NEST_CLOSE,            PRECEDENCE_INVALID        },
-        { 0 }
-    },
+/*
+ * All operators, in no particular order. The lexer does not search this list,
+ * but a trie that gen_oper.c builds from it at build time, so adding an entry
+ * here is all that is needed for the lexer to recognise a new operator.
+ *
+ * The first entry stands for any symbol that does not begin an operator.
+ */
+static const CaOperator oper_list[] = {
+    /*  SYMBOL OPER_ID                        PRECEDENCE                     */
+    { "",    0,                             PRECEDENCE_UNKNOWN        },
+    { "(",   OPER_ID_NEST,                  PRECEDENCE_INVALID        },
+    { ")",   OPER_ID_NEST_CLOSE,            PRECEDENCE_INVALID        },
+    { "+",   OPER_ID_ADDITION,              PRECEDENCE_ADDITIVE       },
+    { "++",  OPER_ID_INCREMENT,             PRECEDENCE_UNARY          },
+    { "+=",  OPER_ID_ADDITION_ASSIGN,       PRECEDENCE_ASSIGNMENT     },
+    { "-",   OPER_ID_SUBTRACTION,           PRECEDENCE_ADDITIVE       },
+    { "--",  OPER_ID_DECREMENT,             PRECEDENCE_UNARY          },
+    { "-=",  OPER_ID_SUBTRACTION_ASSIGN,    PRECEDENCE_ASSIGNMENT     },
+    { "*",   OPER_ID_MULTIPLICATION,        PRECEDENCE_MULTIPLICATIVE },
+    { "**",  OPER_ID_POWER,                 PRECEDENCE_EXPONENTIAL    },
+    { "*=",  OPER_ID_MULTIPLICATION_ASSIGN, PRECEDENCE_ASSIGNMENT     },
+    { "/",   OPER_ID_DIVISION,              PRECEDENCE_MULTIPLICATIVE },
+    { "//",  OPER_ID_DIVISION,              PRECEDENCE_MULTIPLICATIVE },
+    { "/=",  OPER_ID_DIVISION_ASSIGN,       PRECEDENCE_ASSIGNMENT     },
+    { ">",   OPER_ID_GT,                    PRECEDENCE_COMPARISON     },
+    { ">=",  OPER_ID_GTEQ,                  PRECEDENCE_COMPARISON     },
+    { ">>",  OPER_ID_RSHIFT,                PRECEDENCE_SHIFT          },
+    { "<",   OPER_ID_LT,                    PRECEDENCE_COMPARISON     },
+    { "<=",  OPER_ID_LTEQ,                  PRECEDENCE_COMPARISON     },
+    { "<<",  OPER_ID_LSHIFT,                PRECEDENCE_SHIFT          },
+    { "=",   OPER_ID_ASSIGN,                PRECEDENCE_ASSIGNMENT     },
+    { "==",  OPER_ID_EQ,                    PRECEDENCE_EQUALITY       },
+    { "%",   OPER_ID_REMAINDER,             PRECEDENCE_MULTIPLICATIVE },
+    { "%=",  OPER_ID_REMAINDER_ASSIGN,      PRECEDENCE_ASSIGNMENT     },
+    { "&",   OPER_ID_B_AND,                 PRECEDENCE_B_AND          },
+    { "&&",  OPER_ID_AND,                   PRECEDENCE_AND            },
+    { "^",   OPER_ID_B_XOR,                 PRECEDENCE_B_XOR          },
+    { "|",   OPER_ID_B_OR,                  PRECEDENCE_B_OR           },
+    { "||",  OPER_ID_OR,                    PRECEDENCE_OR             },
+    { ",",   OPER_ID_COMMA,                 PRECEDENCE_COMMA          },
+};
 
-    ['['] = { { '\0' }, { 0 } },
-    [']'] = { { '\0' }, { 0 } },
+/// Number of entries in oper_list.
+#define CA_OPER_COUNT (sizeof(oper_list) / sizeof(oper_list[0]))
 
-    ['+'] =
-    {
-        { '\0', OPER_ID_ADDITION,              PRECEDENCE_ADDITIVE       },
-        { '+',  OPER_ID_INCREMENT,             PRECEDENCE_UNARY          },
-        { '=',  OPER_ID_ADDITION_ASSIGN,       PRECEDENCE_ASSIGNMENT     },
-        { 0 }                                  
-    },                                         
-    ['-'] =                                    
-    {                                          
-        { '\0', OPER_ID_SUBTRACTION,           PRECEDENCE_ADDITIVE       },
-        { '-',  OPER_ID_DECREMENT,             PRECEDENCE_UNARY          },
-        { '=',  OPER_ID_SUBTRACTION_ASSIGN,    PRECEDENCE_ASSIGNMENT     },
-        { 0 }
-    },
-    ['*'] =
-    {
-        { '\0', OPER_ID_MULTIPLICATION,        PRECEDENCE_MULTIPLICATIVE },
-        { '*',  OPER_ID_POWER,                 PRECEDENCE_EXPONENTIAL    },
-        { '=',  OPER_ID_MULTIPLICATION_ASSIGN, PRECEDENCE_ASSIGNMENT     },
-        { 0 }
-    },
-    ['/'] =
-    {
-        { '\0', OPER_ID_DIVISION,              PRECEDENCE_MULTIPLICATIVE },
-        { '/',  OPER_ID_DIVISION,              PRECEDENCE_MULTIPLICATIVE },
-        { '=',  OPER_ID_DIVISION_ASSIGN,       PRECEDENCE_ASSIGNMENT     },
-        { 0 }
-    },
-    ['>'] =
-    {
-        { '\0', OPER_ID_GT,                    PRECEDENCE_COMPARISON     },
-        { '=',  OPER_ID_GTEQ,                  PRECEDENCE_COMPARISON     },
-        { '>',  OPER_ID_RSHIFT,                PRECEDENCE_SHIFT          },
-        { 0 }
-    },
-    ['<'] =
-    {
-        { '\0', OPER_ID_LT,                    PRECEDENCE_COMPARISON     },
-        { '=',  OPER_ID_LTEQ,                  PRECEDENCE_COMPARISON     },
-        { '<',  OPER_ID_LSHIFT,                PRECEDENCE_SHIFT          },
-        { 0 }
-    },
-    ['='] =
-    {
-        { '\0', OPER_ID_ASSIGN,                PRECEDENCE_ASSIGNMENT     },
-        { '=',  OPER_ID_EQ,                    PRECEDENCE_EQUALITY       },
-        { 0 }
-    },
-    ['%'] =
-    {
-        { '\0', OPER_ID_REMAINDER,             PRECEDENCE_MULTIPLICATIVE },
-        { '=',  OPER_ID_REMAINDER_ASSIGN,      PRECEDENCE_ASSIGNMENT     },
-        { 0 }
-    },
-};
 #endif
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file peephole.c
+ * \author Anamitra Ghorui
+ * \brief Peephole optimiser for compiled code
+ */
+
+#include "peephole.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The code is read once, front to back, and each instruction is either
+ * copied as it is, or merged with the ones after it into a superinstruction,
+ * trying the longest sequences first. Instructions that are jumped to start a
+ * new sequence, as one running into them from before would be skipped by the
+ * jump. The code only ever shrinks, so it is rewritten in place, and the
+ * targets of jumps are translated once it is done.
+ */
+
+/* Opcodes that may take their right operand from a constant or a variable,
+ * and the superinstructions doing so. */
+static const uint8_t ca_peephole_const[CA_OPCODE_COUNT] = {
+    [CA_OPCODE_ADDITION]       = CA_OPCODE_ADD_CONST,
+    [CA_OPCODE_SUBTRACTION]    = CA_OPCODE_SUB_CONST,
+    [CA_OPCODE_MULTIPLICATION] = CA_OPCODE_MUL_CONST,
+    [CA_OPCODE_DIVISION]       = CA_OPCODE_DIV_CONST,
+};
+
+static const uint8_t ca_peephole_var[CA_OPCODE_COUNT] = {
+    [CA_OPCODE_ADDITION]       = CA_OPCODE_ADD_VAR,
+    [CA_OPCODE_SUBTRACTION]    = CA_OPCODE_SUB_VAR,
+    [CA_OPCODE_MULTIPLICATION] = CA_OPCODE_MUL_VAR,
+    [CA_OPCODE_DIVISION]       = CA_OPCODE_DIV_VAR,
+};
+
+/* Comparisons, and the superinstructions branching on them. */
+static const uint8_t ca_peephole_jump_false[CA_OPCODE_COUNT] = {
+    [CA_OPCODE_LT]   = CA_OPCODE_LT_JUMP_FALSE,
+    [CA_OPCODE_LTEQ] = CA_OPCODE_LTEQ_JUMP_FALSE,
+    [CA_OPCODE_GT]   = CA_OPCODE_GT_JUMP_FALSE,
+    [CA_OPCODE_GTEQ] = CA_OPCODE_GTEQ_JUMP_FALSE,
+    [CA_OPCODE_EQ]   = CA_OPCODE_EQ_JUMP_FALSE,
+    [CA_OPCODE_NEQ]  = CA_OPCODE_NEQ_JUMP_FALSE,
+};
+
+static const uint8_t ca_peephole_jump_true[CA_OPCODE_COUNT] = {
+    [CA_OPCODE_LT]   = CA_OPCODE_LT_JUMP_TRUE,
+    [CA_OPCODE_LTEQ] = CA_OPCODE_LTEQ_JUMP_TRUE,
+    [CA_OPCODE_GT]   = CA_OPCODE_GT_JUMP_TRUE,
+    [CA_OPCODE_GTEQ] = CA_OPCODE_GTEQ_JUMP_TRUE,
+    [CA_OPCODE_EQ]   = CA_OPCODE_EQ_JUMP_TRUE,
+    [CA_OPCODE_NEQ]  = CA_OPCODE_NEQ_JUMP_TRUE,
+};
+
+/* Adds the negation of constant k, and sets k to it. Returns 0 if the
+ * negation of a CaInt overflows. */
+static int ca_peephole_negate(CaCode *code, uint32_t *k)
+{
+    if (!ca_code_const_int(code, *k))
+        return ca_code_const(code, -code->consts[*k], k) == CA_ERROR_OK;
+    return code->iconsts[*k] != INT64_MIN &&
+           ca_code_iconst(code, -code->iconsts[*k], k) == CA_ERROR_OK;
+}
+
+/*
+ * Matches a sequence at in[0], of at most left instructions, none of which
+ * but the first is jumped to. Writes the replacement to out, and returns the
+ * number of instructions replaced, or 0 if nothing matched. An empty
+ * replacement has out->op set to CA_OPCODE_COUNT.
+ */
+static CaSize ca_peephole_match(CaCode *code, const CaInstr *in, CaSize left,
+                                const uint8_t *target, CaInstr *out)
+{
+    CaSize len = 1;
+    uint32_t k;
+
+    while (len < left && len < 4 && !target[len])
+        len++;
+
+    /* x = x + k, x = x - k, x += k and x -= k */
+    if (len >= 4 && in[0].op == CA_OPCODE_LOAD &&
+        in[1].op == CA_OPCODE_PUSH_CONST &&
+        (in[2].op == CA_OPCODE_ADDITION || in[2].op == CA_OPCODE_SUBTRACTION) &&
+        in[3].op == CA_OPCODE_STORE && in[3].arg == in[0].arg) {
+        k = in[1].arg;
+        if (in[2].op == CA_OPCODE_SUBTRACTION && !ca_peephole_negate(code, &k))
+            return 0;
+        if (k <= UINT16_MAX) {
+            *out = (CaInstr) { .op = CA_OPCODE_INC_VAR, .n = k,
+                               .arg = in[0].arg };
+            return 4;
+        }
+    }
+
+    /* a + b * v */
+    if (len >= 3 && in[0].op == CA_OPCODE_LOAD &&
+        in[1].op == CA_OPCODE_MULTIPLICATION &&
+        in[2].op == CA_OPCODE_ADDITION) {
+        *out = (CaInstr) { .op = CA_OPCODE_MUL_ADD_VAR, .arg = in[0].arg };
+        return 3;
+    }
+
+    if (len < 2)
+        return 0;
+
+    switch (in[0].op) {
+    case CA_OPCODE_PUSH_CONST:
+        /* A value that is dropped right away. */
+        if (in[1].op == CA_OPCODE_POP) {
+            out->op = CA_OPCODE_COUNT;
+            return 2;
+        }
+        if (ca_peephole_const[in[1].op]) {
+            *out = (CaInstr) { .op = ca_peephole_const[in[1].op],
+                               .arg = in[0].arg };
+            return 2;
+        }
+        /* b ** 2 and b ** 3, as multiplications. */
+        if (in[1].op == CA_OPCODE_POWER &&
+            ca_code_const_int(code, in[0].arg) &&
+            (code->iconsts[in[0].arg] == 2 || code->iconsts[in[0].arg] == 3)) {
+            *out = (CaInstr) { .op = code->iconsts[in[0].arg] == 2 ?
+                                     CA_OPCODE_SQUARE : CA_OPCODE_CUBE };
+            return 2;
+        }
+        return 0;
+
+    case CA_OPCODE_LOAD:
+        if (ca_peephole_var[in[1].op]) {
+            *out = (CaInstr) { .op = ca_peephole_var[in[1].op],
+                               .arg = in[0].arg };
+            return 2;
+        }
+        return 0;
+
+    case CA_OPCODE_STORE:
+        if (in[1].op == CA_OPCODE_POP) {
+            *out = (CaInstr) { .op = CA_OPCODE_STORE_POP, .arg = in[0].arg };
+            return 2;
+        }
+        return 0;
+
+    case CA_OPCODE_MULTIPLICATION:
+        if (in[1].op == CA_OPCODE_ADDITION) {
+            *out = (CaInstr) { .op = CA_OPCODE_MUL_ADD };
+            return 2;
+        }
+        return 0;
+
+    default:
+        if (in[1].op == CA_OPCODE_JUMP_FALSE_OR_POP &&
+            ca_peephole_jump_false[in[0].op]) {
+            *out = (CaInstr) { .op = ca_peephole_jump_false[in[0].op],
+                               .arg = in[1].arg };
+            return 2;
+        }
+        if (in[1].op == CA_OPCODE_JUMP_TRUE_OR_POP &&
+            ca_peephole_jump_true[in[0].op]) {
+            *out = (CaInstr) { .op = ca_peephole_jump_true[in[0].op],
+                               .arg = in[1].arg };
+            return 2;
+        }
+        return 0;
+    }
+}
+
+CaError ca_code_optimize(CaCode *code, int level)
+{
+    uint32_t *map;
+    uint8_t *target;
+    CaInstr *instrs = code->instrs, fused;
+    CaSize i, j, n, count = code->count;
+
+    if (level < CA_OPTIMIZE_PEEPHOLE || !count)
+        return CA_ERROR_OK;
+
+    /* map[i] is where instruction i ends up. An instruction that is removed
+     * maps to the one after it. */
+    map    = malloc((count + 1) * sizeof(uint32_t));
+    target = calloc(count + 1, 1);
+    if (!map || !target) {
+        free(map);
+        free(target);
+        return CA_ERROR_MEM;
+    }
+
+    for (i = 0; i < count; i++)
+        if (CA_OPCODE_ISJUMP(instrs[i].op))
+            target[instrs[i].arg] = 1;
+
+    for (i = 0, j = 0; i < count; i += n) {
+        n = ca_peephole_match(code, &instrs[i], count - i, &target[i], &fused);
+        for (CaSize k = 0; k < (n ? n : 1); k++)
+            map[i + k] = j;
+        if (!n) {
+            instrs[j++] = instrs[i];
+            n = 1;
+        } else if (fused.op != CA_OPCODE_COUNT) {
+            instrs[j++] = fused;
+        }
+    }
+    map[count] = j;
+
+    for (i = 0; i < j; i++)
+        if (CA_OPCODE_ISJUMP(instrs[i].op))
+            instrs[i].arg = map[instrs[i].arg];
+    code->count = j;
+
+    free(map);
+    free(target);
+    return CA_ERROR_OK;
+}
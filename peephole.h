@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file peephole.h
+ * \author Anamitra Ghorui
+ * \brief Peephole optimiser for compiled code
+ *
+ */
+
+#ifndef CA_PEEPHOLE_H
+#define CA_PEEPHOLE_H
+
+#include "command_stack.h"
+#include "error.h"
+
+/// Code is run as compiled.
+#define CA_OPTIMIZE_NONE 0
+
+/// Common sequences of instructions are replaced with superinstructions.
+#define CA_OPTIMIZE_PEEPHOLE 1
+
+/// As well, repeated subexpressions are computed once (see cse.h).
+#define CA_OPTIMIZE_CSE 2
+
+/// As well, ca_compile infers where integer arithmetic can be used (see
+/// infer.h).
+#define CA_OPTIMIZE_TYPES 3
+
+/// The optimisation level contexts start with.
+#define CA_OPTIMIZE_DEFAULT CA_OPTIMIZE_TYPES
+
+/**
+ * \brief Optimises code in place. The code gives the same results, and
+ *        the same errors, as before.
+ * \param code The code.
+ * \param level The optimisation level, one of the CA_OPTIMIZE_ constants.
+ * \return An error code.
+ */
+CaError ca_code_optimize(CaCode *code, int level);
+
+#endif
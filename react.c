@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file react.c
+ * \author Anamitra Ghorui
+ * \brief Reactive recomputation of variables
+ */
+
+#include "react.h"
+#include "infer.h"
+#include "jit.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Definitions are kept in an array, indexed by the owner of each variable,
+ * and by the lists of the definitions reading each variable. The definitions
+ * to run again after a variable is set are found by a depth first search
+ * from it, along the variables each definition sets. Definitions never read
+ * what they set, directly or not, so the order the search finishes them in,
+ * reversed, runs every definition after the ones it reads from.
+ *
+ * A definition stops being one once any variable it sets is set by something
+ * else, and its entry is reused.
+ */
+
+/// No definition.
+#define CA_REACT_NONE UINT32_MAX
+
+CaError ca_context_reactive(CaContext *c, int on)
+{
+    CaReactive *r = c->reactive;
+
+    if (on) {
+        if (r)
+            return CA_ERROR_OK;
+        if (!(r = calloc(1, sizeof(CaReactive))))
+            return CA_ERROR_MEM;
+        r->free = CA_REACT_NONE;
+        c->reactive = r;
+        return CA_ERROR_OK;
+    }
+
+    if (!r)
+        return CA_ERROR_OK;
+    for (CaSize i = 0; i < r->ndefs; i++) {
+        ca_code_free(&r->defs[i].code);
+        free(r->defs[i].reads);
+        free(r->defs[i].writes);
+    }
+    for (CaSize i = 0; i < r->nvars; i++)
+        free(r->readers[i].defs);
+    free(r->defs);
+    free(r->owner);
+    free(r->readers);
+    free(r->order);
+    free(r);
+    c->reactive = NULL;
+    return CA_ERROR_OK;
+}
+
+/* Adds v to a set of variables, unless it is in it already. */
+static CaError ca_react_add(CaSymbol **set, CaSize *count, CaSymbol v)
+{
+    CaSymbol *s;
+
+    for (CaSize i = 0; i < *count; i++)
+        if ((*set)[i] == v)
+            return CA_ERROR_OK;
+    if (!(*count & (*count - 1))) {
+        if (!(s = realloc(*set, (*count ? *count * 2 : 1) * sizeof(CaSymbol))))
+            return CA_ERROR_MEM;
+        *set = s;
+    }
+    (*set)[(*count)++] = v;
+    return CA_ERROR_OK;
+}
+
+static int ca_react_has(const CaSymbol *set, CaSize count, CaSymbol v)
+{
+    for (CaSize i = 0; i < count; i++)
+        if (set[i] == v)
+            return 1;
+    return 0;
+}
+
+/* Finds the variables code reads and sets. */
+static CaError ca_react_scan(const CaCode *code, CaReactDef *def)
+{
+    const CaInstr *ip;
+    CaError err = CA_ERROR_OK;
+
+    for (ip = code->instrs; ip < code->instrs + code->count; ip++) {
+        switch ((CaOpcode) ip->op) {
+        case CA_OPCODE_LOAD:
+        case CA_OPCODE_ADD_VAR:
+        case CA_OPCODE_SUB_VAR:
+        case CA_OPCODE_MUL_VAR:
+        case CA_OPCODE_DIV_VAR:
+        case CA_OPCODE_MUL_ADD_VAR:
+            err = ca_react_add(&def->reads, &def->nreads, ip->arg);
+            break;
+        case CA_OPCODE_INC_VAR:
+            if ((err = ca_react_add(&def->reads, &def->nreads, ip->arg)) !=
+                CA_ERROR_OK)
+                return err;
+            err = ca_react_add(&def->writes, &def->nwrites, ip->arg);
+            break;
+        case CA_OPCODE_STORE:
+        case CA_OPCODE_STORE_POP:
+        case CA_OPCODE_POST_INC:
+        case CA_OPCODE_POST_DEC:
+            err = ca_react_add(&def->writes, &def->nwrites, ip->arg);
+            break;
+        default:
+            break;
+        }
+        if (err != CA_ERROR_OK)
+            return err;
+    }
+    return CA_ERROR_OK;
+}
+
+/* Gives every symbol of the context an owner and a list of readers. */
+static CaError ca_react_reserve(CaContext *c, CaReactive *r)
+{
+    CaSize nvars = c->symbols.capacity;
+    CaReactReaders *readers;
+    uint32_t *owner;
+
+    if (r->nvars >= c->symbols.count)
+        return CA_ERROR_OK;
+    if (!(owner = realloc(r->owner, nvars * sizeof(uint32_t))))
+        return CA_ERROR_MEM;
+    r->owner = owner;
+    if (!(readers = realloc(r->readers, nvars * sizeof(CaReactReaders))))
+        return CA_ERROR_MEM;
+    r->readers = readers;
+    for (CaSize i = r->nvars; i < nvars; i++) {
+        owner[i]   = CA_REACT_NONE;
+        readers[i] = (CaReactReaders) { NULL, 0, 0 };
+    }
+    r->nvars = nvars;
+    return CA_ERROR_OK;
+}
+
+/* Removes definition d from the readers of variable v. */
+static void ca_react_unread(CaReactive *r, CaSymbol v, uint32_t d)
+{
+    CaReactReaders *l = &r->readers[v];
+
+    for (CaSize i = 0; i < l->count; i++) {
+        if (l->defs[i] == d) {
+            l->defs[i] = l->defs[--l->count];
+            return;
+        }
+    }
+}
+
+/* Drops the definition of variable v, if it has one. */
+static void ca_react_drop(CaReactive *r, CaSymbol v)
+{
+    uint32_t d = r->owner[v];
+    CaReactDef *def;
+
+    if (d == CA_REACT_NONE)
+        return;
+    def = &r->defs[d];
+    for (CaSize i = 0; i < def->nwrites; i++)
+        r->owner[def->writes[i]] = CA_REACT_NONE;
+    for (CaSize i = 0; i < def->nreads; i++)
+        ca_react_unread(r, def->reads[i], d);
+    ca_code_free(&def->code);
+    free(def->reads);
+    free(def->writes);
+    memset(def, 0, sizeof(CaReactDef));
+    def->mark = r->free;
+    r->free   = d;
+}
+
+static CaError ca_react_visit(CaReactive *r, uint32_t d);
+
+/* Visits the definitions reading variable v that have not been visited. */
+static CaError ca_react_visit_readers(CaReactive *r, CaSymbol v)
+{
+    const CaReactReaders *l = &r->readers[v];
+    CaError err;
+
+    for (CaSize i = 0; i < l->count; i++)
+        if (r->defs[l->defs[i]].mark != r->mark &&
+            (err = ca_react_visit(r, l->defs[i])) != CA_ERROR_OK)
+            return err;
+    return CA_ERROR_OK;
+}
+
+/* Visits definition d, adding it to the order after every definition that
+ * reads from it. */
+static CaError ca_react_visit(CaReactive *r, uint32_t d)
+{
+    CaReactDef *def = &r->defs[d];
+    uint32_t *order;
+    CaError err;
+
+    def->mark = r->mark;
+    for (CaSize i = 0; i < def->nwrites; i++)
+        if ((err = ca_react_visit_readers(r, def->writes[i])) != CA_ERROR_OK)
+            return err;
+
+    if (!(r->norder & (r->norder - 1))) {
+        order = realloc(r->order, (r->norder ? r->norder * 2 : 1) *
+                                  sizeof(uint32_t));
+        if (!order)
+            return CA_ERROR_MEM;
+        r->order = order;
+    }
+    r->order[r->norder++] = d;
+    return CA_ERROR_OK;
+}
+
+/* Whether def reads a variable set by one of the definitions in the order. */
+static int ca_react_cycle(const CaReactive *r, const CaReactDef *def)
+{
+    const CaReactDef *e;
+
+    for (CaSize i = 0; i < r->norder; i++) {
+        e = &r->defs[r->order[i]];
+        for (CaSize j = 0; j < e->nwrites; j++)
+            if (ca_react_has(def->reads, def->nreads, e->writes[j]))
+                return 1;
+    }
+    return 0;
+}
+
+/* Keeps def, taking its code from code, as the definition of the variables
+ * it sets. */
+static CaError ca_react_keep(CaContext *c, CaReactive *r, CaReactDef *def,
+                             const CaCode *code)
+{
+    CaReactDef *defs;
+    CaReactReaders *l;
+    uint32_t d, *l_defs;
+    CaSize capacity;
+    CaError err;
+
+    if ((err = ca_code_copy(&def->code, code)) != CA_ERROR_OK)
+        return err;
+    if (c->optimize >= CA_OPTIMIZE_TYPES &&
+        ca_code_infer(c, &def->code) == CA_ERROR_MEM)
+        return CA_ERROR_MEM;
+    if ((c->flags & CA_CONTEXT_JIT) &&
+        ca_jit_compile(&def->code) == CA_ERROR_MEM)
+        return CA_ERROR_MEM;
+
+    /* Room is made in every list first, so that nothing is left half
+     * done. */
+    for (CaSize i = 0; i < def->nreads; i++) {
+        l = &r->readers[def->reads[i]];
+        if (l->count < l->capacity)
+            continue;
+        capacity = l->capacity ? l->capacity * 2 : 4;
+        if (!(l_defs = realloc(l->defs, capacity * sizeof(uint32_t))))
+            return CA_ERROR_MEM;
+        l->defs     = l_defs;
+        l->capacity = capacity;
+    }
+    if (r->free == CA_REACT_NONE && r->ndefs == r->defs_capacity) {
+        capacity = r->defs_capacity ? r->defs_capacity * 2 : 16;
+        if (!(defs = realloc(r->defs, capacity * sizeof(CaReactDef))))
+            return CA_ERROR_MEM;
+        r->defs          = defs;
+        r->defs_capacity = capacity;
+    }
+
+    if (r->free != CA_REACT_NONE) {
+        d       = r->free;
+        r->free = r->defs[d].mark;
+    } else {
+        d = r->ndefs++;
+    }
+    def->mark  = r->mark;
+    r->defs[d] = *def;
+    for (CaSize i = 0; i < def->nwrites; i++)
+        r->owner[def->writes[i]] = d;
+    for (CaSize i = 0; i < def->nreads; i++) {
+        l = &r->readers[def->reads[i]];
+        l->defs[l->count++] = d;
+    }
+    return CA_ERROR_OK;
+}
+
+CaError ca_react_update(CaContext *c, const CaCode *code)
+{
+    CaReactive *r = c->reactive;
+    CaReactDef def;
+    CaReal result;
+    CaError err;
+    int keep = 1;
+
+    if (r->running)
+        return CA_ERROR_OK;
+
+    memset(&def, 0, sizeof(def));
+    ca_code_init(&def.code);
+    if ((err = ca_react_scan(code, &def)) != CA_ERROR_OK ||
+        !def.nwrites || (err = ca_react_reserve(c, r)) != CA_ERROR_OK)
+        goto done;
+
+    /* The variables set are no longer what their definitions made them. */
+    for (CaSize i = 0; i < def.nwrites; i++) {
+        ca_react_drop(r, def.writes[i]);
+        if (ca_react_has(def.reads, def.nreads, def.writes[i]))
+            keep = 0;
+    }
+
+    r->mark++;
+    r->norder = 0;
+    for (CaSize i = 0; i < def.nwrites; i++)
+        if ((err = ca_react_visit_readers(r, def.writes[i])) != CA_ERROR_OK)
+            goto done;
+
+    /* Traced before def is handed over to the definitions kept. */
+    CA_TRACE(CA_TRACE_INFO, REACT, UPDATE, def.nwrites, r->norder);
+    if (keep && !ca_react_cycle(r, &def)) {
+        if ((err = ca_react_keep(c, r, &def, code)) != CA_ERROR_OK)
+            goto done;
+        memset(&def, 0, sizeof(def));
+    }
+
+    r->running = 1;
+    for (CaSize i = r->norder; i > 0; i--) {
+        if ((err = ca_run(c, &r->defs[r->order[i - 1]].code, &result)) !=
+            CA_ERROR_OK)
+            break;
+        r->recomputed++;
+    }
+    r->running = 0;
+
+done:
+    ca_code_free(&def.code);
+    free(def.reads);
+    free(def.writes);
+    return err;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file react.h
+ * \author Anamitra Ghorui
+ * \brief Reactive recomputation of variables
+ *
+ */
+
+/*
+ * In reactive mode, an expression that sets variables is kept as their
+ * definition, with the variables it reads. Whenever code run by ca_run sets
+ * a variable, every definition reading it, and every definition reading
+ * those, is run again, each once and after the ones it reads from, so that
+ * all variables stay as their definitions make them.
+ *
+ * Setting a variable replaces its definition, and that of every variable
+ * defined along with it, which keep their values until they are set. An
+ * expression reading a
+ * variable it sets, like x = x + 1, or reading a variable defined from one it
+ * sets, only sets it, and is not kept. Builtins are taken to depend on
+ * their arguments only.
+ */
+
+#ifndef CA_REACT_H
+#define CA_REACT_H
+
+#include "eval.h"
+#include "command_stack.h"
+#include "error.h"
+
+/// A definition: an expression kept to be run again.
+typedef struct CaReactDef {
+    CaCode code;
+    CaSymbol *reads;     ///< Variables the code reads.
+    CaSize nreads;
+    CaSymbol *writes;    ///< Variables the code sets.
+    CaSize nwrites;
+    uint32_t mark;       ///< Last traversal the definition was seen by.
+} CaReactDef;
+
+/// The definitions reading a variable.
+typedef struct CaReactReaders {
+    uint32_t *defs;
+    CaSize count;
+    CaSize capacity;
+} CaReactReaders;
+
+/// Definitions of the variables of a context.
+typedef struct CaReactive {
+    CaReactDef *defs;
+    CaSize ndefs;
+    CaSize defs_capacity;
+    uint32_t free;           ///< First unused definition, or UINT32_MAX.
+    uint32_t *owner;         ///< Definition of each variable, or UINT32_MAX.
+    CaReactReaders *readers; ///< Definitions reading each variable.
+    CaSize nvars;
+    uint32_t *order;         ///< Definitions to run, in order.
+    CaSize norder;
+    uint32_t mark;
+    int running;             ///< Set while definitions are run.
+    CaSize recomputed;       ///< Definitions run again so far.
+} CaReactive;
+
+/**
+ * \brief Turns reactive mode of a context on or off. Turning it off forgets
+ *        every definition.
+ * \param c The context.
+ * \param on Whether reactive mode is on.
+ * \return An error code.
+ */
+CaError ca_context_reactive(CaContext *c, int on);
+
+/**
+ * \brief Keeps code that has just been run successfully as the definition of
+ *        the variables it sets, and runs every definition reading them
+ *        again. Called by ca_run.
+ * \param c The context, which must be in reactive mode.
+ * \param code The code.
+ * \return An error code, of the first definition that fails to run.
+ */
+CaError ca_react_update(CaContext *c, const CaCode *code);
+
+/**
+ * \brief Returns the number of definitions a context has run again since it
+ *        went into reactive mode.
+ * \param c The context.
+ * \return The number of definitions run, or 0 if reactive mode is off.
+ */
+static inline CaSize ca_react_recomputed(const CaContext *c)
+{
+    return c->reactive ? c->reactive->recomputed : 0;
+}
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file real.h
+ * \author Anamitra Ghorui
+ * \brief Functions on CaReal
+ *
+ */
+
+/*
+ * The math functions, limits and text conversions of the type CaReal is built
+ * as (see types.h), each under one name, so that code working on CaReal need
+ * not know which type it is.
+ */
+
+#ifndef CA_REAL_H
+#define CA_REAL_H
+
+#include "types.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(CA_REAL_FLOAT128)
+#include <quadmath.h>
+
+#define CA_REAL_NAME     "binary128"
+#define CA_REAL_DIG      FLT128_DIG      ///< Decimal digits kept exactly.
+#define CA_REAL_MANT_DIG FLT128_MANT_DIG ///< Bits of the significand.
+
+#define ca_real_pow   powq
+#define ca_real_fmod  fmodq
+#define ca_real_fabs  fabsq
+#define ca_real_ceil  ceilq
+#define ca_real_cos   cosq
+#define ca_real_exp   expq
+#define ca_real_floor floorq
+#define ca_real_fmax  fmaxq
+#define ca_real_fmin  fminq
+#define ca_real_ldexp ldexpq
+#define ca_real_log   logq
+#define ca_real_round roundq
+#define ca_real_sin   sinq
+#define ca_real_sqrt  sqrtq
+#define ca_real_tan   tanq
+
+#define ca_real_strto(_s) strtoflt128((_s), NULL)
+
+#elif defined(CA_REAL_LONG_DOUBLE)
+
+#define CA_REAL_NAME     "long double"
+#define CA_REAL_DIG      LDBL_DIG
+#define CA_REAL_MANT_DIG LDBL_MANT_DIG
+
+#define ca_real_pow   powl
+#define ca_real_fmod  fmodl
+#define ca_real_fabs  fabsl
+#define ca_real_ceil  ceill
+#define ca_real_cos   cosl
+#define ca_real_exp   expl
+#define ca_real_floor floorl
+#define ca_real_fmax  fmaxl
+#define ca_real_fmin  fminl
+#define ca_real_ldexp ldexpl
+#define ca_real_log   logl
+#define ca_real_round roundl
+#define ca_real_sin   sinl
+#define ca_real_sqrt  sqrtl
+#define ca_real_tan   tanl
+
+#define ca_real_strto(_s) strtold((_s), NULL)
+
+#else
+
+#define CA_REAL_NAME     "double"
+#define CA_REAL_DIG      DBL_DIG
+#define CA_REAL_MANT_DIG DBL_MANT_DIG
+
+#define ca_real_pow   pow
+#define ca_real_fmod  fmod
+#define ca_real_fabs  fabs
+#define ca_real_ceil  ceil
+#define ca_real_cos   cos
+#define ca_real_exp   exp
+#define ca_real_floor floor
+#define ca_real_fmax  fmax
+#define ca_real_fmin  fmin
+#define ca_real_ldexp ldexp
+#define ca_real_log   log
+#define ca_real_round round
+#define ca_real_sin   sin
+#define ca_real_sqrt  sqrt
+#define ca_real_tan   tan
+
+#define ca_real_strto(_s) strtod((_s), NULL)
+
+#endif
+
+/**
+ * \brief Writes a CaReal as text, like printf's %g.
+ * \param buf The buffer.
+ * \param size The size of the buffer.
+ * \param x The value.
+ * \param digits The number of significant digits.
+ * \return The size of the text, as for snprintf.
+ */
+static inline int ca_real_format(char *buf, CaSize size, CaReal x,
+                                 int digits)
+{
+#if defined(CA_REAL_FLOAT128)
+    return quadmath_snprintf(buf, size, "%.*Qg", digits, x);
+#elif defined(CA_REAL_LONG_DOUBLE)
+    return snprintf(buf, size, "%.*Lg", digits, x);
+#else
+    return snprintf(buf, size, "%.*g", digits, x);
+#endif
+}
+
+/**
+ * \brief Converts a CaReal to the CaInt shifts and bitwise operators work on,
+ *        truncating it toward 0. Values beyond the limits of CaInt give the
+ *        nearest limit, and NaN gives 0, so that every way code is run gives
+ *        the same value.
+ * \param x The value.
+ */
+static inline CaInt ca_real_to_int(CaReal x)
+{
+    if (x != x)
+        return 0;
+    if (x >= 0x1p63)
+        return INT64_MAX;
+    return x < -0x1p63 ? INT64_MIN : (CaInt) x;
+}
+
+/**
+ * \brief Prints a CaReal, like printf's %g.
+ * \param f The file.
+ * \param x The value.
+ * \param digits The number of significant digits.
+ */
+static inline void ca_real_print(FILE *f, CaReal x, int digits)
+{
+    char buf[64];
+
+    ca_real_format(buf, sizeof(buf), x, digits);
+    fputs(buf, f);
+}
+
+#endif
@@ -16,16 +16,28 @@
  * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include "calcium.h"
-#include "mem.h"
+#include "stack.h"
+#include "bigint.h"
+#include "real.h"
+
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-CaStack *ca_stack_init(size_t size)
+CaStack *ca_stack_init(CaSize size)
 {
-    CaStack *s = ca_malloc(sizeof(CaStack));
-    s->data = ca_malloc(size * sizeof(CaReal));
-    s->top = 0;
-    s->size = size;
+    CaStack *s = malloc(sizeof(CaStack));
+
+    if (!s)
+        return NULL;
+    s->top  = 0;
+    s->size = 0;
+    s->data = NULL;
+    if (ca_stack_grow(s, size ? size : 1) != CA_ERROR_OK) {
+        free(s);
+        return NULL;
+    }
     return s;
 }
 
@@ -35,28 +47,55 @@ void ca_stack_free(CaStack *s)
     free(s);
 }
 
-CaError ca_stack_push(CaStack *s, CaReal value)
+/* aligned_alloc needs a multiple of the alignment, and realloc would not
+ * keep it, so the values are copied to a new block. */
+CaError ca_stack_grow(CaStack *s, CaSize n)
 {
-    if(s->top > s->size)
-        return CA_ERROR_STACK_FULL;
-    s->data[s->top] = value;
-    (s->top)++;
-    return CA_ERROR_OK;
-}
+    CaSize size = s->size ? s->size : CA_STACK_SIZE, bytes;
+    CaVar *data;
 
-CaError ca_stack_pop(CaStack *s, CaReal *value)
-{
-    if(s->top == 0)
-        return CA_ERROR_STACK_EMPTY;
-    *value = s->data[s->top - 1];
-    (s->top)--;
+    if (n <= s->size)
+        return CA_ERROR_OK;
+    while (size < n) {
+        if (size > SIZE_MAX / 2 / sizeof(CaVar))
+            return CA_ERROR_MEM;
+        size *= 2;
+    }
+    bytes = (size * sizeof(CaVar) + CA_STACK_ALIGN - 1) &
+            ~(CaSize) (CA_STACK_ALIGN - 1);
+    if (!(data = aligned_alloc(CA_STACK_ALIGN, bytes)))
+        return CA_ERROR_MEM;
+    if (s->top)
+        memcpy(data, s->data, s->top * sizeof(CaVar));
+    free(s->data);
+    s->data = data;
+    s->size = size;
     return CA_ERROR_OK;
 }
 
-void ca_stack_print(CaStack *s)
+void ca_stack_print(const CaStack *s)
 {
-    printf("CaStack; addr = %lx top = %ld; size = %ld;\n", 
+    const CaVar *v;
+
+    printf("CaStack; addr = %lx top = %zu; size = %zu;\n",
            (unsigned long) s, s->top, s->size);
-    for(size_t i = 0; i < s->top; ++i)
-        printf("[%ld] = %Lf\n", i,  s->data[i]);
+    for (CaSize i = 0; i < s->top; i++) {
+        v = &s->data[i];
+        printf("[%zu] = ", i);
+        switch (ca_var_type(v)) {
+        case CA_TYPE_INT:
+            printf("%" PRId64, ca_var_int(v));
+            break;
+        case CA_TYPE_BIGINT:
+            ca_bigint_print(stdout, ca_var_bigint(v));
+            break;
+        case CA_TYPE_REAL:
+            ca_real_print(stdout, ca_var_real(v), CA_REAL_DIG);
+            break;
+        default:
+            printf("?");
+            break;
+        }
+        putchar('\n');
+    }
 }
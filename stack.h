@@ -23,27 +23,43 @@
  *
  */
 
+/*
+ * A stack of tagged values, which grows as needed. The values are aligned to
+ * a cache line, and the room for them doubles whenever it runs out, so that
+ * pushing is amortised constant time.
+ *
+ * ca_stack_push, ca_stack_pop and ca_stack_peek check the stack, growing it
+ * or failing as needed. Their _unchecked forms do not, for code that has made
+ * room with ca_stack_reserve beforehand, such as compiled code, whose deepest
+ * stack is known (see command_stack.h). Growing moves the values, so pointers
+ * into the stack are only good until the next push or reserve that grows it.
+ */
+
 #ifndef CA_STACK_H
 #define CA_STACK_H
 
 #include "types.h"
 #include "error.h"
 
-/// The maximum size of a stack.
-#define CA_STACK_SIZE 4096
+/// Initial number of values a stack has room for.
+#define CA_STACK_SIZE 256
+
+/// Alignment of the values of a stack, in bytes.
+#define CA_STACK_ALIGN 64
 
 /// Structure defining a stack.
 typedef struct CaStack {
-    CaSize top; /// This is top of the stack, plus one.
-    CaSize size;
-    CaVar *data;
+    CaSize top;   ///< Number of values on the stack.
+    CaSize size;  ///< Number of values there is room for.
+    CaVar *data;  ///< The values, the first being the bottom of the stack.
 } CaStack;
 
 /**
  * \brief Initialises a stack.
- * \param size Size of the stack
+ * \param size Number of values to make room for.
+ * \return The stack, or NULL if memory could not be allocated.
  */
-CaStack *ca_stack_init(size_t size);
+CaStack *ca_stack_init(CaSize size);
 
 /**
  * \brief Frees a stack.
@@ -52,20 +68,98 @@ CaStack *ca_stack_init(size_t size);
 void ca_stack_free(CaStack *s);
 
 /**
- * \brief Enters a key-value pair into a hash table.
- * \param s The hash table.
- * \param value The pointer to the value the key must correspond to.
+ * \brief Makes room for at least n values, keeping those on the stack.
+ *        Called by ca_stack_reserve when the stack has to grow.
+ * \param s The stack.
+ * \param n The number of values.
+ * \return An error code.
+ */
+CaError ca_stack_grow(CaStack *s, CaSize n);
+
+/**
+ * \brief Makes room for at least n values in all, counting those on the
+ *        stack.
+ * \param s The stack.
+ * \param n The number of values.
  * \return An error code.
  */
-CaError ca_stack_push(CaStack *s, CaReal value);
+static inline CaError ca_stack_reserve(CaStack *s, CaSize n)
+{
+    return n <= s->size ? CA_ERROR_OK : ca_stack_grow(s, n);
+}
 
 /**
- * \brief Get the value of a key from a Stack table a Stack table.
+ * \brief Pushes a value, growing the stack if it is full.
  * \param s The stack.
- * \param value The pointer to to the value that may be returned.
+ * \param value The value.
  * \return An error code.
  */
-CaError ca_stack_pop(CaStack *s, CaReal *value);
+static inline CaError ca_stack_push(CaStack *s, CaVar value)
+{
+    CaError err;
+
+    if (s->top == s->size && (err = ca_stack_grow(s, s->top + 1)) !=
+        CA_ERROR_OK)
+        return err;
+    s->data[s->top++] = value;
+    return CA_ERROR_OK;
+}
+
+/**
+ * \brief Pops a value.
+ * \param s The stack.
+ * \param value The value popped.
+ * \return An error code. CA_ERROR_STACK_EMPTY if the stack is empty.
+ */
+static inline CaError ca_stack_pop(CaStack *s, CaVar *value)
+{
+    if (!s->top)
+        return CA_ERROR_STACK_EMPTY;
+    *value = s->data[--s->top];
+    return CA_ERROR_OK;
+}
+
+/**
+ * \brief Finds a value on the stack, without popping it.
+ * \param s The stack.
+ * \param n How far down the value is, 0 being the top.
+ * \return The value, or NULL if there are not that many values.
+ */
+static inline CaVar *ca_stack_peek(const CaStack *s, CaSize n)
+{
+    return n < s->top ? &s->data[s->top - 1 - n] : NULL;
+}
+
+/**
+ * \brief Pushes a value onto a stack that has room for it.
+ * \param s The stack.
+ * \param value The value.
+ */
+static inline void ca_stack_push_unchecked(CaStack *s, CaVar value)
+{
+    s->data[s->top++] = value;
+}
+
+/**
+ * \brief Pops a value from a stack that is not empty.
+ * \param s The stack.
+ * \return The value.
+ */
+static inline CaVar ca_stack_pop_unchecked(CaStack *s)
+{
+    return s->data[--s->top];
+}
+
+/**
+ * \brief Finds a value that is on the stack, without popping it.
+ * \param s The stack.
+ * \param n How far down the value is, 0 being the top.
+ * \return The value.
+ */
+static inline CaVar *ca_stack_peek_unchecked(const CaStack *s, CaSize n)
+{
+    return &s->data[s->top - 1 - n];
+}
 
 /**
  * \brief Prints all of the contents of the Stack table to stdout. Useful for 
@@ -73,6 +167,6 @@ CaError ca_stack_pop(CaStack *s, CaReal *value);
  * \param s the stack
  * \return Nothing.
  */
-void Ca_StackPrint(CaStack *s);
+void ca_stack_print(const CaStack *s);
 
 #endif
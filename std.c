@@ -0,0 +1,436 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file std.c
+ * \author Anamitra Ghorui
+ * \brief Calcium standard library functions
+ *
+ */
+
+#include "std.h"
+#include "real.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/*
+ * DEFINE writes out an operator for one pair of operand types. The operands
+ * are read as the type the operator works on, _T being I for CaInt and R for
+ * CaReal, and the expression _OP##_T gives the result, of type _RT.
+ *
+ * Exact integer operators are written out by DEFINE_BIG, on the operands
+ * read as CaBigInt, and by hand for two CaInt, which only go through a
+ * CaBigInt when the result overflows.
+ */
+
+#define TYPE_I CaInt
+#define TYPE_R CaReal
+
+#define GET_I_INT(_x)    ca_var_int(_x)
+#define GET_I_REAL(_x)   ca_real_to_int(ca_var_real(_x))
+#define GET_I_BIGINT(_x) ca_bigint_trunc(ca_var_bigint(_x))
+#define GET_R_INT(_x)    ((CaReal) ca_var_int(_x))
+#define GET_R_REAL(_x)   ca_var_real(_x)
+#define GET_R_BIGINT(_x) ca_bigint_real(ca_var_bigint(_x))
+
+/* Sets r, which has been released, to a result of type _RT. A CaInt may not
+ * fit in r, so setting one can fail. */
+#define SET_REAL(_r, _v) (ca_var_set_real((_r), (_v)), CA_ERROR_OK)
+#define SET_INT(_r, _v)  ca_std_set_int((_r), (_v))
+
+#define DEFINE(_name, _OP, _TA, _TB, _T, _RT)                                 \
+static CaError ca_std_##_name##_##_TA##_##_TB(CaVar *r, const CaVar *x,     \
+                                               const CaVar *y)              \
+{                                                                           \
+    TYPE_##_T a = GET_##_T##_##_TA(x);                                      \
+    TYPE_##_T b = GET_##_T##_##_TB(y);                                      \
+    ca_std_release(r);                                                      \
+    return SET_##_RT(r, _OP##_##_T(a, b));                                  \
+}
+
+#define DEFINE_BIG(_name, _TA, _TB)                                         \
+static CaError ca_std_##_name##_##_TA##_##_TB(CaVar *r, const CaVar *x,     \
+                                               const CaVar *y)              \
+{                                                                           \
+    return ca_std_big(r, x, y, ca_std_big_##_name);                         \
+}
+
+#define DEFINE_CMP_BIG(_name, _OP, _TA, _TB)                                \
+static CaError ca_std_##_name##_##_TA##_##_TB(CaVar *r, const CaVar *x,     \
+                                               const CaVar *y)              \
+{                                                                           \
+    int cmp = ca_std_cmp(x, y);                                             \
+    ca_std_release(r);                                                      \
+    ca_var_set_int(r, _OP##_I(cmp, 0));                                     \
+    return CA_ERROR_OK;                                                     \
+}
+
+/* Pairs with a CaReal, working on _T, and giving _RT. */
+#define DEFINE_MIXED(_name, _OP, _T, _RT)           \
+    DEFINE(_name, _OP, INT, REAL, _T, _RT)          \
+    DEFINE(_name, _OP, REAL, INT, _T, _RT)          \
+    DEFINE(_name, _OP, REAL, REAL, _T, _RT)         \
+    DEFINE(_name, _OP, BIGINT, REAL, _T, _RT)       \
+    DEFINE(_name, _OP, REAL, BIGINT, _T, _RT)
+
+/* Pairs of integers with a CaBigInt, working on _T, and giving _RT. */
+#define DEFINE_INTEGER(_name, _OP, _T, _RT)         \
+    DEFINE(_name, _OP, INT, BIGINT, _T, _RT)        \
+    DEFINE(_name, _OP, BIGINT, INT, _T, _RT)        \
+    DEFINE(_name, _OP, BIGINT, BIGINT, _T, _RT)
+
+/* An operator exact on integers, working on CaReal otherwise. The pair of
+ * CaInt is written by hand. */
+#define DEFINE_EXACT(_name, _OP)                    \
+    DEFINE_MIXED(_name, _OP, R, REAL)               \
+    DEFINE_BIG(_name, INT, BIGINT)                  \
+    DEFINE_BIG(_name, BIGINT, INT)                  \
+    DEFINE_BIG(_name, BIGINT, BIGINT)
+
+/* An operator working on CaReal, and giving _RT. */
+#define DEFINE_REAL(_name, _OP)                     \
+    DEFINE(_name, _OP, INT, INT, R, REAL)           \
+    DEFINE_MIXED(_name, _OP, R, REAL)               \
+    DEFINE_INTEGER(_name, _OP, R, REAL)
+
+/* An operator working on CaInt. */
+#define DEFINE_INT(_name, _OP)                      \
+    DEFINE(_name, _OP, INT, INT, I, INT)            \
+    DEFINE_MIXED(_name, _OP, I, INT)                \
+    DEFINE_INTEGER(_name, _OP, I, INT)
+
+/* A comparison, which gives a CaInt. Integers are compared with
+ * ca_bigint_cmp if either is a CaBigInt. */
+#define DEFINE_COMPARE(_name, _OP)                  \
+    DEFINE(_name, _OP, INT, INT, I, INT)            \
+    DEFINE_MIXED(_name, _OP, R, INT)                \
+    DEFINE_CMP_BIG(_name, _OP, INT, BIGINT)         \
+    DEFINE_CMP_BIG(_name, _OP, BIGINT, INT)         \
+    DEFINE_CMP_BIG(_name, _OP, BIGINT, BIGINT)
+
+#define ADD_R(_a, _b) ((_a) + (_b))
+#define SUB_R(_a, _b) ((_a) - (_b))
+#define MUL_R(_a, _b) ((_a) * (_b))
+#define DIV_R(_a, _b) ((_a) / (_b))
+#define POW_R(_a, _b) ca_real_pow((_a), (_b))
+#define MOD_R(_a, _b) ca_real_fmod((_a), (_b))
+#define SHL_I(_a, _b) ((CaInt) ((CaUint) (_a) << ((_b) & 63)))
+#define SHR_I(_a, _b) ((_a) >> ((_b) & 63))
+#define AND_I(_a, _b) ((_a) & (_b))
+#define XOR_I(_a, _b) ((_a) ^ (_b))
+#define OR_I(_a, _b)  ((_a) | (_b))
+#define LT_I(_a, _b)   ((_a) < (_b))
+#define LT_R           LT_I
+#define LTEQ_I(_a, _b) ((_a) <= (_b))
+#define LTEQ_R         LTEQ_I
+#define GT_I(_a, _b)   ((_a) > (_b))
+#define GT_R           GT_I
+#define GTEQ_I(_a, _b) ((_a) >= (_b))
+#define GTEQ_R         GTEQ_I
+#define EQ_I(_a, _b)   ((_a) == (_b))
+#define EQ_R           EQ_I
+#define NEQ_I(_a, _b)  ((_a) != (_b))
+#define NEQ_R          NEQ_I
+
+/* Reads an integer as a CaBigInt, into view and limb if it is a CaInt. */
+static const CaBigInt *ca_std_bigint(const CaVar *x, CaBigInt *view,
+                                     CaLimb *limb)
+{
+    CaInt i;
+
+    if (ca_var_is(x, CA_TYPE_BIGINT))
+        return ca_var_bigint(x);
+    i = ca_var_int(x);
+    *limb = i < 0 ? -(CaUint) i : (CaUint) i;
+    view->limbs    = limb;
+    view->size     = i != 0;
+    view->capacity = 0;
+    view->neg      = i < 0;
+    return view;
+}
+
+static int ca_std_cmp(const CaVar *x, const CaVar *y)
+{
+    CaBigInt a, b;
+    CaLimb la, lb;
+
+    return ca_bigint_cmp(ca_std_bigint(x, &a, &la), ca_std_bigint(y, &b, &lb));
+}
+
+/* Sets r to the integer t, which it takes, as a CaInt if r can hold it. */
+static CaError ca_std_set_bigint(CaVar *r, CaBigInt *t)
+{
+    CaBigInt *b;
+    CaInt i;
+
+    if (ca_bigint_get_int(t, &i) && ca_var_int_fits(i)) {
+        ca_bigint_free(t);
+        ca_std_release(r);
+        ca_var_set_int(r, i);
+        return CA_ERROR_OK;
+    }
+    if (!(b = malloc(sizeof(CaBigInt)))) {
+        ca_bigint_free(t);
+        return CA_ERROR_MEM;
+    }
+    *b = *t;
+    ca_std_release(r);
+    ca_var_set_bigint(r, b);
+    return CA_ERROR_OK;
+}
+
+typedef CaError (*CaStdBig)(CaBigInt *r, const CaBigInt *a,
+                            const CaBigInt *b);
+
+/* Applies op to integers x and y, read as CaBigInt. */
+static CaError ca_std_big(CaVar *r, const CaVar *x, const CaVar *y,
+                          CaStdBig op)
+{
+    CaBigInt a, b, t;
+    CaLimb la, lb;
+    CaError err;
+
+    ca_bigint_init(&t);
+    if ((err = op(&t, ca_std_bigint(x, &a, &la),
+                  ca_std_bigint(y, &b, &lb))) != CA_ERROR_OK) {
+        ca_bigint_free(&t);
+        return err;
+    }
+    return ca_std_set_bigint(r, &t);
+}
+
+#define ca_std_big_add ca_bigint_add
+#define ca_std_big_sub ca_bigint_sub
+#define ca_std_big_mul ca_bigint_mul
+
+static CaError ca_std_big_mod(CaBigInt *r, const CaBigInt *a,
+                              const CaBigInt *b)
+{
+    return ca_bigint_divmod(NULL, r, a, b);
+}
+
+/* Arithmetic on two CaInt, which is only done on CaBigInt on overflow. */
+#define DEFINE_CHECKED(_name, _builtin)                                     \
+static CaError ca_std_##_name##_INT_INT(CaVar *r, const CaVar *x,           \
+                                        const CaVar *y)                     \
+{                                                                           \
+    CaInt v;                                                                \
+                                                                            \
+    if (_builtin(ca_var_int(x), ca_var_int(y), &v) || !ca_var_int_fits(v))  \
+        return ca_std_big(r, x, y, ca_std_big_##_name);                     \
+    ca_std_release(r);                                                      \
+    ca_var_set_int(r, v);                                                   \
+    return CA_ERROR_OK;                                                     \
+}
+
+DEFINE_CHECKED(add, __builtin_add_overflow)
+DEFINE_CHECKED(sub, __builtin_sub_overflow)
+DEFINE_CHECKED(mul, __builtin_mul_overflow)
+
+DEFINE_MIXED(pow, POW, R, REAL)
+DEFINE_EXACT(mul, MUL)
+DEFINE_REAL(div, DIV)
+DEFINE_EXACT(mod, MOD)
+DEFINE_EXACT(add, ADD)
+DEFINE_EXACT(sub, SUB)
+DEFINE_INT(lshift, SHL)
+DEFINE_INT(rshift, SHR)
+DEFINE_COMPARE(lt, LT)
+DEFINE_COMPARE(lteq, LTEQ)
+DEFINE_COMPARE(gt, GT)
+DEFINE_COMPARE(gteq, GTEQ)
+DEFINE_COMPARE(eq, EQ)
+DEFINE_COMPARE(neq, NEQ)
+DEFINE_INT(band, AND)
+DEFINE_INT(bxor, XOR)
+DEFINE_INT(bor, OR)
+
+/* Integer powers, for a CaBigInt operand, or two CaInt whose power does not
+ * fit in a CaInt. A CaBigInt exponent of a base other than 0, 1 or -1 gives
+ * too many bits, so only its sign and parity are kept. */
+static CaError ca_std_pow_integer(CaVar *r, const CaVar *x, const CaVar *y)
+{
+    CaBigInt a, t;
+    CaLimb la;
+    CaReal f;
+    uint64_t e;
+    CaError err;
+
+    if (ca_var_is(y, CA_TYPE_INT) ? ca_var_int(y) >= 0 :
+                                    !ca_var_bigint(y)->neg) {
+        e = ca_var_is(y, CA_TYPE_INT) ? (uint64_t) ca_var_int(y) :
+            UINT64_MAX - !(ca_var_bigint(y)->limbs[0] & 1);
+        ca_bigint_init(&t);
+        err = ca_bigint_pow(&t, ca_std_bigint(x, &a, &la), e);
+        if (err == CA_ERROR_OK)
+            return ca_std_set_bigint(r, &t);
+        ca_bigint_free(&t);
+        if (err != CA_ERROR_EVAL_OVERFLOW)
+            return err;
+    }
+    f = ca_real_pow(ca_std_real(x), ca_std_real(y));
+    ca_std_release(r);
+    ca_var_set_real(r, f);
+    return CA_ERROR_OK;
+}
+
+#define ca_std_pow_INT_BIGINT    ca_std_pow_integer
+#define ca_std_pow_BIGINT_INT    ca_std_pow_integer
+#define ca_std_pow_BIGINT_BIGINT ca_std_pow_integer
+
+static CaError ca_std_pow_INT_INT(CaVar *r, const CaVar *x, const CaVar *y)
+{
+    CaInt v;
+
+    if (ca_std_int_pow(ca_var_int(x), ca_var_int(y), &v) ||
+        !ca_var_int_fits(v))
+        return ca_std_pow_integer(r, x, y);
+    ca_std_release(r);
+    ca_var_set_int(r, v);
+    return CA_ERROR_OK;
+}
+
+/* The remainder of integers is the only operator that can fail. */
+static CaError ca_std_mod_INT_INT(CaVar *r, const CaVar *x, const CaVar *y)
+{
+    CaInt a = ca_var_int(x), b = ca_var_int(y);
+
+    if (!b)
+        return CA_ERROR_EVAL_DIVISION_BY_ZERO;
+    ca_std_release(r);
+    /* INT64_MIN % -1 overflows. */
+    ca_var_set_int(r, b == -1 ? 0 : a % b);
+    return CA_ERROR_OK;
+}
+
+static CaError ca_std_unsupported(CaVar *r, const CaVar *a, const CaVar *b)
+{
+    (void) r;
+    (void) a;
+    (void) b;
+    return CA_ERROR_EVAL_UNSUPPORTED;
+}
+
+#define ROW(_oper) [OPER_ID_##_oper - CA_STD_BINARY_FIRST]
+#define ALL [0 ... CA_TYPE_COUNT - 1]
+
+#define ENTRY(_oper, _name) ROW(_oper) = {                                 \
+        ALL = { ALL = ca_std_unsupported },                                \
+        [CA_TYPE_INT][CA_TYPE_INT]       = ca_std_##_name##_INT_INT,       \
+        [CA_TYPE_INT][CA_TYPE_REAL]      = ca_std_##_name##_INT_REAL,      \
+        [CA_TYPE_INT][CA_TYPE_BIGINT]    = ca_std_##_name##_INT_BIGINT,    \
+        [CA_TYPE_REAL][CA_TYPE_INT]      = ca_std_##_name##_REAL_INT,      \
+        [CA_TYPE_REAL][CA_TYPE_REAL]     = ca_std_##_name##_REAL_REAL,     \
+        [CA_TYPE_REAL][CA_TYPE_BIGINT]   = ca_std_##_name##_REAL_BIGINT,   \
+        [CA_TYPE_BIGINT][CA_TYPE_INT]    = ca_std_##_name##_BIGINT_INT,    \
+        [CA_TYPE_BIGINT][CA_TYPE_REAL]   = ca_std_##_name##_BIGINT_REAL,   \
+        [CA_TYPE_BIGINT][CA_TYPE_BIGINT] = ca_std_##_name##_BIGINT_BIGINT, \
+    }
+
+const CaStdBinary
+ca_std_binary[CA_STD_BINARY_COUNT][CA_TYPE_COUNT][CA_TYPE_COUNT] = {
+    ENTRY(POWER, pow),
+    ENTRY(MULTIPLICATION, mul),
+    ENTRY(DIVISION, div),
+    ENTRY(REMAINDER, mod),
+    ENTRY(ADDITION, add),
+    ENTRY(SUBTRACTION, sub),
+    ENTRY(LSHIFT, lshift),
+    ENTRY(RSHIFT, rshift),
+    ENTRY(LT, lt),
+    ENTRY(LTEQ, lteq),
+    ENTRY(GT, gt),
+    ENTRY(GTEQ, gteq),
+    ENTRY(EQ, eq),
+    ENTRY(NEQ, neq),
+    ENTRY(B_AND, band),
+    ENTRY(B_XOR, bxor),
+    ENTRY(B_OR, bor),
+};
+
+/* Types of the results of an operator on two integers, and on an integer
+ * and a CaReal. */
+#define TYPES(_oper, _ii, _mixed) ROW(_oper) = {                           \
+        [CA_TYPE_INT][CA_TYPE_INT]       = CA_TYPE_##_ii,                  \
+        [CA_TYPE_INT][CA_TYPE_REAL]      = CA_TYPE_##_mixed,               \
+        [CA_TYPE_INT][CA_TYPE_BIGINT]    = CA_TYPE_##_ii,                  \
+        [CA_TYPE_REAL][CA_TYPE_INT]      = CA_TYPE_##_mixed,               \
+        [CA_TYPE_REAL][CA_TYPE_REAL]     = CA_TYPE_##_mixed,               \
+        [CA_TYPE_REAL][CA_TYPE_BIGINT]   = CA_TYPE_##_mixed,               \
+        [CA_TYPE_BIGINT][CA_TYPE_INT]    = CA_TYPE_##_ii,                  \
+        [CA_TYPE_BIGINT][CA_TYPE_REAL]   = CA_TYPE_##_mixed,               \
+        [CA_TYPE_BIGINT][CA_TYPE_BIGINT] = CA_TYPE_##_ii,                  \
+    }
+
+const uint8_t
+ca_std_binary_type[CA_STD_BINARY_COUNT][CA_TYPE_COUNT][CA_TYPE_COUNT] = {
+    TYPES(POWER, INT, REAL),
+    TYPES(MULTIPLICATION, INT, REAL),
+    TYPES(DIVISION, REAL, REAL),
+    TYPES(REMAINDER, INT, REAL),
+    TYPES(ADDITION, INT, REAL),
+    TYPES(SUBTRACTION, INT, REAL),
+    TYPES(LSHIFT, INT, INT),
+    TYPES(RSHIFT, INT, INT),
+    TYPES(LT, INT, INT),
+    TYPES(LTEQ, INT, INT),
+    TYPES(GT, INT, INT),
+    TYPES(GTEQ, INT, INT),
+    TYPES(EQ, INT, INT),
+    TYPES(NEQ, INT, INT),
+    TYPES(B_AND, INT, INT),
+    TYPES(B_XOR, INT, INT),
+    TYPES(B_OR, INT, INT),
+};
+
+CaError ca_std_assign(CaVar *r, const CaVar *a)
+{
+    CaBigInt t;
+
+    if (a == r)
+        return CA_ERROR_OK;
+    if (ca_var_is(a, CA_TYPE_BIGINT)) {
+        ca_bigint_init(&t);
+        if (ca_bigint_set(&t, ca_var_bigint(a)) != CA_ERROR_OK)
+            return CA_ERROR_MEM;
+        return ca_std_set_bigint(r, &t);
+    }
+    if (!ca_var_is(a, CA_TYPE_INT) && !ca_var_is(a, CA_TYPE_REAL))
+        return CA_ERROR_EVAL_UNSUPPORTED;
+    ca_std_release(r);
+    *r = *a;
+    return CA_ERROR_OK;
+}
+
+CaError ca_std_set_int(CaVar *r, CaInt i)
+{
+    CaBigInt t;
+
+    if (ca_var_int_fits(i)) {
+        ca_std_release(r);
+        ca_var_set_int(r, i);
+        return CA_ERROR_OK;
+    }
+    ca_bigint_init(&t);
+    if (ca_bigint_set_int(&t, i) != CA_ERROR_OK) {
+        ca_bigint_free(&t);
+        return CA_ERROR_MEM;
+    }
+    return ca_std_set_bigint(r, &t);
+}
@@ -23,98 +23,177 @@
  *
  */
 
+/*
+ * Primitive Operations
+ *
+ * Each binary operator is written out once for every pair of operand types it
+ * supports, and the versions are kept in a table indexed by the operator and
+ * the types of its operands, so that applying an operator is one indexed call,
+ * with no switch on the types. Pairs an operator does not support, such as
+ * any with a container type, have an entry that fails with
+ * CA_ERROR_EVAL_UNSUPPORTED, so a new type only needs its entries filled in.
+ *
+ * Arithmetic on integers is exact: a sum, difference, product or power of
+ * two CaInt that does not fit in a CaInt is a CaBigInt (see bigint.h), and
+ * a CaBigInt result that fits is a CaInt again. Powers are taken by repeated
+ * squaring, and only give a CaReal for a negative exponent, or a power of
+ * more than CA_BIGINT_POW_BITS bits. Arithmetic on an integer and a CaReal
+ * gives a CaReal, and division always gives a CaReal. Shifts
+ * and bitwise operators work on CaInt, truncating CaReal operands, and a
+ * CaBigInt to its low 64 bits. Comparisons give the CaInt 0 or 1, and are
+ * exact between integers. A remainder of integers by 0 fails with
+ * CA_ERROR_EVAL_DIVISION_BY_ZERO, while that of a CaReal is a NaN, as fmod
+ * gives.
+ *
+ * The tables are only used where values may be integers: by exact code (see
+ * exact.h), and by typed code through it when a CaInt overflows. Code that
+ * only reads CaReal values runs on the VM, whose operators are those of
+ * CaReal, and whose results are the same as those of the tables there.
+ *
+ * Every CaVar given as a result must be initialised, as it may hold a
+ * CaBigInt, which is freed when the result is written.
+ */
+
 #ifndef CA_STD_H
 #define CA_STD_H
 
+#include "bigint.h"
 #include "error.h"
-#include <math.h>
+#include "types.h"
+#include "token.h"
 
-/// Macro that determines the resultant vartype of a binary operation
+/// First operator of the table, in CaOperID order.
+#define CA_STD_BINARY_FIRST OPER_ID_POWER
 
-// Always remember to provide a cast to indicate the intended type in situations
-// like this
-#define CA_STD_GET_VAR_TYPE(_x,_y) ((CaVarType) (_x)->type > \
-                                    (_y)->type ? (_x)->type : (_y)->type))
+/// Last operator of the table.
+#define CA_STD_BINARY_LAST OPER_ID_B_OR
 
-/// Assignment function
+/// Number of operators in the table.
+#define CA_STD_BINARY_COUNT (CA_STD_BINARY_LAST - CA_STD_BINARY_FIRST + 1)
 
-#define CA_STD_ASSIGN(_lvalue,_rvalue,_type) \
-switch (_type) { \
-case CaVar_TYPE_REAL: \
-    (CaReal) (_lvalue)->i = (CaReal) (_rvalue); \
-case CaVar_TYPE_INT: \
-    (CaInt) (_lvalue)->r = (CaInt) (_rvalue); \
-}
+/// Whether an operator is in the table.
+#define CA_STD_ISBINARY(_oper) ((_oper) >= CA_STD_BINARY_FIRST && \
+                                (_oper) <= CA_STD_BINARY_LAST)
 
-/// Macro for generalising binary operators
+/// A binary operator specialised for one pair of operand types. r may be the
+/// same as a or b.
+typedef CaError (*CaStdBinary)(CaVar *r, const CaVar *a, const CaVar *b);
 
-#define CA_STD_OPERATE(_lvalue,_x,_y,_oper,_type) \
-        CA_STD_ASSIGN((_lvalue), (CaReal) (_x)->data, _oper, (CaReal) (_y)->data, _type);
-
-#define CA_STD_PRIMITIVE_BINARY_OPERATOR(_NAME, _SYMBOL) \
-inline CaError ca_std_prim_ ## _NAME ## (CaResult *r, CaVar *a, CaVar *b, CaVarType vt) \
-{ \
-    CA_STD_OPERATE(r, a, b, _SYMBOL, vt); \
-    return CA_ERROR_OK; \
-}
+/// Binary operators, indexed by operator and the types of a and b.
+extern const CaStdBinary
+ca_std_binary[CA_STD_BINARY_COUNT][CA_TYPE_COUNT][CA_TYPE_COUNT];
 
- 
-// Handle Precedence
+/// Type of the result of each binary operator, or CA_TYPE_UNKNOWN if the
+/// operator does not support the pair of types. CA_TYPE_INT stands for an
+/// integer, which is a CaBigInt if it does not fit in a CaInt, and for a
+/// power, a CaReal if the exponent is negative.
+extern const uint8_t
+ca_std_binary_type[CA_STD_BINARY_COUNT][CA_TYPE_COUNT][CA_TYPE_COUNT];
 
-// Actual functions/operations
-// TODO in eval loop: CaVarType vt = CA_STD_GET_VAR_TYPE(a, b);
-// Before every iteration
-
-// ===== Binary Operations =====
-
-// !!TODO Implement Errors regarding overflow, MOD Division types, etc.
-
-/*
- * Primitive Operations
- *
- * These are only concerned with primitive types. The interpreter shall forward
- * the computation to these operations to  these primitive functions (by using
- * the wrapper function for all of these operations)
+/**
+ * \brief Applies a binary operator.
+ * \param oper The operator, from CA_STD_BINARY_FIRST to CA_STD_BINARY_LAST.
+ * \param r The result. May be the same as a or b.
+ * \param a The left operand.
+ * \param b The right operand.
+ * \return An error code. CA_ERROR_EVAL_UNSUPPORTED if the operator does not
+ *         support the types of a and b.
  */
+static inline CaError ca_std_binary_op(CaOperID oper, CaVar *r,
+                                       const CaVar *a, const CaVar *b)
+{
+    return ca_std_binary[oper - CA_STD_BINARY_FIRST][ca_var_type(a)]
+                        [ca_var_type(b)](r, a, b);
+}
 
-CA_STD_PRIMITIVE_BINARY_OPERATOR(add, +)
-CA_STD_PRIMITIVE_BINARY_OPERATOR(div, -)
-CA_STD_PRIMITIVE_BINARY_OPERATOR(mul, *)
-CA_STD_PRIMITIVE_BINARY_OPERATOR(sub, /)
-CA_STD_PRIMITIVE_BINARY_OPERATOR(mod, %)
-
-CA_STD_PRIMITIVE_BINARY_OPERATOR(and, &&)
-CA_STD_PRIMITIVE_BINARY_OPERATOR(or , ||)
-CA_STD_PRIMITIVE_BINARY_OPERATOR(not, !)
-
-CA_STD_PRIMITIVE_BINARY_OPERATOR(band, &)
-CA_STD_PRIMITIVE_BINARY_OPERATOR(bor , |)
-CA_STD_PRIMITIVE_BINARY_OPERATOR(bnot, ~)
-CA_STD_PRIMITIVE_BINARY_OPERATOR(bxor, ^)
-
-CA_STD_PRIMITIVE_BINARY_OPERATOR(lshift, <<)
-CA_STD_PRIMITIVE_BINARY_OPERATOR(rshift, >>)
-
+/**
+ * \brief Converts a primitive value to a CaReal.
+ * \param a The value, a CaInt, CaBigInt or CaReal.
+ */
+static inline CaReal ca_std_real(const CaVar *a)
+{
+    if (ca_var_is(a, CA_TYPE_INT))
+        return (CaReal) ca_var_int(a);
+    return ca_var_is(a, CA_TYPE_REAL) ? ca_var_real(a) :
+                                        ca_bigint_real(ca_var_bigint(a));
+}
 
-// Assignment operator
-// TODO handle non primitive types
-inline CaError ca_std_assign(CaResult *r, CaVar *a, CaVar *b, CaVarType vt)
+/**
+ * \brief Gets an integer value as a CaInt.
+ * \param a The value.
+ * \param i The CaInt, if a is a CaInt, or a CaBigInt that fits in one.
+ * \return Nonzero if i was set.
+ */
+static inline int ca_std_get_int(const CaVar *a, CaInt *i)
 {
-     // TODO Write Realloc function
-     a->type = b->type;
-     a->data = b->data;
-     CA_STD_ASSIGN(r, b->data);
-     return CA_ERROR_OK;
+    if (ca_var_is(a, CA_TYPE_INT)) {
+        *i = ca_var_int(a);
+        return 1;
+    }
+    return ca_var_is(a, CA_TYPE_BIGINT) &&
+           ca_bigint_get_int(ca_var_bigint(a), i);
 }
 
-/*
- * Non - primitive (Abstract) operations
+/**
+ * \brief Raises a CaInt to a CaInt power, by repeated squaring.
+ * \param a The base.
+ * \param e The exponent.
+ * \param r The power. Left as it is on failure.
+ * \return Nonzero if the power is not a CaInt, as e is negative or the power
+ *         overflows.
  */
+static inline int ca_std_int_pow(CaInt a, CaInt e, CaInt *r)
+{
+    CaInt p = 1;
+
+    if (e < 0)
+        return 1;
+    /* a is only squared while a higher bit of e is left, so a square that
+     * overflows makes the power overflow too. */
+    for (;;) {
+        if ((e & 1) && __builtin_mul_overflow(p, a, &p))
+            return 1;
+        if (!(e >>= 1))
+            break;
+        if (__builtin_mul_overflow(a, a, &a))
+            return 1;
+    }
+    *r = p;
+    return 0;
+}
 
-CaError ca_std_pow(CaResult *r, CaVar *a, CaVar *b, CaVarType vt)
+/**
+ * \brief Frees what a value holds, and leaves it unset.
+ * \param a The value.
+ */
+static inline void ca_std_release(CaVar *a)
 {
-     CA_STD_ASSIGN(r, pow(a->data, b->data), vt);
-     return CA_ERROR_OK;
+    CaBigInt *b;
+
+    if (ca_var_is(a, CA_TYPE_BIGINT)) {
+        b = ca_var_bigint(a);
+        ca_bigint_free(b);
+        free(b);
+    }
+    ca_var_set_unknown(a);
 }
 
+/**
+ * \brief Assigns a copy of a value to a variable.
+ * \param r The variable, which must be initialised.
+ * \param a The value.
+ * \return An error code. CA_ERROR_EVAL_UNSUPPORTED for types that cannot be
+ *         assigned yet.
+ */
+CaError ca_std_assign(CaVar *r, const CaVar *a);
+
+/**
+ * \brief Sets a variable to a CaInt, which is kept as a CaBigInt if it is
+ *        too large for a CaVar (see types.h).
+ * \param r The variable, which must be initialised.
+ * \param i The integer.
+ * \return An error code.
+ */
+CaError ca_std_set_int(CaVar *r, CaInt i);
+
 #endif
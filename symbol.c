@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file symbol.c
+ * \author Anamitra Ghorui
+ * \brief Symbol interning
+ */
+
+#include "symbol.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* FNV-1a. Names are short, so a simple byte-at-a-time hash does best. */
+static inline uint32_t ca_symbols_hash(const char *name, CaSize size)
+{
+    uint32_t h = 2166136261u;
+
+    for (CaSize i = 0; i < size; ++i)
+        h = (h ^ (unsigned char) name[i]) * 16777619u;
+    return h;
+}
+
+/* Returns the slot of name, or the empty slot it would go in. */
+static inline CaSize ca_symbols_probe(const CaSymbols *s, const char *name,
+                                      CaSize size, uint32_t hash)
+{
+    const CaSymbolEntry *e;
+    CaSize i = hash & s->mask;
+
+    for (; s->slots[i]; i = (i + 1) & s->mask) {
+        e = &s->entries[s->slots[i] - 1];
+        if (e->hash == hash && e->size == size &&
+            !memcmp(s->text + e->pos, name, size))
+            break;
+    }
+    return i;
+}
+
+/* Doubles the number of slots, keeping the load factor at most 1/2. */
+static CaError ca_symbols_grow(CaSymbols *s)
+{
+    CaSize mask = s->mask * 2 + 1, i;
+    CaSymbol *slots = calloc(mask + 1, sizeof(CaSymbol));
+
+    if (!slots)
+        return CA_ERROR_MEM;
+
+    for (CaSymbol id = 0; id < s->count; ++id) {
+        for (i = s->entries[id].hash & mask; slots[i]; i = (i + 1) & mask);
+        slots[i] = id + 1;
+    }
+
+    free(s->slots);
+    s->slots = slots;
+    s->mask  = mask;
+    return CA_ERROR_OK;
+}
+
+CaError ca_symbols_init(CaSymbols *s)
+{
+    s->slots         = calloc(CA_SYMBOLS_SIZE, sizeof(CaSymbol));
+    s->mask          = CA_SYMBOLS_SIZE - 1;
+    s->entries       = malloc(CA_SYMBOLS_SIZE / 2 * sizeof(CaSymbolEntry));
+    s->count         = 0;
+    s->capacity      = CA_SYMBOLS_SIZE / 2;
+    s->text          = malloc(CA_SYMBOLS_TEXT_SIZE);
+    s->text_size     = 0;
+    s->text_capacity = CA_SYMBOLS_TEXT_SIZE;
+
+    if (!s->slots || !s->entries || !s->text) {
+        ca_symbols_free(s);
+        return CA_ERROR_MEM;
+    }
+    return CA_ERROR_OK;
+}
+
+void ca_symbols_free(CaSymbols *s)
+{
+    free(s->slots);
+    free(s->entries);
+    free(s->text);
+    s->slots   = NULL;
+    s->entries = NULL;
+    s->text    = NULL;
+    s->count   = 0;
+}
+
+CaError ca_symbols_find(const CaSymbols *s, const char *name, CaSize size,
+                        CaSymbol *id)
+{
+    CaSize i = ca_symbols_probe(s, name, size, ca_symbols_hash(name, size));
+
+    if (!s->slots[i])
+        return CA_ERROR_HASH_NOTFOUND;
+    *id = s->slots[i] - 1;
+    return CA_ERROR_OK;
+}
+
+CaError ca_symbols_intern(CaSymbols *s, const char *name, CaSize size,
+                          CaSymbol *id)
+{
+    uint32_t hash = ca_symbols_hash(name, size);
+    CaSize i = ca_symbols_probe(s, name, size, hash), capacity;
+    CaSymbolEntry *entries;
+    char *text;
+    CaError err;
+
+    if (s->slots[i]) {
+        *id = s->slots[i] - 1;
+        return CA_ERROR_OK;
+    }
+
+    if (size >= UINT32_MAX || s->text_size + size + 1 > UINT32_MAX ||
+        s->count >= CA_SYMBOL_NONE - 1)
+        return CA_ERROR_HASH_INVALID_KEY;
+
+    if (s->count == s->capacity) {
+        capacity = s->capacity * 2;
+        if (!(entries = realloc(s->entries, capacity * sizeof(*entries))))
+            return CA_ERROR_MEM;
+        s->entries  = entries;
+        s->capacity = capacity;
+    }
+
+    if (s->text_size + size + 1 > s->text_capacity) {
+        capacity = s->text_capacity * 2;
+        while (capacity < s->text_size + size + 1)
+            capacity *= 2;
+        if (!(text = realloc(s->text, capacity)))
+            return CA_ERROR_MEM;
+        s->text          = text;
+        s->text_capacity = capacity;
+    }
+
+    memcpy(s->text + s->text_size, name, size);
+    s->text[s->text_size + size] = '\0';
+    s->entries[s->count] = (CaSymbolEntry) { s->text_size, size, hash };
+    s->text_size += size + 1;
+    s->slots[i] = ++s->count;
+    *id = s->count - 1;
+
+    if (s->count * 2 > s->mask + 1 && (err = ca_symbols_grow(s)) != CA_ERROR_OK)
+        return err;
+    return CA_ERROR_OK;
+}
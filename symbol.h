@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file symbol.h
+ * \author Anamitra Ghorui
+ * \brief Symbol interning
+ *
+ */
+
+/*
+ * Every distinct name read by a context is given a symbol ID the first time
+ * it is seen. IDs are dense, counting up from 0, so anything kept per name,
+ * such as the value of a variable, can be an array indexed by ID, and names
+ * are compared by comparing IDs.
+ *
+ * The table is an open addressing hash table of IDs, with linear probing.
+ * The names themselves are kept NUL terminated in one buffer.
+ */
+
+#ifndef CA_SYMBOL_H
+#define CA_SYMBOL_H
+
+#include "types.h"
+#include "error.h"
+
+#include <stdint.h>
+
+/// Initial number of slots of a symbol table. Must be a power of 2.
+#define CA_SYMBOLS_SIZE 256
+
+/// Initial size of the buffer the names of a symbol table are kept in.
+#define CA_SYMBOLS_TEXT_SIZE 2048
+
+/// A symbol ID.
+typedef uint32_t CaSymbol;
+
+/// The ID of no symbol.
+#define CA_SYMBOL_NONE UINT32_MAX
+
+/// A name in a symbol table.
+typedef struct CaSymbolEntry {
+    uint32_t pos;  ///< Offset of the name in the text of the table.
+    uint32_t size; ///< Size of the name.
+    uint32_t hash; ///< Hash of the name.
+} CaSymbolEntry;
+
+/// Maps names to symbol IDs, and back.
+typedef struct CaSymbols {
+    CaSymbol *slots;        ///< IDs plus one, 0 for empty slots.
+    CaSize mask;            ///< Number of slots, minus one.
+    CaSymbolEntry *entries; ///< The name of each ID.
+    CaSize count;           ///< Number of symbols.
+    CaSize capacity;        ///< Number of entries there is room for.
+    char *text;             ///< The names.
+    CaSize text_size;
+    CaSize text_capacity;
+} CaSymbols;
+
+/**
+ * \brief Initialises an empty symbol table.
+ * \param s The symbol table.
+ * \return An error code.
+ */
+CaError ca_symbols_init(CaSymbols *s);
+
+/**
+ * \brief Frees the memory held by a symbol table.
+ * \param s The symbol table.
+ */
+void ca_symbols_free(CaSymbols *s);
+
+/**
+ * \brief Gets the ID of a name, giving it the next ID if it is new.
+ * \param s The symbol table.
+ * \param name The name. It need not be NUL terminated.
+ * \param size The size of the name.
+ * \param id The ID of the name.
+ * \return An error code.
+ */
+CaError ca_symbols_intern(CaSymbols *s, const char *name, CaSize size,
+                          CaSymbol *id);
+
+/**
+ * \brief Gets the ID of a name, without adding it.
+ * \param s The symbol table.
+ * \param name The name.
+ * \param size The size of the name.
+ * \param id The ID of the name.
+ * \return An error code. CA_ERROR_HASH_NOTFOUND if the name has no ID.
+ */
+CaError ca_symbols_find(const CaSymbols *s, const char *name, CaSize size,
+                        CaSymbol *id);
+
+/**
+ * \brief Gets the name of a symbol.
+ * \param s The symbol table.
+ * \param id The ID, which must be valid.
+ * \param size The size of the name, if not NULL.
+ * \return The name, NUL terminated. It is valid until the next symbol is
+ *         added.
+ */
+static inline const char *ca_symbols_name(const CaSymbols *s, CaSymbol id,
+                                          CaSize *size)
+{
+    if (size)
+        *size = s->entries[id].size;
+    return s->text + s->entries[id].pos;
+}
+
+#endif
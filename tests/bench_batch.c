@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+/*
+ * Compares running an expression over columns with ca_run_batch against
+ * setting its variables and calling ca_run for every row. Times are per row.
+ */
+
+#include "../eval.h"
+#include "../batch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+/* Rows each expression is run on. */
+#define BENCHROWS 1000000
+
+static const char *exprs[] = {
+    "a + b",
+    "a * b + c",
+    "(a + b) * (a - b) % 7 + (a << 2 >> 1) - c / d",
+    "max(a, b) * 2 + sqrt(c)",
+    "a > 0 && b < 100",
+    "a * 3 + (a << 2) & 1023 ^ a",
+};
+
+static CaSymbol symbol(CaContext *c, const char *name)
+{
+    CaSymbol id;
+
+    assert(ca_symbols_intern(&c->symbols, name, strlen(name), &id) ==
+           CA_ERROR_OK);
+    return id;
+}
+
+int main()
+{
+    CaContext *c = ca_context_init();
+    CaInt *as = malloc(BENCHROWS * sizeof(CaInt));
+    CaReal *bs = malloc(BENCHROWS * sizeof(CaReal));
+    CaReal *out = malloc(BENCHROWS * sizeof(CaReal));
+    CaColumn cols[2];
+    CaCode code;
+    CaExpr e;
+    CaReal r;
+    double t_rows, t_batch;
+    clock_t t;
+
+    assert(c && as && bs && out);
+    for (long i = 0; i < BENCHROWS; i++) {
+        as[i] = i % 1000 - 300;
+        bs[i] = i * 0.5L;
+    }
+    cols[0] = (CaColumn) { symbol(c, "a"), CA_TYPE_INT, as };
+    cols[1] = (CaColumn) { symbol(c, "b"), CA_TYPE_REAL, bs };
+    e = (CaExpr) { 0, "c = 7.5, d = 11" };
+    assert(ca_eval(c, &e, &r) == CA_ERROR_OK);
+
+    ca_code_init(&code);
+    for (size_t i = 0; i < sizeof(exprs) / sizeof(exprs[0]); i++) {
+        e = (CaExpr) { 0, exprs[i] };
+        assert(ca_compile(c, &e, &code) == CA_ERROR_OK);
+
+        t = clock();
+        for (long j = 0; j < BENCHROWS; j++) {
+            ca_var_set_int(&c->vars[cols[0].name], as[j]);
+            ca_var_set_real(&c->vars[cols[1].name], bs[j]);
+            assert(ca_run(c, &code, &r) == CA_ERROR_OK);
+        }
+        t_rows = (double) (clock() - t) / CLOCKS_PER_SEC;
+
+        t = clock();
+        assert(ca_run_batch(c, &code, cols, 2, BENCHROWS, out) ==
+               CA_ERROR_OK);
+        t_batch = (double) (clock() - t) / CLOCKS_PER_SEC;
+        assert(out[BENCHROWS - 1] == r);
+
+        printf("%.*s%s: row by row %.2f ns/row, batch %.2f ns/row\n",
+               40, exprs[i], strlen(exprs[i]) > 40 ? "..." : "",
+               t_rows * 1e9 / BENCHROWS, t_batch * 1e9 / BENCHROWS);
+    }
+
+    ca_code_free(&code);
+    ca_context_free(c);
+    free(as);
+    free(bs);
+    free(out);
+
+    printf("Test Passed.\n");
+
+    return 0;
+}
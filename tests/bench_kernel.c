@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+/*
+ * Times every kernel of every implementation the CPU supports, on columns
+ * that fit in the L1 cache, for two columns and for a column and a scalar.
+ * Times are per element.
+ */
+
+#include "../kernel.h"
+
+#include <stdio.h>
+#include <assert.h>
+#include <time.h>
+
+/* Elements of each column. */
+#define BENCHSIZE 2048
+
+/* Elements each kernel is run on. */
+#define BENCHELEMS (1 << 20)
+
+static CaInt ia[BENCHSIZE], ib[BENCHSIZE], ir[BENCHSIZE];
+static double da[BENCHSIZE], db[BENCHSIZE], dr[BENCHSIZE];
+
+static const char *impl_names[] = { "auto", "scalar", "sse2", "avx2",
+                                    "avx512" };
+
+static double now()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* Times kernel _call, run on all columns, in ns per element. */
+#define TIME(_call) do {                                        \
+        double _t = now();                                      \
+        for (int _i = 0; _i < BENCHELEMS / BENCHSIZE; _i++)     \
+            _call;                                              \
+        printf(" %7.3f", (now() - _t) * 1e9 / BENCHELEMS);      \
+    } while (0)
+
+int main()
+{
+    const CaKernels *k;
+    int op, impl;
+
+    for (int i = 0; i < BENCHSIZE; i++) {
+        ia[i] = i * 2654435761u % 1000 - 500;
+        ib[i] = i % 61 + 1;
+        da[i] = ia[i] * 0.25;
+        db[i] = ib[i] * 0.5;
+    }
+
+    printf("%-6s %-6s", "kernel", "op");
+    for (impl = CA_KERNEL_IMPL_SCALAR; impl <= CA_KERNEL_IMPL_AVX512; impl++)
+        if (ca_kernel_supported(impl))
+            printf(" %7s", impl_names[impl]);
+    printf("   (ns/element)\n");
+
+    for (op = 0; op < CA_KERNEL_OP_COUNT; op++) {
+        printf("%-6s %-6s", "i_vv", ca_kernel_op_names[op]);
+        for (impl = CA_KERNEL_IMPL_SCALAR; impl <= CA_KERNEL_IMPL_AVX512;
+             impl++)
+            if ((k = ca_kernels(impl)))
+                TIME(k->i_vv[op](ir, ia, ib, BENCHSIZE));
+        printf("\n%-6s %-6s", "i_vs", ca_kernel_op_names[op]);
+        for (impl = CA_KERNEL_IMPL_SCALAR; impl <= CA_KERNEL_IMPL_AVX512;
+             impl++)
+            if ((k = ca_kernels(impl)))
+                TIME(k->i_vs[op](ir, ia, 3, BENCHSIZE));
+        printf("\n%-6s %-6s", "d_vv", ca_kernel_op_names[op]);
+        for (impl = CA_KERNEL_IMPL_SCALAR; impl <= CA_KERNEL_IMPL_AVX512;
+             impl++)
+            if ((k = ca_kernels(impl)))
+                TIME(k->d_vv[op](dr, da, db, BENCHSIZE));
+        printf("\n%-6s %-6s", "d_vs", ca_kernel_op_names[op]);
+        for (impl = CA_KERNEL_IMPL_SCALAR; impl <= CA_KERNEL_IMPL_AVX512;
+             impl++)
+            if ((k = ca_kernels(impl)))
+                TIME(k->d_vs[op](dr, da, 3.5, BENCHSIZE));
+        printf("\n");
+    }
+
+    assert(ir[0] == ia[0] || ir[0] != ia[0]);
+    printf("Test Passed.\n");
+
+    return 0;
+}
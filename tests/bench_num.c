@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compares the throughput of ca_parse_double against strtod, on typical
+ * "%.17g" output and on short literals as written by hand.
+ */
+
+#include "../num.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <math.h>
+
+#define BENCHCOUNT 1000000
+#define REPEAT     5
+
+static uint64_t rand64(void)
+{
+    return (uint64_t) rand() << 62 ^ (uint64_t) rand() << 31 ^ rand();
+}
+
+/* Fills buf with count NUL separated literals. Returns the size used. */
+static size_t generate(char *buf, int count, int shortform)
+{
+    size_t pos = 0;
+    double d;
+    uint64_t bits;
+
+    srand(1);
+    for (int i = 0; i < count; ++i) {
+        if (shortform) {
+            pos += sprintf(buf + pos, "%d.%d", rand() % 10000, rand() % 1000);
+        } else {
+            do {
+                bits = rand64();
+                memcpy(&d, &bits, sizeof(d));
+            } while (!isfinite(d));
+            pos += sprintf(buf + pos, "%.17g", fabs(d));
+        }
+        buf[pos++] = '\0';
+    }
+    return pos;
+}
+
+static void run(char *buf, const char *name, int shortform)
+{
+    size_t size = generate(buf, BENCHCOUNT, shortform), len;
+    volatile double sink = 0;
+    double v, t_ca, t_strtod;
+    clock_t t;
+
+    /* Check the results first, and warm up. */
+    for (char *c = buf; c < buf + size; c += len + 1) {
+        len = strlen(c);
+        assert(ca_parse_double(c, len, &v) == CA_ERROR_OK);
+        assert(v == strtod(c, NULL));
+    }
+
+    t = clock();
+    for (int r = 0; r < REPEAT; ++r) {
+        for (char *c = buf; c < buf + size; c += len + 1) {
+            len = strlen(c);
+            ca_parse_double(c, len, &v);
+            sink += v;
+        }
+    }
+    t_ca = (double) (clock() - t) / CLOCKS_PER_SEC;
+
+    t = clock();
+    for (int r = 0; r < REPEAT; ++r) {
+        for (char *c = buf; c < buf + size; c += len + 1) {
+            len = strlen(c);
+            sink += strtod(c, NULL);
+        }
+    }
+    t_strtod = (double) (clock() - t) / CLOCKS_PER_SEC;
+
+    (void) sink;
+    printf("%s: %d literals, %.1f MB: ca_parse_double %.0f MB/s, "
+           "strtod %.0f MB/s\n", name, BENCHCOUNT, size / 1e6,
+           REPEAT * size / 1e6 / t_ca, REPEAT * size / 1e6 / t_strtod);
+}
+
+int main()
+{
+    char *buf = malloc(BENCHCOUNT * 32);
+
+    assert(buf);
+    run(buf, "%.17g", 0);
+    run(buf, "short", 1);
+    free(buf);
+    printf("Test Passed.\n");
+
+    return 0;
+}
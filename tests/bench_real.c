@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Times real arithmetic in the type CaReal is built as. Build with each of
+ * REAL=double, REAL=long_double and REAL=float128 to compare them.
+ */
+
+#include "../eval.h"
+#include "../batch.h"
+#include "../real.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#define BENCHRUNS 1000000
+#define BENCHROWS 1000000
+
+static const char *exprs[] = {
+    "a + b",
+    "a * b + c / d",
+    "(a + b) * (a - b) / (c * c + d)",
+    "sqrt(a * a + b * b)",
+};
+
+int main()
+{
+    CaContext *c = ca_context_init();
+    CaReal *as = malloc(BENCHROWS * sizeof(CaReal));
+    CaReal *out = malloc(BENCHROWS * sizeof(CaReal));
+    CaExpr e = { 0, "a = 1.25, b = 0.375, c = 3.5, d = 7.0" };
+    CaColumn col;
+    CaCode code;
+    CaReal r;
+    volatile CaReal sink = 0;
+    double t_run, t_batch;
+    clock_t t;
+
+    assert(c && as && out);
+    assert(ca_eval(c, &e, &r) == CA_ERROR_OK);
+    for (long i = 0; i < BENCHROWS; i++)
+        as[i] = i * 0.25;
+    assert(ca_symbols_intern(&c->symbols, "a", 1, &col.name) ==
+           CA_ERROR_OK);
+    col.type = CA_TYPE_REAL;
+    col.data = as;
+
+    ca_code_init(&code);
+    for (size_t i = 0; i < sizeof(exprs) / sizeof(exprs[0]); i++) {
+        e = (CaExpr) { 0, exprs[i] };
+        assert(ca_compile(c, &e, &code) == CA_ERROR_OK);
+
+        t = clock();
+        for (long j = 0; j < BENCHRUNS; j++) {
+            ca_run(c, &code, &r);
+            sink += r;
+        }
+        t_run = (double) (clock() - t) / CLOCKS_PER_SEC;
+
+        t = clock();
+        assert(ca_run_batch(c, &code, &col, 1, BENCHROWS, out) ==
+               CA_ERROR_OK);
+        t_batch = (double) (clock() - t) / CLOCKS_PER_SEC;
+        sink += out[BENCHROWS - 1];
+
+        printf("%s: %s: ca_run %.2f ns, ca_run_batch %.2f ns/row\n",
+               CA_REAL_NAME, exprs[i], t_run * 1e9 / BENCHRUNS,
+               t_batch * 1e9 / BENCHROWS);
+    }
+    (void) sink;
+
+    ca_code_free(&code);
+    ca_context_free(c);
+    free(as);
+    free(out);
+    printf("Test Passed.\n");
+
+    return 0;
+}
@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compares the table driven tokeniser against the scanner it replaced
+ * (next_token in ref/infix.c), for token boundaries and for speed. The inputs
+ * avoid the cases where the two deliberately differ: numbers with exponents,
+ * prefixes or underscores, and '\r' or skipped bytes next to a token.
+ */
+
+#include "../token.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#define BENCHSIZE (8 << 20)
+
+#define CIN_RANGE(x, l, h) (((x) >= (l)) && ((x) <= (h)))
+#define CIS_ALPHA(x)  (CIN_RANGE((x), 0x41, 0x5A) || \
+                       CIN_RANGE((x), 0x61, 0x7A) || \
+                       ((x) == '_'))
+#define CIS_NUMBER(x) (CIN_RANGE((x), 0x30, 0x39))
+#define CIS_SYMBOL(x) (CIN_RANGE((x), 0x21, 0x2F) || \
+                       CIN_RANGE((x), 0x3A, 0x40) || \
+                       CIN_RANGE((x), 0x5B, 0x5E) || \
+                       CIN_RANGE((x), 0x7B, 0x7E))
+
+/* The operator table of the old scanner, with the operators added since, so
+ * that both scanners agree on them. */
+typedef struct LegacyOperator {
+    char extra_symbol;
+    CaOperID id;
+    CaOperPrec prec;
+} LegacyOperator;
+
+static const LegacyOperator legacy_oper_list[128][5] = {
+    /*    OPER  OPER_ID                        PRECEDENCE                     */
+    ['('] =
+    {
+        { '\0', OPER_ID_NEST,                  PRECEDENCE_INVALID        },
+        { 0 }
+    },
+    [')'] = {
+        { '\0', OPER_ID_NEST_CLOSE,            PRECEDENCE_INVALID        },
+        { 0 }
+    },
+
+    ['['] = { { '\0' }, { 0 } },
+    [']'] = { { '\0' }, { 0 } },
+
+    ['+'] =
+    {
+        { '\0', OPER_ID_ADDITION,              PRECEDENCE_ADDITIVE       },
+        { '+',  OPER_ID_INCREMENT,             PRECEDENCE_UNARY          },
+        { '=',  OPER_ID_ADDITION_ASSIGN,       PRECEDENCE_ASSIGNMENT     },
+        { 0 }
+    },
+    ['-'] =
+    {
+        { '\0', OPER_ID_SUBTRACTION,           PRECEDENCE_ADDITIVE       },
+        { '-',  OPER_ID_DECREMENT,             PRECEDENCE_UNARY          },
+        { '=',  OPER_ID_SUBTRACTION_ASSIGN,    PRECEDENCE_ASSIGNMENT     },
+        { 0 }
+    },
+    ['*'] =
+    {
+        { '\0', OPER_ID_MULTIPLICATION,        PRECEDENCE_MULTIPLICATIVE },
+        { '*',  OPER_ID_POWER,                 PRECEDENCE_EXPONENTIAL    },
+        { '=',  OPER_ID_MULTIPLICATION_ASSIGN, PRECEDENCE_ASSIGNMENT     },
+        { 0 }
+    },
+    ['/'] =
+    {
+        { '\0', OPER_ID_DIVISION,              PRECEDENCE_MULTIPLICATIVE },
+        { '/',  OPER_ID_DIVISION,              PRECEDENCE_MULTIPLICATIVE },
+        { '=',  OPER_ID_DIVISION_ASSIGN,       PRECEDENCE_ASSIGNMENT     },
+        { 0 }
+    },
+    ['>'] =
+    {
+        { '\0', OPER_ID_GT,                    PRECEDENCE_COMPARISON     },
+        { '=',  OPER_ID_GTEQ,                  PRECEDENCE_COMPARISON     },
+        { '>',  OPER_ID_RSHIFT,                PRECEDENCE_SHIFT          },
+        { 0 }
+    },
+    ['<'] =
+    {
+        { '\0', OPER_ID_LT,                    PRECEDENCE_COMPARISON     },
+        { '=',  OPER_ID_LTEQ,                  PRECEDENCE_COMPARISON     },
+        { '<',  OPER_ID_LSHIFT,                PRECEDENCE_SHIFT          },
+        { 0 }
+    },
+    ['='] =
+    {
+        { '\0', OPER_ID_ASSIGN,                PRECEDENCE_ASSIGNMENT     },
+        { '=',  OPER_ID_EQ,                    PRECEDENCE_EQUALITY       },
+        { 0 }
+    },
+    ['%'] =
+    {
+        { '\0', OPER_ID_REMAINDER,             PRECEDENCE_MULTIPLICATIVE },
+        { '=',  OPER_ID_REMAINDER_ASSIGN,      PRECEDENCE_ASSIGNMENT     },
+        { 0 }
+    },
+    ['&'] =
+    {
+        { '\0', OPER_ID_B_AND,                 PRECEDENCE_B_AND          },
+        { '&',  OPER_ID_AND,                   PRECEDENCE_AND            },
+        { 0 }
+    },
+    ['|'] =
+    {
+        { '\0', OPER_ID_B_OR,                  PRECEDENCE_B_OR           },
+        { '|',  OPER_ID_OR,                    PRECEDENCE_OR             },
+        { 0 }
+    },
+    ['^'] =
+    {
+        { '\0', OPER_ID_B_XOR,                 PRECEDENCE_B_XOR          },
+        { 0 }
+    },
+    [','] =
+    {
+        { '\0', OPER_ID_COMMA,                 PRECEDENCE_COMMA          },
+        { 0 }
+    },
+};
+
+/* The old scanner, verbatim apart from names. */
+static const char *legacy_next_token(const char *c, int *size, CaGuess *guess,
+                                     const LegacyOperator **oper)
+{
+    *guess         = CA_GUESS_UNKNOWN;
+    const char *start = NULL;
+    int float_hint = 0;
+    char delimiter = '\0';
+    char curr_oper = '\0';
+    int i;
+
+    while (*c) {
+        switch (*c) {
+        case ' ': case '\n': case '\t':
+            if (*guess)
+                goto end;
+            goto next;
+
+        case '"':
+        case '\'':
+            delimiter = *c;
+            start = c;
+            while ((*++c) && *c != delimiter);
+            if (*c != delimiter) {
+                *guess = CA_GUESS_ERROR;
+                goto end;
+            } else {
+                *guess = CA_GUESS_STRING;
+                c++;
+                goto end;
+            }
+        }
+
+        if (CIS_SYMBOL(*c)) {
+            if (*c == '.' && *guess == CA_GUESS_INTEGER) {
+                float_hint = 1;
+            } else if (*guess && *guess == CA_GUESS_OPERATOR) {
+                for (i = 1; legacy_oper_list[(int) curr_oper][i].extra_symbol; i++) {
+                    if (legacy_oper_list[(int) curr_oper][i].extra_symbol == *c) {
+                        c++;
+                        *oper = &legacy_oper_list[(int) curr_oper][i];
+                        goto end;
+                    }
+                }
+                *oper = &legacy_oper_list[(int) curr_oper][0];
+                goto end;
+            } else if (*guess && *guess != CA_GUESS_OPERATOR) {
+                goto end;
+            } else if (!*guess) {
+                start = c;
+                curr_oper = *c;
+                *oper = &legacy_oper_list[(int) curr_oper][0];
+                *guess = CA_GUESS_OPERATOR;
+            }
+        } else if (CIS_ALPHA(*c)) {
+            if (*guess && *guess != CA_GUESS_NOUN)
+                goto end;
+            else if (!*guess)
+                start = c;
+            *guess = CA_GUESS_NOUN;
+        } else if (CIS_NUMBER(*c)) {
+            if (float_hint && *guess == CA_GUESS_INTEGER) {
+                *guess = CA_GUESS_FLOAT;
+            } else if (*guess && (*guess != CA_GUESS_INTEGER &&
+                                  *guess != CA_GUESS_FLOAT)) {
+                goto end;
+            } else if (*guess == CA_GUESS_UNKNOWN) {
+                start = c;
+                *guess = CA_GUESS_INTEGER;
+            }
+        }
+next:
+        c++;
+    }
+
+end:
+    *size = (int) (c - start);
+    return start;
+}
+
+/* Checks that both scanners split buf into the same tokens. */
+static size_t compare(const char *buf)
+{
+    CaExpr e = { 0, buf };
+    const char *curr = buf, *lstart;
+    const CaOperator *oper = NULL;
+    const LegacyOperator *loper = NULL;
+    CaGuess guess, lguess;
+    CaSize start, size;
+    int lsize;
+    size_t ntokens = 0;
+
+    for (;;) {
+        lstart = legacy_next_token(curr, &lsize, &lguess, &loper);
+        if (ca_next_token(&e, &guess, &start, &size, &oper) != CA_ERROR_OK) {
+            assert(lstart == NULL);
+            return ntokens;
+        }
+        assert(lstart == buf + start);
+        assert((CaSize) lsize == size);
+        assert(lguess == guess);
+        if (guess == CA_GUESS_OPERATOR)
+            assert(loper->id == oper->id && loper->prec == oper->prec);
+        curr = lstart + lsize;
+        ntokens++;
+    }
+}
+
+static const char *cases[] = {
+    "",
+    "   \t\n",
+    "1 + 2",
+    "a=b*c-d/e%f",
+    "x += 12 ** 3 >= y << 2",
+    "1.5 1. 1.2.3 1..5 .5 12abc abc12",
+    "(a+b)*(c-d)",
+    "++--**//>>=<<===%=",
+    "!@#$^&|~{}[]:;,?",
+    "\"a string\" 'another' \"unterminated",
+    "a `b` c \r\n\x01\x7f\xff z",
+    "_under_score__ 0009 9.",
+};
+
+static const char *mixed_pieces[] = {
+    "x", "counter", "_tmp", "42", "3.14159", "1000000", "0.5",
+    "+", "-", "*", "/", "%", "**", "<<", ">>", "<=", ">=", "==", "+=",
+    "=", "(", ")", "!", "&", "|", "^", "~", " 'str' ", " \"s t r\" ",
+    ".", "..", " \r ", " ` ", "1.", " ", " ", " ", "\n", "\t"
+};
+
+static const char *numeric_pieces[] = {
+    "1234567890123", " + ", "0.000123456789", " * ", "98765432.125",
+    " - ", "31415926535897", "\n", "2718281828.4590452", " / "
+};
+
+/* A random expression made of the given pieces. */
+static void generate(char *buf, size_t len, unsigned seed,
+                     const char **pieces, size_t n)
+{
+    size_t pos = 0, l;
+    const char *p;
+
+    srand(seed);
+    while (pos < len - 16) {
+        p = pieces[rand() % n];
+        l = strlen(p);
+        memcpy(buf + pos, p, l);
+        pos += l;
+    }
+    buf[pos] = '\0';
+}
+
+static double bench(const char *buf, int legacy)
+{
+    clock_t t = clock();
+    CaExpr e = { 0, buf };
+    const char *curr = buf, *lstart;
+    const CaOperator *oper;
+    const LegacyOperator *loper;
+    CaGuess guess;
+    CaSize start, size;
+    int lsize;
+    volatile size_t sink = 0;
+
+    if (legacy) {
+        while ((lstart = legacy_next_token(curr, &lsize, &guess, &loper))) {
+            curr = lstart + lsize;
+            sink += guess;
+        }
+    } else {
+        while (ca_next_token(&e, &guess, &start, &size, &oper) == CA_ERROR_OK)
+            sink += guess;
+    }
+    (void) sink;
+    return (double) (clock() - t) / CLOCKS_PER_SEC;
+}
+
+static void run(char *buf, const char *name, const char **pieces, size_t n)
+{
+    size_t ntokens;
+    double t_old, t_new;
+
+    generate(buf, BENCHSIZE, 1, pieces, n);
+    ntokens = compare(buf);
+    t_old = bench(buf, 1);
+    t_new = bench(buf, 0);
+    printf("%s: %zu tokens in %d MiB: next_token %.3fs, ca_next_token "
+           "%.3fs\n", name, ntokens, BENCHSIZE >> 20, t_old, t_new);
+}
+
+int main()
+{
+    char *buf = malloc(BENCHSIZE);
+
+    assert(buf);
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+        compare(cases[i]);
+
+    for (unsigned i = 0; i < 200; ++i) {
+        generate(buf, 4096, i, mixed_pieces,
+                 sizeof(mixed_pieces) / sizeof(mixed_pieces[0]));
+        compare(buf);
+    }
+
+    run(buf, "mixed", mixed_pieces,
+        sizeof(mixed_pieces) / sizeof(mixed_pieces[0]));
+    run(buf, "numeric", numeric_pieces,
+        sizeof(numeric_pieces) / sizeof(numeric_pieces[0]));
+
+    free(buf);
+    printf("Test Passed.\n");
+
+    return 0;
+}
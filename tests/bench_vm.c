@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compares the dispatch of ca_vm_run against its switch fallback, which the
+ * Makefile builds from vm.c again, as ca_vm_run_switch, with CA_VM_SWITCH,
+ * and code as compiled against code with superinstructions, and against
+ * native code where the expression can be compiled to it. Times are per
+ * instruction of the code as compiled.
+ *
+ * The two dispatches are run in turns, ROUNDS times each, starting with each
+ * in turn, and the best time of each is given, so that neither is timed only
+ * while the other has warmed the caches, or only on a noisy round.
+ */
+
+#include "../vm.h"
+#include "../jit.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+/* Instructions run for each expression, by each VM. */
+#define BENCHINSTRS 50000000
+
+/* Times each dispatch is run for each expression. */
+#define ROUNDS 5
+
+CaError ca_vm_run_switch(CaContext *c, const CaCode *code);
+
+typedef CaError (*VmRun)(CaContext *c, const CaCode *code);
+
+static const char *exprs[] = {
+    "x = x + 1",
+    "a * b + c",
+    "(a + b) * (a - b) % 7 + (a << 2 >> 1) - c / d",
+    "x += a * b - c, x -= a * b - c, x < d && x >= 0 || x == a",
+    NULL, /* A long sum, built in main. */
+};
+
+/* Runs code count times, and returns the value it left the last time. */
+static CaReal run(CaContext *c, const CaCode *code, VmRun vm, long count)
+{
+    for (long i = 0; i < count; i++) {
+        c->expr->top = 0;
+        assert(vm(c, code) == CA_ERROR_OK);
+    }
+    return c->expr->data[0].value.f;
+}
+
+static double bench(CaContext *c, const CaCode *code, VmRun vm, long count,
+                    CaReal *result)
+{
+    clock_t t;
+
+    t = clock();
+    *result = run(c, code, vm, count);
+    return (double) (clock() - t) / CLOCKS_PER_SEC;
+}
+
+/* Runs native code count times, through ca_jit_run as the VMs are run
+ * through their own entry points, without ca_run around either. */
+static double bench_jit(CaContext *c, const CaCode *code, long count,
+                        CaReal *result)
+{
+    clock_t t;
+
+    t = clock();
+    for (long i = 0; i < count; i++)
+        assert(ca_jit_run(c, code, result));
+    return (double) (clock() - t) / CLOCKS_PER_SEC;
+}
+
+static void set(CaContext *c, const char *s)
+{
+    CaExpr e = { 0, s };
+    CaReal r;
+
+    assert(ca_eval(c, &e, &r) == CA_ERROR_OK);
+}
+
+int main()
+{
+    CaContext *c = ca_context_init();
+    char *sum = malloc(16 * 1024);
+    CaCode code;
+    CaExpr e;
+    CaReal r_threaded, r_switch, r_opt, r_jit;
+    double t_threaded, t_switch, t_opt, t_jit, t;
+    char native[32];
+    long count;
+    CaSize n;
+    size_t pos = 0;
+
+    assert(c && sum);
+    pos += sprintf(sum + pos, "a");
+    for (int i = 0; i < 256; i++)
+        pos += sprintf(sum + pos, " + b * c - d");
+    exprs[4] = sum;
+
+    /* Which layout of CaVar is benchmarked (see types.h). */
+    printf("CaVar: %zu bytes\n", sizeof(CaVar));
+    ca_code_init(&code);
+    for (size_t i = 0; i < sizeof(exprs) / sizeof(exprs[0]); i++) {
+        set(c, "a = 3, b = 5, c = 7.5, d = 11, x = 0");
+        e = (CaExpr) { 0, exprs[i] };
+        c->optimize = CA_OPTIMIZE_NONE;
+        assert(ca_compile(c, &e, &code) == CA_ERROR_OK);
+        count = BENCHINSTRS / code.count;
+        n     = code.count;
+
+        t_threaded = t_switch = 1e9;
+        for (int k = 0; k < 2 * ROUNDS; k++) {
+            set(c, "x = 0");
+            if ((k & 1) == (k >> 1 & 1)) {
+                t = bench(c, &code, ca_vm_run, count, &r_threaded);
+                t_threaded = t < t_threaded ? t : t_threaded;
+            } else {
+                t = bench(c, &code, ca_vm_run_switch, count, &r_switch);
+                t_switch = t < t_switch ? t : t_switch;
+            }
+        }
+        assert(r_threaded == r_switch);
+
+        /* The same expression, with superinstructions. */
+        c->optimize = CA_OPTIMIZE_PEEPHOLE;
+        e = (CaExpr) { 0, exprs[i] };
+        assert(ca_compile(c, &e, &code) == CA_ERROR_OK);
+        set(c, "x = 0");
+        t_opt = bench(c, &code, ca_vm_run, count, &r_opt);
+        assert(r_threaded == r_opt);
+
+        /* The optimised code, as native code. */
+        strcpy(native, "n/a");
+        if (ca_jit_compile(&code) == CA_ERROR_OK) {
+            set(c, "x = 0");
+            t_jit = bench_jit(c, &code, count, &r_jit);
+            assert(r_threaded == r_jit);
+            sprintf(native, "%.2f ns/op", t_jit * 1e9 / (count * n));
+        }
+
+        printf("%.*s%s: %zu instructions, %s %.2f ns/op, switch %.2f ns/op, "
+               "optimised to %zu instructions, %.2f ns/op, native %s\n",
+               40, exprs[i], strlen(exprs[i]) > 40 ? "..." : "", n,
+               CA_VM_THREADED ? "threaded" : "switch",
+               t_threaded * 1e9 / (count * n), t_switch * 1e9 / (count * n),
+               code.count, t_opt * 1e9 / (count * n), native);
+    }
+
+    ca_code_free(&code);
+    ca_context_free(c);
+    free(sum);
+
+    printf("Test Passed.\n");
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "../eval.h"
+#include "../batch.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define ROWS 1000
+
+static CaContext *c;
+static CaInt xs[ROWS];
+static CaReal ys[ROWS];
+static CaColumn cols[2];
+
+static CaSymbol symbol(const char *name)
+{
+    CaSymbol id;
+
+    assert(ca_symbols_intern(&c->symbols, name, strlen(name), &id) ==
+           CA_ERROR_OK);
+    return id;
+}
+
+/* Runs s over the columns, and checks each row against ca_run, with x set
+ * to a CaInt as its column holds. */
+static void check(const char *s)
+{
+    static CaReal out[ROWS];
+    CaExpr e = { 0, s };
+    CaCode code;
+    CaVar x;
+    CaReal r;
+
+    ca_code_init(&code);
+    assert(ca_compile(c, &e, &code) == CA_ERROR_OK);
+    assert(ca_run_batch(c, &code, cols, 2, ROWS, out) == CA_ERROR_OK);
+    for (CaSize i = 0; i < ROWS; i++) {
+        ca_var_set_int(&x, xs[i]);
+        assert(ca_context_set(c, cols[0].name, &x) == CA_ERROR_OK);
+        assert(ca_context_store(c, cols[1].name, ys[i]) == CA_ERROR_OK);
+        assert(ca_run(c, &code, &r) == CA_ERROR_OK);
+        assert(out[i] == r || (out[i] != out[i] && r != r));
+    }
+    ca_code_free(&code);
+}
+
+int main()
+{
+    CaExpr e = { 0, "x + y" };
+    static CaReal rows[ROWS];
+    CaReal out[4];
+    CaCode code;
+
+    c = ca_context_init();
+    assert(c);
+    for (CaSize i = 0; i < ROWS; i++) {
+        xs[i] = (CaInt) i - 500;
+        ys[i] = i * 0.25L;
+    }
+    cols[0] = (CaColumn) { symbol("x"), CA_TYPE_INT, xs };
+    cols[1] = (CaColumn) { symbol("y"), CA_TYPE_REAL, ys };
+
+    /* Unset variables without a column are an error. */
+    ca_code_init(&code);
+    e = (CaExpr) { 0, "x + z" };
+    assert(ca_compile(c, &e, &code) == CA_ERROR_OK);
+    assert(ca_run_batch(c, &code, cols, 2, 4, out) == CA_ERROR_HASH_NOTFOUND);
+    assert(c->error && !strcmp(c->error, "z"));
+    ca_code_free(&code);
+
+    /* Variables without a column have the same value in every row. */
+    assert(ca_context_store(c, symbol("z"), 3) == CA_ERROR_OK);
+    check("x + y");
+    check("x * y - z");
+    check("x * z + y / 2");
+    check("(x + y) * (x + y) + (x + y)");
+    check("x ** 2 % 7 + y // 3");
+    check("x << 2 >> 1 & 255 | z ^ 1");
+    check("y * 1e300 & 255 | (y - y) / 0 << 1 | (x - 1e300) >> 60");
+    check("x < y, x <= 0, y > 10, y >= z, x == 0");
+    check("max(x, y) + abs(x) + sqrt(y)");
+    check("x + y * z");
+
+    /* Integer operators on the integer column are run by kernels. */
+    check("x * 7 - x * x + (x >> 1) ^ 5");
+    check("(x << 3 | x & 12) < 100, x * x >= 250");
+    check("x * 3 + x * 3 * y");
+
+    check("x ** 2 + x ** 3 * y - (x + y) ** 2");
+
+    /* Rows that overflow a CaInt are run again exactly, as are CaInt powers
+     * with a negative exponent. */
+    check("x * 3037000500 * 3037000500 - x");
+    check("x ** 8 - x ** 3 * x ** 5");
+    check("z ** x + (x * 3037000) ** 3");
+    check("x % 7 + 100 % (x - 1000)");
+
+    /* A remainder by 0 in any row is an error. */
+    ca_code_init(&code);
+    e = (CaExpr) { 0, "x % 7 + 100 % x" };
+    assert(ca_compile(c, &e, &code) == CA_ERROR_OK);
+    assert(ca_run_batch(c, &code, cols, 2, ROWS, rows) ==
+           CA_ERROR_EVAL_DIVISION_BY_ZERO);
+    ca_code_free(&code);
+
+    /* Code that jumps or sets variables is run row by row. */
+    check("x > 0 && y < 100 || z");
+    check("w = x + y, w * 2");
+    check("y = y + x");
+
+    /* The variables of the columns are left as they were. */
+    assert(ca_context_store(c, cols[0].name, 7) == CA_ERROR_OK);
+    ca_code_init(&code);
+    e = (CaExpr) { 0, "x = x * y" };
+    assert(ca_compile(c, &e, &code) == CA_ERROR_OK);
+    assert(ca_run_batch(c, &code, cols, 2, 4, out) == CA_ERROR_OK);
+    assert(out[3] == -497 * 0.75L);
+    e = (CaExpr) { 0, "x" };
+    assert(ca_eval(c, &e, out) == CA_ERROR_OK && out[0] == 7);
+    ca_code_free(&code);
+
+    ca_context_free(c);
+    printf("Test Passed.\n");
+    return 0;
+}
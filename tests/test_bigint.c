@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "../bigint.h"
+#include "../real.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+/* A xorshift generator, so that runs are the same. */
+static CaLimb rand_limb(void)
+{
+    static CaLimb x = 88172645463325252ULL;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return x;
+}
+
+/* Sets a to n random limbs, negative if neg is set. */
+static void set_random(CaBigInt *a, CaSize n, int neg)
+{
+    char buf[32];
+
+    assert(ca_bigint_set_int(a, 0) == CA_ERROR_OK);
+    for (CaSize i = 0; i < n; i++) {
+        CaBigInt limb, shift;
+
+        ca_bigint_init(&limb);
+        ca_bigint_init(&shift);
+        snprintf(buf, sizeof(buf), "%llu", (unsigned long long) rand_limb());
+        assert(ca_bigint_parse(&limb, buf, strlen(buf)) == CA_ERROR_OK);
+        assert(ca_bigint_parse(&shift, "18446744073709551616", 20) ==
+               CA_ERROR_OK);
+        assert(ca_bigint_mul(a, a, &shift) == CA_ERROR_OK);
+        assert(ca_bigint_add(a, a, &limb) == CA_ERROR_OK);
+        ca_bigint_free(&limb);
+        ca_bigint_free(&shift);
+    }
+    a->neg = neg && a->size;
+}
+
+/* Checks that every algorithm multiplies a and b as schoolbook does. */
+static void check_mul(CaSize an, CaSize bn)
+{
+    CaBigInt a, b, expect, r;
+    CaBigIntMul algs[] = { CA_BIGINT_MUL_AUTO, CA_BIGINT_MUL_KARATSUBA,
+                           CA_BIGINT_MUL_TOOM3 };
+
+    ca_bigint_init(&a);
+    ca_bigint_init(&b);
+    ca_bigint_init(&expect);
+    ca_bigint_init(&r);
+    set_random(&a, an, an & 1);
+    set_random(&b, bn, 0);
+    assert(ca_bigint_mul_with(&expect, &a, &b, CA_BIGINT_MUL_SCHOOLBOOK) ==
+           CA_ERROR_OK);
+    assert(expect.size == an + bn || expect.size == an + bn - 1);
+    for (int i = 0; i < 3; i++) {
+        assert(ca_bigint_mul_with(&r, &a, &b, algs[i]) == CA_ERROR_OK);
+        assert(ca_bigint_cmp(&r, &expect) == 0);
+        assert(ca_bigint_mul_with(&r, &b, &a, algs[i]) == CA_ERROR_OK);
+        assert(ca_bigint_cmp(&r, &expect) == 0);
+    }
+    ca_bigint_free(&a);
+    ca_bigint_free(&b);
+    ca_bigint_free(&expect);
+    ca_bigint_free(&r);
+}
+
+/* Checks that q * b + r is a with |r| < |b| and r of the sign of a. */
+static void check_divmod(CaSize an, CaSize bn, int neg)
+{
+    CaBigInt a, b, q, r, t;
+
+    ca_bigint_init(&a);
+    ca_bigint_init(&b);
+    ca_bigint_init(&q);
+    ca_bigint_init(&r);
+    ca_bigint_init(&t);
+    set_random(&a, an, neg & 1);
+    set_random(&b, bn, neg & 2);
+    assert(ca_bigint_divmod(&q, &r, &a, &b) == CA_ERROR_OK);
+    assert(ca_bigint_mul(&t, &q, &b) == CA_ERROR_OK);
+    assert(ca_bigint_add(&t, &t, &r) == CA_ERROR_OK);
+    assert(ca_bigint_cmp(&t, &a) == 0);
+    assert(!r.size || r.neg == a.neg);
+    r.neg = b.neg;
+    assert(b.neg ? ca_bigint_cmp(&r, &b) > 0 : ca_bigint_cmp(&r, &b) < 0);
+    ca_bigint_free(&a);
+    ca_bigint_free(&b);
+    ca_bigint_free(&q);
+    ca_bigint_free(&r);
+    ca_bigint_free(&t);
+}
+
+/* Checks that s reads and writes back unchanged. */
+static void check_text(const char *s)
+{
+    CaBigInt a;
+    char buf[128];
+
+    ca_bigint_init(&a);
+    assert(ca_bigint_parse(&a, s, strlen(s)) == CA_ERROR_OK);
+    assert(ca_bigint_format(buf, sizeof(buf), &a) == (long) strlen(s));
+    assert(strcmp(buf, s) == 0);
+    ca_bigint_free(&a);
+}
+
+int main()
+{
+    CaBigInt a, b;
+    CaInt i;
+    char buf[8];
+
+    ca_bigint_init(&a);
+    ca_bigint_init(&b);
+
+    /* Every size around and past the thresholds, balanced or not. */
+    for (CaSize n = 1; n < 70; n++)
+        check_mul(n, n);
+    check_mul(CA_BIGINT_TOOM3_LIMBS, CA_BIGINT_TOOM3_LIMBS);
+    check_mul(CA_BIGINT_TOOM3_LIMBS + 1, CA_BIGINT_TOOM3_LIMBS + 1);
+    check_mul(600, 599);
+    check_mul(100, 3);
+    check_mul(250, 40);
+    check_mul(1000, 300);
+
+    for (CaSize n = 1; n < 12; n++) {
+        for (CaSize m = 1; m <= n; m++)
+            check_divmod(n, m, (int) (n + m));
+    }
+    check_divmod(300, 120, 3);
+    check_divmod(3, 7, 1);
+
+    check_text("0");
+    check_text("1");
+    check_text("-1");
+    check_text("9223372036854775807");
+    check_text("-9223372036854775808");
+    check_text("18446744073709551616");
+    check_text("10000000000000000000");
+    check_text("265252859812191058636308480000000");
+    check_text("-123456789012345678901234567890123456789012345678901234567");
+    assert(ca_bigint_parse(&a, "12a", 3) == CA_ERROR_NUM_INVALID);
+    assert(ca_bigint_parse(&a, "-", 1) == CA_ERROR_NUM_INVALID);
+
+    /* Truncated text, as snprintf does. */
+    assert(ca_bigint_parse(&a, "-1234567890", 11) == CA_ERROR_OK);
+    assert(ca_bigint_format(buf, sizeof(buf), &a) == 11);
+    assert(strcmp(buf, "-123456") == 0);
+
+    /* 30! */
+    assert(ca_bigint_set_int(&a, 1) == CA_ERROR_OK);
+    for (CaInt k = 2; k <= 30; k++) {
+        assert(ca_bigint_set_int(&b, k) == CA_ERROR_OK);
+        assert(ca_bigint_mul(&a, &a, &b) == CA_ERROR_OK);
+    }
+    assert(ca_bigint_format(NULL, 0, &a) == 33);
+    assert(ca_bigint_real(&a) ==
+           ca_real_strto("265252859812191058636308480000000"));
+    assert(!ca_bigint_get_int(&a, &i));
+    assert(ca_bigint_trunc(&a) == (CaInt) 0x865df5dd54000000ULL);
+
+    /* Powers by squaring, as repeated multiplication gives. */
+    for (uint64_t e = 0; e < 40; e += 3) {
+        set_random(&a, 3, (int) e);
+        assert(ca_bigint_set_int(&b, 1) == CA_ERROR_OK);
+        for (uint64_t k = 0; k < e; k++)
+            assert(ca_bigint_mul(&b, &b, &a) == CA_ERROR_OK);
+        assert(ca_bigint_pow(&a, &a, e) == CA_ERROR_OK);
+        assert(ca_bigint_cmp(&a, &b) == 0);
+    }
+    assert(ca_bigint_set_int(&a, -1) == CA_ERROR_OK);
+    assert(ca_bigint_pow(&b, &a, UINT64_MAX) == CA_ERROR_OK);
+    assert(ca_bigint_get_int(&b, &i) && i == -1);
+    assert(ca_bigint_set_int(&a, 2) == CA_ERROR_OK);
+    assert(ca_bigint_pow(&b, &a, CA_BIGINT_POW_BITS) == CA_ERROR_OK);
+    assert(b.size == CA_BIGINT_POW_BITS / 64 + 1);
+    assert(ca_bigint_pow(&b, &a, CA_BIGINT_POW_BITS + 1) ==
+           CA_ERROR_EVAL_OVERFLOW);
+
+    /* CaInt limits. */
+    assert(ca_bigint_set_int(&a, INT64_MIN) == CA_ERROR_OK);
+    assert(ca_bigint_get_int(&a, &i) && i == INT64_MIN);
+    assert(ca_bigint_real(&a) == -0x1p63);
+    assert(ca_bigint_set_int(&b, -1) == CA_ERROR_OK);
+    assert(ca_bigint_sub(&a, &a, &b) == CA_ERROR_OK);
+    assert(ca_bigint_get_int(&a, &i) && i == INT64_MIN + 1);
+    assert(ca_bigint_add(&a, &a, &b) == CA_ERROR_OK);
+    assert(ca_bigint_add(&a, &a, &b) == CA_ERROR_OK);
+    assert(!ca_bigint_get_int(&a, &i));
+    assert(ca_bigint_trunc(&a) == INT64_MAX);
+
+    /* Rounding to nearest, with the bits below the top 128 counted: this
+     * is just above halfway between two doubles. */
+    assert(ca_bigint_parse(&a, "1447401115466452603488441738507626402362084"
+                           "0424367673027135191783781976506369", 77) ==
+           CA_ERROR_OK);
+#ifdef CA_REAL_DOUBLE
+    assert(ca_bigint_real(&a) == 0x1.0000000000001p253);
+#endif
+    assert(ca_bigint_set_int(&b, 0) == CA_ERROR_OK);
+    assert(ca_bigint_divmod(&a, NULL, &a, &b) ==
+           CA_ERROR_EVAL_DIVISION_BY_ZERO);
+
+    ca_bigint_free(&a);
+    ca_bigint_free(&b);
+    printf("Test Passed.\n");
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../cache.h"
+#include "../interpreter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+static char key[CA_CACHE_KEY_SIZE + 1];
+
+static long make_key(const char *s, uint32_t *hash)
+{
+    return ca_cache_key(s, strlen(s), key, hash);
+}
+
+/* Adds s to the cache, with a single PUSH_CONST of value as its code. */
+static void insert(CaCache *cache, const char *s, CaReal value)
+{
+    CaCode code;
+    uint32_t hash, index;
+    long n = make_key(s, &hash);
+
+    ca_code_init(&code);
+    assert(ca_code_const(&code, value, &index) == CA_ERROR_OK);
+    assert(ca_code_emit(&code, CA_OPCODE_PUSH_CONST, index, 0) ==
+           CA_ERROR_OK);
+    assert(ca_cache_insert(cache, key, n, hash, &code) == CA_ERROR_OK);
+    assert(code.count == 0);
+    ca_code_free(&code);
+}
+
+/* Finds s in the cache, returning the value its code pushes, or -1. */
+static CaReal find(CaCache *cache, const char *s, uint32_t generation)
+{
+    const CaCode *code;
+    uint32_t hash;
+    long n = make_key(s, &hash);
+
+    code = ca_cache_find(cache, key, n, hash, generation);
+    return code ? code->consts[code->instrs[0].arg] : -1;
+}
+
+/* Runs the interpreter on input, and returns what it printed. */
+static char *interpret(const char *input, CaInterpreterOptions *opts)
+{
+    static char out[4096];
+    FILE *f_in = fmemopen((void *) input, strlen(input), "r");
+    FILE *f_out = fmemopen(out, sizeof(out), "w");
+
+    assert(f_in && f_out);
+    ca_start_interpreter(f_in, f_out, f_out, opts);
+    fclose(f_in);
+    fclose(f_out);
+    return out;
+}
+
+static CaReal one(const CaReal *args)
+{
+    (void) args;
+    return 1;
+}
+
+int main()
+{
+    CaInterpreterOptions opts = { 4, 0, 0 };
+    CaContext *c = ca_context_init();
+    CaCache cache;
+    uint32_t hash, hash2;
+    char *out;
+
+    /* Whitespace is normalized, apart from that in quotes. */
+    assert(make_key("  a \t+\r\n  b  ", &hash) == 5 && !strcmp(key, "a + b"));
+    assert(make_key("a + b", &hash2) == 5 && hash == hash2);
+    assert(make_key("a+b", &hash2) == 3 && hash != hash2);
+    assert(make_key(" 'a  b'  \"c\t d\" ", &hash) == 13 &&
+           !strcmp(key, "'a  b' \"c\t d\""));
+    assert(make_key(" \t ", &hash) == 0);
+    assert(ca_cache_key("a\0b", 3, key, &hash) == -1);
+
+    /* The least recently used line is dropped. */
+    assert(ca_cache_init(&cache, 3) == CA_ERROR_OK);
+    insert(&cache, "a", 1);
+    insert(&cache, "b", 2);
+    insert(&cache, "c", 3);
+    assert(find(&cache, "a", 0) == 1);
+    insert(&cache, "d", 4);
+    assert(find(&cache, "b", 0) == -1);
+    assert(find(&cache, " a ", 0) == 1);
+    assert(find(&cache, "c", 0) == 3);
+    assert(find(&cache, "d", 0) == 4);
+    insert(&cache, "e", 5);
+    assert(find(&cache, "a", 0) == -1);
+    assert(find(&cache, "e", 0) == 5);
+    assert(cache.hits == 5 && cache.misses == 2);
+
+    /* A new generation empties the cache. */
+    assert(find(&cache, "e", 1) == -1);
+    assert(cache.count == 0);
+    insert(&cache, "e", 5);
+    assert(find(&cache, "e", 1) == 5);
+    ca_cache_free(&cache);
+
+    /* Defining a builtin, or changing the optimisation level, starts a new
+     * generation. */
+    assert(c);
+    hash = ca_context_generation(c);
+    assert(ca_context_define(c, "one", one, 0) == CA_ERROR_OK);
+    assert(ca_context_generation(c) != hash);
+    hash = ca_context_generation(c);
+    c->optimize = CA_OPTIMIZE_NONE;
+    assert(ca_context_generation(c) != hash);
+    ca_context_free(c);
+
+    /* Repeated lines are compiled once, and give what they would without the
+     * cache. */
+    out = interpret("x = 1\nx = x * 2\nx = x * 2\n  x  =  x*2 \n"
+                    "y + 1\ny = 1\ny + 1\n1 +\n1 +\nx = x * 2\n", &opts);
+    assert(!strcmp(out, "1\n2\n4\n8\nKey not found in table: y\n1\n2\n"
+                        "Stack Underflow\nStack Underflow\n16\n"));
+    assert(opts.cache_hits == 3 && opts.cache_misses == 7);
+
+    opts.cache_size = 0;
+    assert(!strcmp(interpret("x = 1\nx = x * 2\nx = x * 2\nx = x * 2\n",
+                             &opts), "1\n2\n4\n8\n"));
+    assert(opts.cache_hits == 0);
+
+    /* A line cached while its variable held a CaReal stays exact once it
+     * holds a large CaInt. */
+    for (CaSize size = 0; size <= 64; size += 64) {
+        opts.cache_size = size;
+        out = interpret("x = 0.5\nx * 3\nx = 1152921504606846977\nx * 3\n"
+                        "x = 2.5\nx * 3\n", &opts);
+        assert(!strcmp(out, "0.5\n1.5\n1152921504606846977\n"
+                            "3458764513820540931\n2.5\n7.5\n"));
+    }
+    assert(opts.cache_hits == 2);
+
+    printf("Test Passed.\n");
+
+    return 0;
+}
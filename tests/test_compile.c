@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../eval.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+static CaError compile(CaContext *c, const char *s, CaCode *code)
+{
+    CaExpr e = { 0, s };
+
+    return ca_compile(c, &e, code);
+}
+
+static CaReal run(CaContext *c, const char *s, CaError expect)
+{
+    CaCode code;
+    CaReal r = 0;
+    CaError err;
+
+    ca_code_init(&code);
+    err = compile(c, s, &code);
+    if (err == CA_ERROR_OK)
+        err = ca_run(c, &code, &r);
+    assert(err == expect);
+    ca_code_free(&code);
+    return r;
+}
+
+/* Checks the listing of the code of an expression. */
+static void listing(CaContext *c, const char *s, const char *expect)
+{
+    CaCode code;
+    char *buf;
+    size_t size;
+    FILE *f = open_memstream(&buf, &size);
+
+    ca_code_init(&code);
+    assert(f && compile(c, s, &code) == CA_ERROR_OK);
+    ca_code_print(&code, &c->symbols, f);
+    fclose(f);
+    assert(!strcmp(buf, expect));
+    free(buf);
+    ca_code_free(&code);
+}
+
+static CaReal twice(const CaReal *args)
+{
+    return args[0] * 2;
+}
+
+static const char *same_as_eval[] = {
+    "1 + 2 * 3",
+    "(1 + 2) * 3",
+    "2 ** 3 ** 2",
+    "7 % 4 + 1 << 2",
+    "3 >= 2 == 1",
+    "p = q = 4",
+    "p += q * 2",
+    "p++ + p--",
+    "p",
+    "(p + 1) * (q - 1) / 2",
+    "0x10 >> 2 << 3",
+};
+
+static const char *same_as_opt[] = {
+    "a < b && c || d",
+    "a > b && c || d >= e",
+    "a == 2 || b < 3",
+    "a <= 1 && b",
+    "x = 1, x += 2, x -= 5, x = x + 0.5, x",
+    "a * b + c * 2 - d / e + f - 1",
+    "a + b * c + (d + e * (f + g))",
+    "3 - a, a / 4 + (b * 2 + 1) * (1 + 2 * g)",
+    "a ** 2 + (a + b) ** 3 - 2 ** 3 ** 2 + b ** 2.0",
+};
+
+int main()
+{
+    CaContext *c = ca_context_init(), *d = ca_context_init();
+    CaCode code;
+    CaReal r, s;
+
+    assert(c && d);
+
+    /* Compiled code gives what evaluating the expression does. */
+    for (size_t i = 0; i < sizeof(same_as_eval) / sizeof(same_as_eval[0]);
+         i++) {
+        CaExpr e = { 0, same_as_eval[i] };
+
+        assert(ca_eval(d, &e, &s) == CA_ERROR_OK);
+        assert(run(c, same_as_eval[i], CA_ERROR_OK) == s);
+    }
+
+    c->optimize = CA_OPTIMIZE_NONE;
+    listing(c, "x = x + 1",
+            "   0 LOAD x\n"
+            "   1 PUSH_CONST 1\n"
+            "   2 ADDITION\n"
+            "   3 STORE x\n"
+            "   4 END\n");
+    listing(c, "a && b",
+            "   0 LOAD a\n"
+            "   1 JUMP_FALSE_OR_POP 3\n"
+            "   2 LOAD b\n"
+            "   3 BOOL\n"
+            "   4 END\n");
+    listing(c, "y++, max(y, 2)",
+            "   0 LOAD y\n"
+            "   1 POST_INC y\n"
+            "   2 POP\n"
+            "   3 LOAD y\n"
+            "   4 PUSH_CONST 2\n"
+            "   5 EXT_CALL max 2\n"
+            "   6 END\n");
+
+
+    /* Superinstructions. Jumps are kept pointing at the same place. */
+    c->optimize = CA_OPTIMIZE_PEEPHOLE;
+    listing(c, "x = x + 1",
+            "   0 INC_VAR x 1\n"
+            "   1 END\n");
+    listing(c, "x -= 2",
+            "   0 INC_VAR x -2\n"
+            "   1 END\n");
+    listing(c, "a * b + c * 2 - d / e",
+            "   0 LOAD a\n"
+            "   1 MUL_VAR b\n"
+            "   2 LOAD c\n"
+            "   3 MUL_CONST 2\n"
+            "   4 ADDITION\n"
+            "   5 LOAD d\n"
+            "   6 DIV_VAR e\n"
+            "   7 SUBTRACTION\n"
+            "   8 END\n");
+    listing(c, "a + b * c + (d + e * (f + g))",
+            "   0 LOAD a\n"
+            "   1 LOAD b\n"
+            "   2 MUL_ADD_VAR c\n"
+            "   3 LOAD d\n"
+            "   4 LOAD e\n"
+            "   5 LOAD f\n"
+            "   6 ADD_VAR g\n"
+            "   7 MUL_ADD\n"
+            "   8 ADDITION\n"
+            "   9 END\n");
+    listing(c, "a < b && c || d, x = 1, 2",
+            "   0 LOAD a\n"
+            "   1 LOAD b\n"
+            "   2 LT_JUMP_FALSE 4\n"
+            "   3 LOAD c\n"
+            "   4 BOOL\n"
+            "   5 JUMP_TRUE_OR_POP 7\n"
+            "   6 LOAD d\n"
+            "   7 BOOL\n"
+            "   8 POP\n"
+            "   9 PUSH_CONST 1\n"
+            "  10 STORE_POP x\n"
+            "  11 PUSH_CONST 2\n"
+            "  12 END\n");
+
+    listing(c, "a ** 2 + (a - 1) ** 3 + a ** 4",
+            "   0 LOAD a\n"
+            "   1 SQUARE\n"
+            "   2 LOAD a\n"
+            "   3 SUB_CONST 1\n"
+            "   4 CUBE\n"
+            "   5 ADDITION\n"
+            "   6 LOAD a\n"
+            "   7 PUSH_CONST 4\n"
+            "   8 POWER\n"
+            "   9 ADDITION\n"
+            "  10 END\n");
+
+    /* Optimised code gives what the code as compiled does. */
+    assert(run(c, "a = 2, b = 3, c = 0, d = 5, e = 7, f = 1, g = 4",
+               CA_ERROR_OK) == 4);
+    for (size_t i = 0; i < sizeof(same_as_opt) / sizeof(same_as_opt[0]);
+         i++) {
+        c->optimize = CA_OPTIMIZE_NONE;
+        s = run(c, same_as_opt[i], CA_ERROR_OK);
+        c->optimize = CA_OPTIMIZE_PEEPHOLE;
+        assert(run(c, same_as_opt[i], CA_ERROR_OK) == s);
+    }
+    assert(run(c, "undefined = undefined + 1", CA_ERROR_HASH_NOTFOUND) == 0);
+    assert(run(c, "a * undefined + 1", CA_ERROR_HASH_NOTFOUND) == 0);
+    assert(run(c, "a + b * undefined", CA_ERROR_HASH_NOTFOUND) == 0);
+
+    /* Code is compiled once, and run any number of times. */
+    assert(run(c, "y = 1", CA_ERROR_OK) == 1);
+    ca_code_init(&code);
+    assert(compile(c, "y = y * 2 + 1", &code) == CA_ERROR_OK);
+    for (int i = 0; i < 10; i++)
+        assert(ca_run(c, &code, &r) == CA_ERROR_OK);
+    assert(r == 2047);
+    assert(run(c, "y", CA_ERROR_OK) == 2047);
+
+    /* Builtins are looked up when they are called. */
+    assert(compile(c, "twice(y) + 1", &code) == CA_ERROR_OK);
+    assert(ca_run(c, &code, &r) == CA_ERROR_EVAL_UNKNOWN_FUNCTION);
+    assert(c->error_size == 5 && !memcmp(c->error, "twice", 5));
+    assert(ca_context_define(c, "twice", twice, 1) == CA_ERROR_OK);
+    assert(ca_run(c, &code, &r) == CA_ERROR_OK && r == 4095);
+    ca_code_free(&code);
+
+    assert(run(c, "sqrt(16) + max(2, 3) + floor(2.5)", CA_ERROR_OK) == 9);
+    assert(run(c, "min(max(1, 2), abs(0 - 3))", CA_ERROR_OK) == 2);
+    assert(run(c, "max(1)", CA_ERROR_EVAL_ARGS) == 0);
+    assert(run(c, "max(1, 2, 3)", CA_ERROR_EVAL_ARGS) == 0);
+    assert(run(c, "max(1, )", CA_ERROR_EVAL) == 0);
+    assert(run(c, "max(, 1)", CA_ERROR_EVAL) == 0);
+
+    /* The right side of && and || is only run if it is needed. */
+    assert(run(c, "0 && undefined", CA_ERROR_OK) == 0);
+    assert(run(c, "2 || undefined", CA_ERROR_OK) == 1);
+    assert(run(c, "2 && 3", CA_ERROR_OK) == 1);
+    assert(run(c, "0 || 0.5", CA_ERROR_OK) == 1);
+    assert(run(c, "1 && 0 || 2 > 1", CA_ERROR_OK) == 1);
+    assert(run(c, "1 && undefined", CA_ERROR_HASH_NOTFOUND) == 0);
+
+    /* ',' outside a call drops the value on its left. */
+    assert(run(c, "m = 1, n = m + 1, m + n", CA_ERROR_OK) == 3);
+    assert(run(c, "(m, n) * 2", CA_ERROR_OK) == 4);
+
+    assert(run(c, "", CA_ERROR_EVAL_END) == 0);
+    assert(run(c, "1 = 2", CA_ERROR_EVAL_NOT_LVALUE) == 0);
+    assert(run(c, "(m) = 2", CA_ERROR_EVAL_NOT_LVALUE) == 0);
+    assert(run(c, "1 + m = 2", CA_ERROR_EVAL_NOT_LVALUE) == 0);
+    assert(run(c, "m =", CA_ERROR_STACK_EMPTY) == 0);
+    assert(run(c, "()", CA_ERROR_STACK_EMPTY) == 0);
+    assert(run(c, "1 (2)", CA_ERROR_EVAL) == 0);
+    assert(run(c, "(1", CA_ERROR_EVAL_SYNTAX_NO_CLOSING_PARANTHESIS) == 0);
+    assert(run(c, "max(1, 2", CA_ERROR_EVAL_SYNTAX_NO_CLOSING_PARANTHESIS) ==
+           0);
+
+    ca_context_free(c);
+    ca_context_free(d);
+
+    printf("Test Passed.\n");
+
+    return 0;
+}
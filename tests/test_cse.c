@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "../eval.h"
+#include "../cse.h"
+#include "../jit.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+static CaReal run(CaContext *c, const char *s, CaError expect)
+{
+    CaExpr e = { 0, s };
+    CaReal r = 0;
+
+    assert(ca_eval(c, &e, &r) == expect);
+    return r;
+}
+
+/* Checks the listing of an expression after common subexpression
+ * elimination alone, and the number of operators it removes. */
+static void listing(CaContext *c, const char *s, CaSize removed,
+                    const char *expect)
+{
+    CaExpr e = { 0, s };
+    CaCode code;
+    CaSize n;
+    char *buf;
+    size_t size;
+    FILE *f = open_memstream(&buf, &size);
+
+    c->optimize = CA_OPTIMIZE_NONE;
+    ca_code_init(&code);
+    assert(f && ca_compile(c, &e, &code) == CA_ERROR_OK);
+    assert(ca_code_cse(&code, &n) == CA_ERROR_OK && n == removed);
+    ca_code_print(&code, &c->symbols, f);
+    fclose(f);
+    assert(!strcmp(buf, expect));
+    free(buf);
+    ca_code_free(&code);
+    c->optimize = CA_OPTIMIZE_DEFAULT;
+}
+
+static const char *same_values[] = {
+    "(a * b + c) / (a * b - c) + (a * b) ** 2",
+    "a * b + b * a",
+    "a * b + (a = 1) * b + a * b",
+    "a * b + (a += 1) * b + a * b",
+    "(a + b) * (a + b) + a++ * (a + b)",
+    "x = a * b, y = a * b, x + y",
+    "a * b > 1 && a * b || a * b",
+    "sqrt(a * b) + sqrt(a * b) + a * b",
+    "(a < b) + (a < b) + (b < a) + (b > a)",
+    "a - b + (b - a) + (a - b)",
+    "1.5 * a + 1.5 * a + 3 * a / 2",
+};
+
+int main()
+{
+    CaContext *c = ca_context_init(), *d = ca_context_init();
+    const char *init = "a = 2, b = 3, c = 0.5, p = 1.5, q = 2.25";
+    CaExpr e;
+    CaCode code;
+    CaReal r;
+
+    assert(c && d);
+    d->optimize = CA_OPTIMIZE_PEEPHOLE;
+    run(c, init, CA_ERROR_OK);
+    run(d, init, CA_ERROR_OK);
+
+    listing(c, "(a * b + c) / (a * b - c) + (a * b) ** 2", 2,
+            "   0 LOAD a\n"
+            "   1 LOAD b\n"
+            "   2 MULTIPLICATION\n"
+            "   3 SAVE_TEMP 0\n"
+            "   4 LOAD c\n"
+            "   5 ADDITION\n"
+            "   6 LOAD_TEMP 0\n"
+            "   7 LOAD c\n"
+            "   8 SUBTRACTION\n"
+            "   9 DIVISION\n"
+            "  10 LOAD_TEMP 0\n"
+            "  11 PUSH_CONST 2\n"
+            "  12 POWER\n"
+            "  13 ADDITION\n"
+            "  14 END\n");
+
+    /* The largest repeated subexpression is the one removed. */
+    listing(c, "(a + b) * c + (b + a) * c", 2,
+            "   0 LOAD a\n"
+            "   1 LOAD b\n"
+            "   2 ADDITION\n"
+            "   3 LOAD c\n"
+            "   4 MULTIPLICATION\n"
+            "   5 SAVE_TEMP 0\n"
+            "   6 LOAD_TEMP 0\n"
+            "   7 ADDITION\n"
+            "   8 END\n");
+
+    /* A variable set in between is read again, and assignments are kept. */
+    listing(c, "a * b + (a = 2) * b", 0,
+            "   0 LOAD a\n"
+            "   1 LOAD b\n"
+            "   2 MULTIPLICATION\n"
+            "   3 PUSH_CONST 2\n"
+            "   4 STORE a\n"
+            "   5 LOAD b\n"
+            "   6 MULTIPLICATION\n"
+            "   7 ADDITION\n"
+            "   8 END\n");
+    listing(c, "(a = a * b) + (a = a * b)", 0,
+            "   0 LOAD a\n"
+            "   1 LOAD b\n"
+            "   2 MULTIPLICATION\n"
+            "   3 STORE a\n"
+            "   4 LOAD a\n"
+            "   5 LOAD b\n"
+            "   6 MULTIPLICATION\n"
+            "   7 STORE a\n"
+            "   8 ADDITION\n"
+            "   9 END\n");
+
+    /* Builtins are always called, and may change any variable. */
+    listing(c, "sqrt(a) + sqrt(a)", 0,
+            "   0 LOAD a\n"
+            "   1 EXT_CALL sqrt 1\n"
+            "   2 LOAD a\n"
+            "   3 EXT_CALL sqrt 1\n"
+            "   4 ADDITION\n"
+            "   5 END\n");
+
+    /* Code a jump may skip computes nothing for the code after it. */
+    listing(c, "a * b && a * b", 0,
+            "   0 LOAD a\n"
+            "   1 LOAD b\n"
+            "   2 MULTIPLICATION\n"
+            "   3 JUMP_FALSE_OR_POP 7\n"
+            "   4 LOAD a\n"
+            "   5 LOAD b\n"
+            "   6 MULTIPLICATION\n"
+            "   7 BOOL\n"
+            "   8 END\n");
+
+    /* Code gives the same values, and sets the same variables, with common
+     * subexpression elimination as without. */
+    for (size_t n = 0; n < sizeof(same_values) / sizeof(same_values[0]);
+         n++) {
+        r = run(c, same_values[n], CA_ERROR_OK);
+        assert(r == run(d, same_values[n], CA_ERROR_OK));
+        assert(run(c, "a", CA_ERROR_OK) == run(d, "a", CA_ERROR_OK));
+    }
+    assert(c->cse_removed > 0 && d->cse_removed == 0);
+
+    /* Unset variables are reported as before. */
+    run(c, "unset * a + unset * a", CA_ERROR_HASH_NOTFOUND);
+    assert(c->error_size == 5 && !memcmp(c->error, "unset", 5));
+
+    /* Temporaries are kept in native code. */
+    c->flags |= CA_CONTEXT_JIT;
+    e = (CaExpr) { 0, "(p * q + c) * (p * q - c) - p * q" };
+    ca_code_init(&code);
+    assert(ca_compile(c, &e, &code) == CA_ERROR_OK && code.ntemps == 1);
+    assert(!CA_JIT_X86_64 || code.jit);
+    assert(ca_run(c, &code, &r) == CA_ERROR_OK);
+    assert(r == run(d, e.buf, CA_ERROR_OK));
+    ca_code_free(&code);
+
+    ca_context_free(c);
+    ca_context_free(d);
+
+    printf("Test Passed.\n");
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "../eval.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/* Brackets nested in the deep expression. */
+#define DEPTH 5000
+
+static CaReal eval(CaContext *c, const char *s, CaError expect)
+{
+    CaExpr e = { 0, s };
+    CaReal r = 0;
+
+    assert(ca_eval(c, &e, &r) == expect);
+    return r;
+}
+
+int main()
+{
+    CaContext *c = ca_context_init();
+    CaToken *tokens;
+    char buf[8192], *p, *deep;
+
+    assert(c);
+    assert(eval(c, "1 + 2 * 3", CA_ERROR_OK) == 7);
+    assert(eval(c, "(1 + 2) * 3", CA_ERROR_OK) == 9);
+    assert(eval(c, "10 - 4 - 3", CA_ERROR_OK) == 3);
+    assert(eval(c, "2 ** 3 ** 2", CA_ERROR_OK) == 512);
+    assert(eval(c, "7 % 4 + 1 << 2", CA_ERROR_OK) == 16);
+    assert(eval(c, "1.5 * 4", CA_ERROR_OK) == 6);
+    assert(eval(c, "3 >= 2 == 1", CA_ERROR_OK) == 1);
+    assert(eval(c, "0xFF + 0b101 + 1_000", CA_ERROR_OK) == 1260);
+    assert(eval(c, "2.5e2 - 1e+2 + 5E-1", CA_ERROR_OK) == 150.5);
+    assert(eval(c, "1e3-1", CA_ERROR_OK) == 999);
+
+    /* Shifts and bitwise operators truncate values to CaInt, with NaN as 0
+     * and values beyond CaInt at its limits. */
+    assert(eval(c, "1e300 & 1", CA_ERROR_OK) == 1);
+    assert(eval(c, "(0 / 0) << 1", CA_ERROR_OK) == 0);
+    assert(eval(c, "(0 - 1e300) | 0", CA_ERROR_OK) == -0x1p63);
+    assert(eval(c, "1 << 1e300", CA_ERROR_OK) == -0x1p63);
+
+    assert(eval(c, "x = y = 4", CA_ERROR_OK) == 4);
+    assert(eval(c, "x += y * 2", CA_ERROR_OK) == 12);
+    assert(eval(c, "x++", CA_ERROR_OK) == 12);
+    assert(eval(c, "x", CA_ERROR_OK) == 13);
+    assert(eval(c, "a_name_longer_than_thirty_one_bytes = x", CA_ERROR_OK) ==
+           13);
+    assert(eval(c, "a_name_longer_than_thirty_one_bytes + 1", CA_ERROR_OK) ==
+           14);
+
+    eval(c, "", CA_ERROR_EVAL_END);
+    eval(c, "(1 + 2", CA_ERROR_EVAL_SYNTAX_NO_CLOSING_PARANTHESIS);
+    eval(c, "1 + 2)", CA_ERROR_EVAL_SYNTAX_NO_OPENING_PARANTHESIS);
+    eval(c, "undefined + 1", CA_ERROR_HASH_NOTFOUND);
+    assert(c->error_size == 9 && !memcmp(c->error, "undefined", 9));
+    eval(c, "1 = 2", CA_ERROR_EVAL_NOT_LVALUE);
+    eval(c, "1 2", CA_ERROR_EVAL);
+    eval(c, "1 ! 2", CA_ERROR_EVAL_UNKNOWN_OPERATOR);
+    eval(c, "0b102", CA_ERROR_NUM_INVALID);
+    eval(c, "1..5", CA_ERROR_NUM_INVALID);
+    eval(c, "9223372036854775808", CA_ERROR_NUM_RANGE);
+
+    /* The token list is reused once it is large enough. */
+    eval(c, "a = 1 + 2 + 3 + 4 + 5 + 6 + 7 + 8 + 9", CA_ERROR_OK);
+    tokens = c->tokens.tokens;
+    for (int i = 0; i < 100; ++i)
+        eval(c, "a = a + 1", CA_ERROR_OK);
+    assert(c->tokens.tokens == tokens);
+    assert(eval(c, "a", CA_ERROR_OK) == 145);
+
+    /* Names first read by an expression get slots before it runs, however
+     * many there are. */
+    p = buf;
+    for (char x = 'a'; x <= 'z'; x++)
+        for (char y = 'a'; y <= 'z'; y++)
+            p += sprintf(p, "s%c%c = %d, ", x, y, (x - 'a') * 26 + y - 'a');
+    strcpy(p, "szz + sba");
+    assert(eval(c, buf, CA_ERROR_OK) == 675 + 26);
+    assert(c->nvars >= c->symbols.count);
+    eval(c, "szz + sbz + unseen", CA_ERROR_HASH_NOTFOUND);
+
+    /* The stacks grow with the nesting of an expression. */
+    p = deep = malloc(DEPTH * 8 + 2);
+    assert(deep);
+    for (int i = 0; i < DEPTH; i++)
+        p += sprintf(p, "(1.5 + ");
+    p += sprintf(p, "1");
+    for (int i = 0; i < DEPTH; i++)
+        *p++ = ')';
+    *p = '\0';
+    assert(eval(c, deep, CA_ERROR_OK) == DEPTH * 1.5 + 1);
+    free(deep);
+
+    ca_context_free(c);
+    printf("Test Passed.\n");
+
+    return 0;
+}
@@ -1,5 +1,4 @@
 #include "../calcium.h"
-#include "../debug.h"
 
 #include <stdio.h>
 #include <assert.h>
@@ -7,13 +6,13 @@
 int main()
 {
     int g = 3;
-    ca_hash k = ca_hash_init();
-    ca_hash_node *p;
+    CaHash k = ca_hash_init();
+    CaHashNode *p;
     assert(k);
-    assert(ca_hash_set(k, "aaa", 3, CA_TYPE_INT, &g) == CA_ERROR_HASH_NEW);
-    assert(ca_hash_get(k, "aaa", 3, &p) == CA_ERROR_OK);
+    assert(ca_hash_set(k, (CaHashKey) "aaa", 3, CA_TYPE_INT, &g) == CA_ERROR_HASH_NEW);
+    assert(ca_hash_get(k, (CaHashKey) "aaa", 3, &p) == CA_ERROR_OK);
     assert((*((int *) p->data)) == 3);
-    assert(ca_hash_get(k, "bbb", 3, &p) == CA_ERROR_HASH_NOTFOUND);
+    assert(ca_hash_get(k, (CaHashKey) "bbb", 3, &p) == CA_ERROR_HASH_NOTFOUND);
     ca_hash_print(k);
     ca_hash_free(k);
     printf("Test Passed.\n");
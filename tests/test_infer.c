@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "../eval.h"
+#include "../infer.h"
+#include "../std.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+static CaError compile(CaContext *c, const char *s, CaCode *code)
+{
+    CaExpr e = { 0, s };
+
+    return ca_compile(c, &e, code);
+}
+
+static CaReal run(CaContext *c, const char *s, CaError expect)
+{
+    CaCode code;
+    CaReal r = 0;
+    CaError err;
+
+    ca_code_init(&code);
+    err = compile(c, s, &code);
+    if (err == CA_ERROR_OK)
+        err = ca_run(c, &code, &r);
+    assert(err == expect);
+    ca_code_free(&code);
+    return r;
+}
+
+/* Runs an expression that gives an integer, and returns it. */
+static CaInt run_int(CaContext *c, const char *s)
+{
+    CaCode code;
+    CaVar v;
+    CaInt i;
+
+    ca_code_init(&code);
+    assert(compile(c, s, &code) == CA_ERROR_OK &&
+           ca_run_var(c, &code, &v) == CA_ERROR_OK);
+    assert(ca_std_get_int(&v, &i));
+    ca_std_release(&v);
+    ca_code_free(&code);
+    return i;
+}
+
+/* Checks the listing of the typed code of an expression, or that it has
+ * none if expect is NULL. */
+static void listing(CaContext *c, const char *s, const char *expect)
+{
+    CaCode code;
+    char *buf;
+    size_t size;
+    FILE *f = open_memstream(&buf, &size);
+
+    ca_code_init(&code);
+    assert(f && compile(c, s, &code) == CA_ERROR_OK);
+    assert(!code.typed == !expect);
+    if (code.typed)
+        ca_code_print(&code.typed->code, &c->symbols, f);
+    fclose(f);
+    assert(!expect || !strcmp(buf, expect));
+    free(buf);
+    ca_code_free(&code);
+}
+
+static CaType type(CaContext *c, const char *name)
+{
+    CaSymbol id;
+
+    assert(ca_symbols_intern(&c->symbols, name, strlen(name), &id) ==
+           CA_ERROR_OK);
+    return id < c->nvars ? ca_var_type(&c->vars[id]) : CA_TYPE_UNKNOWN;
+}
+
+static const char *same_as_real[] = {
+    "i + j * k - 1",
+    "i * j + k * i",
+    "(i + j) * (i - j) % 7 + (i << 2 >> 1) - k / j",
+    "i << 3 | j & 6 ^ k",
+    "x << 1 | 1",
+    "i < j && j <= k || k == i",
+    "i > j || x",
+    "i && j, i > 1 && j < 10",
+    "i ** 2 + j ** 0.5",
+    "i ** 3 - j ** 2 * k + i ** j - (i - j) ** 3",
+    "max(i, j) + sqrt(i * j)",
+    "i / j + x",
+    "n = i, n += 2, n -= j, n *= 3, n",
+    "n++ + n-- - n",
+    "n = n * k + i",
+    "n = i + x, n * 2",
+    "k % 3 + i % x",
+    "(x * 1e300 & i) + ((x - x) / 0 << j) + (0 - 1e300 | k)",
+};
+
+int main()
+{
+    CaContext *c = ca_context_init(), *d = ca_context_init();
+    const char *init = "i = 3, j = 5, k = 0 - 7, x = 2.5";
+    CaCode code;
+    CaReal r;
+
+    assert(c && d);
+    assert(c->optimize == CA_OPTIMIZE_TYPES);
+    d->optimize = CA_OPTIMIZE_PEEPHOLE;
+    assert(run(c, init, CA_ERROR_OK) == 2.5);
+    assert(run(d, init, CA_ERROR_OK) == 2.5);
+
+    /* Integer literals make integer variables. */
+    assert(type(c, "i") == CA_TYPE_INT && type(c, "x") == CA_TYPE_REAL);
+    assert(type(d, "i") == CA_TYPE_REAL);
+
+    listing(c, "i = i + 1",
+            "   0 I_INC_VAR i 1\n"
+            "   1 END\n");
+    listing(c, "m = i << 4 | j",
+            "   0 I_LOAD i\n"
+            "   1 I_PUSH_CONST 4\n"
+            "   2 I_LSHIFT\n"
+            "   3 I_LOAD j\n"
+            "   4 I_B_OR\n"
+            "   5 I_STORE m\n"
+            "   6 END\n");
+
+    /* Values are made CaReal only where they have to be. */
+    listing(c, "i * j + x",
+            "   0 I_LOAD i\n"
+            "   1 I_MUL_VAR j\n"
+            "   2 TO_REAL 1\n"
+            "   3 ADD_VAR x\n"
+            "   4 END\n");
+    listing(c, "x < i + 1",
+            "   0 LOAD x\n"
+            "   1 I_LOAD i\n"
+            "   2 I_ADD_CONST 1\n"
+            "   3 TO_REAL 1\n"
+            "   4 LT\n"
+            "   5 END\n");
+    listing(c, "i % j + x % 2",
+            "   0 I_LOAD i\n"
+            "   1 I_LOAD j\n"
+            "   2 I_REMAINDER\n"
+            "   3 LOAD x\n"
+            "   4 PUSH_CONST 2\n"
+            "   5 REMAINDER\n"
+            "   6 TO_REAL 2\n"
+            "   7 ADDITION\n"
+            "   8 END\n");
+    listing(c, "i / 2 + j",
+            "   0 I_LOAD i\n"
+            "   1 TO_REAL 1\n"
+            "   2 DIV_CONST 2\n"
+            "   3 ADD_VAR j\n"
+            "   4 END\n");
+    listing(c, "x & i",
+            "   0 LOAD x\n"
+            "   1 I_LOAD i\n"
+            "   2 TO_INT 2\n"
+            "   3 I_B_AND\n"
+            "   4 END\n");
+    listing(c, "i < j && j",
+            "   0 I_LOAD i\n"
+            "   1 I_LOAD j\n"
+            "   2 I_LT_JUMP_FALSE 4\n"
+            "   3 I_LOAD j\n"
+            "   4 I_BOOL\n"
+            "   5 END\n");
+
+    listing(c, "i ** j + k ** 2",
+            "   0 I_LOAD i\n"
+            "   1 I_LOAD j\n"
+            "   2 I_POWER\n"
+            "   3 I_LOAD k\n"
+            "   4 I_SQUARE\n"
+            "   5 I_ADDITION\n"
+            "   6 END\n");
+
+    /* Code with no integer arithmetic, but for integer constants made
+     * CaReal, is left as it is, as is code with a variable that is not set,
+     * or one that is set to a CaInt or a CaReal depending on a condition. */
+    listing(c, "x * 2.5", NULL);
+    listing(c, "2 * x + 1", NULL);
+    listing(c, "x * 2 + 1", NULL);
+    listing(c, "(1 < x) + 2 ** 0.5", NULL);
+    listing(c, "i + unset", NULL);
+    listing(c, "i > 0 && (i = x)", NULL);
+    listing(c, "i > 0 && (i = j)",
+            "   0 I_LOAD i\n"
+            "   1 I_PUSH_CONST 0\n"
+            "   2 I_GT_JUMP_FALSE 5\n"
+            "   3 I_LOAD j\n"
+            "   4 I_STORE i\n"
+            "   5 I_BOOL\n"
+            "   6 END\n");
+
+    /* Typed code gives the same values as code as compiled. */
+    for (size_t n = 0; n < sizeof(same_as_real) / sizeof(same_as_real[0]);
+         n++) {
+        r = run(c, same_as_real[n], CA_ERROR_OK);
+        assert(r == run(d, same_as_real[n], CA_ERROR_OK));
+    }
+    assert(run(c, "n", CA_ERROR_OK) == run(d, "n", CA_ERROR_OK));
+
+    /* Code is run as compiled when a variable changes type. */
+    ca_code_init(&code);
+    assert(compile(c, "i * 3", &code) == CA_ERROR_OK && code.typed);
+    assert(ca_code_typed(c, &code));
+    assert(ca_run(c, &code, &r) == CA_ERROR_OK && r == 9);
+    assert(run(c, "i = 1.5", CA_ERROR_OK) == 1.5);
+    assert(!ca_code_typed(c, &code));
+    assert(ca_run(c, &code, &r) == CA_ERROR_OK && r == 4.5);
+    assert(run(c, "i = 4", CA_ERROR_OK) == 4);
+    assert(ca_run(c, &code, &r) == CA_ERROR_OK && r == 12);
+    ca_code_free(&code);
+
+    /* Counters stay CaInt. */
+    assert(compile(c, "i += 1", &code) == CA_ERROR_OK && code.typed);
+    for (int n = 0; n < 1000; n++)
+        assert(ca_run(c, &code, &r) == CA_ERROR_OK);
+    assert(r == 1004 && type(c, "i") == CA_TYPE_INT);
+    ca_code_free(&code);
+
+    /* CaInt arithmetic that overflows is run again on exact integers, with
+     * the variables set before the overflow put back first. */
+    assert(run(c, "w = 4611686018427387904", CA_ERROR_OK) == 0x1p62L);
+    assert(run(c, "w * 4", CA_ERROR_OK) == 0x1p64L);
+    assert(run(c, "i = 0, v = w * 4, i += 1", CA_ERROR_OK) == 1);
+    assert(type(c, "v") == CA_TYPE_BIGINT && type(c, "i") == CA_TYPE_INT);
+    assert(run(c, "v - w * 4", CA_ERROR_OK) == 0);
+    assert(run(c, "v = v - w * 3", CA_ERROR_OK) == 0x1p62L);
+    /* Unless it is too large for a packed CaVar (see types.h). */
+    assert(type(c, "v") == (ca_var_int_fits((CaInt) 1 << 62) ?
+                            CA_TYPE_INT : CA_TYPE_BIGINT));
+    assert(run(d, "w = 4611686018427387904, w * 4", CA_ERROR_OK) == 0x1p64L);
+
+    /* So are CaInt powers that overflow, and those with a negative exponent,
+     * which give a CaReal. */
+    assert(run(c, "b = 3, p = b ** 40, p - b ** 39 * b", CA_ERROR_OK) == 0);
+    assert(type(c, "p") == CA_TYPE_BIGINT);
+    assert(run(c, "p = b ** 39 - (b ** 13) ** 3", CA_ERROR_OK) == 0);
+    assert(type(c, "p") == CA_TYPE_INT);
+    assert(run(c, "p = (b - 1) ** (b - 5)", CA_ERROR_OK) == 0.25);
+    assert(type(c, "p") == CA_TYPE_REAL);
+
+    /* Integers are given as they are, even where a CaReal cannot hold them. */
+    assert(run_int(c, "2 ** 53 + 1") == ((CaInt) 1 << 53) + 1);
+    assert(run_int(c, "2 ** 50") == (CaInt) 1 << 50);
+    assert(run_int(c, "9007199254740993") == 9007199254740993);
+    assert(run_int(c, "3 ** 35") == 50031545098999707);
+    assert(run_int(c, "0 - 9223372036854775807 - 1") == INT64_MIN);
+    assert(run_int(c, "v = 9007199254740993, v - 9007199254740992") == 1);
+    assert(run_int(c, "3 ** 35 % 10") == 7);
+    assert(run_int(c, "w = 50031545098999707, w % 10") == 7);
+    assert(run_int(c, "(0 - 9223372036854775807 - 1) % (0 - 1)") == 0);
+    assert(run_int(c, "k % 3") == -1);
+    /* A remainder of integers by 0 is an error, and of a CaReal a NaN. */
+    run(c, "i % 0", CA_ERROR_EVAL_DIVISION_BY_ZERO);
+    r = run(c, "i % 0.0", CA_ERROR_OK);
+    assert(r != r);
+    listing(c, "9007199254740993 - 1",
+            "   0 I_PUSH_CONST 9007199254740993\n"
+            "   1 I_SUB_CONST 1\n"
+            "   2 END\n");
+
+    ca_context_free(c);
+    ca_context_free(d);
+
+    printf("Test Passed.\n");
+
+    return 0;
+}
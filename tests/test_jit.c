@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "../eval.h"
+#include "../interpreter.h"
+#include "../jit.h"
+#include "../std.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+/* Code that is compiled to native code where it can be, and run both ways. */
+static const char *jit_exprs[] = {
+    "1 + 2 * 3",
+    "(1 + 2) * 3 - 4 / 8",
+    "a * b + c * 2 - d / e",
+    "a + b * c + (d + e * (f + g))",
+    "x = x + 1",
+    "x -= 2.5",
+    "x++ + x--",
+    "y = a * x + b, y * y",
+    "z = a < b, z + (a <= a) + (b > a) * 2 + (a >= b) * 4",
+    "(a == a) + (a == b) * 2",
+    "(nan < 1) + (nan <= 1) + (nan > 1) + (nan >= 1) + (nan == nan)",
+    "nan + 1",
+    "1 / 0 - 1 / 0",
+    "((((((a + b) * c) - d) / e) + f) * g)",
+    "a + (b + (c + (d + (e + (f + (g + 1))))))",
+    "0.1 + 0.2 - 0.3",
+    "b / e * e - b + f / 3",
+    "h = 1e308, h * 10 / 10",
+    "h * b - h * b + (h + h - h)",
+    "l = 1e-308, l / 1e10 * 1e10",
+    "l * l / l + 4.9e-324 / 2 * 2",
+    "m = 0 - h * 2, m / h, m * 0",
+};
+
+/* Code that is run on the VM. */
+static const char *vm_exprs[] = {
+    "a ** 0.5",
+    "a % 3",
+    "a << 2",
+    "a && b",
+    "sqrt(a)",
+    "a + (b + (c + (d + (e + (f + (g + (x + (a + 1))))))))",
+};
+
+/* Compiles an expression, checks whether it has native code, and runs it. */
+static CaError run_jit(CaContext *c, const char *s, int native, CaVar *v)
+{
+    CaExpr e = { 0, s };
+    CaCode code;
+    CaError err;
+
+    ca_code_init(&code);
+    assert(ca_compile(c, &e, &code) == CA_ERROR_OK && !!code.jit == native);
+    err = ca_run_var(c, &code, v);
+    ca_code_free(&code);
+    return err;
+}
+
+/* Runs an expression on the VM and as native code, and checks that both give
+ * the same result and set the same variables. */
+static void same(CaContext *vm, CaContext *jit, const char *s, int native)
+{
+    CaExpr e1 = { 0, s }, e2 = { 0, s };
+    CaCode c1, c2;
+    CaReal r1, r2;
+
+    ca_code_init(&c1);
+    ca_code_init(&c2);
+    assert(ca_compile(vm, &e1, &c1) == CA_ERROR_OK && !c1.jit);
+    assert(ca_compile(jit, &e2, &c2) == CA_ERROR_OK);
+    assert(!!c2.jit == native);
+
+    for (int i = 0; i < 3; i++) {
+        assert(ca_run(vm, &c1, &r1) == CA_ERROR_OK);
+        assert(ca_run(jit, &c2, &r2) == CA_ERROR_OK);
+        assert(r1 == r2 || (isnan(r1) && isnan(r2)));
+    }
+
+    assert(vm->nvars == jit->nvars);
+    for (CaSize i = 0; i < vm->nvars; i++) {
+        assert(ca_var_type(&vm->vars[i]) == ca_var_type(&jit->vars[i]));
+        if (ca_var_is(&vm->vars[i], CA_TYPE_REAL))
+            assert(ca_var_real(&vm->vars[i]) == ca_var_real(&jit->vars[i]) ||
+                   (isnan(ca_var_real(&vm->vars[i])) &&
+                    isnan(ca_var_real(&jit->vars[i]))));
+    }
+    ca_code_free(&c1);
+    ca_code_free(&c2);
+}
+
+/* Runs the interpreter on input, with or without native code, and returns
+ * what it printed. */
+static char *interpret(const char *input, int native)
+{
+    static char out[2][1024];
+    CaInterpreterOptions opts = { .cache_size = 64, .jit = native };
+    FILE *f_in = fmemopen((void *) input, strlen(input), "r");
+    FILE *f_out = fmemopen(out[native], sizeof(out[native]), "w");
+
+    assert(f_in && f_out);
+    ca_start_interpreter(f_in, f_out, f_out, &opts);
+    fclose(f_in);
+    fclose(f_out);
+    return out[native];
+}
+
+/* Checks a comparison on every ordering of two values, NaN included. */
+static void compare(CaContext *c, CaOpcode op)
+{
+    static const CaReal values[] = { 1, 2, NAN };
+    CaReal r1, r2;
+    uint32_t k1, k2;
+    CaCode code;
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            ca_code_init(&code);
+            assert(ca_code_const(&code, values[i], &k1) == CA_ERROR_OK &&
+                   ca_code_const(&code, values[j], &k2) == CA_ERROR_OK &&
+                   ca_code_emit(&code, CA_OPCODE_PUSH_CONST, k1, 0) ==
+                   CA_ERROR_OK &&
+                   ca_code_emit(&code, CA_OPCODE_PUSH_CONST, k2, 0) ==
+                   CA_ERROR_OK &&
+                   ca_code_emit(&code, op, 0, 0) == CA_ERROR_OK &&
+                   ca_code_emit(&code, CA_OPCODE_END, 0, 0) == CA_ERROR_OK);
+            code.depth = 2;
+            assert(ca_run(c, &code, &r1) == CA_ERROR_OK);
+            assert(ca_jit_compile(&code) == CA_ERROR_OK && code.jit);
+            assert(ca_run(c, &code, &r2) == CA_ERROR_OK && r1 == r2);
+            ca_code_free(&code);
+        }
+    }
+}
+
+int main()
+{
+    CaContext *vm = ca_context_init(), *jit = ca_context_init();
+    const char *init = "a = 2, b = 3.5, c = 0 - 1, d = 5, e = 7, f = 0.25, "
+                       "g = 4, x = 10, nan = 0 / 0";
+    CaExpr e = { 0, NULL };
+    const char *input;
+    char buf[2048], *p;
+    CaCode code;
+    CaVar v;
+    CaReal r;
+
+    /* Typed code would set variables to CaInt values, which native code
+     * does not read. */
+    assert(vm && jit);
+    jit->flags |= CA_CONTEXT_JIT;
+    vm->optimize = jit->optimize = CA_OPTIMIZE_PEEPHOLE;
+    same(vm, jit, init, CA_JIT_X86_64);
+
+    if (!CA_JIT_X86_64) {
+        ca_code_init(&code);
+        assert(ca_jit_compile(&code) == CA_ERROR_JIT_UNSUPPORTED);
+        printf("Test Passed.\n");
+        return 0;
+    }
+
+    for (size_t i = 0; i < sizeof(jit_exprs) / sizeof(jit_exprs[0]); i++)
+        same(vm, jit, jit_exprs[i], 1);
+    for (size_t i = 0; i < sizeof(vm_exprs) / sizeof(vm_exprs[0]); i++)
+        same(vm, jit, vm_exprs[i], 0);
+
+    /* Small integer powers are multiplications, once optimised. */
+    same(vm, jit, "a ** 2 + b ** 3 - (a + f) ** 2", 1);
+
+    for (CaOpcode op = CA_OPCODE_LT; op <= CA_OPCODE_NEQ; op++)
+        compare(jit, op);
+
+    /* Both optimisation levels compile to native code. */
+    vm->optimize = jit->optimize = CA_OPTIMIZE_NONE;
+    for (size_t i = 0; i < sizeof(jit_exprs) / sizeof(jit_exprs[0]); i++)
+        same(vm, jit, jit_exprs[i], 1);
+    vm->optimize = jit->optimize = CA_OPTIMIZE_PEEPHOLE;
+
+    /* Native code reading a variable that is not set falls back to the VM,
+     * which reports the error, and is run once the variable is set. */
+    ca_code_init(&code);
+    e.buf = "later * 2";
+    assert(ca_compile(jit, &e, &code) == CA_ERROR_OK && code.jit);
+    assert(ca_run(jit, &code, &r) == CA_ERROR_HASH_NOTFOUND);
+    assert(jit->error_size == 5 && !memcmp(jit->error, "later", 5));
+    e = (CaExpr) { 0, "later = 21" };
+    assert(ca_eval(jit, &e, &r) == CA_ERROR_OK);
+    assert(ca_run(jit, &code, &r) == CA_ERROR_OK && r == 42);
+
+    /* So does native code storing to a variable the context has no room
+     * for yet. */
+    p = buf;
+    for (int i = 0; i < 200; i++)
+        p += sprintf(p, "q%c%c = ", 'a' + i / 26, 'a' + i % 26);
+    strcpy(p, "1");
+    e = (CaExpr) { 0, buf };
+    assert(ca_compile(jit, &e, &code) == CA_ERROR_OK && code.jit);
+    assert(jit->nvars < code.jit->nvars && !ca_jit_run(jit, &code, &r));
+    assert(ca_run(jit, &code, &r) == CA_ERROR_OK && r == 1);
+    assert(ca_jit_run(jit, &code, &r) && r == 1);
+
+    /* Emptying the code frees its native code. */
+    ca_code_reset(&code);
+    assert(!code.jit);
+    ca_code_free(&code);
+
+    /* Code with typed code is left to it, which keeps integers exact. */
+    jit->optimize = CA_OPTIMIZE_TYPES;
+    assert(run_jit(jit, "n = 3", 0, &v) == CA_ERROR_OK &&
+           ca_var_is(&v, CA_TYPE_INT) && ca_var_int(&v) == 3);
+    assert(run_jit(jit, "n ** 40", 0, &v) == CA_ERROR_OK &&
+           ca_var_is(&v, CA_TYPE_BIGINT));
+    ca_std_release(&v);
+    assert(run_jit(jit, "4611686018427387904 * 4", 0, &v) == CA_ERROR_OK &&
+           ca_var_is(&v, CA_TYPE_BIGINT));
+    ca_std_release(&v);
+    assert(run_jit(jit, "b * f + e", 1, &v) == CA_ERROR_OK &&
+           ca_var_is(&v, CA_TYPE_REAL) && ca_var_real(&v) == 7.875);
+
+    /* Integer constants made CaReal are no integer arithmetic, whichever
+     * side of an operator they are on. */
+    assert(run_jit(jit, "2 * b + 1", 1, &v) == CA_ERROR_OK &&
+           ca_var_is(&v, CA_TYPE_REAL) && ca_var_real(&v) == 8);
+    assert(run_jit(jit, "b * 2 + 1", 1, &v) == CA_ERROR_OK &&
+           ca_var_is(&v, CA_TYPE_REAL) && ca_var_real(&v) == 8);
+    assert(run_jit(jit, "(1 < b) + 2 / b", 1, &v) == CA_ERROR_OK &&
+           ca_var_is(&v, CA_TYPE_REAL));
+
+    ca_context_free(vm);
+    ca_context_free(jit);
+
+    /* Lines print the same with -j, those that overflow or underflow on
+     * the way included. */
+    input = "y = 1e308\ny * 10 / 10\ny * 10 - y * 10\nz = 1e-308\n"
+            "z / 1e10 * 1e10\nz * z / z\n2 * y + 1\n(y * y < y) + 0.5\n";
+    assert(!strcmp(interpret(input, 0), interpret(input, 1)));
+#ifdef CA_REAL_DOUBLE
+    assert(!strncmp(interpret(input, 1), "1e+308\ninf\n", 11));
+#endif
+
+    printf("Test Passed.\n");
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "../kernel.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+/* Covers every whole vector and tail length of every implementation. */
+#define N 75
+
+static const CaInt ints[] = {
+    0, 1, -1, 2, 3, 7, -8, 63, 64, 65, 100, -100, 12345, INT64_MAX,
+    INT64_MIN, INT64_MIN + 1, (CaInt) 1 << 40, -((CaInt) 1 << 33)
+};
+
+static const double reals[] = {
+    0, -0.0, 1, -1, 0.5, 2.75, -3.25, 7, 64, 100.5, -1e6, 1e12, 1e-300, 42
+};
+
+#define COUNT(_a) (sizeof(_a) / sizeof((_a)[0]))
+
+static void check_impl(const CaKernels *k, const CaKernels *s)
+{
+    CaInt ia[N], ib[N], ir[N], is[N];
+    double da[N], db[N], dr[N], ds[N];
+
+    for (int i = 0; i < N; i++) {
+        ia[i] = ints[i % COUNT(ints)];
+        ib[i] = ints[(i * 7 + 3) % COUNT(ints)];
+        da[i] = reals[i % COUNT(reals)];
+        db[i] = reals[(i * 5 + 2) % COUNT(reals)];
+    }
+
+    for (int op = 0; op < CA_KERNEL_OP_COUNT; op++) {
+        for (int n = 0; n <= N; n += n < 20 ? 1 : 11) {
+            k->i_vv[op](ir, ia, ib, n);
+            s->i_vv[op](is, ia, ib, n);
+            assert(!memcmp(ir, is, n * sizeof(CaInt)));
+            k->i_vs[op](ir, ia, ib[n / 2], n);
+            s->i_vs[op](is, ia, ib[n / 2], n);
+            assert(!memcmp(ir, is, n * sizeof(CaInt)));
+            k->i_sv[op](ir, ia[n / 3], ib, n);
+            s->i_sv[op](is, ia[n / 3], ib, n);
+            assert(!memcmp(ir, is, n * sizeof(CaInt)));
+
+            k->d_vv[op](dr, da, db, n);
+            s->d_vv[op](ds, da, db, n);
+            assert(!memcmp(dr, ds, n * sizeof(double)));
+            k->d_vs[op](dr, da, db[n / 2], n);
+            s->d_vs[op](ds, da, db[n / 2], n);
+            assert(!memcmp(dr, ds, n * sizeof(double)));
+            k->d_sv[op](dr, da[n / 3], db, n);
+            s->d_sv[op](ds, da[n / 3], db, n);
+            assert(!memcmp(dr, ds, n * sizeof(double)));
+        }
+    }
+
+    /* The result may be written over an operand. */
+    memcpy(ir, ia, sizeof(ia));
+    k->i_vv[CA_KERNEL_MUL](ir, ir, ib, N);
+    s->i_vv[CA_KERNEL_MUL](is, ia, ib, N);
+    assert(!memcmp(ir, is, sizeof(ir)));
+}
+
+int main()
+{
+    const CaKernels *s = ca_kernels(CA_KERNEL_IMPL_SCALAR);
+    CaInt a[4] = { 7, INT64_MIN, INT64_MAX, -7 }, b[4] = { 0, -1, 2, 66 };
+    CaInt r[4];
+    double x[3] = { 1, 0, -2.5 }, y[3] = { 0, 0, 4 }, d[3];
+
+    assert(s && ca_kernel_supported(CA_KERNEL_IMPL_AUTO));
+    assert(ca_kernels(CA_KERNEL_IMPL_AUTO));
+
+    s->i_vv[CA_KERNEL_DIV](r, a, b, 4);
+    assert(r[0] == 0 && r[1] == INT64_MIN && r[2] == INT64_MAX / 2 &&
+           r[3] == -7 / 66);
+    s->i_vv[CA_KERNEL_REM](r, a, b, 4);
+    assert(r[0] == 0 && r[1] == 0 && r[2] == 1 && r[3] == -7);
+    s->i_vv[CA_KERNEL_ADD](r, a, b, 4);
+    assert(r[1] == INT64_MAX && r[2] == INT64_MIN + 1);
+    s->i_vs[CA_KERNEL_LSHIFT](r, a, 65, 4);
+    assert(r[0] == 14 && r[1] == 0 && r[3] == -14);
+    s->i_sv[CA_KERNEL_LT](r, 0, a, 4);
+    assert(r[0] == 1 && r[1] == 0 && r[2] == 1 && r[3] == 0);
+    s->i_vv[CA_KERNEL_AND](r, a, b, 4);
+    assert(r[0] == 0 && r[1] == 1 && r[3] == 1);
+    s->d_vv[CA_KERNEL_OR](d, x, y, 3);
+    assert(d[0] == 1 && d[1] == 0 && d[2] == 1);
+    s->d_vs[CA_KERNEL_B_OR](d, x, 4.5, 3);
+    assert(d[0] == 5 && d[1] == 4 && d[2] == -2);
+
+    for (int i = CA_KERNEL_IMPL_SCALAR; i <= CA_KERNEL_IMPL_AVX512; i++) {
+        if (!ca_kernel_supported(i)) {
+            assert(!ca_kernels(i));
+            continue;
+        }
+        check_impl(ca_kernels(i), s);
+    }
+
+    printf("Test Passed.\n");
+    return 0;
+}
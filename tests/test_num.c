@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../num.h"
+#include "../real.h"
+#include "../token.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#define RANDOM_COUNT 200000
+
+static CaInt parse_int(const char *s, CaError expect)
+{
+    CaInt v = 0;
+
+    assert(ca_parse_int(s, strlen(s), &v) == expect);
+    return v;
+}
+
+/* Checks that s parses to the same double as strtod, bit for bit. */
+static void check_double(const char *s)
+{
+    char buf[128];
+    double v, ref;
+    size_t n = 0;
+
+    for (const char *c = s; *c; c++)
+        if (*c != '_')
+            buf[n++] = *c;
+    buf[n] = '\0';
+    ref = strtod(buf, NULL);
+
+    assert(ca_parse_double(s, strlen(s), &v) == CA_ERROR_OK);
+    if (memcmp(&v, &ref, sizeof(v))) {
+        printf("%s: %.17g != %.17g\n", s, v, ref);
+        assert(0);
+    }
+}
+
+static void check_real(const char *s)
+{
+    CaReal v, ref = ca_real_strto(s);
+
+    assert(ca_parse_real(s, strlen(s), &v) == CA_ERROR_OK);
+    assert(v == ref);
+}
+
+/* Checks that the tokeniser splits s into the tokens in expect. */
+static void check_tokens(const char *s, const char **expect)
+{
+    CaExpr e = { 0, s };
+    const CaOperator *oper;
+    CaGuess guess;
+    CaSize start, size;
+
+    for (; *expect; expect++) {
+        assert(ca_next_token(&e, &guess, &start, &size, &oper) ==
+               CA_ERROR_OK);
+        assert(size == strlen(*expect));
+        assert(!memcmp(s + start, *expect, size));
+    }
+    assert(ca_next_token(&e, &guess, &start, &size, &oper) ==
+           CA_ERROR_EVAL_END);
+}
+
+static uint64_t rand64(void)
+{
+    return (uint64_t) rand() << 62 ^ (uint64_t) rand() << 31 ^ rand();
+}
+
+int main()
+{
+    static const char *doubles[] = {
+        "0", "0.0", "1", "1.", "0.1", "0.3", "3.14159", "1e23", "8.41e21",
+        "9007199254740993", "9007199254740992.5", "2.2250738585072014e-308",
+        "2.2250738585072011e-308", "4.9e-324", "2e-324", "1e-400",
+        "1.7976931348623157e308", "1.7976931348623159e308", "1e309",
+        "123456789012345678901234567890", "0.000000000000000000001234",
+        "7.3177701707893310e+15", "1_000.000_1", "1e1_0", "5e-1",
+        "1448997445238699", "179769313486231580793728971405301e276",
+        "2.4703282292062328e-324", "2.4703282292062327e-324",
+        "0.500000000000000166533453693773481063544750213623046875",
+    };
+    static const char *reals[] = {
+        "0.1", "1e27", "1e-27", "123456789.0123456789", "1e4000",
+        "3.36210314311209350626e-4932",
+    };
+    char buf[64];
+    CaVar var;
+
+    /* Integers */
+    assert(parse_int("0", CA_ERROR_OK) == 0);
+    assert(parse_int("1234567890", CA_ERROR_OK) == 1234567890);
+    assert(parse_int("1_000_000", CA_ERROR_OK) == 1000000);
+    assert(parse_int("0xff", CA_ERROR_OK) == 255);
+    assert(parse_int("0XdEaD_bEeF", CA_ERROR_OK) == 0xdeadbeef);
+    assert(parse_int("0b1010_1010", CA_ERROR_OK) == 0xAA);
+    assert(parse_int("9223372036854775807", CA_ERROR_OK) == INT64_MAX);
+    assert(parse_int("0xFFFFFFFFFFFFFFFF", CA_ERROR_OK) == -1);
+    parse_int("9223372036854775808", CA_ERROR_NUM_RANGE);
+    parse_int("0x1_0000_0000_0000_0000", CA_ERROR_NUM_RANGE);
+    parse_int("", CA_ERROR_NUM_INVALID);
+    parse_int("0x", CA_ERROR_NUM_INVALID);
+    parse_int("0b102", CA_ERROR_NUM_INVALID);
+    parse_int("1__0", CA_ERROR_NUM_INVALID);
+    parse_int("_1", CA_ERROR_NUM_INVALID);
+    parse_int("1_", CA_ERROR_NUM_INVALID);
+    parse_int("0x_1", CA_ERROR_NUM_INVALID);
+    parse_int("12a", CA_ERROR_NUM_INVALID);
+
+    /* Only the given size is read. */
+    assert(ca_parse_int("12345", 3, &var.value.i) == CA_ERROR_OK);
+    assert(var.value.i == 123);
+
+    /* Reals */
+    for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); ++i)
+        check_double(doubles[i]);
+    for (size_t i = 0; i < sizeof(reals) / sizeof(reals[0]); ++i)
+        check_real(reals[i]);
+
+    assert(ca_parse_double("1.5e", 4, &(double) { 0 }) == CA_ERROR_NUM_INVALID);
+    assert(ca_parse_double(".", 1, &(double) { 0 }) == CA_ERROR_NUM_INVALID);
+    assert(ca_parse_double("1..5", 4, &(double) { 0 }) == CA_ERROR_NUM_INVALID);
+    assert(ca_parse_double("1_.5", 4, &(double) { 0 }) == CA_ERROR_NUM_INVALID);
+    assert(ca_parse_double("1e5x", 4, &(double) { 0 }) == CA_ERROR_NUM_INVALID);
+
+    assert(ca_parse_number("42", 2, &var) == CA_ERROR_OK);
+    assert(ca_var_is(&var, CA_TYPE_INT) && ca_var_int(&var) == 42);
+    assert(ca_parse_number("4e2", 3, &var) == CA_ERROR_OK);
+    assert(ca_var_is(&var, CA_TYPE_REAL) && ca_var_real(&var) == 400);
+    assert(ca_parse_number("0xE", 3, &var) == CA_ERROR_OK);
+    assert(ca_var_is(&var, CA_TYPE_INT) && ca_var_int(&var) == 14);
+
+    srand(1);
+    for (int i = 0; i < RANDOM_COUNT; ++i) {
+        double d;
+        uint64_t bits = rand64();
+
+        memcpy(&d, &bits, sizeof(d));
+        if (!isfinite(d))
+            continue;
+        snprintf(buf, sizeof(buf), "%.*g", 1 + rand() % 19, fabs(d));
+        check_double(buf);
+        snprintf(buf, sizeof(buf), "%llu.%llue%d",
+                 (unsigned long long) (rand64() % 100000000000ULL),
+                 (unsigned long long) (rand64() % 1000000000ULL),
+                 rand() % 700 - 350);
+        check_double(buf);
+    }
+
+    /* Tokens */
+    check_tokens("1e5 1e+5 1.5e-5 0x1F 0b11 1_000",
+                 (const char *[]) { "1e5", "1e+5", "1.5e-5", "0x1F", "0b11",
+                                    "1_000", NULL });
+    check_tokens("1e+x 2_y 0xg 3e",
+                 (const char *[]) { "1", "e", "+", "x", "2", "_y", "0", "xg",
+                                    "3", "e", NULL });
+    check_tokens("1e5+2 0x1e-1 1.\r\n",
+                 (const char *[]) { "1e5", "+", "2", "0x1e", "-", "1", "1.",
+                                    NULL });
+
+    printf("Test Passed.\n");
+
+    return 0;
+}
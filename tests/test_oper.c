@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../token.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+/* oper_list is static, so entries are compared by value. */
+static int same(const CaOperator *a, const CaOperator *b)
+{
+    return !strcmp(a->symbol, b->symbol) && a->id == b->id &&
+           a->prec == b->prec;
+}
+
+/* Reads the first token of s, which must be an operator of size len. */
+static const CaOperator *read_oper(const char *s, CaSize len)
+{
+    CaExpr e = { 0, s };
+    const CaOperator *oper = NULL;
+    CaGuess guess;
+    CaSize start, size;
+
+    assert(ca_next_token(&e, &guess, &start, &size, &oper) == CA_ERROR_OK);
+    assert(guess == CA_GUESS_OPERATOR);
+    assert(start == 0 && size == len);
+    return oper;
+}
+
+int main()
+{
+    char buf[16];
+    const CaOperator *oper;
+
+    /* Every operator is read as itself, alone and before other tokens. */
+    for (size_t i = 1; i < CA_OPER_COUNT; ++i) {
+        const char *s = oper_list[i].symbol;
+
+        assert(same(read_oper(s, strlen(s)), &oper_list[i]));
+        snprintf(buf, sizeof(buf), "%sa", s);
+        assert(same(read_oper(buf, strlen(s)), &oper_list[i]));
+        snprintf(buf, sizeof(buf), "%s 1", s);
+        assert(same(read_oper(buf, strlen(s)), &oper_list[i]));
+    }
+
+    /* The longest operator wins. */
+    assert(read_oper("**=", 2)->id == OPER_ID_POWER);
+    assert(read_oper("<<=", 2)->id == OPER_ID_LSHIFT);
+    assert(read_oper("===", 2)->id == OPER_ID_EQ);
+    assert(read_oper("+-", 1)->id == OPER_ID_ADDITION);
+
+    /* Symbols that begin no operator are unknown operators. */
+    for (const char *s = "!@#$~[]{}:;?.\\"; *s; s++) {
+        buf[0] = *s;
+        buf[1] = '\0';
+        oper = read_oper(buf, 1);
+        assert(same(oper, &oper_list[0]));
+        assert(oper->prec == PRECEDENCE_UNKNOWN);
+    }
+
+    /* Skipped bytes end an operator. */
+    assert(read_oper("+\x01=", 1)->id == OPER_ID_ADDITION);
+
+    printf("Test Passed.\n");
+
+    return 0;
+}
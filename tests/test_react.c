@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "../eval.h"
+#include "../interpreter.h"
+#include "../react.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static CaReal eval(CaContext *c, const char *s, CaError expect)
+{
+    CaExpr e = { 0, s };
+    CaReal r = 0;
+
+    assert(ca_eval(c, &e, &r) == expect);
+    return r;
+}
+
+/* Evaluates s, and checks how many definitions it runs again. */
+static CaReal update(CaContext *c, const char *s, CaSize recomputed)
+{
+    CaSize before = ca_react_recomputed(c);
+    CaReal r = eval(c, s, CA_ERROR_OK);
+
+    assert(ca_react_recomputed(c) - before == recomputed);
+    return r;
+}
+
+/* Runs the interpreter in reactive mode on input, and returns what it
+ * printed. */
+static char *interpret(const char *input, CaSize cache_size,
+                       CaSize recomputed)
+{
+    static char out[4096];
+    CaInterpreterOptions opts = { .cache_size = cache_size, .reactive = 1 };
+    FILE *f_in = fmemopen((void *) input, strlen(input), "r");
+    FILE *f_out = fmemopen(out, sizeof(out), "w");
+
+    assert(f_in && f_out);
+    ca_start_interpreter(f_in, f_out, f_out, &opts);
+    fclose(f_in);
+    fclose(f_out);
+    assert(opts.recomputed == recomputed);
+    return out;
+}
+
+int main()
+{
+    CaContext *c = ca_context_init();
+    CaCode code;
+    CaExpr e;
+    CaReal r;
+    char buf[64], *s;
+
+    assert(c && !c->reactive);
+    eval(c, "a = 1, b = a * 2", CA_ERROR_OK);
+    eval(c, "a = 5", CA_ERROR_OK);
+    assert(eval(c, "b", CA_ERROR_OK) == 2 && ca_react_recomputed(c) == 0);
+
+    assert(ca_context_reactive(c, 1) == CA_ERROR_OK && c->reactive);
+    update(c, "a = 1", 0);
+    update(c, "b = a * 2", 0);
+    update(c, "k = b + 1", 0);
+    update(c, "d = a + k", 0);
+    update(c, "e = 5", 0);
+    update(c, "f = sqrt(e * 20)", 0);
+
+    /* Only what depends on a variable is run again, each once. */
+    update(c, "a = 10", 3);
+    assert(eval(c, "b", CA_ERROR_OK) == 20);
+    assert(eval(c, "k", CA_ERROR_OK) == 21);
+    assert(eval(c, "d", CA_ERROR_OK) == 31);
+    update(c, "e = 45", 1);
+    assert(eval(c, "f", CA_ERROR_OK) == 30);
+    update(c, "d + f", 0);
+
+    /* An expression reading what it sets is not a definition. */
+    update(c, "a = a + 1", 3);
+    assert(eval(c, "d", CA_ERROR_OK) == 34);
+    update(c, "a += 1", 3);
+    update(c, "a = 1", 3);
+    assert(eval(c, "d", CA_ERROR_OK) == 4);
+
+    /* Nor is one that would be defined from itself. */
+    update(c, "a = d * 2", 3);
+    assert(eval(c, "a", CA_ERROR_OK) == 8);
+    assert(eval(c, "d", CA_ERROR_OK) == 25);
+    update(c, "k = 0", 1);
+    assert(eval(c, "a", CA_ERROR_OK) == 8 && eval(c, "d", CA_ERROR_OK) == 8);
+
+    /* Setting a variable replaces its definition. */
+    update(c, "b = a * 3", 0);
+    update(c, "a = 2", 2);
+    assert(eval(c, "b", CA_ERROR_OK) == 6 && eval(c, "k", CA_ERROR_OK) == 0);
+
+    /* An expression setting many variables defines them all, until any of
+     * them is set by another. */
+    update(c, "x = a + 1, y = a + 2", 0);
+    update(c, "z = x * y", 0);
+    update(c, "a = 3", 4);
+    assert(eval(c, "z", CA_ERROR_OK) == 20);
+    update(c, "x = 0", 1);
+    assert(eval(c, "z", CA_ERROR_OK) == 0);
+    update(c, "a = 4", 2);
+    assert(eval(c, "y", CA_ERROR_OK) == 5 && eval(c, "z", CA_ERROR_OK) == 0);
+
+    /* A long chain, run in order. */
+    update(c, "qaa = 1", 0);
+    for (char x = 'a'; x <= 'j'; x++) {
+        for (char y = 'a'; y <= 'z'; y++) {
+            if (x == 'a' && y == 'a')
+                continue;
+            snprintf(buf, sizeof(buf), "q%c%c = q%c%c + 1", x, y,
+                     y == 'a' ? x - 1 : x, y == 'a' ? 'z' : y - 1);
+            update(c, buf, 0);
+        }
+    }
+    update(c, "qaa = 100", 259);
+    assert(eval(c, "qjz", CA_ERROR_OK) == 359);
+    update(c, "qje = 0", 21);
+    assert(eval(c, "qjz", CA_ERROR_OK) == 21);
+
+    /* Compiled code updates the definitions as well. */
+    e = (CaExpr) { 0, "qaa = qaa * 2" };
+    ca_code_init(&code);
+    assert(ca_compile(c, &e, &code) == CA_ERROR_OK);
+    assert(ca_run(c, &code, &r) == CA_ERROR_OK && r == 200);
+    assert(eval(c, "qjd", CA_ERROR_OK) == 437);
+    ca_code_free(&code);
+
+    /* Turning reactive mode off forgets the definitions. */
+    assert(ca_context_reactive(c, 0) == CA_ERROR_OK && !c->reactive);
+    eval(c, "a = 0", CA_ERROR_OK);
+    assert(eval(c, "b", CA_ERROR_OK) == 12);
+
+    ca_context_free(c);
+
+    /* Lines update the definitions whether they are cached or streamed, and
+     * however long they are. */
+    for (CaSize size = 0; size <= 64; size += 64) {
+        assert(!strcmp(interpret("a = 1\nb = a + 1\na = 10\nb", size, 1),
+                       "1\n2\n10\n11\n"));
+        s = malloc(32 + 1000 * 6);
+        assert(s);
+        strcpy(s, "a = 1\nb = a + 1\nb = a");
+        for (int i = 0; i < 1000; i++)
+            strcat(s, " + 0.5");
+        strcat(s, "\na = 10\nb");
+        assert(!strcmp(interpret(s, size, 1), "1\n2\n501\n10\n510\n"));
+        free(s);
+    }
+
+    printf("Test Passed.\n");
+
+    return 0;
+}
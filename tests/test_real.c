@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "../eval.h"
+#include "../num.h"
+#include "../real.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+/* Values that need every digit of the type to be read back. */
+static const char *literals[] = {
+    "0.1",
+    "0.3333333333333333333333333333333333333333",
+    "3.1415926535897932384626433832795028841971",
+    "2.7182818284590452353602874713526624977572e-300",
+    "1.7976931348623157e308",
+    "123456789012345678901234567890",
+};
+
+/* Evaluates s, and checks that the result is exactly expect. */
+static void check_eval(CaContext *c, const char *s, CaReal expect)
+{
+    CaExpr e = { 0, s };
+    CaReal r;
+
+    assert(ca_eval(c, &e, &r) == CA_ERROR_OK);
+    assert(r == expect);
+}
+
+int main()
+{
+    CaContext *c = ca_context_init();
+    volatile CaReal one = 1, ulp = 1;
+    char buf[64];
+    CaReal x, y;
+
+    assert(c);
+
+    /* The significand has exactly CA_REAL_MANT_DIG bits. */
+    for (int i = 1; i < CA_REAL_MANT_DIG; i++)
+        ulp /= 2;
+    assert(one + ulp != one);
+    assert(one + ulp / 2 == one);
+
+    /* Literals are read correctly rounded, and printing CA_REAL_DIG + 3
+     * digits reads back the same value. */
+    for (size_t i = 0; i < sizeof(literals) / sizeof(literals[0]); i++) {
+        assert(ca_parse_real(literals[i], strlen(literals[i]), &x) ==
+               CA_ERROR_OK);
+        assert(x == ca_real_strto(literals[i]));
+        assert(ca_real_format(buf, sizeof(buf), x, CA_REAL_DIG + 3) <
+               (int) sizeof(buf));
+        assert(ca_parse_real(buf, strlen(buf), &y) == CA_ERROR_OK);
+        assert(x == y);
+    }
+
+    /* CA_REAL_DIG digits are printed without noise. */
+    ca_real_format(buf, sizeof(buf), 0.5, 6);
+    assert(!strcmp(buf, "0.5"));
+    x = 1;
+    ca_real_format(buf, sizeof(buf), x / 10, CA_REAL_DIG);
+    assert(!strcmp(buf, "0.1"));
+    ca_real_format(buf, sizeof(buf), -1e100, 3);
+    assert(!strcmp(buf, "-1e+100"));
+
+    /* Expressions are evaluated in the type. */
+    x = 1;
+    check_eval(c, "1.0 / 3", x / 3);
+    check_eval(c, "0.1 + 0.2", ca_real_strto("0.1") + ca_real_strto("0.2"));
+    check_eval(c, "sqrt(2.0)", ca_real_sqrt(x * 2));
+    check_eval(c, "7.5 % 2", ca_real_fmod(x * 7.5, 2));
+
+    ca_context_free(c);
+
+    printf("Test Passed.\n");
+
+    return 0;
+}
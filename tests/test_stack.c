@@ -1,24 +1,47 @@
 #include "../calcium.h"
 #include <stdio.h>
-#include <sys/time.h>
+#include <stdint.h>
 #include <assert.h>
 #define TESTSIZE 100
 
 int main()
 {
-    CaStack *a = Ca_StackInit(TESTSIZE);
-    CaReal dummy;
-    
-    for(size_t i = 0; i < 100; ++i)
-        ca_stack_push(a, i);
+    CaStack *a = ca_stack_init(TESTSIZE);
+    CaVar dummy;
 
-    assert(ca_stack_push(a, 1) == CA_ERROR_STACK_FULL);
+    assert(a);
+    assert((uintptr_t) a->data % CA_STACK_ALIGN == 0);
+
+    /* The stack grows past its initial size, keeping its values. */
+    for(CaInt i = 0; i < 10 * TESTSIZE; ++i) {
+        ca_var_set_int(&dummy, i);
+        assert(ca_stack_push(a, dummy) == CA_ERROR_OK);
+    }
+    assert(a->size >= 10 * TESTSIZE);
+    assert((uintptr_t) a->data % CA_STACK_ALIGN == 0);
+
+    assert(ca_var_int(ca_stack_peek(a, 0)) == 10 * TESTSIZE - 1);
+    assert(ca_var_int(ca_stack_peek(a, 10 * TESTSIZE - 1)) == 0);
+    assert(!ca_stack_peek(a, 10 * TESTSIZE));
+    assert(ca_var_int(ca_stack_peek_unchecked(a, 1)) == 10 * TESTSIZE - 2);
+
+    for(CaInt i = 10 * TESTSIZE - 1; i >= 0; --i) {
+        assert(ca_stack_pop(a, &dummy) == CA_ERROR_OK);
+        assert(ca_var_is(&dummy, CA_TYPE_INT) && ca_var_int(&dummy) == i);
+    }
 
-    for(size_t i = 0; i < 100; ++i)
-        ca_stack_pop(a, &dummy);
-    
     assert(ca_stack_pop(a, &dummy) == CA_ERROR_STACK_EMPTY);
 
+    /* Reserved room is used without checks. */
+    assert(ca_stack_reserve(a, 20 * TESTSIZE) == CA_ERROR_OK);
+    assert(a->size >= 20 * TESTSIZE);
+    ca_var_set_real(&dummy, 0.25);
+    ca_stack_push_unchecked(a, dummy);
+    dummy = ca_stack_pop_unchecked(a);
+    assert(ca_var_is(&dummy, CA_TYPE_REAL) &&
+           ca_var_real(&dummy) == (CaReal) 0.25);
+    assert(a->top == 0);
+
     ca_stack_free(a);
     printf("Test Passed.\n");
 
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "../std.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#define num_int(_i)  set_int(&(CaVar) CA_VAR_UNKNOWN, (_i))
+#define num_real(_f) set_real(&(CaVar) CA_VAR_UNKNOWN, (_f))
+
+static CaVar *set_int(CaVar *v, CaInt i)
+{
+    assert(ca_std_set_int(v, i) == CA_ERROR_OK);
+    return v;
+}
+
+static CaVar *set_real(CaVar *v, CaReal f)
+{
+    ca_var_set_real(v, f);
+    return v;
+}
+
+static const CaVar *op(CaOperID oper, const CaVar *a, const CaVar *b)
+{
+    static CaVar r;
+
+    assert(ca_std_binary_op(oper, &r, a, b) == CA_ERROR_OK);
+    return &r;
+}
+
+/* A CaInt too large for a packed CaVar is a CaBigInt (see types.h). */
+static void is_int(const CaVar *r, CaInt i)
+{
+    CaInt v;
+
+    if (!ca_var_int_fits(i)) {
+        assert(ca_var_is(r, CA_TYPE_BIGINT) &&
+               ca_bigint_get_int(ca_var_bigint(r), &v) && v == i);
+        return;
+    }
+    assert(ca_var_is(r, CA_TYPE_INT) && ca_var_int(r) == i);
+}
+
+static void is_real(const CaVar *r, CaReal f)
+{
+    assert(ca_var_is(r, CA_TYPE_REAL) && ca_var_real(r) == f);
+}
+
+int main()
+{
+    CaVar a = *num_int(7), b = *num_int(2), x = *num_real(2.5), s, r;
+    CaVar n = CA_VAR_UNKNOWN;
+    const CaVar *big;
+    CaType types[] = { CA_TYPE_INT, CA_TYPE_REAL };
+
+    /* CaInt stays CaInt, unless a CaReal is involved. */
+    is_int(op(OPER_ID_ADDITION, &a, &b), 9);
+    is_int(op(OPER_ID_SUBTRACTION, &b, &a), -5);
+    is_int(op(OPER_ID_MULTIPLICATION, &a, &b), 14);
+    is_int(op(OPER_ID_REMAINDER, num_int(-7), &b), -1);
+    is_real(op(OPER_ID_ADDITION, &a, &x), 9.5);
+    is_real(op(OPER_ID_SUBTRACTION, &x, &a), -4.5);
+    is_real(op(OPER_ID_MULTIPLICATION, &x, &x), 6.25);
+    is_real(op(OPER_ID_REMAINDER, &a, &x), 2);
+
+    /* Division always gives a CaReal, and powers do for a negative
+     * exponent. */
+    is_real(op(OPER_ID_DIVISION, &a, &b), 3.5);
+    is_int(op(OPER_ID_POWER, &a, &b), 49);
+    is_int(op(OPER_ID_POWER, &b, num_int(0)), 1);
+    is_int(op(OPER_ID_POWER, num_int(-3), num_int(39)), -4052555153018976267);
+    is_real(op(OPER_ID_POWER, &b, num_int(-1)), 0.5);
+    is_real(op(OPER_ID_POWER, &x, &b), 6.25);
+    is_real(op(OPER_ID_POWER, num_int(4), num_real(0.5)), 2);
+
+    /* Shifts and bitwise operators truncate CaReal. */
+    is_int(op(OPER_ID_LSHIFT, &a, &b), 28);
+    is_int(op(OPER_ID_RSHIFT, num_int(-8), num_real(1.9)), -4);
+    is_int(op(OPER_ID_B_AND, &a, num_real(3.7)), 3);
+    is_int(op(OPER_ID_B_XOR, &a, &b), 5);
+    is_int(op(OPER_ID_B_OR, &a, num_int(8)), 15);
+
+    /* Comparisons give a CaInt, and CaInt is compared exactly. */
+    is_int(op(OPER_ID_LT, &b, &x), 1);
+    is_int(op(OPER_ID_GTEQ, &x, &a), 0);
+    is_int(op(OPER_ID_EQ, num_int(INT64_MAX), num_int(INT64_MAX - 1)), 0);
+    is_int(op(OPER_ID_NEQ, num_real(NAN), num_real(NAN)), 1);
+    is_int(op(OPER_ID_LTEQ, num_real(NAN), &a), 0);
+
+    /* CaInt that overflows becomes a CaBigInt, and becomes a CaInt again
+     * once it fits. Only its remainder can fail. */
+    big = op(OPER_ID_ADDITION, num_int(INT64_MAX), num_int(1));
+    assert(ca_var_is(big, CA_TYPE_BIGINT) && ca_std_real(big) == 0x1p63);
+    assert(ca_std_assign(&n, big) == CA_ERROR_OK);
+    big = op(OPER_ID_MULTIPLICATION, &n, &n);
+    assert(ca_var_is(big, CA_TYPE_BIGINT) && ca_std_real(big) == 0x1p126);
+    is_int(op(OPER_ID_SUBTRACTION, &n, num_int(1)), INT64_MAX);
+    is_int(op(OPER_ID_REMAINDER, &n, num_int(10)), 8);
+    is_int(op(OPER_ID_LT, num_int(INT64_MAX), &n), 1);
+    is_int(op(OPER_ID_EQ, &n, num_real(0x1p63)), 1);
+    is_real(op(OPER_ID_DIVISION, &n, num_int(4)), 0x1p61);
+    is_int(op(OPER_ID_REMAINDER, num_int(INT64_MIN), num_int(-1)), 0);
+
+    /* So do powers, which are taken exactly by squaring. */
+    big = op(OPER_ID_POWER, num_int(3), num_int(40));
+    assert(ca_var_is(big, CA_TYPE_BIGINT) &&
+           ca_std_real(big) == (CaReal) 12157665459056928801.0L);
+    is_int(op(OPER_ID_POWER, num_int(2), num_int(62)), 0x1p62);
+    big = op(OPER_ID_POWER, &n, num_int(3));
+    assert(ca_var_is(big, CA_TYPE_BIGINT) && ca_std_real(big) == 0x1p189);
+    is_int(op(OPER_ID_POWER, num_int(-1), &n), 1);
+    is_int(op(OPER_ID_POWER, num_int(0), &n), 0);
+    is_real(op(OPER_ID_POWER, num_int(2), &n), INFINITY);
+    is_real(op(OPER_ID_POWER, &n, num_int(-1)), 0x1p-63);
+    r = *num_int(0);
+    assert(ca_std_binary_op(OPER_ID_REMAINDER, &r, &a, &r) ==
+           CA_ERROR_EVAL_DIVISION_BY_ZERO);
+    assert(ca_std_binary_op(OPER_ID_REMAINDER, &r, &n, &r) ==
+           CA_ERROR_EVAL_DIVISION_BY_ZERO);
+    ca_std_release(&n);
+    assert(ca_var_is(&n, CA_TYPE_UNKNOWN));
+
+    /* The result may be an operand. */
+    r = a;
+    assert(ca_std_binary_op(OPER_ID_SUBTRACTION, &r, &b, &r) == CA_ERROR_OK);
+    is_int(&r, -5);
+
+    /* Unset values, and types that are not primitive, are not supported
+     * yet. */
+    assert(ca_std_binary_op(OPER_ID_ADDITION, &r, &a, &(CaVar) CA_VAR_UNKNOWN) ==
+           CA_ERROR_EVAL_UNSUPPORTED);
+    ca_var_set_ptr(&s, CA_TYPE_STRING, NULL);
+    for (int oper = CA_STD_BINARY_FIRST; oper <= CA_STD_BINARY_LAST; oper++) {
+        assert(ca_std_binary_op(oper, &r, &s, &a) ==
+               CA_ERROR_EVAL_UNSUPPORTED);
+        assert(ca_std_binary_op(oper, &r, &x, &s) ==
+               CA_ERROR_EVAL_UNSUPPORTED);
+        assert(!ca_std_binary_type[oper - CA_STD_BINARY_FIRST]
+                                  [CA_TYPE_STRING][CA_TYPE_INT]);
+    }
+
+    /* Every result has the type the table of types gives. */
+    for (int oper = CA_STD_BINARY_FIRST; oper <= CA_STD_BINARY_LAST; oper++) {
+        for (int i = 0; i < 2; i++) {
+            for (int j = 0; j < 2; j++) {
+                const CaVar *p = types[i] == CA_TYPE_INT ? &a : &x;
+                const CaVar *q = types[j] == CA_TYPE_INT ? &b : &x;
+                int t = ca_std_binary_type[oper - CA_STD_BINARY_FIRST]
+                                          [types[i]][types[j]];
+
+                assert(ca_var_type(op(oper, p, q)) == (CaType) t);
+            }
+        }
+    }
+
+    assert(ca_std_assign(&r, &x) == CA_ERROR_OK);
+    is_real(&r, 2.5);
+    assert(ca_std_assign(&r, &s) == CA_ERROR_EVAL_UNSUPPORTED);
+
+    printf("Test Passed.\n");
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../interpreter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define TESTSIZE 20000
+#define STREAMSIZE (16 << 20)
+
+static const char alphabet[] = "0123456789   \t\n.+-*/=<>()abcexyz_'\"`\r\x01";
+
+/* Lexes buf in chunks of random sizes, and compares the tokens with those
+ * read from the whole buffer at once. */
+static void check_chunks(const char *buf, CaSize len, int maxchunk)
+{
+    CaExpr e = { 0, buf };
+    CaLexer l;
+    const CaOperator *o1 = NULL;
+    CaToken t;
+    CaGuess g1;
+    CaSize start, s1, fed = 0, n;
+    CaError e1, e2;
+
+    ca_lexer_init(&l);
+    do {
+        e1 = ca_next_token(&e, &g1, &start, &s1, &o1);
+        for (;;) {
+            e2 = ca_lexer_next(&l, &t);
+            if (e2 != CA_ERROR_OK || t.guess != CA_GUESS_NEED_MORE_DATA)
+                break;
+            if (fed == len) {
+                ca_lexer_finish(&l);
+                continue;
+            }
+            n = 1 + rand() % maxchunk;
+            n = n > len - fed ? len - fed : n;
+            assert(ca_lexer_feed(&l, buf + fed, n) == CA_ERROR_OK);
+            fed += n;
+        }
+        assert(e1 == e2);
+        if (e1 != CA_ERROR_OK)
+            break;
+        assert(g1 == t.guess && s1 == t.size);
+        assert(!memcmp(buf + start, l.buf + t.pos, s1));
+        if (g1 == CA_GUESS_OPERATOR)
+            assert(o1->id == ca_token_oper(&t)->id &&
+                   o1->prec == ca_token_oper(&t)->prec);
+    } while (e1 == CA_ERROR_OK);
+
+    /* The buffer only ever held a chunk and the token before it. */
+    assert(l.capacity <= CA_LEXER_BUF_SIZE);
+    ca_lexer_free(&l);
+}
+
+/* Runs the interpreter on input, and returns what it printed. */
+static char *interpret(const char *input, CaSize len,
+                       CaInterpreterOptions *opts)
+{
+    static char out[4096];
+    FILE *f_in = fmemopen((void *) input, len, "r");
+    FILE *f_out = fmemopen(out, sizeof(out), "w");
+
+    assert(f_in && f_out);
+    ca_start_interpreter(f_in, f_out, f_out, opts);
+    fclose(f_in);
+    fclose(f_out);
+    return out;
+}
+
+int main()
+{
+    char buf[TESTSIZE + 1];
+    CaInterpreterOptions opts = { 0 };
+    char *stream;
+    CaSize len;
+
+    srand(1);
+    for (int i = 0; i < 500; ++i) {
+        len = rand() % TESTSIZE;
+        for (CaSize j = 0; j < len; ++j)
+            buf[j] = alphabet[rand() % (sizeof(alphabet) - 1)];
+        buf[len] = '\0';
+        check_chunks(buf, len, 1 + i % 64);
+    }
+
+    assert(!strcmp(interpret("1 + 2\nx = 4\n\nx * 2", 19, NULL), "3\n4\n8\n"));
+    assert(!strcmp(interpret("1 +\n2\ny + 1\n3", 13, NULL),
+                   "Stack Underflow\n2\nKey not found in table: y\n3\n"));
+
+    /* A line far longer than a chunk, with tokens across chunk bounds. */
+    stream = malloc(STREAMSIZE + 16);
+    assert(stream);
+    len = 0;
+    memcpy(stream, "total = 0", 9);
+    len = 9;
+    while (len < STREAMSIZE - 16) {
+        memcpy(stream + len, " + 1_0e-1", 9);
+        len += 9;
+    }
+    stream[len++] = '\n';
+    memcpy(stream + len, "total", 5);
+    len += 5;
+    assert(!strcmp(interpret(stream, len, NULL), "1864133\n1864133\n"));
+
+    /* Lines give the same exact values whether they are cached, streamed,
+     * streamed without a final newline or streamed in parts. */
+    assert(!strcmp(interpret("2 ** 64\n9223372036854775807 + 1", 32, NULL),
+                   "18446744073709551616\n9223372036854775808\n"));
+    assert(!strcmp(interpret("2 ** 64\n9223372036854775807 + 1", 32, &opts),
+                   "18446744073709551616\n9223372036854775808\n"));
+    for (len = 0; len < 2000 * 6; len += 6)
+        memcpy(stream + len, "0.5 + ", 6);
+    memcpy(stream + len, "3 ** 35 % 10", 12);
+    len += 12;
+    assert(!strcmp(interpret(stream, len, NULL), "1007\n"));
+    assert(!strcmp(interpret(stream, len, &opts), "1007\n"));
+    for (len = 0; len < 2000 * 4; len += 4)
+        memcpy(stream + len, "1 + ", 4);
+    memcpy(stream + len, "9223372036854775807", 19);
+    len += 19;
+    assert(!strcmp(interpret(stream, len, NULL), "9223372036854777807\n"));
+    free(stream);
+
+    printf("Test Passed.\n");
+
+    return 0;
+}
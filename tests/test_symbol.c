@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../symbol.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define TESTCOUNT 10000
+
+int main()
+{
+    CaSymbols s;
+    CaSymbol id;
+    CaSize size;
+    char name[32];
+
+    assert(ca_symbols_init(&s) == CA_ERROR_OK);
+    assert(ca_symbols_find(&s, "x", 1, &id) == CA_ERROR_HASH_NOTFOUND);
+
+    /* IDs are dense, and the same name always gets the same one. */
+    for (CaSymbol i = 0; i < TESTCOUNT; ++i) {
+        snprintf(name, sizeof(name), "var_%u", i);
+        assert(ca_symbols_intern(&s, name, strlen(name), &id) == CA_ERROR_OK);
+        assert(id == i);
+    }
+    assert(s.count == TESTCOUNT);
+
+    for (CaSymbol i = 0; i < TESTCOUNT; ++i) {
+        snprintf(name, sizeof(name), "var_%u", i);
+        assert(ca_symbols_intern(&s, name, strlen(name), &id) == CA_ERROR_OK);
+        assert(id == i);
+        assert(ca_symbols_find(&s, name, strlen(name), &id) == CA_ERROR_OK);
+        assert(id == i);
+        assert(!strcmp(ca_symbols_name(&s, i, &size), name));
+        assert(size == strlen(name));
+    }
+
+    /* Names are compared by their whole size. */
+    assert(ca_symbols_intern(&s, "var_12345", 5, &id) == CA_ERROR_OK);
+    assert(id == 1);
+    assert(ca_symbols_find(&s, "var_", 4, &id) == CA_ERROR_HASH_NOTFOUND);
+    assert(s.count == TESTCOUNT);
+
+    ca_symbols_free(&s);
+    printf("Test Passed.\n");
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#undef CA_TRACE_LEVEL
+#define CA_TRACE_LEVEL CA_TRACE_INFO
+
+#include "../trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+int main()
+{
+    CaTraceEvent e;
+    char magic[8];
+    uint64_t last = 0;
+    FILE *f = tmpfile();
+    int i;
+
+    assert(f);
+
+    /* Nothing is recorded until tracing is turned on. */
+    CA_TRACE(CA_TRACE_ERROR, VM, ERROR, 1, 2);
+    ca_trace_enable(1);
+
+    /* Levels above CA_TRACE_LEVEL are not compiled. */
+    CA_TRACE(CA_TRACE_DEBUG, HASH, GET, 1, 2);
+    CA_TRACE(CA_TRACE_ERROR, VM, ERROR, 3, 4);
+    for (i = 0; i < CA_TRACE_SIZE + 10; i++)
+        CA_TRACE(CA_TRACE_INFO, CACHE, HIT, i, 7);
+    ca_trace_enable(0);
+    CA_TRACE(CA_TRACE_ERROR, VM, ERROR, 5, 6);
+
+    assert(ca_trace_write(f) == CA_ERROR_OK);
+    rewind(f);
+    assert(fread(magic, 8, 1, f) == 1);
+    assert(!memcmp(magic, CA_TRACE_MAGIC, 8));
+
+    /* Only the last CA_TRACE_SIZE events are kept, oldest first. */
+    for (i = 0; ca_trace_read(f, &e); i++) {
+        assert(e.subsystem == CA_TRACE_CACHE);
+        assert(e.event == CA_TRACE_CACHE_HIT);
+        assert(e.thread == 0);
+        assert(e.args[0] == (uint64_t) i + 10 && e.args[1] == 7);
+        assert(e.time >= last);
+        last = e.time;
+    }
+    assert(i == CA_TRACE_SIZE);
+    assert(!strcmp(ca_trace_subsystem_names[e.subsystem], "cache"));
+    assert(!strcmp(ca_trace_event_names[e.event], "hit"));
+
+    fclose(f);
+    printf("Test Passed.\n");
+    return 0;
+}
@@ -0,0 +1,637 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file token.c
+ * \author Anamitra Ghorui
+ * \brief Calcium expression tokeniser
+ */
+
+#include "token.h"
+#include "oper_trie.h"
+
+#include <string.h>
+
+/*
+ * The tokeniser is a DFA. Each byte is first mapped to a character class by
+ * ca_char_class, and the class and current state index ca_lex_trans to get the
+ * next state. States at or above CA_LS_COUNT do not consume the byte, and end
+ * the token instead.
+ *
+ * Token boundaries are the same as that of next_token in ref/infix.c:
+ * - Whitespace ends a token. Bytes that are neither whitespace, alphanumeric
+ *   nor symbols are skipped, but do not end a token.
+ * - An integer followed by '.' may become a float. "1." is still an integer,
+ *   and "1.2." is read as "1.2" and ".".
+ * - A symbol starts an operator, which is the longest entry of oper_list
+ *   that matches. Symbols that match no entry are unknown operators.
+ * - A string ends at the matching quote. If there is none, the rest of the
+ *   expression is returned as an error token.
+ *
+ * Unlike next_token:
+ * - A quote ends the preceding token instead of discarding it.
+ * - Skipped bytes end an operator, as "+\x01=" is not "+=".
+ * - '\r' is whitespace.
+ * - Numbers may have an exponent (1e10, 2.5E-3), a 0x or 0b prefix, and
+ *   underscores between digits (see num.h). Where such a suffix is only
+ *   started, as in "1e" or "1_", the DFA is in a tentative state, and backs
+ *   off to the end of the number with CA_LS_ACCEPT_BACK if the suffix is not
+ *   completed. "1e+x" is therefore still "1", "e", "+" and "x".
+ *
+ * Operators are not read by the DFA, but by walking the trie in oper_trie.h,
+ * which gen_oper.c builds from oper_list. Each symbol takes a load of its
+ * column and a load of the next node, and a last load gives the operator, so
+ * an operator of n symbols takes at most 2 * n + 1 loads with no search.
+ */
+
+typedef enum CaCharClass {
+    CA_CC_END = 0,  /* '\0' */
+    CA_CC_SPACE,    /* ' ', '\t', '\n', '\r' */
+    CA_CC_IGNORE,   /* Everything not covered by the others */
+    CA_CC_ZERO,     /* '0' */
+    CA_CC_DIGIT,    /* '1' to '9' */
+    CA_CC_ALPHA,    /* Letters not covered by the others */
+    CA_CC_HEXALPHA, /* Hexadecimal digits, other than 'b' and 'e' */
+    CA_CC_B,        /* 'b', 'B' */
+    CA_CC_E,        /* 'e', 'E' */
+    CA_CC_X,        /* 'x', 'X' */
+    CA_CC_UNDER,    /* '_' */
+    CA_CC_DOT,
+    CA_CC_SIGN,     /* '+', '-' */
+    CA_CC_SYMBOL,
+    CA_CC_DQUOTE,
+    CA_CC_SQUOTE,
+    CA_CC_COUNT
+} CaCharClass;
+
+typedef enum CaLexState {
+    CA_LS_START = 0,
+    CA_LS_ZERO,       /* "0", which may start a prefix */
+    CA_LS_INT,
+    CA_LS_INT_US,     /* Tentative: "1_" */
+    CA_LS_INT_DOT,
+    CA_LS_FLOAT,
+    CA_LS_FLOAT_US,   /* Tentative: "1.5_" */
+    CA_LS_EXPI_MARK,  /* Tentative: "1e" */
+    CA_LS_EXPI_SIGN,  /* Tentative: "1e+" */
+    CA_LS_EXPF_MARK,  /* Tentative: "1.5e" */
+    CA_LS_EXPF_SIGN,  /* Tentative: "1.5e+" */
+    CA_LS_EXP,
+    CA_LS_EXP_US,     /* Tentative: "1e5_" */
+    CA_LS_HEX_PREFIX, /* Tentative: "0x" */
+    CA_LS_HEX,
+    CA_LS_HEX_US,     /* Tentative: "0xF_" */
+    CA_LS_BIN_PREFIX, /* Tentative: "0b" */
+    CA_LS_BIN,
+    CA_LS_BIN_US,     /* Tentative: "0b1_" */
+    CA_LS_NOUN,
+    CA_LS_DSTRING,
+    CA_LS_SSTRING,
+    CA_LS_COUNT,
+
+    /* Final states */
+    CA_LS_ACCEPT = CA_LS_COUNT, /* Token ends before the current byte */
+    CA_LS_ACCEPT_NEXT,          /* Token ends after the current byte */
+    CA_LS_ACCEPT_BACK,          /* Token ends before the tentative bytes */
+    CA_LS_OPER,                 /* Operator, read through the trie */
+    CA_LS_UNTERMINATED,         /* String without closing quote */
+    CA_LS_EMPTY                 /* No token left */
+} CaLexState;
+
+static const uint8_t ca_char_class[256] = {
+    [0x01 ... 0xFF] = CA_CC_IGNORE,
+    ['\0']          = CA_CC_END,
+    [' ']           = CA_CC_SPACE,
+    ['\t']          = CA_CC_SPACE,
+    ['\n']          = CA_CC_SPACE,
+    ['\r']          = CA_CC_SPACE,
+    [0x21 ... 0x2F] = CA_CC_SYMBOL,
+    [0x3A ... 0x40] = CA_CC_SYMBOL,
+    [0x5B ... 0x5E] = CA_CC_SYMBOL,
+    [0x7B ... 0x7E] = CA_CC_SYMBOL,
+    ['0']           = CA_CC_ZERO,
+    ['1' ... '9']   = CA_CC_DIGIT,
+    ['A' ... 'Z']   = CA_CC_ALPHA,
+    ['a' ... 'z']   = CA_CC_ALPHA,
+    ['a']           = CA_CC_HEXALPHA,
+    ['c' ... 'd']   = CA_CC_HEXALPHA,
+    ['f']           = CA_CC_HEXALPHA,
+    ['A']           = CA_CC_HEXALPHA,
+    ['C' ... 'D']   = CA_CC_HEXALPHA,
+    ['F']           = CA_CC_HEXALPHA,
+    ['b']           = CA_CC_B,
+    ['B']           = CA_CC_B,
+    ['e']           = CA_CC_E,
+    ['E']           = CA_CC_E,
+    ['x']           = CA_CC_X,
+    ['X']           = CA_CC_X,
+    ['_']           = CA_CC_UNDER,
+    ['.']           = CA_CC_DOT,
+    ['+']           = CA_CC_SIGN,
+    ['-']           = CA_CC_SIGN,
+    ['"']           = CA_CC_DQUOTE,
+    ['\'']          = CA_CC_SQUOTE
+};
+
+#define ACC  CA_LS_ACCEPT
+#define BACK CA_LS_ACCEPT_BACK
+#define ALL  0 ... CA_CC_COUNT - 1
+
+/* Each row gives its default first, and then the exceptions to it. */
+static const uint8_t ca_lex_trans[CA_LS_COUNT][CA_CC_COUNT] = {
+    [CA_LS_START]      = { [ALL]            = CA_LS_NOUN,
+                           [CA_CC_END]      = CA_LS_EMPTY,
+                           [CA_CC_SPACE]    = CA_LS_START,
+                           [CA_CC_IGNORE]   = CA_LS_START,
+                           [CA_CC_ZERO]     = CA_LS_ZERO,
+                           [CA_CC_DIGIT]    = CA_LS_INT,
+                           [CA_CC_DOT]      = CA_LS_OPER,
+                           [CA_CC_SIGN]     = CA_LS_OPER,
+                           [CA_CC_SYMBOL]   = CA_LS_OPER,
+                           [CA_CC_DQUOTE]   = CA_LS_DSTRING,
+                           [CA_CC_SQUOTE]   = CA_LS_SSTRING },
+
+    [CA_LS_ZERO]       = { [ALL]            = ACC,
+                           [CA_CC_IGNORE]   = CA_LS_INT,
+                           [CA_CC_ZERO]     = CA_LS_INT,
+                           [CA_CC_DIGIT]    = CA_LS_INT,
+                           [CA_CC_UNDER]    = CA_LS_INT_US,
+                           [CA_CC_DOT]      = CA_LS_INT_DOT,
+                           [CA_CC_E]        = CA_LS_EXPI_MARK,
+                           [CA_CC_X]        = CA_LS_HEX_PREFIX,
+                           [CA_CC_B]        = CA_LS_BIN_PREFIX },
+
+    [CA_LS_INT]        = { [ALL]            = ACC,
+                           [CA_CC_IGNORE]   = CA_LS_INT,
+                           [CA_CC_ZERO]     = CA_LS_INT,
+                           [CA_CC_DIGIT]    = CA_LS_INT,
+                           [CA_CC_UNDER]    = CA_LS_INT_US,
+                           [CA_CC_DOT]      = CA_LS_INT_DOT,
+                           [CA_CC_E]        = CA_LS_EXPI_MARK },
+
+    [CA_LS_INT_US]     = { [ALL]            = BACK,
+                           [CA_CC_ZERO]     = CA_LS_INT,
+                           [CA_CC_DIGIT]    = CA_LS_INT },
+
+    [CA_LS_INT_DOT]    = { [ALL]            = ACC,
+                           [CA_CC_IGNORE]   = CA_LS_INT_DOT,
+                           [CA_CC_ZERO]     = CA_LS_FLOAT,
+                           [CA_CC_DIGIT]    = CA_LS_FLOAT,
+                           [CA_CC_DOT]      = CA_LS_INT_DOT },
+
+    [CA_LS_FLOAT]      = { [ALL]            = ACC,
+                           [CA_CC_IGNORE]   = CA_LS_FLOAT,
+                           [CA_CC_ZERO]     = CA_LS_FLOAT,
+                           [CA_CC_DIGIT]    = CA_LS_FLOAT,
+                           [CA_CC_UNDER]    = CA_LS_FLOAT_US,
+                           [CA_CC_E]        = CA_LS_EXPF_MARK },
+
+    [CA_LS_FLOAT_US]   = { [ALL]            = BACK,
+                           [CA_CC_ZERO]     = CA_LS_FLOAT,
+                           [CA_CC_DIGIT]    = CA_LS_FLOAT },
+
+    [CA_LS_EXPI_MARK]  = { [ALL]            = BACK,
+                           [CA_CC_ZERO]     = CA_LS_EXP,
+                           [CA_CC_DIGIT]    = CA_LS_EXP,
+                           [CA_CC_SIGN]     = CA_LS_EXPI_SIGN },
+
+    [CA_LS_EXPI_SIGN]  = { [ALL]            = BACK,
+                           [CA_CC_ZERO]     = CA_LS_EXP,
+                           [CA_CC_DIGIT]    = CA_LS_EXP },
+
+    [CA_LS_EXPF_MARK]  = { [ALL]            = BACK,
+                           [CA_CC_ZERO]     = CA_LS_EXP,
+                           [CA_CC_DIGIT]    = CA_LS_EXP,
+                           [CA_CC_SIGN]     = CA_LS_EXPF_SIGN },
+
+    [CA_LS_EXPF_SIGN]  = { [ALL]            = BACK,
+                           [CA_CC_ZERO]     = CA_LS_EXP,
+                           [CA_CC_DIGIT]    = CA_LS_EXP },
+
+    [CA_LS_EXP]        = { [ALL]            = ACC,
+                           [CA_CC_IGNORE]   = CA_LS_EXP,
+                           [CA_CC_ZERO]     = CA_LS_EXP,
+                           [CA_CC_DIGIT]    = CA_LS_EXP,
+                           [CA_CC_UNDER]    = CA_LS_EXP_US },
+
+    [CA_LS_EXP_US]     = { [ALL]            = BACK,
+                           [CA_CC_ZERO]     = CA_LS_EXP,
+                           [CA_CC_DIGIT]    = CA_LS_EXP },
+
+    [CA_LS_HEX_PREFIX] = { [ALL]            = BACK,
+                           [CA_CC_ZERO]     = CA_LS_HEX,
+                           [CA_CC_DIGIT]    = CA_LS_HEX,
+                           [CA_CC_HEXALPHA] = CA_LS_HEX,
+                           [CA_CC_B]        = CA_LS_HEX,
+                           [CA_CC_E]        = CA_LS_HEX },
+
+    [CA_LS_HEX]        = { [ALL]            = ACC,
+                           [CA_CC_IGNORE]   = CA_LS_HEX,
+                           [CA_CC_ZERO]     = CA_LS_HEX,
+                           [CA_CC_DIGIT]    = CA_LS_HEX,
+                           [CA_CC_HEXALPHA] = CA_LS_HEX,
+                           [CA_CC_B]        = CA_LS_HEX,
+                           [CA_CC_E]        = CA_LS_HEX,
+                           [CA_CC_UNDER]    = CA_LS_HEX_US },
+
+    [CA_LS_HEX_US]     = { [ALL]            = BACK,
+                           [CA_CC_ZERO]     = CA_LS_HEX,
+                           [CA_CC_DIGIT]    = CA_LS_HEX,
+                           [CA_CC_HEXALPHA] = CA_LS_HEX,
+                           [CA_CC_B]        = CA_LS_HEX,
+                           [CA_CC_E]        = CA_LS_HEX },
+
+    /* Digits other than 0 and 1 are left for the parser to reject. */
+    [CA_LS_BIN_PREFIX] = { [ALL]            = BACK,
+                           [CA_CC_ZERO]     = CA_LS_BIN,
+                           [CA_CC_DIGIT]    = CA_LS_BIN },
+
+    [CA_LS_BIN]        = { [ALL]            = ACC,
+                           [CA_CC_IGNORE]   = CA_LS_BIN,
+                           [CA_CC_ZERO]     = CA_LS_BIN,
+                           [CA_CC_DIGIT]    = CA_LS_BIN,
+                           [CA_CC_UNDER]    = CA_LS_BIN_US },
+
+    [CA_LS_BIN_US]     = { [ALL]            = BACK,
+                           [CA_CC_ZERO]     = CA_LS_BIN,
+                           [CA_CC_DIGIT]    = CA_LS_BIN },
+
+    [CA_LS_NOUN]       = { [ALL]            = CA_LS_NOUN,
+                           [CA_CC_END]      = ACC,
+                           [CA_CC_SPACE]    = ACC,
+                           [CA_CC_ZERO]     = ACC,
+                           [CA_CC_DIGIT]    = ACC,
+                           [CA_CC_DOT]      = ACC,
+                           [CA_CC_SIGN]     = ACC,
+                           [CA_CC_SYMBOL]   = ACC,
+                           [CA_CC_DQUOTE]   = ACC,
+                           [CA_CC_SQUOTE]   = ACC },
+
+    [CA_LS_DSTRING]    = { [ALL]            = CA_LS_DSTRING,
+                           [CA_CC_END]      = CA_LS_UNTERMINATED,
+                           [CA_CC_DQUOTE]   = CA_LS_ACCEPT_NEXT },
+
+    [CA_LS_SSTRING]    = { [ALL]            = CA_LS_SSTRING,
+                           [CA_CC_END]      = CA_LS_UNTERMINATED,
+                           [CA_CC_SQUOTE]   = CA_LS_ACCEPT_NEXT },
+};
+
+#undef ALL
+#undef BACK
+#undef ACC
+
+/// The guess for a token that ends while the DFA is in a given state. For
+/// tentative states, it is the guess for the token without the tentative
+/// bytes.
+static const uint8_t ca_lex_guess[CA_LS_COUNT] = {
+    [CA_LS_START]      = CA_GUESS_UNKNOWN,
+    [CA_LS_ZERO]       = CA_GUESS_INTEGER,
+    [CA_LS_INT]        = CA_GUESS_INTEGER,
+    [CA_LS_INT_US]     = CA_GUESS_INTEGER,
+    [CA_LS_INT_DOT]    = CA_GUESS_INTEGER,
+    [CA_LS_FLOAT]      = CA_GUESS_FLOAT,
+    [CA_LS_FLOAT_US]   = CA_GUESS_FLOAT,
+    [CA_LS_EXPI_MARK]  = CA_GUESS_INTEGER,
+    [CA_LS_EXPI_SIGN]  = CA_GUESS_INTEGER,
+    [CA_LS_EXPF_MARK]  = CA_GUESS_FLOAT,
+    [CA_LS_EXPF_SIGN]  = CA_GUESS_FLOAT,
+    [CA_LS_EXP]        = CA_GUESS_FLOAT,
+    [CA_LS_EXP_US]     = CA_GUESS_FLOAT,
+    [CA_LS_HEX_PREFIX] = CA_GUESS_INTEGER,
+    [CA_LS_HEX]        = CA_GUESS_INTEGER,
+    [CA_LS_HEX_US]     = CA_GUESS_INTEGER,
+    [CA_LS_BIN_PREFIX] = CA_GUESS_INTEGER,
+    [CA_LS_BIN]        = CA_GUESS_INTEGER,
+    [CA_LS_BIN_US]     = CA_GUESS_INTEGER,
+    [CA_LS_NOUN]       = CA_GUESS_NOUN,
+    [CA_LS_DSTRING]    = CA_GUESS_STRING,
+    [CA_LS_SSTRING]    = CA_GUESS_STRING
+};
+
+/// Number of tentative bytes to give back on CA_LS_ACCEPT_BACK.
+static const uint8_t ca_lex_back[CA_LS_COUNT] = {
+    [CA_LS_INT_US]     = 1,
+    [CA_LS_FLOAT_US]   = 1,
+    [CA_LS_EXPI_MARK]  = 1,
+    [CA_LS_EXPI_SIGN]  = 2,
+    [CA_LS_EXPF_MARK]  = 1,
+    [CA_LS_EXPF_SIGN]  = 2,
+    [CA_LS_EXP_US]     = 1,
+    [CA_LS_HEX_PREFIX] = 1,
+    [CA_LS_HEX_US]     = 1,
+    [CA_LS_BIN_PREFIX] = 1,
+    [CA_LS_BIN_US]     = 1
+};
+
+const char *ca_guess_strings[] = {
+    [CA_GUESS_UNKNOWN]        = "unknown",
+    [CA_GUESS_ERROR]          = "error",
+    [CA_GUESS_NEED_MORE_DATA] = "incomplete",
+    [CA_GUESS_INTEGER]        = "int",
+    [CA_GUESS_FLOAT]          = "float",
+    [CA_GUESS_OPERATOR]       = "oper",
+    [CA_GUESS_NOUN]           = "noun",
+    [CA_GUESS_STRING]         = "string"
+};
+
+void ca_token_list_init(CaTokenList *l)
+{
+    l->buf      = NULL;
+    l->tokens   = NULL;
+    l->count    = 0;
+    l->capacity = 0;
+    l->symbols  = NULL;
+}
+
+void ca_token_list_free(CaTokenList *l)
+{
+    CaSymbols *symbols = l->symbols;
+
+    free(l->tokens);
+    ca_token_list_init(l);
+    l->symbols = symbols;
+}
+
+/* Sets the id of a token from its operator or name. */
+static inline CaError ca_token_id(CaToken *t, const char *buf,
+                                  const CaOperator *oper, CaSymbols *symbols)
+{
+    t->id = 0;
+    if (t->guess == CA_GUESS_OPERATOR)
+        t->id = oper - oper_list;
+    else if (t->guess == CA_GUESS_NOUN && symbols)
+        return ca_symbols_intern(symbols, buf + t->pos, t->size, &t->id);
+    return CA_ERROR_OK;
+}
+
+CaError ca_tokenize(CaTokenList *l, CaExpr *expr)
+{
+    const CaOperator *oper = NULL;
+    CaToken *tokens;
+    CaGuess guess;
+    CaSize start, size, capacity;
+    CaToken *t;
+    CaError err;
+
+    l->buf   = expr->buf;
+    l->count = 0;
+
+    while (ca_next_token(expr, &guess, &start, &size, &oper) == CA_ERROR_OK) {
+        if (expr->pos > UINT32_MAX)
+            return CA_ERROR_EVAL;
+
+        if (l->count == l->capacity) {
+            capacity = l->capacity ? l->capacity * 2 : CA_TOKEN_LIST_SIZE;
+            tokens = realloc(l->tokens, capacity * sizeof(CaToken));
+            if (!tokens)
+                return CA_ERROR_MEM;
+            l->tokens   = tokens;
+            l->capacity = capacity;
+        }
+
+        t = &l->tokens[l->count++];
+        t->pos   = start;
+        t->size  = size;
+        t->guess = guess;
+        if ((err = ca_token_id(t, l->buf, oper, l->symbols)) != CA_ERROR_OK)
+            return err;
+    }
+
+    return CA_ERROR_OK;
+}
+
+/*
+ * Returns the end of the longest operator starting at c. The end of the walk
+ * through the trie is left in stop.
+ */
+static inline const unsigned char *ca_oper_read(const unsigned char *c,
+                                                const CaOperator **oper,
+                                                const unsigned char **stop)
+{
+    unsigned node = 0, next, i;
+    CaOperMatch m;
+
+    /* No symbol has column 0, so this stops at the end of the buffer. */
+    for (i = 0; i < CA_MAX_OPER_LEN; i++) {
+        if (!(next = ca_oper_trie[node][ca_oper_column[c[i]]]))
+            break;
+        node = next;
+    }
+
+    m = ca_oper_match[node];
+    *oper = &oper_list[m.oper];
+    *stop = c + i;
+    return c + m.len;
+}
+
+/*
+ * Reads the next token of expr. With a lexer l whose last chunk has not been
+ * fed, a token that reaches the end of the chunk may go on in the next one, so
+ * the DFA state is saved in l, and CA_GUESS_NEED_MORE_DATA is returned
+ * without moving past the token. The next call resumes from there.
+ */
+static inline CaError ca_lex(CaExpr *expr, CaLexer *l, CaGuess *guess,
+                             CaSize *start, CaSize *size,
+                             const CaOperator **oper)
+{
+    const unsigned char *buf   = (const unsigned char *) expr->buf;
+    const unsigned char *begin = buf + expr->pos;
+    const unsigned char *end   = l ? buf + l->len : NULL;
+    const unsigned char *c, *stop;
+    unsigned state, next;
+
+    if (l && l->state != CA_LS_START) {
+        state    = l->state;
+        c        = buf + l->scan;
+        l->state = CA_LS_START;
+    } else {
+        /* Leading whitespace, and skipped bytes never start a token. */
+        while ((next = ca_lex_trans[CA_LS_START][ca_char_class[*begin]]) ==
+               CA_LS_START)
+            begin++;
+
+        if (next == CA_LS_EMPTY) {
+            expr->pos = begin - buf;
+            *size  = 0;
+            *start = expr->pos;
+            if (l && !l->final && begin == end) {
+                *guess = CA_GUESS_NEED_MORE_DATA;
+                return CA_ERROR_OK;
+            }
+            *guess = CA_GUESS_UNKNOWN;
+            return CA_ERROR_EVAL_END;
+        }
+
+        if (next == CA_LS_OPER) {
+            c = ca_oper_read(begin, oper, &stop);
+            *guess = CA_GUESS_OPERATOR;
+            /* A longer operator may follow. The trie is walked again once
+             * it has arrived. */
+            if (l && !l->final && stop == end)
+                goto more;
+            goto accept;
+        }
+
+        state = next;
+        c = begin + 1;
+    }
+
+    while ((next = ca_lex_trans[state][ca_char_class[*c]]) < CA_LS_COUNT) {
+        state = next;
+        c++;
+    }
+
+    if (l && !l->final && c == end) {
+        l->state = state;
+        l->scan  = c - buf;
+        goto more;
+    }
+
+    *guess = ca_lex_guess[state];
+
+    switch (next) {
+    case CA_LS_ACCEPT_NEXT:
+        c++;
+        break;
+
+    case CA_LS_ACCEPT_BACK:
+        c -= ca_lex_back[state];
+        break;
+
+    case CA_LS_UNTERMINATED:
+        *guess = CA_GUESS_ERROR;
+        break;
+    }
+
+accept:
+    *start    = begin - buf;
+    *size     = c - begin;
+    expr->pos = c - buf;
+    return CA_ERROR_OK;
+
+more:
+    *guess    = CA_GUESS_NEED_MORE_DATA;
+    *start    = begin - buf;
+    *size     = c - begin;
+    expr->pos = begin - buf;
+    return CA_ERROR_OK;
+}
+
+CaError ca_next_token(CaExpr *expr, CaGuess *guess, CaSize *start,
+                      CaSize *size, const CaOperator **oper)
+{
+    return ca_lex(expr, NULL, guess, start, size, oper);
+}
+
+void ca_lexer_init(CaLexer *l)
+{
+    l->buf      = NULL;
+    l->len      = 0;
+    l->capacity = 0;
+    l->expr     = (CaExpr) { 0, NULL };
+    l->scan     = 0;
+    l->state    = CA_LS_START;
+    l->final    = 0;
+    l->symbols  = NULL;
+}
+
+void ca_lexer_free(CaLexer *l)
+{
+    CaSymbols *symbols = l->symbols;
+
+    free(l->buf);
+    ca_lexer_init(l);
+    l->symbols = symbols;
+}
+
+void ca_lexer_reset(CaLexer *l)
+{
+    l->len      = 0;
+    l->expr.pos = 0;
+    l->state    = CA_LS_START;
+    l->final    = 0;
+    if (l->buf)
+        l->buf[0] = '\0';
+}
+
+CaError ca_lexer_feed(CaLexer *l, const char *data, CaSize size)
+{
+    CaSize keep = l->len - l->expr.pos, capacity;
+    char *buf;
+
+    /* Drop what has been read, keeping the token that was cut off. */
+    if (l->expr.pos) {
+        memmove(l->buf, l->buf + l->expr.pos, keep);
+        if (l->state != CA_LS_START)
+            l->scan -= l->expr.pos;
+        l->expr.pos = 0;
+        l->len = keep;
+    }
+
+    if (l->len + size + 1 > l->capacity) {
+        capacity = l->capacity ? l->capacity : CA_LEXER_BUF_SIZE;
+        while (capacity < l->len + size + 1)
+            capacity *= 2;
+        if (!(buf = realloc(l->buf, capacity)))
+            return CA_ERROR_MEM;
+        l->buf      = buf;
+        l->capacity = capacity;
+    }
+
+    memcpy(l->buf + l->len, data, size);
+    l->len += size;
+    l->buf[l->len] = '\0';
+    l->expr.buf = l->buf;
+    return CA_ERROR_OK;
+}
+
+void ca_lexer_finish(CaLexer *l)
+{
+    l->final = 1;
+}
+
+CaError ca_lexer_next(CaLexer *l, CaToken *t)
+{
+    const CaOperator *oper = NULL;
+    CaGuess guess;
+    CaSize start = 0, size = 0;
+    CaError err;
+
+    if (!l->buf) {
+        t->pos   = 0;
+        t->size  = 0;
+        t->id    = 0;
+        t->guess = l->final ? CA_GUESS_UNKNOWN : CA_GUESS_NEED_MORE_DATA;
+        return l->final ? CA_ERROR_EVAL_END : CA_ERROR_OK;
+    }
+
+    /* ca_next_token stops at a NUL byte, but a stream goes on after one, so
+     * it is skipped like whitespace. */
+    while ((err = ca_lex(&l->expr, l, &guess, &start, &size, &oper)) ==
+           CA_ERROR_EVAL_END && l->expr.pos < l->len)
+        l->expr.pos++;
+
+    if (l->len > UINT32_MAX)
+        return CA_ERROR_EVAL;
+    t->pos   = start;
+    t->size  = size;
+    t->guess = guess;
+    if (err != CA_ERROR_OK)
+        return err;
+    return ca_token_id(t, l->buf, oper, l->symbols);
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file token.h
+ * \author Anamitra Ghorui
+ * \brief Calcium expression tokeniser
+ *
+ */
+
+#ifndef CA_TOKEN_H
+#define CA_TOKEN_H
+
+#include "types.h"
+#include "error.h"
+#include "oper.h"
+#include "symbol.h"
+
+/// Initial number of tokens a token list has room for.
+#define CA_TOKEN_LIST_SIZE 64
+
+/// Initial size of the buffer of a lexer.
+#define CA_LEXER_BUF_SIZE 4096
+
+/// Contains the expression and the current location on the expression.
+typedef struct CaExpr CaExpr;
+
+struct CaExpr {
+    CaSize pos;
+    const char *buf;
+};
+
+/// A token of an expression. It refers to the expression's buffer instead of
+/// holding a copy, so the buffer must outlive it.
+typedef struct CaToken {
+    uint32_t pos;  ///< Offset of the token in the buffer.
+    uint32_t size; ///< Size of the token.
+    uint32_t id;   ///< Index of the operator in oper_list for operators, and
+                   ///< the symbol ID for nouns, if they are interned.
+    uint8_t guess; ///< The CaGuess of the token.
+} CaToken;
+
+/// The operator of a token guessed to be CA_GUESS_OPERATOR.
+#define ca_token_oper(t) (&oper_list[(t)->id])
+
+/// Reads an expression that arrives in chunks of any size, such as reads from
+/// a file. A token cut off by the end of a chunk is kept, with the state of the
+/// DFA, and lexing resumes where it stopped once the next chunk arrives. Only
+/// the unfinished token is carried over, so memory use does not grow with the
+/// size of the expression.
+typedef struct CaLexer {
+    char *buf;       ///< The unfinished token, followed by the current chunk.
+    CaSize len;      ///< Size of the data in buf.
+    CaSize capacity; ///< Size of buf.
+    CaExpr expr;     ///< Position in buf.
+    CaSize scan;     ///< Where the DFA stopped in a token that was cut off.
+    uint8_t state;   ///< State of the DFA at scan, if a token was cut off.
+    uint8_t final;   ///< Whether the last chunk has been fed.
+    CaSymbols *symbols; ///< Table nouns are interned in, if any.
+} CaLexer;
+
+/// The tokens of an expression. The array is kept when the list is reused
+/// for another expression, and only grows when an expression has more tokens
+/// than any before it.
+typedef struct CaTokenList {
+    const char *buf;
+    CaToken *tokens;
+    CaSize count;
+    CaSize capacity;
+    CaSymbols *symbols; ///< Table nouns are interned in, if any.
+} CaTokenList;
+
+/// Printable names of each CaGuess.
+extern const char *ca_guess_strings[];
+
+/**
+ * \brief Initialises an empty token list.
+ * \param l The token list.
+ */
+void ca_token_list_init(CaTokenList *l);
+
+/**
+ * \brief Frees the memory held by a token list.
+ * \param l The token list.
+ */
+void ca_token_list_free(CaTokenList *l);
+
+/**
+ * \brief Reads all tokens from the current position of an expression to its
+ *        end into a token list, replacing what the list held before.
+ *        Expressions may not be longer than 4 GiB.
+ * \param l The token list.
+ * \param expr The expression.
+ * \return An error code.
+ */
+CaError ca_tokenize(CaTokenList *l, CaExpr *expr);
+
+/**
+ * \brief Gets the next token, and the type from the expression, and moves the
+ *        expression's position past it.
+ * \param expr The expression to read.
+ * \param guess The type of the given token guessed by the tokeniser.
+ * \param start The offset of the start of the token.
+ * \param size The size of the token.
+ * \param oper The operator read, if guess is CA_GUESS_OPERATOR.
+ * \return CA_ERROR_OK, or CA_ERROR_EVAL_END if there are no more tokens.
+ */
+CaError ca_next_token(CaExpr *expr, CaGuess *guess, CaSize *start,
+                      CaSize *size, const CaOperator **oper);
+
+/**
+ * \brief Initialises a lexer with no data.
+ * \param l The lexer.
+ */
+void ca_lexer_init(CaLexer *l);
+
+/**
+ * \brief Frees the memory held by a lexer.
+ * \param l The lexer.
+ */
+void ca_lexer_free(CaLexer *l);
+
+/**
+ * \brief Readies a lexer for another expression, keeping its buffer.
+ * \param l The lexer.
+ */
+void ca_lexer_reset(CaLexer *l);
+
+/**
+ * \brief Feeds the next chunk of the expression to a lexer. Tokens returned
+ *        before are no longer valid after this.
+ * \param l The lexer.
+ * \param data The chunk. It need not be NUL terminated.
+ * \param size The size of the chunk.
+ * \return An error code.
+ */
+CaError ca_lexer_feed(CaLexer *l, const char *data, CaSize size);
+
+/**
+ * \brief Tells a lexer that no more chunks follow, so that tokens reaching the
+ *        end of the last chunk end there.
+ * \param l The lexer.
+ */
+void ca_lexer_finish(CaLexer *l);
+
+/**
+ * \brief Gets the next token from a lexer.
+ * \param l The lexer.
+ * \param t The token, at an offset in the lexer's buffer. It is valid until
+ *          the next chunk is fed. Its guess is CA_GUESS_NEED_MORE_DATA if the
+ *          next chunk must be fed first.
+ * \return CA_ERROR_OK, CA_ERROR_EVAL_END if there are no more tokens and the
+ *         lexer is finished, or an error code.
+ */
+CaError ca_lexer_next(CaLexer *l, CaToken *t);
+
+#endif
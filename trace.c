@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file trace.c
+ * \author Anamitra Ghorui
+ * \brief Event tracing
+ *
+ */
+
+#include "trace.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Only the owning thread writes to a ring, and it publishes each event by
+ * storing the new count with release order. The rings are never freed, so
+ * that a thread may exit before its events are written out.
+ */
+typedef struct CaTraceRing {
+    CaTraceEvent events[CA_TRACE_SIZE];
+    _Atomic uint64_t count;
+    struct CaTraceRing *next;
+} CaTraceRing;
+
+const char *const ca_trace_subsystem_names[CA_TRACE_SUBSYSTEM_COUNT] = {
+    "hash", "eval", "vm", "cache", "jit", "react"
+};
+
+const char *const ca_trace_event_names[CA_TRACE_EVENT_COUNT] = {
+    "get", "probe", "miss",
+    "compile", "error",
+    "run", "error",
+    "hit", "miss",
+    "compile",
+    "update"
+};
+
+int ca_trace_on = 0;
+
+static _Atomic(CaTraceRing *) ca_trace_rings = NULL;
+static atomic_uint ca_trace_threads = 0;
+static _Thread_local CaTraceRing *ca_trace_ring = NULL;
+static _Thread_local uint32_t ca_trace_thread;
+
+static CaTraceRing *ca_trace_ring_new()
+{
+    CaTraceRing *r = malloc(sizeof(*r));
+
+    if (r == NULL) {
+        return NULL;
+    }
+    atomic_init(&r->count, 0);
+    r->next = atomic_load(&ca_trace_rings);
+    while (!atomic_compare_exchange_weak(&ca_trace_rings, &r->next, r));
+    ca_trace_thread = atomic_fetch_add(&ca_trace_threads, 1);
+    return r;
+}
+
+void ca_trace_enable(int on)
+{
+    ca_trace_on = on;
+}
+
+void ca_trace_event(CaTraceSubsystem subsystem, CaTraceEventId event,
+                    uint64_t a, uint64_t b)
+{
+    CaTraceRing *r = ca_trace_ring;
+    struct timespec t;
+    CaTraceEvent *e;
+    uint64_t count;
+
+    if (r == NULL && (r = ca_trace_ring = ca_trace_ring_new()) == NULL) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    count = atomic_load_explicit(&r->count, memory_order_relaxed);
+    e = &r->events[count & (CA_TRACE_SIZE - 1)];
+    e->time = (uint64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+    e->subsystem = subsystem;
+    e->event = event;
+    e->pad = 0;
+    e->thread = ca_trace_thread;
+    e->args[0] = a;
+    e->args[1] = b;
+    atomic_store_explicit(&r->count, count + 1, memory_order_release);
+}
+
+CaError ca_trace_write(FILE *f)
+{
+    CaTraceRing *r;
+    uint64_t count, i;
+
+    if (fwrite(CA_TRACE_MAGIC, 8, 1, f) != 1) {
+        return CA_ERROR_IO;
+    }
+    for (r = atomic_load(&ca_trace_rings); r != NULL; r = r->next) {
+        count = atomic_load_explicit(&r->count, memory_order_acquire);
+        i = count > CA_TRACE_SIZE ? count - CA_TRACE_SIZE : 0;
+        for (; i < count; ++i) {
+            if (fwrite(&r->events[i & (CA_TRACE_SIZE - 1)],
+                       sizeof(CaTraceEvent), 1, f) != 1) {
+                return CA_ERROR_IO;
+            }
+        }
+    }
+    return CA_ERROR_OK;
+}
+
+int ca_trace_read(FILE *f, CaTraceEvent *e)
+{
+    return fread(e, sizeof(*e), 1, f) == 1;
+}
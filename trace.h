@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file trace.h
+ * \author Anamitra Ghorui
+ * \brief Event tracing
+ *
+ */
+
+/*
+ * Trace points record binary events: the subsystem and event they are in,
+ * a timestamp, and two arguments. Each trace point has a level, and only
+ * those at or under CA_TRACE_LEVEL are compiled at all, so with the default
+ * of 0 tracing costs nothing. Compiled trace points cost a load and a branch
+ * until tracing is turned on at runtime with ca_trace_enable.
+ *
+ * Each thread writes its events to its own ring buffer, which only keeps the
+ * last CA_TRACE_SIZE of them, so writing an event takes no lock and never
+ * allocates but the first time. ca_trace_write writes the buffers of all
+ * threads to a file, which trace_dump prints.
+ */
+
+#ifndef CA_TRACE_H
+#define CA_TRACE_H
+
+#include "types.h"
+#include "error.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/// Trace points compiled in: those of CA_TRACE_ERROR up to this level.
+#ifndef CA_TRACE_LEVEL
+#define CA_TRACE_LEVEL 0
+#endif
+
+#define CA_TRACE_ERROR 1 ///< Errors.
+#define CA_TRACE_INFO  2 ///< Expressions compiled and run.
+#define CA_TRACE_DEBUG 3 ///< Lookups and other frequent steps.
+
+/// Number of events kept by each thread. Must be a power of 2.
+#define CA_TRACE_SIZE 4096
+
+/// The first bytes of a trace file.
+#define CA_TRACE_MAGIC "CATRACE1"
+
+typedef enum CaTraceSubsystem {
+    CA_TRACE_HASH = 0,
+    CA_TRACE_EVAL,
+    CA_TRACE_VM,
+    CA_TRACE_CACHE,
+    CA_TRACE_JIT,
+    CA_TRACE_REACT,
+    CA_TRACE_SUBSYSTEM_COUNT
+} CaTraceSubsystem;
+
+/*
+ * Events, and what their arguments are. Any not given are 0.
+ */
+typedef enum CaTraceEventId {
+    CA_TRACE_HASH_GET = 0,     ///< Size of the key, its bucket.
+    CA_TRACE_HASH_PROBE,       ///< Size of the key probed, bucket.
+    CA_TRACE_HASH_MISS,        ///< Size of the key, bucket.
+    CA_TRACE_EVAL_COMPILE,     ///< Instructions, constants.
+    CA_TRACE_EVAL_ERROR,       ///< CaError, position in the expression.
+    CA_TRACE_VM_RUN,           ///< Instructions, depth.
+    CA_TRACE_VM_ERROR,         ///< CaError, instruction.
+    CA_TRACE_CACHE_HIT,        ///< Hash of the key, size of the key.
+    CA_TRACE_CACHE_MISS,       ///< Hash of the key, size of the key.
+    CA_TRACE_JIT_COMPILE,      ///< CaError, bytes of machine code.
+    CA_TRACE_REACT_UPDATE,     ///< Variables set, definitions to run.
+    CA_TRACE_EVENT_COUNT
+} CaTraceEventId;
+
+/// An event, as written to trace files.
+typedef struct CaTraceEvent {
+    uint64_t time;        ///< Nanoseconds, from an arbitrary start.
+    uint8_t subsystem;    ///< A CaTraceSubsystem.
+    uint8_t event;        ///< A CaTraceEventId.
+    uint16_t pad;
+    uint32_t thread;      ///< Index of the thread, from 0.
+    uint64_t args[2];
+} CaTraceEvent;
+
+/// Names of the subsystems and events.
+extern const char *const ca_trace_subsystem_names[CA_TRACE_SUBSYSTEM_COUNT];
+extern const char *const ca_trace_event_names[CA_TRACE_EVENT_COUNT];
+
+/// Whether events are recorded. Set with ca_trace_enable.
+extern int ca_trace_on;
+
+/**
+ * \brief Turns recording of events on or off.
+ * \param on Whether events are recorded.
+ */
+void ca_trace_enable(int on);
+
+/**
+ * \brief Records an event in the buffer of the calling thread. Use
+ *        CA_TRACE instead.
+ * \param subsystem A CaTraceSubsystem.
+ * \param event A CaTraceEventId.
+ * \param a The first argument.
+ * \param b The second argument.
+ */
+void ca_trace_event(CaTraceSubsystem subsystem, CaTraceEventId event,
+                    uint64_t a, uint64_t b);
+
+/**
+ * \brief Writes the events of every thread, oldest first in each, to a
+ *        file. The threads must not be recording events.
+ * \param f The file.
+ * \return An error code.
+ */
+CaError ca_trace_write(FILE *f);
+
+/**
+ * \brief Reads the next event of a file written by ca_trace_write.
+ * \param f The file, read from after the header.
+ * \param e The event.
+ * \return 1 if an event was read, 0 at the end of the file.
+ */
+int ca_trace_read(FILE *f, CaTraceEvent *e);
+
+/// Records event _event of subsystem _subsystem with arguments _a and _b, if
+/// _level is compiled in and tracing is on.
+#define CA_TRACE(_level, _subsystem, _event, _a, _b) do {                  \
+        if ((_level) <= CA_TRACE_LEVEL && ca_trace_on)                     \
+            ca_trace_event(CA_TRACE_##_subsystem,                         \
+                           CA_TRACE_##_subsystem##_##_event,               \
+                           (uint64_t) (_a), (uint64_t) (_b));              \
+    } while (0)
+
+#endif
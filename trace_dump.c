@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * \file trace_dump.c
+ * \author Anamitra Ghorui
+ * \brief Prints a trace file written by ca_trace_write
+ *
+ * Events of all threads are printed in the order they happened, one per
+ * line: the time in microseconds since the first, the thread, the event and
+ * its arguments.
+ */
+
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int ca_trace_cmp(const void *a, const void *b)
+{
+    const CaTraceEvent *x = a, *y = b;
+
+    if (x->time != y->time)
+        return x->time < y->time ? -1 : 1;
+    return (x->thread > y->thread) - (x->thread < y->thread);
+}
+
+int main(int argc, char **argv)
+{
+    CaTraceEvent *events = NULL, *p;
+    size_t count = 0, capacity = 0;
+    char magic[8];
+    const char *sub, *event;
+    FILE *f;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s trace\n", argv[0]);
+        return 1;
+    }
+    if (!(f = fopen(argv[1], "rb"))) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (fread(magic, 8, 1, f) != 1 || memcmp(magic, CA_TRACE_MAGIC, 8)) {
+        fprintf(stderr, "%s: not a trace file\n", argv[1]);
+        return 1;
+    }
+
+    for (;;) {
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : CA_TRACE_SIZE;
+            if (!(p = realloc(events, capacity * sizeof(*events)))) {
+                fprintf(stderr, "Out of memory\n");
+                return 1;
+            }
+            events = p;
+        }
+        if (!ca_trace_read(f, &events[count]))
+            break;
+        count++;
+    }
+    fclose(f);
+
+    qsort(events, count, sizeof(*events), ca_trace_cmp);
+    for (size_t i = 0; i < count; i++) {
+        p = &events[i];
+        sub = p->subsystem < CA_TRACE_SUBSYSTEM_COUNT ?
+              ca_trace_subsystem_names[p->subsystem] : "?";
+        event = p->event < CA_TRACE_EVENT_COUNT ?
+                ca_trace_event_names[p->event] : "?";
+        printf("%12.3f %3u %s.%s %lld %lld\n",
+               (p->time - events[0].time) / 1000.0, p->thread, sub, event,
+               (long long) p->args[0],
+               (long long) p->args[1]);
+    }
+    free(events);
+    return 0;
+}
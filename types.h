@@ -38,8 +38,21 @@ typedef int64_t CaInt;
 /// Default unsigned integer datatype.
 typedef uint64_t CaUint;
 
-/// Datatype for all real numbers.
+/*
+ * Datatype for all real numbers: a double, unless more precision is asked for
+ * at build time with CA_REAL_LONG_DOUBLE, or CA_REAL_FLOAT128 for an IEEE
+ * binary128, which needs libquadmath. Doubles take half the space of either,
+ * and only they have vector instructions. CA_REAL_DOUBLE is defined when
+ * CaReal is a double. See real.h for functions on CaReal.
+ */
+#if defined(CA_REAL_FLOAT128)
+typedef __float128 CaReal;
+#elif defined(CA_REAL_LONG_DOUBLE)
 typedef long double CaReal;
+#else
+#define CA_REAL_DOUBLE
+typedef double CaReal;
+#endif
 
 /// Default datatupe for any sort of "size" quantity.
 typedef size_t CaSize;
@@ -56,12 +69,14 @@ typedef enum CaType {
     CA_TYPE_UNKNOWN = 0,
     CA_TYPE_REAL,
     CA_TYPE_INT,
+    CA_TYPE_BIGINT,
     CA_TYPE_STRING,
     CA_TYPE_DICT,
     CA_TYPE_SET,
     CA_TYPE_LIST,
     CA_TYPE_TUPLE,
-    CA_TYPE_OBJ
+    CA_TYPE_OBJ,
+    CA_TYPE_COUNT
 } CaType;
 
 /// The type guessed by the tokeniser
@@ -77,33 +92,208 @@ typedef enum CaGuess {
     CA_GUESS_STRING
 } CaGuess;
 
+struct CaBigInt;
+
 typedef union CaValue {
     CaInt i;
     CaChar c;
     CaReal f;
+    struct CaBigInt *b;  ///< Owned by the CaVar (see bigint.h).
     CaObjPtr *p;
 } CaValue;
 
+/*
+ * A value and its type. By default this is a CaValue with a CaType next to
+ * it. With CA_NANBOX, which needs CaReal to be a double, both are packed into
+ * 8 bytes, a quarter of the size, by keeping every other type in the payload
+ * of a NaN:
+ *
+ * - A CaReal is kept as it is. NaNs that would read as a boxed value are
+ *   replaced by the default NaN.
+ * - Anything else has its top 13 bits set, which makes it a negative quiet
+ *   NaN, the type plus 1 in the next 4 bits, and a 47 bit payload below them.
+ *   The default NaN of x86, 0xFFF8000000000000, has a tag of 0, and is a
+ *   CaReal.
+ * - The payload of a CaInt is its low 47 bits, so only a CaInt for which
+ *   ca_var_int_fits is true may be kept. Larger ones are kept as a CaBigInt
+ *   (see std.h).
+ * - The payload of a pointer is its address, which assumes user space
+ *   addresses below 2^47, as on x86-64.
+ *
+ * Values are only read and written through the ca_var functions below, which
+ * work the same on either layout. Code that knows the type of a value from
+ * elsewhere, such as the VM with its stack, may read and write value.f and
+ * value.i directly, leaving the type alone.
+ */
+#if defined(CA_NANBOX)
+#ifndef CA_REAL_DOUBLE
+#error "CA_NANBOX needs CaReal to be a double"
+#endif
+
+/// Values at or above this are boxed.
+#define CA_NANBOX_MIN     UINT64_C(0xFFF8800000000000)
+/// Bits of the payload of a boxed value.
+#define CA_NANBOX_PAYLOAD ((UINT64_C(1) << 47) - 1)
+/// What NaNs that would read as boxed values are replaced by.
+#define CA_NANBOX_NAN     UINT64_C(0x7FF8000000000000)
+/// The top 17 bits of a value of type _t, which must not be CA_TYPE_REAL.
+#define CA_NANBOX_TAG(_t) (UINT64_C(0x1FFF0) | ((uint64_t) (_t) + 1))
+
+typedef union CaVar {
+    uint64_t bits;  ///< The value, boxed unless it is a CaReal.
+    CaValue value;  ///< The unboxed value, for a CaVar whose tag is not read.
+} CaVar;
+
+/// Initialiser of a CaVar that holds nothing.
+#define CA_VAR_UNKNOWN { .bits = CA_NANBOX_TAG(CA_TYPE_UNKNOWN) << 47 }
+
+/// Largest CaInt a CaVar can hold.
+#define CA_VAR_INT_MAX ((CaInt) (CA_NANBOX_PAYLOAD >> 1))
+/// Smallest CaInt a CaVar can hold.
+#define CA_VAR_INT_MIN (-CA_VAR_INT_MAX - 1)
+
+static inline CaType ca_var_type(const CaVar *v)
+{
+    return v->bits < CA_NANBOX_MIN ? CA_TYPE_REAL :
+           (CaType) ((v->bits >> 47 & 0xF) - 1);
+}
+
+static inline int ca_var_is(const CaVar *v, CaType t)
+{
+    return t == CA_TYPE_REAL ? v->bits < CA_NANBOX_MIN :
+                               v->bits >> 47 == CA_NANBOX_TAG(t);
+}
+
+static inline CaInt ca_var_int(const CaVar *v)
+{
+    return (CaInt) (v->bits << 17) >> 17;
+}
+
+static inline void *ca_var_ptr(const CaVar *v)
+{
+    return (void *) (uintptr_t) (v->bits & CA_NANBOX_PAYLOAD);
+}
+
+static inline void ca_var_set_real(CaVar *v, CaReal f)
+{
+    v->value.f = f;
+    if (v->bits >= CA_NANBOX_MIN)
+        v->bits = CA_NANBOX_NAN;
+}
+
+static inline void ca_var_set_int(CaVar *v, CaInt i)
+{
+    v->bits = CA_NANBOX_TAG(CA_TYPE_INT) << 47 |
+              ((uint64_t) i & CA_NANBOX_PAYLOAD);
+}
+
+static inline void ca_var_set_ptr(CaVar *v, CaType t, void *p)
+{
+    v->bits = CA_NANBOX_TAG(t) << 47 | (uint64_t) (uintptr_t) p;
+}
+
+static inline void ca_var_set_unknown(CaVar *v)
+{
+    v->bits = CA_NANBOX_TAG(CA_TYPE_UNKNOWN) << 47;
+}
+#else
 typedef struct CaVar {
     CaValue value;
     CaType type;
 } CaVar;
 
+/// Initialiser of a CaVar that holds nothing.
+#define CA_VAR_UNKNOWN { .type = CA_TYPE_UNKNOWN }
+
+/// Largest CaInt a CaVar can hold.
+#define CA_VAR_INT_MAX INT64_MAX
+/// Smallest CaInt a CaVar can hold.
+#define CA_VAR_INT_MIN INT64_MIN
+
+static inline CaType ca_var_type(const CaVar *v)
+{
+    return v->type;
+}
+
+static inline int ca_var_is(const CaVar *v, CaType t)
+{
+    return v->type == t;
+}
+
+static inline CaInt ca_var_int(const CaVar *v)
+{
+    return v->value.i;
+}
+
+static inline void *ca_var_ptr(const CaVar *v)
+{
+    return v->value.p;
+}
+
+static inline void ca_var_set_real(CaVar *v, CaReal f)
+{
+    v->value.f = f;
+    v->type    = CA_TYPE_REAL;
+}
+
+static inline void ca_var_set_int(CaVar *v, CaInt i)
+{
+    v->value.i = i;
+    v->type    = CA_TYPE_INT;
+}
+
+static inline void ca_var_set_ptr(CaVar *v, CaType t, void *p)
+{
+    v->value.p = p;
+    v->type    = t;
+}
+
+static inline void ca_var_set_unknown(CaVar *v)
+{
+    v->type = CA_TYPE_UNKNOWN;
+}
+#endif
+
+/// Whether a CaVar can hold CaInt i, rather than a CaBigInt of it.
+static inline int ca_var_int_fits(CaInt i)
+{
+    return i >= CA_VAR_INT_MIN && i <= CA_VAR_INT_MAX;
+}
+
+/// The CaReal a CaVar holds. Only valid for CA_TYPE_REAL.
+static inline CaReal ca_var_real(const CaVar *v)
+{
+    return v->value.f;
+}
+
+/// The CaBigInt a CaVar holds. Only valid for CA_TYPE_BIGINT.
+static inline struct CaBigInt *ca_var_bigint(const CaVar *v)
+{
+    return (struct CaBigInt *) ca_var_ptr(v);
+}
+
+/// Sets a CaVar to CaBigInt b, which it takes.
+static inline void ca_var_set_bigint(CaVar *v, struct CaBigInt *b)
+{
+    ca_var_set_ptr(v, CA_TYPE_BIGINT, b);
+}
+
 typedef union CaResult {
     CaInt i;
     CaReal r;
 } CaResult;
 
 
-#define ca_t_str(a)   ((a).type == CA_TYPE_STRING)
-#define ca_t_int(a)   ((a).type == CA_TYPE_INT)
-#define ca_t_real(a)  ((a).type == CA_TYPE_REAL)
-#define ca_t_dict(a)  ((a).type == CA_TYPE_DICT)
-#define ca_t_set(a)   ((a).type == CA_TYPE_SET)
-#define ca_t_list(a)  ((a).type == CA_TYPE_LIST)
-#define ca_t_tuple(a) ((a).type == CA_TYPE_TUPLE)
+#define ca_t_str(a)   ca_var_is(&(a), CA_TYPE_STRING)
+#define ca_t_int(a)   ca_var_is(&(a), CA_TYPE_INT)
+#define ca_t_bigint(a) ca_var_is(&(a), CA_TYPE_BIGINT)
+#define ca_t_real(a)  ca_var_is(&(a), CA_TYPE_REAL)
+#define ca_t_dict(a)  ca_var_is(&(a), CA_TYPE_DICT)
+#define ca_t_set(a)   ca_var_is(&(a), CA_TYPE_SET)
+#define ca_t_list(a)  ca_var_is(&(a), CA_TYPE_LIST)
+#define ca_t_tuple(a) ca_var_is(&(a), CA_TYPE_TUPLE)
 
 // May change later
-#define ca_t_obj(a)   ((a).type == CA_TYPE_OBJ)
+#define ca_t_obj(a)   ca_var_is(&(a), CA_TYPE_OBJ)
 #define ca_objtype(a) (((void *) (a).value)->type)
 #endif
@@ -0,0 +1,679 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file vm.c
+ * \author Anamitra Ghorui
+ * \brief Bytecode interpreter
+ */
+
+#include "vm.h"
+#include "std.h"
+#include "real.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The data stack is kept in sp while code runs. The compiler records how deep
+ * the stack gets, so the stack is grown once before the code runs rather than
+ * checked on every push. Temporaries are kept at the other end of the stack,
+ * out of the way of the values. In the same way, vars is grown to cover every
+ * symbol before the code runs, so loads and stores index it by symbol ID with
+ * no bounds check, and a store is a plain write.
+ *
+ * With CA_VM_THREADED, every handler jumps straight to the handler of the
+ * next instruction through a table of label addresses, so that each has its
+ * own indirect branch for the branch predictor to learn, instead of all of
+ * them sharing the one of a switch. The handlers are the same either way, and
+ * only the CASE, DISPATCH and NEXT macros differ.
+ *
+ * Typed code (see infer.h) keeps CaInt values in the same stack slots as
+ * CaReal values. The type of every value is known from the code, so the VM
+ * leaves the type tags of the slots alone, and slots are only read as the
+ * type they were written as.
+ */
+
+/* Largest number of arguments to a builtin that are passed from the stack
+ * without allocating. */
+#define CA_VM_ARGS 8
+
+#if CA_VM_THREADED
+#define CASE(_op) L_##_op
+#define DISPATCH() goto *ca_vm_labels[ip->op]
+#define LABEL(_op) [CA_OPCODE_##_op] = &&L_##_op
+#else
+#define CASE(_op) case CA_OPCODE_##_op
+#define DISPATCH() goto dispatch
+#endif
+
+/* Moves on to the next instruction. */
+#define NEXT() do { ip++; DISPATCH(); } while (0)
+
+/* Moves on to instruction _index. */
+#define JUMP(_index) do { ip = code->instrs + (_index); DISPATCH(); } while (0)
+
+/* Applies a binary operator to a and b, and pops b. */
+#define BINARY(_expr) do {        \
+        CaReal a = sp[-2].value.f;\
+        CaReal b = sp[-1].value.f;\
+        sp[-2].value.f = (_expr); \
+        sp--;                     \
+        NEXT();                   \
+    } while (0)
+
+/* The CaInt value in a stack slot. */
+static inline CaInt ca_vm_int(const CaVar *slot)
+{
+    return slot->value.i;
+}
+
+static inline void ca_vm_set_int(CaVar *slot, CaInt i)
+{
+    slot->value.i = i;
+}
+
+/* Calls builtin f on the n values from args, and leaves the result in args.
+ * Builtins take an array of CaReal, so the values are copied out of their
+ * slots first. */
+static CaError ca_vm_call(const CaBuiltin *f, CaVar *args, CaSize n)
+{
+    CaReal buf[CA_VM_ARGS], *a = buf;
+    CaSize i;
+
+    if (n > CA_VM_ARGS && !(a = malloc(n * sizeof(CaReal))))
+        return CA_ERROR_MEM;
+    for (i = 0; i < n; i++)
+        a[i] = args[i].value.f;
+    args->value.f = f->func(a);
+    if (a != buf)
+        free(a);
+    return CA_ERROR_OK;
+}
+
+/* Sets CaInt _r to _a _op _b, where _op is add, sub or mul, and fails with
+ * CA_ERROR_EVAL_OVERFLOW if it overflows, for the code to be run again on
+ * exact integers (see exact.h). */
+#define CHECK(_op, _a, _b, _r) do {                             \
+        if (__builtin_##_op##_overflow((_a), (_b), &(_r)))      \
+            goto overflow;                                      \
+    } while (0)
+
+/* Applies checked operator _op to CaInt a and b, and pops b. */
+#define BINARY_CHECKED(_op) do {                                \
+        CHECK(_op, ca_vm_int(sp - 2), ca_vm_int(sp - 1), v);    \
+        ca_vm_set_int(sp - 2, v);                               \
+        sp--;                                                   \
+        NEXT();                                                 \
+    } while (0)
+
+/* Applies checked operator _op to CaInt b and _x. */
+#define UPDATE_CHECKED(_op, _x) do {                            \
+        CHECK(_op, ca_vm_int(sp - 1), (_x), v);                 \
+        ca_vm_set_int(sp - 1, v);                               \
+        NEXT();                                                 \
+    } while (0)
+
+/* Applies a binary operator to CaInt a and b, and pops b. */
+#define BINARY_INT(_expr) do {                  \
+        CaInt a = ca_vm_int(sp - 2);            \
+        CaInt b = ca_vm_int(sp - 1);            \
+        ca_vm_set_int(sp - 2, (_expr));         \
+        sp--;                                   \
+        NEXT();                                 \
+    } while (0)
+
+/* Value of variable arg, which is set, as a CaReal. */
+#define VAR_REAL() ca_std_real(&c->vars[ip->arg])
+
+/* Applies a binary operator to b and constant arg. */
+#define BINARY_CONST(_op) do {                          \
+        sp[-1].value.f = sp[-1].value.f _op             \
+                         code->consts[ip->arg];         \
+        NEXT();                                         \
+    } while (0)
+
+/* Applies a binary operator to b and variable arg. */
+#define BINARY_VAR(_op) do {                            \
+        LOAD_CHECK();                                   \
+        sp[-1].value.f = sp[-1].value.f _op VAR_REAL(); \
+        NEXT();                                         \
+    } while (0)
+
+/* Fails unless variable arg is set. */
+#define LOAD_CHECK() do {                                                  \
+        if (ca_var_is(&c->vars[ip->arg], CA_TYPE_UNKNOWN)) {               \
+            err = ca_vm_error(c, ip->arg, CA_ERROR_HASH_NOTFOUND);         \
+            goto fail;                                                     \
+        }                                                                  \
+    } while (0)
+
+/* Compares CaInt a and b, and jumps to arg, leaving the result, if it is
+ * _jump. */
+#define COMPARE_JUMP_INT(_op, _jump) do {                       \
+        int _cmp = ca_vm_int(sp - 2) _op ca_vm_int(sp - 1);     \
+        sp -= 2;                                                \
+        if (_cmp == (_jump)) {                                  \
+            ca_vm_set_int(sp++, _cmp);                          \
+            JUMP(ip->arg);                                      \
+        }                                                       \
+        NEXT();                                                 \
+    } while (0)
+
+/* Sets variable arg to CaReal _value. */
+#define STORE(_value) ca_var_set_real(&c->vars[ip->arg], (_value))
+
+/* Sets variable arg to CaInt _value, which overflows if it is too large for
+ * a CaVar, as can only happen with CA_NANBOX. */
+#define STORE_INT(_value) do {                                          \
+        CaInt _v = (_value);                                            \
+        if (!ca_var_int_fits(_v))                                       \
+            goto overflow;                                              \
+        ca_var_set_int(&c->vars[ip->arg], _v);                          \
+    } while (0)
+
+/* Value of variable arg, which is a CaInt. */
+#define VAR_INT() ca_var_int(&c->vars[ip->arg])
+
+/* Compares a and b, and jumps to arg, leaving the result, if it is _jump. */
+#define COMPARE_JUMP(_op, _jump) do {   \
+        int _cmp = sp[-2].value.f _op   \
+                   sp[-1].value.f;      \
+        sp -= 2;                        \
+        if (_cmp == (_jump)) {          \
+            sp++->value.f = _cmp;       \
+            JUMP(ip->arg);              \
+        }                               \
+        NEXT();                         \
+    } while (0)
+
+static CaError ca_vm_error(CaContext *c, CaSymbol name, CaError err)
+{
+    c->error = ca_symbols_name(&c->symbols, name, &c->error_size);
+    return err;
+}
+
+CaError ca_vm_run(CaContext *c, const CaCode *code)
+{
+#if CA_VM_THREADED
+    static const void *const ca_vm_labels[256] = {
+        [0 ... 255] = &&L_INVALID,
+        LABEL(END),
+        LABEL(PUSH_CONST),
+        LABEL(LOAD),
+        LABEL(STORE),
+        LABEL(POP),
+        LABEL(POST_INC),
+        LABEL(POST_DEC),
+        LABEL(POWER),
+        LABEL(MULTIPLICATION),
+        LABEL(DIVISION),
+        LABEL(REMAINDER),
+        LABEL(ADDITION),
+        LABEL(SUBTRACTION),
+        LABEL(LSHIFT),
+        LABEL(RSHIFT),
+        LABEL(LT),
+        LABEL(LTEQ),
+        LABEL(GT),
+        LABEL(GTEQ),
+        LABEL(EQ),
+        LABEL(NEQ),
+        LABEL(B_AND),
+        LABEL(B_XOR),
+        LABEL(B_OR),
+        LABEL(BOOL),
+        LABEL(JUMP),
+        LABEL(JUMP_FALSE_OR_POP),
+        LABEL(JUMP_TRUE_OR_POP),
+        LABEL(EXT_CALL),
+        LABEL(ADD_CONST),
+        LABEL(SUB_CONST),
+        LABEL(MUL_CONST),
+        LABEL(DIV_CONST),
+        LABEL(ADD_VAR),
+        LABEL(SUB_VAR),
+        LABEL(MUL_VAR),
+        LABEL(DIV_VAR),
+        LABEL(MUL_ADD),
+        LABEL(MUL_ADD_VAR),
+        LABEL(SQUARE),
+        LABEL(CUBE),
+        LABEL(INC_VAR),
+        LABEL(STORE_POP),
+        LABEL(LT_JUMP_FALSE),
+        LABEL(LTEQ_JUMP_FALSE),
+        LABEL(GT_JUMP_FALSE),
+        LABEL(GTEQ_JUMP_FALSE),
+        LABEL(EQ_JUMP_FALSE),
+        LABEL(NEQ_JUMP_FALSE),
+        LABEL(LT_JUMP_TRUE),
+        LABEL(LTEQ_JUMP_TRUE),
+        LABEL(GT_JUMP_TRUE),
+        LABEL(GTEQ_JUMP_TRUE),
+        LABEL(EQ_JUMP_TRUE),
+        LABEL(NEQ_JUMP_TRUE),
+        LABEL(SAVE_TEMP),
+        LABEL(LOAD_TEMP),
+        LABEL(I_PUSH_CONST),
+        LABEL(I_LOAD),
+        LABEL(I_STORE),
+        LABEL(I_POST_INC),
+        LABEL(I_POST_DEC),
+        LABEL(I_POWER),
+        LABEL(I_MULTIPLICATION),
+        LABEL(I_REMAINDER),
+        LABEL(I_ADDITION),
+        LABEL(I_SUBTRACTION),
+        LABEL(I_LSHIFT),
+        LABEL(I_RSHIFT),
+        LABEL(I_LT),
+        LABEL(I_LTEQ),
+        LABEL(I_GT),
+        LABEL(I_GTEQ),
+        LABEL(I_EQ),
+        LABEL(I_NEQ),
+        LABEL(I_B_AND),
+        LABEL(I_B_XOR),
+        LABEL(I_B_OR),
+        LABEL(I_BOOL),
+        LABEL(I_JUMP_FALSE_OR_POP),
+        LABEL(I_JUMP_TRUE_OR_POP),
+        LABEL(I_ADD_CONST),
+        LABEL(I_SUB_CONST),
+        LABEL(I_MUL_CONST),
+        LABEL(I_ADD_VAR),
+        LABEL(I_SUB_VAR),
+        LABEL(I_MUL_VAR),
+        LABEL(I_MUL_ADD),
+        LABEL(I_MUL_ADD_VAR),
+        LABEL(I_SQUARE),
+        LABEL(I_CUBE),
+        LABEL(I_INC_VAR),
+        LABEL(I_STORE_POP),
+        LABEL(I_LT_JUMP_FALSE),
+        LABEL(I_LTEQ_JUMP_FALSE),
+        LABEL(I_GT_JUMP_FALSE),
+        LABEL(I_GTEQ_JUMP_FALSE),
+        LABEL(I_EQ_JUMP_FALSE),
+        LABEL(I_NEQ_JUMP_FALSE),
+        LABEL(I_LT_JUMP_TRUE),
+        LABEL(I_LTEQ_JUMP_TRUE),
+        LABEL(I_GT_JUMP_TRUE),
+        LABEL(I_GTEQ_JUMP_TRUE),
+        LABEL(I_EQ_JUMP_TRUE),
+        LABEL(I_NEQ_JUMP_TRUE),
+        LABEL(TO_REAL),
+        LABEL(TO_INT),
+    };
+#endif
+    const CaInstr *ip = code->instrs;
+    CaVar *base, *sp, *temps;
+    const CaBuiltin *f;
+    CaError err;
+    CaInt v;
+
+    if ((err = ca_stack_reserve(c->expr, c->expr->top + code->depth +
+                                code->ntemps)) != CA_ERROR_OK ||
+        (err = ca_context_reserve(c)) != CA_ERROR_OK)
+        return err;
+    base = c->expr->data;
+    sp = base + c->expr->top;
+    temps = base + c->expr->size - code->ntemps;
+    c->error = NULL;
+
+    DISPATCH();
+#if !CA_VM_THREADED
+dispatch:
+    switch ((CaOpcode) ip->op) {
+#endif
+    CASE(END):
+        c->expr->top = sp - base;
+        return CA_ERROR_OK;
+
+    CASE(PUSH_CONST):
+        sp++->value.f = code->consts[ip->arg];
+        NEXT();
+
+    CASE(LOAD):
+        LOAD_CHECK();
+        sp++->value.f = VAR_REAL();
+        NEXT();
+
+    CASE(STORE):
+        STORE(sp[-1].value.f);
+        NEXT();
+
+    CASE(POP):
+        sp--;
+        NEXT();
+
+    CASE(POST_INC):
+        STORE(sp[-1].value.f + 1);
+        NEXT();
+
+    CASE(POST_DEC):
+        STORE(sp[-1].value.f - 1);
+        NEXT();
+
+    CASE(POWER):
+        BINARY(ca_real_pow(a, b));
+    CASE(MULTIPLICATION):
+        BINARY(a * b);
+    CASE(DIVISION):
+        BINARY(a / b);
+    CASE(REMAINDER):
+        BINARY(ca_real_fmod(a, b));
+    CASE(ADDITION):
+        BINARY(a + b);
+    CASE(SUBTRACTION):
+        BINARY(a - b);
+    CASE(LSHIFT):
+        BINARY((CaInt) ((CaUint) ca_real_to_int(a) <<
+                        (ca_real_to_int(b) & 63)));
+    CASE(RSHIFT):
+        BINARY(ca_real_to_int(a) >> (ca_real_to_int(b) & 63));
+    CASE(LT):
+        BINARY(a < b);
+    CASE(LTEQ):
+        BINARY(a <= b);
+    CASE(GT):
+        BINARY(a > b);
+    CASE(GTEQ):
+        BINARY(a >= b);
+    CASE(EQ):
+        BINARY(a == b);
+    CASE(NEQ):
+        BINARY(a != b);
+    CASE(B_AND):
+        BINARY(ca_real_to_int(a) & ca_real_to_int(b));
+    CASE(B_XOR):
+        BINARY(ca_real_to_int(a) ^ ca_real_to_int(b));
+    CASE(B_OR):
+        BINARY(ca_real_to_int(a) | ca_real_to_int(b));
+
+    CASE(BOOL):
+        sp[-1].value.f = sp[-1].value.f != 0;
+        NEXT();
+
+    CASE(JUMP):
+        JUMP(ip->arg);
+    CASE(JUMP_FALSE_OR_POP):
+        if (sp[-1].value.f == 0)
+            JUMP(ip->arg);
+        sp--;
+        NEXT();
+    CASE(JUMP_TRUE_OR_POP):
+        if (sp[-1].value.f != 0)
+            JUMP(ip->arg);
+        sp--;
+        NEXT();
+
+    CASE(EXT_CALL):
+        f = ip->arg < c->nfuncs ? &c->funcs[ip->arg] : NULL;
+        if (!f || !f->func || f->nargs != ip->n) {
+            err = ca_vm_error(c, ip->arg, f && f->func ?
+                              CA_ERROR_EVAL_ARGS :
+                              CA_ERROR_EVAL_UNKNOWN_FUNCTION);
+            goto fail;
+        }
+        sp -= ip->n;
+        if ((err = ca_vm_call(f, sp, ip->n)) != CA_ERROR_OK)
+            goto fail;
+        sp++;
+        NEXT();
+
+    CASE(ADD_CONST):
+        BINARY_CONST(+);
+    CASE(SUB_CONST):
+        BINARY_CONST(-);
+    CASE(MUL_CONST):
+        BINARY_CONST(*);
+    CASE(DIV_CONST):
+        BINARY_CONST(/);
+    CASE(ADD_VAR):
+        BINARY_VAR(+);
+    CASE(SUB_VAR):
+        BINARY_VAR(-);
+    CASE(MUL_VAR):
+        BINARY_VAR(*);
+    CASE(DIV_VAR):
+        BINARY_VAR(/);
+
+    CASE(MUL_ADD):
+        sp[-3].value.f = sp[-3].value.f + sp[-2].value.f * sp[-1].value.f;
+        sp -= 2;
+        NEXT();
+    CASE(MUL_ADD_VAR):
+        LOAD_CHECK();
+        sp[-2].value.f = sp[-2].value.f + sp[-1].value.f * VAR_REAL();
+        sp--;
+        NEXT();
+    CASE(SQUARE):
+        sp[-1].value.f = sp[-1].value.f * sp[-1].value.f;
+        NEXT();
+    CASE(CUBE):
+        sp[-1].value.f = sp[-1].value.f * sp[-1].value.f * sp[-1].value.f;
+        NEXT();
+
+    CASE(INC_VAR):
+        LOAD_CHECK();
+        STORE(VAR_REAL() + code->consts[ip->n]);
+        sp++->value.f = c->vars[ip->arg].value.f;
+        NEXT();
+
+    CASE(STORE_POP):
+        STORE((--sp)->value.f);
+        NEXT();
+
+    CASE(LT_JUMP_FALSE):
+        COMPARE_JUMP(<, 0);
+    CASE(LTEQ_JUMP_FALSE):
+        COMPARE_JUMP(<=, 0);
+    CASE(GT_JUMP_FALSE):
+        COMPARE_JUMP(>, 0);
+    CASE(GTEQ_JUMP_FALSE):
+        COMPARE_JUMP(>=, 0);
+    CASE(EQ_JUMP_FALSE):
+        COMPARE_JUMP(==, 0);
+    CASE(NEQ_JUMP_FALSE):
+        COMPARE_JUMP(!=, 0);
+    CASE(LT_JUMP_TRUE):
+        COMPARE_JUMP(<, 1);
+    CASE(LTEQ_JUMP_TRUE):
+        COMPARE_JUMP(<=, 1);
+    CASE(GT_JUMP_TRUE):
+        COMPARE_JUMP(>, 1);
+    CASE(GTEQ_JUMP_TRUE):
+        COMPARE_JUMP(>=, 1);
+    CASE(EQ_JUMP_TRUE):
+        COMPARE_JUMP(==, 1);
+    CASE(NEQ_JUMP_TRUE):
+        COMPARE_JUMP(!=, 1);
+
+    /* Temporaries may hold CaInt values in typed code, so they are copied
+     * as they are. */
+    CASE(SAVE_TEMP):
+        temps[ip->arg] = sp[-1];
+        NEXT();
+    CASE(LOAD_TEMP):
+        *sp++ = temps[ip->arg];
+        NEXT();
+
+    /* Typed code only reads variables it has checked the types of, so
+     * integer instructions do no checks. */
+    CASE(I_PUSH_CONST):
+        ca_vm_set_int(sp++, code->iconsts[ip->arg]);
+        NEXT();
+    CASE(I_LOAD):
+        ca_vm_set_int(sp++, VAR_INT());
+        NEXT();
+    CASE(I_STORE):
+        STORE_INT(ca_vm_int(sp - 1));
+        NEXT();
+    CASE(I_STORE_POP):
+        STORE_INT(ca_vm_int(--sp));
+        NEXT();
+    CASE(I_POST_INC):
+        CHECK(add, ca_vm_int(sp - 1), 1, v);
+        STORE_INT(v);
+        NEXT();
+    CASE(I_POST_DEC):
+        CHECK(sub, ca_vm_int(sp - 1), 1, v);
+        STORE_INT(v);
+        NEXT();
+
+    CASE(I_POWER):
+        if (ca_std_int_pow(ca_vm_int(sp - 2), ca_vm_int(sp - 1), &v))
+            goto overflow;
+        ca_vm_set_int(sp - 2, v);
+        sp--;
+        NEXT();
+    CASE(I_MULTIPLICATION):
+        BINARY_CHECKED(mul);
+    CASE(I_REMAINDER):
+        /* INT64_MIN % -1 overflows, though the remainder is 0. */
+        if (!ca_vm_int(sp - 1))
+            goto overflow;
+        BINARY_INT(b == -1 ? 0 : a % b);
+    CASE(I_ADDITION):
+        BINARY_CHECKED(add);
+    CASE(I_SUBTRACTION):
+        BINARY_CHECKED(sub);
+    CASE(I_LSHIFT):
+        BINARY_INT((CaInt) ((CaUint) a << (b & 63)));
+    CASE(I_RSHIFT):
+        BINARY_INT(a >> (b & 63));
+    CASE(I_LT):
+        BINARY_INT(a < b);
+    CASE(I_LTEQ):
+        BINARY_INT(a <= b);
+    CASE(I_GT):
+        BINARY_INT(a > b);
+    CASE(I_GTEQ):
+        BINARY_INT(a >= b);
+    CASE(I_EQ):
+        BINARY_INT(a == b);
+    CASE(I_NEQ):
+        BINARY_INT(a != b);
+    CASE(I_B_AND):
+        BINARY_INT(a & b);
+    CASE(I_B_XOR):
+        BINARY_INT(a ^ b);
+    CASE(I_B_OR):
+        BINARY_INT(a | b);
+
+    CASE(I_BOOL):
+        ca_vm_set_int(sp - 1, ca_vm_int(sp - 1) != 0);
+        NEXT();
+    CASE(I_JUMP_FALSE_OR_POP):
+        if (ca_vm_int(sp - 1) == 0)
+            JUMP(ip->arg);
+        sp--;
+        NEXT();
+    CASE(I_JUMP_TRUE_OR_POP):
+        if (ca_vm_int(sp - 1) != 0)
+            JUMP(ip->arg);
+        sp--;
+        NEXT();
+
+    CASE(I_ADD_CONST):
+        UPDATE_CHECKED(add, code->iconsts[ip->arg]);
+    CASE(I_SUB_CONST):
+        UPDATE_CHECKED(sub, code->iconsts[ip->arg]);
+    CASE(I_MUL_CONST):
+        UPDATE_CHECKED(mul, code->iconsts[ip->arg]);
+    CASE(I_ADD_VAR):
+        UPDATE_CHECKED(add, VAR_INT());
+    CASE(I_SUB_VAR):
+        UPDATE_CHECKED(sub, VAR_INT());
+    CASE(I_MUL_VAR):
+        UPDATE_CHECKED(mul, VAR_INT());
+    CASE(I_MUL_ADD):
+        CHECK(mul, ca_vm_int(sp - 2), ca_vm_int(sp - 1), v);
+        CHECK(add, ca_vm_int(sp - 3), v, v);
+        ca_vm_set_int(sp - 3, v);
+        sp -= 2;
+        NEXT();
+    CASE(I_MUL_ADD_VAR):
+        CHECK(mul, ca_vm_int(sp - 1), VAR_INT(), v);
+        CHECK(add, ca_vm_int(sp - 2), v, v);
+        ca_vm_set_int(sp - 2, v);
+        sp--;
+        NEXT();
+    CASE(I_SQUARE):
+        UPDATE_CHECKED(mul, ca_vm_int(sp - 1));
+    CASE(I_CUBE):
+        CHECK(mul, ca_vm_int(sp - 1), ca_vm_int(sp - 1), v);
+        UPDATE_CHECKED(mul, v);
+    CASE(I_INC_VAR):
+        CHECK(add, VAR_INT(), code->iconsts[ip->n], v);
+        STORE_INT(v);
+        ca_vm_set_int(sp++, v);
+        NEXT();
+
+    CASE(I_LT_JUMP_FALSE):
+        COMPARE_JUMP_INT(<, 0);
+    CASE(I_LTEQ_JUMP_FALSE):
+        COMPARE_JUMP_INT(<=, 0);
+    CASE(I_GT_JUMP_FALSE):
+        COMPARE_JUMP_INT(>, 0);
+    CASE(I_GTEQ_JUMP_FALSE):
+        COMPARE_JUMP_INT(>=, 0);
+    CASE(I_EQ_JUMP_FALSE):
+        COMPARE_JUMP_INT(==, 0);
+    CASE(I_NEQ_JUMP_FALSE):
+        COMPARE_JUMP_INT(!=, 0);
+    CASE(I_LT_JUMP_TRUE):
+        COMPARE_JUMP_INT(<, 1);
+    CASE(I_LTEQ_JUMP_TRUE):
+        COMPARE_JUMP_INT(<=, 1);
+    CASE(I_GT_JUMP_TRUE):
+        COMPARE_JUMP_INT(>, 1);
+    CASE(I_GTEQ_JUMP_TRUE):
+        COMPARE_JUMP_INT(>=, 1);
+    CASE(I_EQ_JUMP_TRUE):
+        COMPARE_JUMP_INT(==, 1);
+    CASE(I_NEQ_JUMP_TRUE):
+        COMPARE_JUMP_INT(!=, 1);
+
+    CASE(TO_REAL):
+        sp[-(long) ip->arg].value.f = ca_vm_int(sp - ip->arg);
+        NEXT();
+    CASE(TO_INT):
+        ca_vm_set_int(sp - ip->arg,
+                      ca_real_to_int(sp[-(long) ip->arg].value.f));
+        NEXT();
+
+#if CA_VM_THREADED
+    L_INVALID:
+#else
+    default:
+        break;
+    }
+#endif
+    err = CA_ERROR_EVAL;
+    goto fail;
+
+overflow:
+    err = CA_ERROR_EVAL_OVERFLOW;
+
+fail:
+    c->expr->top = sp - base;
+    return err;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2020 Anamitra Ghorui
+ * This file is part of Calcium.
+ *
+ * Calcium is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Calcium is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Calcium.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file vm.h
+ * \author Anamitra Ghorui
+ * \brief Bytecode interpreter
+ *
+ */
+
+#ifndef CA_VM_H
+#define CA_VM_H
+
+#include "eval.h"
+#include "command_stack.h"
+#include "error.h"
+
+/*
+ * Instructions are dispatched with computed gotos where the compiler supports
+ * them, and with a switch otherwise. Defining CA_VM_SWITCH selects the switch
+ * regardless.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(CA_VM_SWITCH)
+#define CA_VM_THREADED 1
+#else
+#define CA_VM_THREADED 0
+#endif
+
+/**
+ * \brief Runs code on the expr stack of a context, until CA_OPCODE_END. Values
+ *        already on the stack are kept, so code may be run in parts.
+ * \param c The context the code was compiled for.
+ * \param code The code.
+ * \return An error code. On an error, c->error is set to the name of the
+ *         variable or builtin at fault, if any, else NULL.
+ */
+CaError ca_vm_run(CaContext *c, const CaCode *code);
+
+#endif